@@ -0,0 +1,778 @@
+#include <math.h>
+#include "aggregate.h"
+#include "library.h"
+
+// Room for the text of one key or aggregate value
+#define VALUE_LENGTH 128
+
+// How a field value is shown
+typedef enum {
+    FIELD_NUMBER,
+    FIELD_SYMBOL,               // Interned string
+    FIELD_GENDER,
+    FIELD_MONTH                 // year * 12 + month - 1
+} FieldType;
+
+// The row a field is read from: a book, a reader or a borrowing. Book
+// fields read the book row, which for loans comes from the book join.
+typedef struct {
+    int row;
+    int book;
+} AggregateRow;
+
+// Returns the value of a field, NAN if the row has none
+typedef double (*FieldValue)(const AggregateRow *row);
+
+typedef struct {
+    const char *name;
+    FieldValue value;
+    FieldType type;
+    int readsBook;              // Needs the book of the row to be looked up
+} AggregateField;
+
+typedef struct {
+    const char *name;
+    const AggregateField *fields;
+    int fieldCount;
+} AggregateTable;
+
+// Time fines are worked out at, fixed for one run
+static time_t aggregationTime;
+
+static double monthOfTime(time_t time) {
+    int year, month, day;
+    civilFromDays(dayFromTime(time), &year, &month, &day);
+    return year * 12.0 + month - 1;
+}
+
+static double yearOfTime(time_t time) {
+    int year, month, day;
+    civilFromDays(dayFromTime(time), &year, &month, &day);
+    return year;
+}
+
+static const Book *rowBook(const AggregateRow *row) { return row->book == -1 ? NULL : bookAt(row->book); }
+
+static double bookISBNValue(const AggregateRow *row) { return rowBook(row) ? (double)rowBook(row)->ISBN : NAN; }
+static double bookAuthorValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->author : NAN; }
+static double bookPublisherValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->publisher : NAN; }
+static double bookYearValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->publishYear : NAN; }
+static double bookCategoryValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->category : NAN; }
+static double bookPriceValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->price : NAN; }
+static double bookQuantityValue(const AggregateRow *row) { return rowBook(row) ? rowBook(row)->quantity : NAN; }
+static double bookStockValue(const AggregateRow *row) {
+    return rowBook(row) ? (double)rowBook(row)->price * rowBook(row)->quantity : NAN;
+}
+
+static const AggregateField bookFields[] = {
+    { "ISBN", bookISBNValue, FIELD_NUMBER, 1 },
+    { "author", bookAuthorValue, FIELD_SYMBOL, 1 },
+    { "publisher", bookPublisherValue, FIELD_SYMBOL, 1 },
+    { "year", bookYearValue, FIELD_NUMBER, 1 },
+    { "category", bookCategoryValue, FIELD_SYMBOL, 1 },
+    { "price", bookPriceValue, FIELD_NUMBER, 1 },
+    { "quantity", bookQuantityValue, FIELD_NUMBER, 1 },
+    { "stockValue", bookStockValue, FIELD_NUMBER, 1 },
+};
+
+static double readerIDValue(const AggregateRow *row) { return readerAt(row->row)->ID; }
+static double readerGenderValue(const AggregateRow *row) { return readerAt(row->row)->gender; }
+static double readerMembershipYearValue(const AggregateRow *row) { return readerAt(row->row)->membershipYear; }
+static double readerBirthYearValue(const AggregateRow *row) {
+    int birthDate = readerAt(row->row)->birthDate;
+    if (birthDate == DATE_UNKNOWN) {
+        return NAN;
+    }
+    int year, month, day;
+    civilFromDays(birthDate, &year, &month, &day);
+    return year;
+}
+
+static const AggregateField readerFields[] = {
+    { "ID", readerIDValue, FIELD_NUMBER, 0 },
+    { "gender", readerGenderValue, FIELD_GENDER, 0 },
+    { "membershipYear", readerMembershipYearValue, FIELD_NUMBER, 0 },
+    { "birthYear", readerBirthYearValue, FIELD_NUMBER, 0 },
+};
+
+static double loanReaderIDValue(const AggregateRow *row) { return borrowingAt(row->row)->readerID; }
+static double loanMonthValue(const AggregateRow *row) { return monthOfTime(borrowingAt(row->row)->borrowingDate); }
+static double loanYearValue(const AggregateRow *row) { return yearOfTime(borrowingAt(row->row)->borrowingDate); }
+static double loanDueMonthValue(const AggregateRow *row) { return monthOfTime(borrowingAt(row->row)->dueDate); }
+static double loanReturnedValue(const AggregateRow *row) { return borrowingAt(row->row)->isReturned; }
+static double loanBookCountValue(const AggregateRow *row) { return borrowingAt(row->row)->bookCount; }
+// Fine charged on return, or owed so far if the books are still out
+static double loanFineValue(const AggregateRow *row) {
+    const Borrowing *borrowing = borrowingAt(row->row);
+    return calculateFine(borrowing->dueDate, borrowing->isReturned ? borrowing->returnDate : aggregationTime);
+}
+
+static const AggregateField borrowingFields[] = {
+    { "readerID", loanReaderIDValue, FIELD_NUMBER, 0 },
+    { "month", loanMonthValue, FIELD_MONTH, 0 },
+    { "year", loanYearValue, FIELD_NUMBER, 0 },
+    { "dueMonth", loanDueMonthValue, FIELD_MONTH, 0 },
+    { "returned", loanReturnedValue, FIELD_NUMBER, 0 },
+    { "books", loanBookCountValue, FIELD_NUMBER, 0 },
+    { "fine", loanFineValue, FIELD_NUMBER, 0 },
+};
+
+// The fields of a borrowing followed by those of the book lent
+static const AggregateField loanFields[] = {
+    { "readerID", loanReaderIDValue, FIELD_NUMBER, 0 },
+    { "month", loanMonthValue, FIELD_MONTH, 0 },
+    { "year", loanYearValue, FIELD_NUMBER, 0 },
+    { "dueMonth", loanDueMonthValue, FIELD_MONTH, 0 },
+    { "returned", loanReturnedValue, FIELD_NUMBER, 0 },
+    { "fine", loanFineValue, FIELD_NUMBER, 0 },
+    { "ISBN", bookISBNValue, FIELD_NUMBER, 1 },
+    { "author", bookAuthorValue, FIELD_SYMBOL, 1 },
+    { "publisher", bookPublisherValue, FIELD_SYMBOL, 1 },
+    { "publishYear", bookYearValue, FIELD_NUMBER, 1 },
+    { "category", bookCategoryValue, FIELD_SYMBOL, 1 },
+    { "price", bookPriceValue, FIELD_NUMBER, 1 },
+};
+
+#define FIELDS(fields) fields, (int)(sizeof(fields) / sizeof(fields[0]))
+
+// In the order of aggregateTables
+enum { TABLE_BOOKS, TABLE_READERS, TABLE_BORROWINGS, TABLE_LOANS };
+
+static const AggregateTable aggregateTables[] = {
+    { "books", FIELDS(bookFields) },
+    { "readers", FIELDS(readerFields) },
+    { "borrowings", FIELDS(borrowingFields) },
+    { "loans", FIELDS(loanFields) },
+};
+
+static const char *functionNames[] = { "count", "sum", "avg", "min", "max" };
+
+/**
+ * @brief Finds a table by name
+ * @param name The name
+ * @return int Position in aggregateTables, or -1 if there is no such table
+ */
+static int findTable(const char *name) {
+    for (size_t i = 0; i < sizeof(aggregateTables) / sizeof(aggregateTables[0]); i++) {
+        if (strcmp(aggregateTables[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds a field of a table by the first characters of a string
+ * @param table The table
+ * @param name The field name, not necessarily terminated
+ * @param length Length of the name
+ * @return int Position in the table's fields, or -1 if there is no such field
+ */
+static int findField(const AggregateTable *table, const char *name, size_t length) {
+    for (int i = 0; i < table->fieldCount; i++) {
+        if (strlen(table->fields[i].name) == length && strncmp(table->fields[i].name, name, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses the comma-separated group-by keys
+ * @param aggregation The query being set up
+ * @param keys The keys, empty or "-" for none
+ * @return const char* NULL on success, or the reason the keys are invalid
+ */
+static const char *parseKeys(Aggregation *aggregation, const char *keys) {
+    const AggregateTable *table = &aggregateTables[aggregation->table];
+    aggregation->keyCount = 0;
+    if (*keys == 0 || strcmp(keys, "-") == 0) {
+        return NULL;
+    }
+    for (const char *name = keys; ; name++) {
+        size_t length = strcspn(name, ",");
+        int field = findField(table, name, length);
+        if (field == -1) {
+            return "unknown_field";
+        }
+        if (aggregation->keyCount == AGGREGATE_MAX_KEYS) {
+            return "too_many_keys";
+        }
+        aggregation->keys[aggregation->keyCount++] = field;
+        name += length;
+        if (*name == 0) {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Parses the comma-separated aggregates
+ * @param aggregation The query being set up
+ * @param values The aggregates, such as "count,avg:price"
+ * @return const char* NULL on success, or the reason the aggregates are invalid
+ */
+static const char *parseValues(Aggregation *aggregation, const char *values) {
+    const AggregateTable *table = &aggregateTables[aggregation->table];
+    aggregation->valueCount = 0;
+    for (const char *item = values; ; item++) {
+        size_t length = strcspn(item, ",");
+        const char *colon = memchr(item, ':', length);
+        size_t nameLength = colon == NULL ? length : (size_t)(colon - item);
+        int function = -1;
+        for (int i = 0; i < (int)(sizeof(functionNames) / sizeof(functionNames[0])); i++) {
+            if (strlen(functionNames[i]) == nameLength && strncmp(functionNames[i], item, nameLength) == 0) {
+                function = i;
+            }
+        }
+        if (function == -1) {
+            return "unknown_aggregate";
+        }
+        int field = -1;
+        if (colon != NULL) {
+            field = findField(table, colon + 1, length - nameLength - 1);
+            if (field == -1) {
+                return "unknown_field";
+            }
+        } else if (function != AGGREGATE_COUNT) {
+            return "missing_field";
+        }
+        if (aggregation->valueCount == AGGREGATE_MAX_VALUES) {
+            return "too_many_aggregates";
+        }
+        aggregation->functions[aggregation->valueCount] = (AggregateFunction)function;
+        aggregation->values[aggregation->valueCount++] = field;
+        item += length;
+        if (*item == 0) {
+            return NULL;
+        }
+    }
+}
+
+// Key values being looked up among the groups
+typedef struct {
+    const Aggregation *aggregation;
+    const double *keys;
+} GroupKey;
+
+// Returns non-zero when the group has the key values; NAN matches NAN
+static int groupHasKeys(int group, const void *key) {
+    const GroupKey *wanted = key;
+    const double *keys = &wanted->aggregation->groupKeys[group * wanted->aggregation->keyCount];
+    return memcmp(keys, wanted->keys, sizeof(double) * (size_t)wanted->aggregation->keyCount) == 0;
+}
+
+/**
+ * @brief Hashes the key values of a row
+ * @param keys The values
+ * @param count Number of values
+ * @return unsigned int The hash
+ */
+static unsigned int hashKeys(const double *keys, int count) {
+    unsigned int hash = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned long long bits;
+        memcpy(&bits, &keys[i], sizeof(bits));
+        hash = hash * 31 + hashInteger(bits);
+    }
+    return hash;
+}
+
+/**
+ * @brief Finds the group of some key values, adding it if it is new
+ * @param aggregation The query being run
+ * @param keys The key values of a row
+ * @return int The group, or -1 if memory could not be allocated
+ */
+static int findGroup(Aggregation *aggregation, const double *keys) {
+    unsigned int hash = hashKeys(keys, aggregation->keyCount);
+    GroupKey wanted = { aggregation, keys };
+    int group = hashIndexFind(&aggregation->index, hash, groupHasKeys, &wanted);
+    if (group != -1) {
+        return group;
+    }
+    if (aggregation->groupCount == aggregation->groupCapacity) {
+        int newCapacity = aggregation->groupCapacity == 0 ? 64 : aggregation->groupCapacity * 2;
+        double *groupKeys = realloc(aggregation->groupKeys,
+                                    sizeof(double) * (size_t)newCapacity * (size_t)(aggregation->keyCount + 1));
+        if (groupKeys == NULL) {
+            return -1;
+        }
+        aggregation->groupKeys = groupKeys;
+        AggregateState *states = realloc(aggregation->states,
+                                         sizeof(AggregateState) * (size_t)newCapacity * (size_t)(aggregation->valueCount + 1));
+        if (states == NULL) {
+            return -1;
+        }
+        aggregation->states = states;
+        aggregation->groupCapacity = newCapacity;
+    }
+    group = aggregation->groupCount;
+    if (!hashIndexInsert(&aggregation->index, hash, group)) {
+        return -1;
+    }
+    aggregation->groupCount++;
+    memcpy(&aggregation->groupKeys[group * aggregation->keyCount], keys, sizeof(double) * (size_t)aggregation->keyCount);
+    for (int i = 0; i < aggregation->valueCount; i++) {
+        aggregation->states[group * aggregation->valueCount + i] = (AggregateState){ 0, 0, 0, 0 };
+    }
+    return group;
+}
+
+// Most distinct fields one query reads
+#define MAX_COLUMNS (AGGREGATE_MAX_KEYS + AGGREGATE_MAX_VALUES)
+
+// Borrowings ahead of the current one whose join slots are prefetched
+#define PREFETCH_DISTANCE 2
+
+// Marks an empty slot of the book join; no ISBN is negative
+#define JOIN_EMPTY -1.0
+
+// State of a query while it reads the rows. Every field the query uses is
+// a column computed once per row. For loans, the columns that come from
+// the book are looked up in a hash join built from the books first: each
+// slot holds an ISBN followed by those columns of the book, so a loan
+// costs one probe into a compact array instead of an ISBN index lookup
+// and a visit to the book row.
+typedef struct {
+    Aggregation *aggregation;
+    const AggregateField *columns[MAX_COLUMNS];
+    int columnCount;
+    int keyColumns[AGGREGATE_MAX_KEYS];
+    int valueColumns[AGGREGATE_MAX_VALUES];    // -1 for count
+    int joinColumns[MAX_COLUMNS];               // Columns read from the book join
+    int joinCount;                              // 0 if the query does not join
+    double *join;                               // Slots of joinCount + 1 values
+    unsigned int joinMask;                      // Number of slots minus one
+} AggregateRun;
+
+/**
+ * @brief Returns the column of a field, adding it if the query did not read it yet
+ * @param run The running query
+ * @param field The field
+ * @return int The column
+ */
+static int columnOf(AggregateRun *run, const AggregateField *field) {
+    for (int i = 0; i < run->columnCount; i++) {
+        if (run->columns[i] == field) {
+            return i;
+        }
+    }
+    run->columns[run->columnCount] = field;
+    return run->columnCount++;
+}
+
+/**
+ * @brief Builds the book join used by loans
+ * @param run The running query, with joinColumns set
+ * @param bookCount Current number of book rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int buildBookJoin(AggregateRun *run, int bookCount) {
+    unsigned int slots = 16;
+    while (slots < (unsigned int)liveBookCount(bookCount) * 2) {
+        slots *= 2;
+    }
+    int width = run->joinCount + 1;
+    run->join = malloc(sizeof(double) * slots * (size_t)width);
+    if (run->join == NULL) {
+        return 0;
+    }
+    run->joinMask = slots - 1;
+    for (unsigned int i = 0; i < slots; i++) {
+        run->join[i * width] = JOIN_EMPTY;
+    }
+    AggregateRow row = { 0, 0 };
+    for (row.book = 0; row.book < bookCount; row.book++) {
+        if (!isBookLive(row.book)) {
+            continue;
+        }
+        unsigned long long ISBN = bookAt(row.book)->ISBN;
+        unsigned int slot = hashInteger(ISBN) & run->joinMask;
+        while (run->join[slot * width] != JOIN_EMPTY) {
+            slot = (slot + 1) & run->joinMask;
+        }
+        double *entry = &run->join[slot * width];
+        entry[0] = (double)ISBN;        // Exact: ISBNs have at most 13 digits
+        for (int j = 0; j < run->joinCount; j++) {
+            entry[j + 1] = run->columns[run->joinColumns[j]]->value(&row);
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the first slot of the book join an ISBN may be in
+ * @param run The running query
+ * @param ISBN The ISBN
+ * @return const double* The slot
+ */
+static const double *joinSlot(const AggregateRun *run, unsigned long long ISBN) {
+    return &run->join[(hashInteger(ISBN) & run->joinMask) * (unsigned int)(run->joinCount + 1)];
+}
+
+/**
+ * @brief Copies the columns of a lent book from the book join
+ * @param run The running query
+ * @param ISBN The book's ISBN
+ * @param columns The row's columns; the joined ones are set, to NAN if
+ *                the book was deleted
+ * @return void
+ */
+static void joinBook(const AggregateRun *run, unsigned long long ISBN, double *columns) {
+    int width = run->joinCount + 1;
+    double key = (double)ISBN;
+    const double *entry = joinSlot(run, ISBN);
+    const double *end = run->join + (size_t)(run->joinMask + 1) * (size_t)width;
+    while (*entry != JOIN_EMPTY && *entry != key) {
+        entry += width;
+        if (entry == end) {
+            entry = run->join;
+        }
+    }
+    for (int j = 0; j < run->joinCount; j++) {
+        columns[run->joinColumns[j]] = *entry == key ? entry[j + 1] : NAN;
+    }
+}
+
+/**
+ * @brief Reads the columns of a row that do not come from the book join
+ * @param run The running query
+ * @param row The row
+ * @param columns Receives the columns
+ * @return void
+ */
+static void readColumns(const AggregateRun *run, const AggregateRow *row, double *columns) {
+    for (int c = 0; c < run->columnCount; c++) {
+        if (run->joinCount == 0 || !run->columns[c]->readsBook) {
+            columns[c] = run->columns[c]->value(row);
+        }
+    }
+}
+
+/**
+ * @brief Adds one row to its group
+ * @param run The running query
+ * @param columns The row's columns
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int addRow(AggregateRun *run, const double *columns) {
+    Aggregation *aggregation = run->aggregation;
+    double keys[AGGREGATE_MAX_KEYS];
+    for (int i = 0; i < aggregation->keyCount; i++) {
+        keys[i] = columns[run->keyColumns[i]];
+        if (isnan(keys[i])) {
+            keys[i] = NAN;              // One bit pattern, so missing values share a group
+        } else if (keys[i] == 0) {
+            keys[i] = 0;                // Same for -0.0
+        }
+    }
+    int group = findGroup(aggregation, keys);
+    if (group == -1) {
+        return 0;
+    }
+    AggregateState *states = &aggregation->states[group * aggregation->valueCount];
+    for (int i = 0; i < aggregation->valueCount; i++) {
+        double value = run->valueColumns[i] == -1 ? 1 : columns[run->valueColumns[i]];
+        if (isnan(value)) {
+            continue;
+        }
+        AggregateState *state = &states[i];
+        if (state->count == 0 || value < state->min) {
+            state->min = value;
+        }
+        if (state->count == 0 || value > state->max) {
+            state->max = value;
+        }
+        state->count++;
+        state->sum += value;
+    }
+    return 1;
+}
+
+/**
+ * @brief Adds the loans of every borrowing, one per book lent
+ * @param run The running query
+ * @param borrowingCount Current number of borrowings
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * The columns of the borrowing are read once for all its books. The join
+ * slots of the books a few borrowings ahead are prefetched so their cache
+ * misses overlap with the work on the current one.
+ */
+static int addLoans(AggregateRun *run, int borrowingCount) {
+    double columns[MAX_COLUMNS];
+    AggregateRow row = { 0, -1 };
+    for (row.row = 0; row.row < borrowingCount; row.row++) {
+        const Borrowing *borrowing = borrowingAt(row.row);
+#ifdef __GNUC__
+        if (run->joinCount > 0 && row.row + PREFETCH_DISTANCE < borrowingCount) {
+            const Borrowing *next = borrowingAt(row.row + PREFETCH_DISTANCE);
+            for (int i = 0; i < next->bookCount; i++) {
+                __builtin_prefetch(joinSlot(run, next->books[i]));
+            }
+        }
+#endif
+        readColumns(run, &row, columns);
+        for (int i = 0; i < borrowing->bookCount; i++) {
+            if (run->joinCount > 0) {
+                joinBook(run, borrowing->books[i], columns);
+            }
+            if (!addRow(run, columns)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Runs a group-by query over a table
+const char *runAggregation(Aggregation *aggregation, const char *table, const char *keys, const char *values,
+                           int bookCount, int readerCount, int borrowingCount) {
+    aggregation->table = findTable(table);
+    if (aggregation->table == -1) {
+        return "unknown_table";
+    }
+    const char *error = parseKeys(aggregation, keys);
+    if (error == NULL) {
+        error = parseValues(aggregation, values);
+    }
+    if (error != NULL) {
+        return error;
+    }
+    const AggregateTable *source = &aggregateTables[aggregation->table];
+    AggregateRun run;
+    memset(&run, 0, sizeof(run));
+    run.aggregation = aggregation;
+    for (int i = 0; i < aggregation->keyCount; i++) {
+        run.keyColumns[i] = columnOf(&run, &source->fields[aggregation->keys[i]]);
+    }
+    for (int i = 0; i < aggregation->valueCount; i++) {
+        run.valueColumns[i] = aggregation->values[i] == -1 ? -1 : columnOf(&run, &source->fields[aggregation->values[i]]);
+    }
+    if (aggregation->table == TABLE_LOANS) {
+        for (int c = 0; c < run.columnCount; c++) {
+            if (run.columns[c]->readsBook) {
+                run.joinColumns[run.joinCount++] = c;
+            }
+        }
+    }
+
+    aggregationTime = time(NULL);
+    aggregation->groupCount = 0;
+    hashIndexClear(&aggregation->index);
+    double noKeys[1];
+    if ((aggregation->keyCount == 0 && findGroup(aggregation, noKeys) == -1) ||
+        (run.joinCount > 0 && !buildBookJoin(&run, bookCount))) {
+        return "no_memory";
+    }
+    int ok = 1;
+    double columns[MAX_COLUMNS];
+    AggregateRow row = { 0, -1 };
+    switch (aggregation->table) {
+        case TABLE_BOOKS:
+            for (row.row = 0; ok && row.row < bookCount; row.row++) {
+                if (isBookLive(row.row)) {
+                    row.book = row.row;
+                    readColumns(&run, &row, columns);
+                    ok = addRow(&run, columns);
+                }
+            }
+            break;
+        case TABLE_READERS:
+            for (row.row = 0; ok && row.row < readerCount; row.row++) {
+                if (isReaderLive(row.row)) {
+                    readColumns(&run, &row, columns);
+                    ok = addRow(&run, columns);
+                }
+            }
+            break;
+        case TABLE_BORROWINGS:
+            for (row.row = 0; ok && row.row < borrowingCount; row.row++) {
+                readColumns(&run, &row, columns);
+                ok = addRow(&run, columns);
+            }
+            break;
+        case TABLE_LOANS:
+            ok = addLoans(&run, borrowingCount);
+            break;
+    }
+    free(run.join);
+    return ok ? NULL : "no_memory";
+}
+
+/**
+ * @brief Formats a number, without decimals if it is whole
+ * @param value The number
+ * @param text Receives the text, VALUE_LENGTH bytes
+ * @return void
+ */
+static void formatNumber(double value, char *text) {
+    if (isnan(value)) {
+        text[0] = 0;
+    } else if (value > -1e15 && value < 1e15 && value == (double)(long long)value) {
+        snprintf(text, VALUE_LENGTH, "%.0f", value);
+    } else {
+        snprintf(text, VALUE_LENGTH, "%.2f", value);
+    }
+}
+
+/**
+ * @brief Formats a key value as its field shows it
+ * @param field The field
+ * @param value The value
+ * @param text Receives the text, VALUE_LENGTH bytes
+ * @return void
+ */
+static void formatKey(const AggregateField *field, double value, char *text) {
+    if (isnan(value)) {
+        text[0] = 0;
+        return;
+    }
+    switch (field->type) {
+        case FIELD_SYMBOL:
+            snprintf(text, VALUE_LENGTH, "%s", symbolText((Symbol)value));
+            break;
+        case FIELD_GENDER:
+            snprintf(text, VALUE_LENGTH, "%s", genderName((Gender)value));
+            break;
+        case FIELD_MONTH:
+            snprintf(text, VALUE_LENGTH, "%04d-%02d", (int)value / 12, (int)value % 12 + 1);
+            break;
+        case FIELD_NUMBER:
+            formatNumber(value, text);
+            break;
+    }
+}
+
+/**
+ * @brief Formats the result of an aggregate
+ * @param function The aggregate
+ * @param state Its running values
+ * @param text Receives the text, VALUE_LENGTH bytes; empty when no row had a value
+ * @return void
+ */
+static void formatValue(AggregateFunction function, const AggregateState *state, char *text) {
+    switch (function) {
+        case AGGREGATE_COUNT:
+            snprintf(text, VALUE_LENGTH, "%lld", state->count);
+            return;
+        case AGGREGATE_SUM:
+            formatNumber(state->sum, text);
+            return;
+        case AGGREGATE_AVG:
+            if (state->count > 0) {
+                snprintf(text, VALUE_LENGTH, "%.2f", state->sum / (double)state->count);
+            } else {
+                text[0] = 0;
+            }
+            return;
+        case AGGREGATE_MIN:
+            formatNumber(state->count > 0 ? state->min : NAN, text);
+            return;
+        case AGGREGATE_MAX:
+            formatNumber(state->count > 0 ? state->max : NAN, text);
+            return;
+    }
+}
+
+// Result being sorted; qsort passes no context to the comparison
+static const Aggregation *sortedAggregation;
+
+/**
+ * @brief Orders two groups by their key values, missing values last
+ * @param a First group number
+ * @param b Second group number
+ * @return int Negative, zero or positive as for qsort
+ */
+static int compareGroups(const void *a, const void *b) {
+    const Aggregation *aggregation = sortedAggregation;
+    const AggregateField *fields = aggregateTables[aggregation->table].fields;
+    const double *first = &aggregation->groupKeys[*(const int *)a * aggregation->keyCount];
+    const double *second = &aggregation->groupKeys[*(const int *)b * aggregation->keyCount];
+    for (int i = 0; i < aggregation->keyCount; i++) {
+        if (isnan(first[i]) || isnan(second[i])) {
+            if (isnan(first[i]) != isnan(second[i])) {
+                return isnan(first[i]) ? 1 : -1;
+            }
+            continue;
+        }
+        int order = 0;
+        if (fields[aggregation->keys[i]].type == FIELD_SYMBOL) {
+            order = strcmp(symbolText((Symbol)first[i]), symbolText((Symbol)second[i]));
+        } else if (first[i] != second[i]) {
+            order = first[i] < second[i] ? -1 : 1;
+        }
+        if (order != 0) {
+            return order;
+        }
+    }
+    return 0;
+}
+
+// Writes a header line, then one line per group in key order
+void writeAggregation(FILE *out, const Aggregation *aggregation, const char *separator) {
+    const AggregateField *fields = aggregateTables[aggregation->table].fields;
+    const char *gap = "";
+    for (int i = 0; i < aggregation->keyCount; i++) {
+        fprintf(out, "%s%s", gap, fields[aggregation->keys[i]].name);
+        gap = separator;
+    }
+    for (int i = 0; i < aggregation->valueCount; i++) {
+        fprintf(out, "%s%s", gap, functionNames[aggregation->functions[i]]);
+        if (aggregation->values[i] != -1) {
+            fprintf(out, ":%s", fields[aggregation->values[i]].name);
+        }
+        gap = separator;
+    }
+    fputc('\n', out);
+
+    int *order = malloc(sizeof(int) * (size_t)(aggregation->groupCount + 1));
+    for (int i = 0; order != NULL && i < aggregation->groupCount; i++) {
+        order[i] = i;
+    }
+    if (order != NULL) {
+        sortedAggregation = aggregation;
+        qsort(order, aggregation->groupCount, sizeof(int), compareGroups);
+    }
+    char text[VALUE_LENGTH];
+    for (int i = 0; i < aggregation->groupCount; i++) {
+        int group = order != NULL ? order[i] : i;
+        gap = "";
+        for (int k = 0; k < aggregation->keyCount; k++) {
+            formatKey(&fields[aggregation->keys[k]], aggregation->groupKeys[group * aggregation->keyCount + k], text);
+            fprintf(out, "%s%s", gap, text);
+            gap = separator;
+        }
+        for (int v = 0; v < aggregation->valueCount; v++) {
+            formatValue(aggregation->functions[v], &aggregation->states[group * aggregation->valueCount + v], text);
+            fprintf(out, "%s%s", gap, text);
+            gap = separator;
+        }
+        fputc('\n', out);
+    }
+    free(order);
+}
+
+// Writes the fields a table can be grouped and aggregated by
+int listAggregateFields(FILE *out, const char *table) {
+    int index = findTable(table);
+    if (index == -1) {
+        return 0;
+    }
+    const AggregateTable *source = &aggregateTables[index];
+    fputs("Fields:", out);
+    for (int i = 0; i < source->fieldCount; i++) {
+        fprintf(out, "%s %s", i > 0 ? "," : "", source->fields[i].name);
+    }
+    fputc('\n', out);
+    return 1;
+}
+
+// Releases the memory of a result
+void freeAggregation(Aggregation *aggregation) {
+    free(aggregation->groupKeys);
+    free(aggregation->states);
+    hashIndexFree(&aggregation->index);
+    *aggregation = (Aggregation)AGGREGATION_INIT;
+}
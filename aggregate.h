@@ -0,0 +1,92 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdio.h>
+#include "hashindex.h"
+
+// Most group-by keys and aggregates one query takes
+#define AGGREGATE_MAX_KEYS 4
+#define AGGREGATE_MAX_VALUES 8
+
+typedef enum {
+    AGGREGATE_COUNT,
+    AGGREGATE_SUM,
+    AGGREGATE_AVG,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX
+} AggregateFunction;
+
+// Running values of one aggregate over one group
+typedef struct {
+    long long count;            // Rows with a value
+    double sum;
+    double min;
+    double max;
+} AggregateState;
+
+// A group-by query and its result. Groups are found through a hash index
+// on their key values, so the rows are read once whatever the number of
+// groups.
+typedef struct {
+    int table;                                  // Table the rows come from
+    int keyCount;
+    int keys[AGGREGATE_MAX_KEYS];               // Field of each key
+    int valueCount;
+    AggregateFunction functions[AGGREGATE_MAX_VALUES];
+    int values[AGGREGATE_MAX_VALUES];           // Field of each aggregate, -1 for count
+    int groupCount;
+    int groupCapacity;
+    double *groupKeys;                          // keyCount values per group
+    AggregateState *states;                     // valueCount states per group
+    HashIndex index;                            // Hash of the key values to group
+} Aggregation;
+
+#define AGGREGATION_INIT { 0, 0, { 0 }, 0, { 0 }, { 0 }, 0, 0, NULL, NULL, HASH_INDEX_INIT }
+
+/**
+ * @brief Groups the rows of a table and computes aggregates per group
+ * @param aggregation Receives the result; must be AGGREGATION_INIT or freed
+ * @param table "books", "readers", "borrowings" or "loans"
+ * @param keys Comma-separated fields to group by, empty or "-" for a
+ *             single group over every row
+ * @param values Comma-separated aggregates: "count", or count, sum, avg,
+ *               min or max followed by ':' and a field, as in "avg:price"
+ * @param bookCount Current number of book rows
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return const char* NULL on success, or the reason the query failed
+ *
+ * "loans" has one row per book lent, with the fields of the book, while
+ * "borrowings" has one row per borrowing. Deleted books and readers are
+ * skipped. A missing value (the book of a loan was deleted, a date is
+ * unknown) forms its own group and is left out of the aggregates.
+ */
+const char *runAggregation(Aggregation *aggregation, const char *table, const char *keys, const char *values,
+                           int bookCount, int readerCount, int borrowingCount);
+
+/**
+ * @brief Writes a header line, then one line per group in key order
+ * @param out The stream to write to
+ * @param aggregation The result of runAggregation
+ * @param separator Written between two columns
+ * @return void
+ */
+void writeAggregation(FILE *out, const Aggregation *aggregation, const char *separator);
+
+/**
+ * @brief Writes the fields a table can be grouped and aggregated by, as
+ *        "Fields: a, b, c"
+ * @param out The stream to write to
+ * @param table The table name
+ * @return int 1 on success, 0 if there is no such table
+ */
+int listAggregateFields(FILE *out, const char *table);
+
+/**
+ * @brief Releases the memory of a result
+ * @param aggregation The result
+ * @return void
+ */
+void freeAggregation(Aggregation *aggregation);
+
+#endif // AGGREGATE_H
@@ -0,0 +1,543 @@
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include "batch.h"
+#include "library.h"
+#include "journal.h"
+#include "checkpoint.h"
+#include "aggregate.h"
+#include "columns.h"
+
+// Longest command line, and most fields on one line
+#define BATCH_LINE 4096
+#define BATCH_FIELDS 16
+
+// Runs one command; returns 1 if it succeeded, 0 if it wrote an error
+typedef int (*BatchHandler)(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out);
+
+typedef struct {
+    const char *name;
+    int minFields;              // Including the command name
+    int maxFields;
+    BatchHandler run;
+} BatchCommand;
+
+// Writes an error result; always returns 0
+static int batchError(FILE *out, const char *reason) {
+    fprintf(out, "ERR\t%s\n", reason);
+    return 0;
+}
+
+// ADD_BOOK ISBN title author publisher year category price quantity
+static int batchAddBook(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    BookValues values;
+    if (!parseISBN(fields[1], &values.ISBN)) {
+        return batchError(out, "bad_isbn");
+    }
+    for (int i = 2; i <= 7; i++) {
+        if (i != 5 && strlen(fields[i]) >= MAX_STRING) {
+            return batchError(out, "too_long");
+        }
+    }
+    values.title = fields[2];
+    values.author = fields[3];
+    values.publisher = fields[4];
+    values.category = fields[6];
+    if (!parseInteger(fields[5], &values.publishYear) || !parsePrice(fields[7], &values.price) ||
+        !parseInteger(fields[8], &values.quantity)) {
+        return batchError(out, "bad_number");
+    }
+    if (findBookByISBN(*bookCount, values.ISBN) != -1) {
+        return batchError(out, "exists");
+    }
+    int index = storeBook(bookCount, &values);
+    if (index == -1) {
+        return batchError(out, "no_memory");
+    }
+    journalBook(bookAt(index));
+    fputs("OK\n", out);
+    return 1;
+}
+
+// DELETE_BOOK ISBN
+static int batchDeleteBook(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    int index = findBookByISBNText(*bookCount, fields[1]);
+    if (index == -1) {
+        return batchError(out, "not_found");
+    }
+    journalBookDeleted(bookAt(index)->ISBN);
+    removeBook(index);
+    fputs("OK\n", out);
+    return 1;
+}
+
+// Writes the fields of a book as tab-separated values, after a prefix
+static void writeBook(FILE *out, const char *prefix, const Book *book) {
+    char ISBN[ISBN_LENGTH];
+    formatISBN(book->ISBN, ISBN);
+    fprintf(out, "%s%s\t%s\t%s\t%s\t%d\t%s\t%.2f\t%d\n", prefix, ISBN, bookString(book->title),
+            symbolText(book->author), symbolText(book->publisher), book->publishYear,
+            symbolText(book->category), book->price, book->quantity);
+}
+
+// FIND_ISBN ISBN
+static int batchFindISBN(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    int index = findBookByISBNText(*bookCount, fields[1]);
+    if (index == -1) {
+        return batchError(out, "not_found");
+    }
+    writeBook(out, "OK\t", bookAt(index));
+    return 1;
+}
+
+// BORROW readerID ISBN [ISBN...]
+static int batchBorrow(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    Borrowing borrowing;
+    memset(&borrowing, 0, sizeof(Borrowing));
+    if (!parseInteger(fields[1], &borrowing.readerID)) {
+        return batchError(out, "bad_number");
+    }
+    int readerIndex = findReaderByID(readerCount, borrowing.readerID);
+    if (readerIndex == -1) {
+        return batchError(out, "no_reader");
+    }
+    time_t currentTime = time(NULL);
+    if (dayFromTime(currentTime) > readerAt(readerIndex)->cardExpiryDate) {
+        return batchError(out, "card_expired");
+    }
+    borrowing.borrowingDate = currentTime;
+    borrowing.dueDate = currentTime + LOAN_DAYS * 24 * 60 * 60;
+    for (int i = 0; fields[i + 2] != NULL; i++) {
+        if (!parseISBN(fields[i + 2], &borrowing.books[i])) {
+            return batchError(out, "bad_isbn");
+        }
+        borrowing.bookCount++;
+        switch (checkLendable(*bookCount, &borrowing, i)) {
+            case LEND_NOT_FOUND:
+                return batchError(out, "not_found");
+            case LEND_UNAVAILABLE:
+                return batchError(out, "unavailable");
+            case LEND_OK:
+                break;
+        }
+    }
+    int index = storeBorrowing(*bookCount, borrowingCount, &borrowing);
+    if (index == -1) {
+        return batchError(out, "no_memory");
+    }
+    journalBorrowing(borrowingAt(index));
+    fprintf(out, "OK\t%d\t%lld\n", index, (long long)borrowing.dueDate);
+    return 1;
+}
+
+// RETURN borrowing
+static int batchReturn(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    int index;
+    if (!parseInteger(fields[1], &index)) {
+        return batchError(out, "bad_number");
+    }
+    if (index < 0 || index >= *borrowingCount) {
+        return batchError(out, "not_found");
+    }
+    if (borrowingAt(index)->isReturned) {
+        return batchError(out, "returned");
+    }
+    time_t currentTime = time(NULL);
+    int fine = calculateFine(borrowingAt(index)->dueDate, currentTime);
+    returnBorrowing(*bookCount, index, currentTime);
+    journalReturn(index, currentTime);
+    fprintf(out, "OK\t%d\n", fine);
+    return 1;
+}
+
+// AGGREGATE table keys aggregates
+static int batchAggregate(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    Aggregation aggregation = AGGREGATION_INIT;
+    const char *error = runAggregation(&aggregation, fields[1], fields[2], fields[3],
+                                       *bookCount, readerCount, *borrowingCount);
+    if (error != NULL) {
+        freeAggregation(&aggregation);
+        return batchError(out, error);
+    }
+    fprintf(out, "OK\t%d\n", aggregation.groupCount);
+    writeAggregation(out, &aggregation, "\t");
+    freeAggregation(&aggregation);
+    return 1;
+}
+
+// FILTER_BOOKS yearFrom yearTo priceFrom priceTo minQuantity
+static int batchFilterBooks(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    BookFilter filter;
+    if (!parseInteger(fields[1], &filter.yearFrom) || !parseInteger(fields[2], &filter.yearTo) ||
+        !parsePrice(fields[3], &filter.priceFrom) || !parsePrice(fields[4], &filter.priceTo) ||
+        !parseInteger(fields[5], &filter.minQuantity)) {
+        return batchError(out, "bad_number");
+    }
+    double stockValue = 0;
+    int count = filterBookColumns(&filter, *bookCount, NULL, &stockValue);
+    if (count == -1) {
+        return batchError(out, "no_memory");
+    }
+    fprintf(out, "OK\t%d\t%.2f\n", count, stockValue);
+    return 1;
+}
+
+// RANGE_BOOKS field low high asc|desc limit
+static int batchRangeBooks(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    float low;
+    float high;
+    int limit;
+    if (!parsePrice(fields[2], &low) || !parsePrice(fields[3], &high) || !parseInteger(fields[5], &limit) ||
+        limit < 0) {
+        return batchError(out, "bad_number");
+    }
+    if (strcmp(fields[4], "asc") != 0 && strcmp(fields[4], "desc") != 0) {
+        return batchError(out, "bad_order");
+    }
+    int *rows;
+    int count = findBooksInRange(*bookCount, fields[1], low, high, strcmp(fields[4], "desc") == 0, limit, &rows);
+    if (count == -1) {
+        return batchError(out, "bad_field");
+    }
+    if (count == -2) {
+        return batchError(out, "no_memory");
+    }
+    fprintf(out, "OK\t%d\n", count);
+    for (int i = 0; i < count; i++) {
+        writeBook(out, "", bookAt(rows[i]));
+    }
+    free(rows);
+    return 1;
+}
+
+// FACETS category publisher decade
+static int batchFacets(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    FacetSelection selection;
+    memset(&selection, 0, sizeof(selection));
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        if (strcmp(fields[facet + 1], "-") == 0) {
+            continue;
+        }
+        for (char *value = strtok(fields[facet + 1], "|"); value != NULL; value = strtok(NULL, "|")) {
+            if (selection.count[facet] == MAX_FACET_PICKS) {
+                return batchError(out, "too_many_values");
+            }
+            if (!parseBookFacetValue(facet, value, &selection.values[facet][selection.count[facet]++])) {
+                return batchError(out, "bad_number");
+            }
+        }
+    }
+    const char *names[BOOK_FACET_COUNT] = { "category", "publisher", "decade" };
+    FacetCount *counts[BOOK_FACET_COUNT];
+    int valueCounts[BOOK_FACET_COUNT];
+    int matches = countBookFacets(*bookCount, &selection, counts, valueCounts);
+    if (matches == -1) {
+        return batchError(out, "no_memory");
+    }
+    fprintf(out, "OK\t%d\n", matches);
+    char text[MAX_STRING];
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        for (int i = 0; i < valueCounts[facet]; i++) {
+            formatBookFacetValue(facet, counts[facet][i].value, text);
+            fprintf(out, "%s\t%s\t%d\n", names[facet], text, counts[facet][i].count);
+        }
+        free(counts[facet]);
+    }
+    return 1;
+}
+
+// Reads where a page lies relative to its cursor: from, after or before
+static int parsePageStart(const char *text, RangePageStart *start) {
+    static const char *names[] = { "from", "after", "before" };
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(text, names[i]) == 0) {
+            *start = (RangePageStart)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Reads the number of rows on a page
+static int parsePageSize(const char *text, int *size) {
+    return parseInteger(text, size) && *size >= 1 && *size <= MAX_PAGE_SIZE;
+}
+
+// PAGE_BOOKS from|after|before ISBN|- size
+static int batchPageBooks(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)readerCount;
+    (void)borrowingCount;
+    RangePageStart start;
+    if (!parsePageStart(fields[1], &start)) {
+        return batchError(out, "bad_start");
+    }
+    // Without a cursor the page starts at the first book, or ends at the last
+    unsigned long long ISBN = start == RANGE_PAGE_BEFORE ? ULLONG_MAX : 0;
+    if (strcmp(fields[2], "-") != 0 && !parseISBN(fields[2], &ISBN)) {
+        return batchError(out, "bad_isbn");
+    }
+    int size;
+    if (!parsePageSize(fields[3], &size)) {
+        return batchError(out, "bad_number");
+    }
+    int rows[MAX_PAGE_SIZE];
+    int hasPrevious;
+    int hasNext;
+    int count = findBookPage(*bookCount, ISBN, start, size, rows, &hasPrevious, &hasNext);
+    if (count == -1) {
+        return batchError(out, "no_memory");
+    }
+    char previous[ISBN_LENGTH] = "-";
+    char next[ISBN_LENGTH] = "-";
+    if (hasPrevious && count > 0) {
+        formatISBN(bookAt(rows[0])->ISBN, previous);
+    }
+    if (hasNext && count > 0) {
+        formatISBN(bookAt(rows[count - 1])->ISBN, next);
+    }
+    fprintf(out, "OK\t%d\t%s\t%s\n", count, previous, next);
+    for (int i = 0; i < count; i++) {
+        writeBook(out, "", bookAt(rows[i]));
+    }
+    return 1;
+}
+
+// PAGE_READERS from|after|before ID|- size
+static int batchPageReaders(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)bookCount;
+    (void)borrowingCount;
+    RangePageStart start;
+    if (!parsePageStart(fields[1], &start)) {
+        return batchError(out, "bad_start");
+    }
+    int id = start == RANGE_PAGE_BEFORE ? INT_MAX : 0;
+    int size;
+    if ((strcmp(fields[2], "-") != 0 && !parseInteger(fields[2], &id)) || !parsePageSize(fields[3], &size)) {
+        return batchError(out, "bad_number");
+    }
+    int rows[MAX_PAGE_SIZE];
+    int hasPrevious;
+    int hasNext;
+    int count = findReaderPage(readerCount, id, start, size, rows, &hasPrevious, &hasNext);
+    if (count == -1) {
+        return batchError(out, "no_memory");
+    }
+    fprintf(out, "OK\t%d\t", count);
+    if (hasPrevious && count > 0) {
+        fprintf(out, "%d\t", readerAt(rows[0])->ID);
+    } else {
+        fputs("-\t", out);
+    }
+    if (hasNext && count > 0) {
+        fprintf(out, "%d\n", readerAt(rows[count - 1])->ID);
+    } else {
+        fputs("-\n", out);
+    }
+    for (int i = 0; i < count; i++) {
+        const Reader *reader = readerAt(rows[i]);
+        fprintf(out, "%d\t%s\t%s\t%s\t%s\t%d\n", reader->ID, readerString(reader->name),
+                readerString(reader->email), readerString(reader->phone), readerString(reader->address),
+                reader->membershipYear);
+    }
+    return 1;
+}
+
+// COUNT_DUE time
+static int batchCountDue(char **fields, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    (void)bookCount;
+    (void)readerCount;
+    char *end;
+    errno = 0;
+    long long before = strtoll(fields[1], &end, 10);
+    if (end == fields[1] || *end != 0 || errno != 0) {
+        return batchError(out, "bad_number");
+    }
+    int count = countDueBefore((time_t)before, *borrowingCount);
+    if (count == -1) {
+        return batchError(out, "no_memory");
+    }
+    fprintf(out, "OK\t%d\n", count);
+    return 1;
+}
+
+static const BatchCommand batchCommands[] = {
+    { "ADD_BOOK", 9, 9, batchAddBook },
+    { "DELETE_BOOK", 2, 2, batchDeleteBook },
+    { "FIND_ISBN", 2, 2, batchFindISBN },
+    { "BORROW", 3, 2 + MAX_BOOKS_PER_READER, batchBorrow },
+    { "RETURN", 2, 2, batchReturn },
+    { "AGGREGATE", 4, 4, batchAggregate },
+    { "FILTER_BOOKS", 6, 6, batchFilterBooks },
+    { "COUNT_DUE", 2, 2, batchCountDue },
+    { "RANGE_BOOKS", 6, 6, batchRangeBooks },
+    { "FACETS", 4, 4, batchFacets },
+    { "PAGE_BOOKS", 4, 4, batchPageBooks },
+    { "PAGE_READERS", 4, 4, batchPageReaders },
+};
+
+/**
+ * @brief Splits a line into tab-separated fields in place
+ * @param line The line, without its line break
+ * @param fields Receives the fields, followed by NULL
+ * @return int Number of fields, or -1 if there are more than BATCH_FIELDS
+ */
+static int splitFields(char *line, char **fields) {
+    int count = 0;
+    while (count < BATCH_FIELDS) {
+        fields[count++] = line;
+        char *tab = strchr(line, '\t');
+        if (tab == NULL) {
+            fields[count] = NULL;
+            return count;
+        }
+        *tab = 0;
+        line = tab + 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Runs one command line
+ * @param line The line, without its line break
+ * @param bookCount Pointer to the current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Pointer to the current number of borrowings
+ * @param out Receives the result line
+ * @return int 1 if the command succeeded, 0 otherwise
+ */
+static int runCommand(char *line, int *bookCount, int readerCount, int *borrowingCount, FILE *out) {
+    char *fields[BATCH_FIELDS + 1];
+    int count = splitFields(line, fields);
+    if (count == -1) {
+        return batchError(out, "syntax");
+    }
+    for (size_t i = 0; i < sizeof(batchCommands) / sizeof(batchCommands[0]); i++) {
+        const BatchCommand *command = &batchCommands[i];
+        if (strcmp(fields[0], command->name) == 0) {
+            if (count < command->minFields || count > command->maxFields) {
+                return batchError(out, "syntax");
+            }
+            return command->run(fields, bookCount, readerCount, borrowingCount, out);
+        }
+    }
+    return batchError(out, "unknown_command");
+}
+
+// Opens the stream batch results are written to
+FILE *openBatchResults(void) {
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd == -1 || dup2(STDERR_FILENO, STDOUT_FILENO) == -1) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return stdout;
+    }
+    FILE *results = fdopen(fd, "w");
+    if (results == NULL) {
+        close(fd);
+        return stdout;
+    }
+    return results;
+}
+
+// Results of the commands run since the last commit, held in memory
+typedef struct {
+    FILE *stream;
+    char *data;
+    size_t size;
+} BatchResults;
+
+// Starts holding back a new group of results; returns 0 if memory runs out
+static int openBatchGroup(BatchResults *group) {
+    group->data = NULL;
+    group->size = 0;
+    group->stream = open_memstream(&group->data, &group->size);
+    return group->stream != NULL;
+}
+
+/**
+ * @brief Commits the journal, then releases the results of the commands
+ * @param group The results held back since the last commit; emptied
+ * @param out The stream the results are released to
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return int 1 on success, 0 if memory for the next group could not be
+ *             allocated
+ *
+ * The results are kept in memory however long they get, so none of them
+ * reaches the client before the changes they report are in the journal.
+ */
+static int commitBatch(BatchResults *group, FILE *out, int bookCount, int readerCount, int borrowingCount) {
+    if (!journalCommit()) {
+        printf("Error writing journal, changes are only saved on exit.\n");
+    }
+    fclose(group->stream);
+    fwrite(group->data, 1, group->size, out);
+    free(group->data);
+    fflush(out);
+    checkpointIfDue(bookCount, readerCount, borrowingCount);
+    return openBatchGroup(group);
+}
+
+// Runs the commands of a batch file
+int runBatch(FILE *in, FILE *out, int *bookCount, int readerCount, int *borrowingCount) {
+    char line[BATCH_LINE];
+    int commands = 0;
+    int failed = 0;
+    int pending = 0;
+    BatchResults group;
+    if (!openBatchGroup(&group)) {
+        printf("Not enough memory to run the batch.\n");
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in) != NULL) {
+        size_t length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            // Skip the rest of a line that does not fit
+            int c;
+            while ((c = fgetc(in)) != '\n' && c != EOF);
+            commands++;
+            failed++;
+            batchError(group.stream, "too_long");
+            continue;
+        }
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = 0;
+        }
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        commands++;
+        if (!runCommand(line, bookCount, readerCount, borrowingCount, group.stream)) {
+            failed++;
+        }
+        if (++pending == BATCH_COMMIT_EVERY) {
+            if (!commitBatch(&group, out, *bookCount, readerCount, *borrowingCount)) {
+                printf("Not enough memory to run the rest of the batch.\n");
+                return failed + 1;
+            }
+            pending = 0;
+        }
+    }
+    if (commitBatch(&group, out, *bookCount, readerCount, *borrowingCount)) {
+        fclose(group.stream);
+        free(group.data);
+    }
+    printf("Ran %d commands, %d failed.\n", commands, failed);
+    return failed;
+}
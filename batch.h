@@ -0,0 +1,60 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+// Commands run between two journal commits in batch mode
+#define BATCH_COMMIT_EVERY 1024
+
+/**
+ * @brief Opens the stream batch results are written to
+ * @return FILE* The original standard output
+ *
+ * Standard output is pointed at standard error afterwards, so the
+ * messages printed while loading and saving the library do not mix with
+ * the results.
+ */
+FILE *openBatchResults(void);
+
+/**
+ * @brief Runs the commands of a batch file
+ * @param in The commands, one per line
+ * @param out Receives one result line per command
+ * @param bookCount Pointer to the current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Pointer to the current number of borrowings
+ * @return int Number of commands that failed
+ *
+ * Fields are separated by tabs. Commands:
+ *   ADD_BOOK ISBN title author publisher year category price quantity
+ *   DELETE_BOOK ISBN
+ *   FIND_ISBN ISBN
+ *   BORROW readerID ISBN [ISBN...]
+ *   RETURN borrowing
+ *   AGGREGATE table keys aggregates  (see runAggregation)
+ *   FILTER_BOOKS yearFrom yearTo priceFrom priceTo minQuantity
+ *   COUNT_DUE time  (open borrowings due before a Unix time)
+ *   RANGE_BOOKS year|price|quantity low high asc|desc limit  (0 for no limit)
+ *   FACETS category publisher decade  (values joined by '|', "-" for any)
+ *   PAGE_BOOKS from|after|before ISBN size  ("-" for the first or last page)
+ *   PAGE_READERS from|after|before ID size
+ * Blank lines and lines starting with '#' are skipped. Each command gets
+ * "OK" followed by its results, or "ERR" followed by the reason, as
+ * tab-separated fields. AGGREGATE answers "OK" and the number of groups,
+ * then a header line and one line per group. FILTER_BOOKS answers the
+ * number of live books within the inclusive bounds and the value of their
+ * stock. RANGE_BOOKS answers "OK" and the number of books, then one line
+ * per book with the fields FIND_ISBN gives. FACETS answers "OK" and the
+ * number of books with one of the values picked for every facet, then one
+ * line per facet value: the facet, the value and the number of books
+ * picking it would give (see countBookFacets). PAGE_BOOKS and PAGE_READERS
+ * answer "OK", the number of rows on the page and the cursors of the pages
+ * before and after it ("-" when there is none), then one line per book
+ * with the fields FIND_ISBN gives or per reader with its ID, name, email,
+ * phone, address and membership year; the previous page is "before" its
+ * cursor and the next page "after" it. Results are only written
+ * out once the changes before them are committed to the journal.
+ */
+int runBatch(FILE *in, FILE *out, int *bookCount, int readerCount, int *borrowingCount);
+
+#endif // BATCH_H
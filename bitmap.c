@@ -0,0 +1,702 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BITMAP_POPCNT 1
+#endif
+
+// A bitmap container that shrinks to this many rows turns back into an
+// array. It is well below BITMAP_ARRAY_LIMIT so a row added and removed
+// at the limit does not convert the container every time.
+#define BITMAP_SHRINK_LIMIT (BITMAP_ARRAY_LIMIT / 2)
+
+// Arrays bitmapAndCardinalities spreads out into words have more rows
+// than this; below it, testing each row costs less than ANDing every word
+#define BITMAP_DENSE_LIMIT (BITMAP_WORDS / 2)
+
+// Counts the set bits of a container's words, or of two ANDed together
+typedef int (*BitCounter)(const unsigned long long *a, const unsigned long long *b);
+
+/**
+ * @brief Counts set bits with the portable popcount
+ * @param a The words of a bitmap container
+ * @param b Words to AND with them, or NULL to count a alone
+ * @return int Number of set bits
+ */
+static int countBitsScalar(const unsigned long long *a, const unsigned long long *b) {
+    int count = 0;
+    if (b == NULL) {
+        for (int i = 0; i < BITMAP_WORDS; i++) {
+            count += __builtin_popcountll(a[i]);
+        }
+        return count;
+    }
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        count += __builtin_popcountll(a[i] & b[i]);
+    }
+    return count;
+}
+
+#ifdef BITMAP_POPCNT
+/**
+ * @brief Counts set bits with the POPCNT instruction
+ * @param a The words of a bitmap container
+ * @param b Words to AND with them, or NULL to count a alone
+ * @return int Number of set bits
+ *
+ * Without it the compiler calls a library routine for every word.
+ */
+__attribute__((target("popcnt")))
+static int countBitsPopcnt(const unsigned long long *a, const unsigned long long *b) {
+    long long count = 0;
+    if (b == NULL) {
+        for (int i = 0; i < BITMAP_WORDS; i += 4) {
+            count += __builtin_popcountll(a[i]) + __builtin_popcountll(a[i + 1]) +
+                     __builtin_popcountll(a[i + 2]) + __builtin_popcountll(a[i + 3]);
+        }
+        return (int)count;
+    }
+    for (int i = 0; i < BITMAP_WORDS; i += 4) {
+        count += __builtin_popcountll(a[i] & b[i]) + __builtin_popcountll(a[i + 1] & b[i + 1]) +
+                 __builtin_popcountll(a[i + 2] & b[i + 2]) + __builtin_popcountll(a[i + 3] & b[i + 3]);
+    }
+    return (int)count;
+}
+#endif
+
+// Returns the fastest bit counter the processor runs
+static BitCounter bitCounter(void) {
+    static BitCounter counter = NULL;
+    if (counter == NULL) {
+#ifdef BITMAP_POPCNT
+        __builtin_cpu_init();
+        counter = __builtin_cpu_supports("popcnt") ? countBitsPopcnt : countBitsScalar;
+#else
+        counter = countBitsScalar;
+#endif
+    }
+    return counter;
+}
+
+// Returns non-zero if a row's low bits are set in a bitmap container
+static int hasBit(const unsigned long long *words, unsigned short low) {
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+// Frees the memory of a container
+static void freeContainer(BitmapContainer *container) {
+    free(container->values);
+    free(container->words);
+}
+
+/**
+ * @brief Finds the container of a key
+ * @param bitmap The bitmap
+ * @param key High 16 bits of a row
+ * @return int Position of the container, or -(position it belongs at) - 1
+ */
+static int findContainer(const Bitmap *bitmap, unsigned short key) {
+    int low = 0;
+    int high = bitmap->count;
+    if (high > 0 && bitmap->containers[high - 1].key < key) {
+        return -high - 1;
+    }
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (bitmap->containers[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < bitmap->count && bitmap->containers[low].key == key) {
+        return low;
+    }
+    return -low - 1;
+}
+
+/**
+ * @brief Adds an empty array container
+ * @param bitmap The bitmap
+ * @param position Position of the new container
+ * @param key High 16 bits of its rows
+ * @return BitmapContainer* The container, or NULL if memory could not be allocated
+ */
+static BitmapContainer *insertContainer(Bitmap *bitmap, int position, unsigned short key) {
+    if (bitmap->count == bitmap->capacity) {
+        int capacity = bitmap->capacity == 0 ? 4 : bitmap->capacity * 2;
+        BitmapContainer *containers = realloc(bitmap->containers, sizeof(BitmapContainer) * capacity);
+        if (containers == NULL) {
+            return NULL;
+        }
+        bitmap->containers = containers;
+        bitmap->capacity = capacity;
+    }
+    memmove(&bitmap->containers[position + 1], &bitmap->containers[position],
+            sizeof(BitmapContainer) * (bitmap->count - position));
+    bitmap->count++;
+    BitmapContainer *container = &bitmap->containers[position];
+    memset(container, 0, sizeof(BitmapContainer));
+    container->key = key;
+    return container;
+}
+
+// Frees a container and closes the gap it leaves
+static void removeContainer(Bitmap *bitmap, int position) {
+    freeContainer(&bitmap->containers[position]);
+    memmove(&bitmap->containers[position], &bitmap->containers[position + 1],
+            sizeof(BitmapContainer) * (bitmap->count - position - 1));
+    bitmap->count--;
+}
+
+/**
+ * @brief Finds where a value belongs in an array container
+ * @param container The array container
+ * @param low The low 16 bits of a row
+ * @return int Position of the first value not below it
+ *
+ * Rows are mostly added in order, so the end is tried first.
+ */
+static int valuePosition(const BitmapContainer *container, unsigned short low) {
+    int lowest = 0;
+    int highest = container->cardinality;
+    if (highest == 0 || container->values[highest - 1] < low) {
+        return highest;
+    }
+    while (lowest < highest) {
+        int middle = lowest + (highest - lowest) / 2;
+        if (container->values[middle] < low) {
+            lowest = middle + 1;
+        } else {
+            highest = middle;
+        }
+    }
+    return lowest;
+}
+
+/**
+ * @brief Turns an array container into a bitmap container
+ * @param container The array container
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int toBitmapContainer(BitmapContainer *container) {
+    unsigned long long *words = calloc(BITMAP_WORDS, sizeof(unsigned long long));
+    if (words == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < container->cardinality; i++) {
+        unsigned short low = container->values[i];
+        words[low >> 6] |= 1ULL << (low & 63);
+    }
+    free(container->values);
+    container->values = NULL;
+    container->capacity = 0;
+    container->words = words;
+    return 1;
+}
+
+/**
+ * @brief Turns a bitmap container into an array container
+ * @param container The bitmap container
+ * @return int 1 on success, 0 if memory could not be allocated (the
+ *             container is then left as it was)
+ */
+static int toArrayContainer(BitmapContainer *container) {
+    unsigned short *values = malloc(sizeof(unsigned short) * (container->cardinality + 1));
+    if (values == NULL) {
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        unsigned long long word = container->words[i];
+        while (word != 0) {
+            values[count++] = (unsigned short)(i * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free(container->words);
+    container->words = NULL;
+    container->values = values;
+    container->capacity = container->cardinality + 1;
+    return 1;
+}
+
+/**
+ * @brief Copies a container
+ * @param target Receives the copy
+ * @param source The container to copy
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int copyContainer(BitmapContainer *target, const BitmapContainer *source) {
+    *target = *source;
+    if (source->words != NULL) {
+        target->words = malloc(sizeof(unsigned long long) * BITMAP_WORDS);
+        if (target->words == NULL) {
+            return 0;
+        }
+        memcpy(target->words, source->words, sizeof(unsigned long long) * BITMAP_WORDS);
+        return 1;
+    }
+    target->capacity = source->cardinality + 1;
+    target->values = malloc(sizeof(unsigned short) * target->capacity);
+    if (target->values == NULL) {
+        return 0;
+    }
+    memcpy(target->values, source->values, sizeof(unsigned short) * source->cardinality);
+    return 1;
+}
+
+// Adds a row to a bitmap
+int bitmapAdd(Bitmap *bitmap, int row) {
+    unsigned short key = (unsigned short)((unsigned int)row >> 16);
+    unsigned short low = (unsigned short)(row & 0xFFFF);
+    int position = findContainer(bitmap, key);
+    BitmapContainer *container;
+    if (position >= 0) {
+        container = &bitmap->containers[position];
+    } else {
+        position = -position - 1;
+        container = insertContainer(bitmap, position, key);
+        if (container == NULL) {
+            return 0;
+        }
+    }
+
+    if (container->words != NULL) {
+        if (!hasBit(container->words, low)) {
+            container->words[low >> 6] |= 1ULL << (low & 63);
+            container->cardinality++;
+        }
+        return 1;
+    }
+    int at = valuePosition(container, low);
+    if (at < container->cardinality && container->values[at] == low) {
+        return 1;
+    }
+    if (container->cardinality == BITMAP_ARRAY_LIMIT) {
+        if (!toBitmapContainer(container)) {
+            return 0;
+        }
+        container->words[low >> 6] |= 1ULL << (low & 63);
+        container->cardinality++;
+        return 1;
+    }
+    if (container->cardinality == container->capacity) {
+        int capacity = container->capacity == 0 ? 4 : container->capacity * 2;
+        if (capacity > BITMAP_ARRAY_LIMIT) {
+            capacity = BITMAP_ARRAY_LIMIT;
+        }
+        unsigned short *values = realloc(container->values, sizeof(unsigned short) * capacity);
+        if (values == NULL) {
+            if (container->cardinality == 0) {
+                removeContainer(bitmap, position);
+            }
+            return 0;
+        }
+        container->values = values;
+        container->capacity = capacity;
+    }
+    memmove(&container->values[at + 1], &container->values[at],
+            sizeof(unsigned short) * (container->cardinality - at));
+    container->values[at] = low;
+    container->cardinality++;
+    return 1;
+}
+
+// Removes a row from a bitmap
+void bitmapRemove(Bitmap *bitmap, int row) {
+    unsigned short low = (unsigned short)(row & 0xFFFF);
+    int position = findContainer(bitmap, (unsigned short)((unsigned int)row >> 16));
+    if (position < 0) {
+        return;
+    }
+    BitmapContainer *container = &bitmap->containers[position];
+    if (container->words != NULL) {
+        if (!hasBit(container->words, low)) {
+            return;
+        }
+        container->words[low >> 6] &= ~(1ULL << (low & 63));
+        container->cardinality--;
+        if (container->cardinality <= BITMAP_SHRINK_LIMIT) {
+            toArrayContainer(container);
+        }
+    } else {
+        int at = valuePosition(container, low);
+        if (at == container->cardinality || container->values[at] != low) {
+            return;
+        }
+        memmove(&container->values[at], &container->values[at + 1],
+                sizeof(unsigned short) * (container->cardinality - at - 1));
+        container->cardinality--;
+    }
+    if (container->cardinality == 0) {
+        removeContainer(bitmap, position);
+    }
+}
+
+// Returns the number of rows in a bitmap
+int bitmapCardinality(const Bitmap *bitmap) {
+    int count = 0;
+    for (int i = 0; i < bitmap->count; i++) {
+        count += bitmap->containers[i].cardinality;
+    }
+    return count;
+}
+
+// Makes a bitmap hold the same rows as another
+int bitmapCopy(Bitmap *target, const Bitmap *source) {
+    bitmapFree(target);
+    if (source->count == 0) {
+        return 1;
+    }
+    target->containers = malloc(sizeof(BitmapContainer) * source->count);
+    if (target->containers == NULL) {
+        return 0;
+    }
+    target->capacity = source->count;
+    for (int i = 0; i < source->count; i++) {
+        if (!copyContainer(&target->containers[i], &source->containers[i])) {
+            bitmapFree(target);
+            return 0;
+        }
+        target->count++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Works out the rows two containers have in common
+ * @param result Receives the rows, an empty array container on failure
+ * @param a The first container
+ * @param b A container with the same key
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * The result of two bitmap containers stays a bitmap container even when
+ * it holds few rows: intersections are mostly counted against other
+ * bitmaps straight away, and an array would have to be turned back.
+ */
+static int andContainers(BitmapContainer *result, const BitmapContainer *a, const BitmapContainer *b) {
+    memset(result, 0, sizeof(BitmapContainer));
+    result->key = a->key;
+    if (a->words != NULL && b->words != NULL) {
+        result->words = malloc(sizeof(unsigned long long) * BITMAP_WORDS);
+        if (result->words == NULL) {
+            return 0;
+        }
+        for (int i = 0; i < BITMAP_WORDS; i++) {
+            result->words[i] = a->words[i] & b->words[i];
+        }
+        result->cardinality = bitCounter()(result->words, NULL);
+        return 1;
+    }
+
+    if (a->words != NULL) {
+        const BitmapContainer *swap = a;
+        a = b;
+        b = swap;
+    }
+    // The result is a subset of the array a
+    result->values = malloc(sizeof(unsigned short) * (a->cardinality + 1));
+    if (result->values == NULL) {
+        return 0;
+    }
+    result->capacity = a->cardinality + 1;
+    int count = 0;
+    if (b->words != NULL) {
+        for (int i = 0; i < a->cardinality; i++) {
+            if (hasBit(b->words, a->values[i])) {
+                result->values[count++] = a->values[i];
+            }
+        }
+    } else {
+        for (int i = 0, j = 0; i < a->cardinality && j < b->cardinality;) {
+            if (a->values[i] < b->values[j]) {
+                i++;
+            } else if (a->values[i] > b->values[j]) {
+                j++;
+            } else {
+                result->values[count++] = a->values[i];
+                i++;
+                j++;
+            }
+        }
+    }
+    result->cardinality = count;
+    return 1;
+}
+
+// Works out the rows two bitmaps have in common
+int bitmapAnd(Bitmap *result, const Bitmap *a, const Bitmap *b) {
+    bitmapFree(result);
+    int most = a->count < b->count ? a->count : b->count;
+    if (most == 0) {
+        return 1;
+    }
+    result->containers = malloc(sizeof(BitmapContainer) * most);
+    if (result->containers == NULL) {
+        return 0;
+    }
+    result->capacity = most;
+    for (int i = 0, j = 0; i < a->count && j < b->count;) {
+        if (a->containers[i].key < b->containers[j].key) {
+            i++;
+        } else if (a->containers[i].key > b->containers[j].key) {
+            j++;
+        } else {
+            BitmapContainer *container = &result->containers[result->count];
+            if (!andContainers(container, &a->containers[i], &b->containers[j])) {
+                freeContainer(container);
+                bitmapFree(result);
+                return 0;
+            }
+            if (container->cardinality > 0) {
+                result->count++;
+            } else {
+                freeContainer(container);
+            }
+            i++;
+            j++;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Adds the rows of a container to another
+ * @param target The container to widen
+ * @param other A container with the same key
+ * @return int 1 on success, 0 if memory could not be allocated (the
+ *             target then still holds its own rows)
+ */
+static int orContainer(BitmapContainer *target, const BitmapContainer *other) {
+    if (target->words == NULL && other->words == NULL &&
+        target->cardinality + other->cardinality <= BITMAP_ARRAY_LIMIT) {
+        unsigned short *values = malloc(sizeof(unsigned short) * (target->cardinality + other->cardinality + 1));
+        if (values == NULL) {
+            return 0;
+        }
+        int count = 0;
+        int i = 0;
+        int j = 0;
+        while (i < target->cardinality || j < other->cardinality) {
+            if (j == other->cardinality || (i < target->cardinality && target->values[i] < other->values[j])) {
+                values[count++] = target->values[i++];
+            } else if (i == target->cardinality || other->values[j] < target->values[i]) {
+                values[count++] = other->values[j++];
+            } else {
+                values[count++] = target->values[i++];
+                j++;
+            }
+        }
+        free(target->values);
+        target->values = values;
+        target->capacity = target->cardinality + other->cardinality + 1;
+        target->cardinality = count;
+        return 1;
+    }
+
+    if (target->words == NULL) {
+        if (other->words != NULL) {
+            // Start from a copy of the other bitmap and set the array's rows
+            unsigned long long *words = malloc(sizeof(unsigned long long) * BITMAP_WORDS);
+            if (words == NULL) {
+                return 0;
+            }
+            memcpy(words, other->words, sizeof(unsigned long long) * BITMAP_WORDS);
+            int count = other->cardinality;
+            for (int i = 0; i < target->cardinality; i++) {
+                unsigned short low = target->values[i];
+                if (!hasBit(words, low)) {
+                    words[low >> 6] |= 1ULL << (low & 63);
+                    count++;
+                }
+            }
+            free(target->values);
+            target->values = NULL;
+            target->capacity = 0;
+            target->words = words;
+            target->cardinality = count;
+            return 1;
+        }
+        if (!toBitmapContainer(target)) {
+            return 0;
+        }
+    }
+
+    if (other->words == NULL) {
+        for (int i = 0; i < other->cardinality; i++) {
+            unsigned short low = other->values[i];
+            if (!hasBit(target->words, low)) {
+                target->words[low >> 6] |= 1ULL << (low & 63);
+                target->cardinality++;
+            }
+        }
+        return 1;
+    }
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        target->words[i] |= other->words[i];
+    }
+    target->cardinality = bitCounter()(target->words, NULL);
+    return 1;
+}
+
+// Adds the rows of another bitmap to a bitmap
+int bitmapOr(Bitmap *target, const Bitmap *other) {
+    if (other->count == 0) {
+        return 1;
+    }
+    BitmapContainer *merged = malloc(sizeof(BitmapContainer) * (target->count + other->count));
+    if (merged == NULL) {
+        bitmapFree(target);
+        return 0;
+    }
+    int count = 0;
+    int failed = 0;
+    int i = 0;
+    int j = 0;
+    while (i < target->count || j < other->count) {
+        if (j == other->count || (i < target->count && target->containers[i].key < other->containers[j].key)) {
+            merged[count++] = target->containers[i++];
+        } else if (i == target->count || other->containers[j].key < target->containers[i].key) {
+            if (!failed && copyContainer(&merged[count], &other->containers[j])) {
+                count++;
+            } else {
+                failed = 1;
+            }
+            j++;
+        } else {
+            merged[count] = target->containers[i++];
+            if (!failed && !orContainer(&merged[count], &other->containers[j])) {
+                failed = 1;
+            }
+            count++;
+            j++;
+        }
+    }
+    free(target->containers);
+    target->containers = merged;
+    target->count = count;
+    target->capacity = i + j;
+    if (failed) {
+        bitmapFree(target);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Counts the rows two containers have in common
+ * @param a The first container
+ * @param b A container with the same key
+ * @return int Number of rows in both
+ */
+static int andContainerCardinality(const BitmapContainer *a, const BitmapContainer *b) {
+    if (a->words != NULL && b->words != NULL) {
+        return bitCounter()(a->words, b->words);
+    }
+    if (a->words != NULL) {
+        const BitmapContainer *swap = a;
+        a = b;
+        b = swap;
+    }
+    int count = 0;
+    if (b->words != NULL) {
+        for (int i = 0; i < a->cardinality; i++) {
+            count += hasBit(b->words, a->values[i]);
+        }
+        return count;
+    }
+    for (int i = 0, j = 0; i < a->cardinality && j < b->cardinality;) {
+        if (a->values[i] < b->values[j]) {
+            i++;
+        } else if (a->values[i] > b->values[j]) {
+            j++;
+        } else {
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+// Counts the rows two bitmaps have in common
+int bitmapAndCardinality(const Bitmap *a, const Bitmap *b) {
+    int count = 0;
+    for (int i = 0, j = 0; i < a->count && j < b->count;) {
+        if (a->containers[i].key < b->containers[j].key) {
+            i++;
+        } else if (a->containers[i].key > b->containers[j].key) {
+            j++;
+        } else {
+            count += andContainerCardinality(&a->containers[i], &b->containers[j]);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+// Counts the rows a bitmap has in common with each of several others
+void bitmapAndCardinalities(const Bitmap *base, const Bitmap *others, int count, int *counts) {
+    unsigned long long words[BITMAP_WORDS];
+    for (int i = 0; i < count; i++) {
+        counts[i] = 0;
+    }
+    for (int i = 0; i < base->count; i++) {
+        const BitmapContainer *container = &base->containers[i];
+        BitmapContainer dense;
+        if (container->words == NULL && container->cardinality > BITMAP_DENSE_LIMIT) {
+            // Spread the array out once for all the others
+            memset(words, 0, sizeof(words));
+            for (int j = 0; j < container->cardinality; j++) {
+                words[container->values[j] >> 6] |= 1ULL << (container->values[j] & 63);
+            }
+            dense = *container;
+            dense.values = NULL;
+            dense.words = words;
+            container = &dense;
+        }
+        for (int j = 0; j < count; j++) {
+            int position = findContainer(&others[j], container->key);
+            if (position >= 0) {
+                counts[j] += andContainerCardinality(container, &others[j].containers[position]);
+            }
+        }
+    }
+}
+
+// Lists the rows of a bitmap in order
+int bitmapRows(const Bitmap *bitmap, int *rows) {
+    int count = 0;
+    for (int i = 0; i < bitmap->count; i++) {
+        const BitmapContainer *container = &bitmap->containers[i];
+        int base = (int)container->key << 16;
+        if (container->words == NULL) {
+            for (int j = 0; j < container->cardinality; j++) {
+                rows[count++] = base | container->values[j];
+            }
+            continue;
+        }
+        for (int j = 0; j < BITMAP_WORDS; j++) {
+            unsigned long long word = container->words[j];
+            while (word != 0) {
+                rows[count++] = base + j * 64 + __builtin_ctzll(word);
+                word &= word - 1;
+            }
+        }
+    }
+    return count;
+}
+
+// Empties a bitmap and frees its memory
+void bitmapFree(Bitmap *bitmap) {
+    for (int i = 0; i < bitmap->count; i++) {
+        freeContainer(&bitmap->containers[i]);
+    }
+    free(bitmap->containers);
+    bitmap->containers = NULL;
+    bitmap->count = 0;
+    bitmap->capacity = 0;
+}
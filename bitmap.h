@@ -0,0 +1,131 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+// Rows up to which a container stays a sorted array
+#define BITMAP_ARRAY_LIMIT 4096
+
+// 64-bit words of a bitmap container, one bit per row of its 65536
+#define BITMAP_WORDS 1024
+
+// The rows of a bitmap sharing the same high 16 bits. A sparse container
+// is a sorted array of the low 16 bits; once it holds more than
+// BITMAP_ARRAY_LIMIT rows it becomes a bitmap of 65536 bits, which is then
+// the smaller of the two (8 KB).
+typedef struct {
+    unsigned short key;         // High 16 bits of the rows
+    int cardinality;            // Rows in the container
+    int capacity;               // Room in values
+    unsigned short *values;     // Sorted low 16 bits, NULL for a bitmap container
+    unsigned long long *words;  // BITMAP_WORDS words, NULL for an array container
+} BitmapContainer;
+
+// Compressed set of rows in the style of Roaring bitmaps: the containers
+// are kept sorted by key, so AND and OR walk two bitmaps side by side one
+// container at a time, and a bitmap container is combined 64 rows per
+// word and counted with popcount. Empty containers are dropped.
+typedef struct {
+    BitmapContainer *containers;
+    int count;
+    int capacity;
+} Bitmap;
+
+#define BITMAP_INIT { NULL, 0, 0 }
+
+/**
+ * @brief Adds a row to a bitmap
+ * @param bitmap The bitmap
+ * @param row The row, not negative
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int bitmapAdd(Bitmap *bitmap, int row);
+
+/**
+ * @brief Removes a row from a bitmap
+ * @param bitmap The bitmap
+ * @param row The row; nothing happens if it is not in the bitmap
+ * @return void
+ */
+void bitmapRemove(Bitmap *bitmap, int row);
+
+/**
+ * @brief Returns the number of rows in a bitmap
+ * @param bitmap The bitmap
+ * @return int Number of rows
+ */
+int bitmapCardinality(const Bitmap *bitmap);
+
+/**
+ * @brief Makes a bitmap hold the same rows as another
+ * @param target The bitmap to overwrite
+ * @param source The rows to copy
+ * @return int 1 on success, 0 if memory could not be allocated (target is
+ *             then left empty)
+ */
+int bitmapCopy(Bitmap *target, const Bitmap *source);
+
+/**
+ * @brief Works out the rows two bitmaps have in common
+ * @param result Receives the rows; its old rows are dropped. Must not be
+ *               a or b.
+ * @param a The first bitmap
+ * @param b The second bitmap
+ * @return int 1 on success, 0 if memory could not be allocated (result is
+ *             then left empty)
+ *
+ * Where both have a bitmap container the result keeps one, however few
+ * rows it holds, since intersections are mostly counted against other
+ * bitmaps straight away.
+ */
+int bitmapAnd(Bitmap *result, const Bitmap *a, const Bitmap *b);
+
+/**
+ * @brief Adds the rows of another bitmap to a bitmap
+ * @param target The bitmap to widen
+ * @param other The rows to add
+ * @return int 1 on success, 0 if memory could not be allocated (target is
+ *             then left empty)
+ */
+int bitmapOr(Bitmap *target, const Bitmap *other);
+
+/**
+ * @brief Counts the rows two bitmaps have in common
+ * @param a The first bitmap
+ * @param b The second bitmap
+ * @return int Number of rows in both
+ *
+ * Nothing is allocated: bitmap containers are ANDed and popcounted word
+ * by word, which is how facet counts are worked out.
+ */
+int bitmapAndCardinality(const Bitmap *a, const Bitmap *b);
+
+/**
+ * @brief Counts the rows a bitmap has in common with each of several others
+ * @param base The bitmap
+ * @param others The other bitmaps
+ * @param count Number of other bitmaps
+ * @param counts Receives, for each other bitmap, the rows it shares with base
+ * @return void
+ *
+ * Gives the same counts as calling bitmapAndCardinality for each, but
+ * goes over base once: a large array container of base is spread out into
+ * words for all the others, so every pair is counted a word at a time.
+ * This is how a facet's counts are worked out.
+ */
+void bitmapAndCardinalities(const Bitmap *base, const Bitmap *others, int count, int *counts);
+
+/**
+ * @brief Lists the rows of a bitmap in order
+ * @param bitmap The bitmap
+ * @param rows Receives the rows; room for bitmapCardinality rows
+ * @return int Number of rows
+ */
+int bitmapRows(const Bitmap *bitmap, int *rows);
+
+/**
+ * @brief Empties a bitmap and frees its memory
+ * @param bitmap The bitmap
+ * @return void
+ */
+void bitmapFree(Bitmap *bitmap);
+
+#endif // BITMAP_H
@@ -1,18 +1,576 @@
 #include "book.h"
 #include "library.h"
+#include "trigram.h"
+#include "normalize.h"
+#include "journal.h"
+#include "counters.h"
+#include "columns.h"
+#include "substring.h"
+#include "rangeindex.h"
+#include "facetindex.h"
+#include "output.h"
 #include <ctype.h>
 
-// Define the array of books
-Book books[MAX_BOOKS];
+// Define the table of books
+Table bookTable = TABLE_INIT(Book);
 
-// Function to find a book by ISBN
-int findBookByISBN(int bookCount, const char *ISBN) {
+// Define the arena holding the text of books
+TextArena bookText = TEXT_ARENA_INIT;
+
+// Hash index from ISBN to book row
+static HashIndex isbnIndex = HASH_INDEX_INIT;
+
+// Rows of deleted books, reused before the table grows
+static int *freeRows = NULL;
+static int freeCount = 0;
+static int freeCapacity = 0;
+
+// Rows of deleted books, including any that could not be put on the free
+// list, so the live count does not depend on the list growing
+static int deletedCount = 0;
+
+// Trigram indexes over the title and author search keys
+static TrigramIndex titleTrigrams = TRIGRAM_INDEX_INIT;
+static TrigramIndex authorTrigrams = TRIGRAM_INDEX_INIT;
+
+// The trigram indexes are only built by the first substring search after
+// a load, so startup does not pay for them; until then changes skip them
+static int trigramsBuilt = 0;
+
+// Title and author search keys of the live books packed back to back,
+// scanned by searches the trigram indexes cannot narrow. Dropped when a
+// key changes or a book is removed, and packed again by the next such
+// search.
+static PackedText titleKeys = PACKED_TEXT_INIT;
+static PackedText authorKeys = PACKED_TEXT_INIT;
+static int keysPacked = 0;
+
+static double bookISBNKey(int row) { return (double)bookAt(row)->ISBN; }
+static double bookYearKey(int row) { return bookAt(row)->publishYear; }
+static double bookPriceKey(int row) { return bookAt(row)->price; }
+static double bookQuantityKey(int row) { return bookAt(row)->quantity; }
+
+// Range indexes on the numeric fields of the live books. Like the trigram
+// indexes they are only built by the first range query after a load and
+// kept in sync from then on; if an update runs out of memory they are
+// dropped and built again by the next query. The ISBN index gives the
+// order books are listed in page by page (ISBNs have at most 13 digits,
+// so a double holds them exactly).
+enum { BOOK_RANGE_ISBN, BOOK_RANGE_YEAR, BOOK_RANGE_PRICE, BOOK_RANGE_QUANTITY, BOOK_RANGE_COUNT };
+static RangeIndex bookRanges[BOOK_RANGE_COUNT] = {
+    RANGE_INDEX("isbn", bookISBNKey),
+    RANGE_INDEX("year", bookYearKey),
+    RANGE_INDEX("price", bookPriceKey),
+    RANGE_INDEX("quantity", bookQuantityKey),
+};
+static int rangesBuilt = 0;
+
+static int bookCategoryValue(int row) { return (int)bookAt(row)->category; }
+static int bookPublisherValue(int row) { return (int)bookAt(row)->publisher; }
+static int bookDecadeValue(int row) { return bookAt(row)->publishYear / 10 * 10; }
+
+// Bitmap indexes for browsing the live books by facet, in the order of
+// the BOOK_FACET_* constants. Built by the first faceted query and kept in
+// sync like the range indexes.
+static FacetIndex bookFacets[BOOK_FACET_COUNT] = {
+    FACET_INDEX("category", bookCategoryValue),
+    FACET_INDEX("publisher", bookPublisherValue),
+    FACET_INDEX("decade", bookDecadeValue),
+};
+static int facetsBuilt = 0;
+
+// Values listed for each facet while browsing by facets
+#define MAX_FACET_SHOWN 10
+
+// Fields a substring search looks at
+#define SEARCH_TITLE 1
+#define SEARCH_AUTHOR 2
+
+// Returns non-zero when the book at the given row has the ISBN
+static int bookHasISBN(int row, const void *ISBN) {
+    return bookAt(row)->ISBN == *(const unsigned long long *)ISBN;
+}
+
+/**
+ * @brief Parses an ISBN-10 or ISBN-13
+ * @param text The ISBN as typed, digits only
+ * @param ISBN Receives the ISBN as a number
+ * @return int 1 if the text is 10 digits, or 13 digits starting with 978
+ *             or 979, 0 otherwise
+ *
+ * ISBN-13 prefixes keep the two forms apart: every ISBN-13 is larger than
+ * any ISBN-10, so formatISBN knows how many digits to print.
+ */
+int parseISBN(const char *text, unsigned long long *ISBN) {
+    size_t length = strlen(text);
+    if (length != 10 && length != 13) {
+        return 0;
+    }
+    unsigned long long value = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)text[i])) {
+            return 0;
+        }
+        value = value * 10 + (unsigned long long)(text[i] - '0');
+    }
+    if (length == 13 && strncmp(text, "978", 3) != 0 && strncmp(text, "979", 3) != 0) {
+        return 0;
+    }
+    *ISBN = value;
+    return 1;
+}
+
+/**
+ * @brief Writes an ISBN with its leading zeros
+ * @param ISBN The ISBN as a number
+ * @param text Buffer of at least ISBN_LENGTH bytes
+ * @return void
+ */
+void formatISBN(unsigned long long ISBN, char *text) {
+    if (ISBN >= 10000000000ULL) {
+        snprintf(text, ISBN_LENGTH, "%013llu", ISBN % 10000000000000ULL);
+    } else {
+        snprintf(text, ISBN_LENGTH, "%010llu", ISBN % 10000000000ULL);
+    }
+}
+
+/**
+ * @brief Computes the search keys of a book's title and author
+ * @param book The book to update
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int updateBookKeys(Book *book) {
+    char titleKey[MAX_STRING];
+    char authorKey[MAX_STRING];
+    normalizeText(bookString(book->title), titleKey, MAX_STRING);
+    normalizeText(symbolText(book->author), authorKey, MAX_STRING);
+    book->authorKey = internString(authorKey);
+    keysPacked = 0;
+    return arenaReplace(&bookText, &book->titleKey, titleKey);
+}
+
+/**
+ * @brief Reads one line of text into the book text arena
+ * @param stream The stream to read from
+ * @param field The field to store the line in
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int readText(FILE *stream, TextRef *field) {
+    char text[MAX_STRING];
+    if (fgets(text, MAX_STRING, stream) == NULL) {
+        text[0] = 0;
+    }
+    text[strcspn(text, "\n")] = 0;
+    return arenaReplace(&bookText, field, text);
+}
+
+/**
+ * @brief Reads one line of text and interns it
+ * @param stream The stream to read from
+ * @return Symbol Symbol of the line without its newline
+ */
+static Symbol readSymbol(FILE *stream) {
+    char text[MAX_STRING];
+    if (fgets(text, MAX_STRING, stream) == NULL) {
+        text[0] = 0;
+    }
+    text[strcspn(text, "\n")] = 0;
+    return internString(text);
+}
+
+/**
+ * @brief Adds a book to the trigram indexes if they have been built
+ * @param row The book's row
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int addBookTrigrams(int row) {
+    if (!trigramsBuilt) {
+        return 1;
+    }
+    return trigramIndexAdd(&titleTrigrams, bookString(bookAt(row)->titleKey), row) &&
+           trigramIndexAdd(&authorTrigrams, symbolText(bookAt(row)->authorKey), row);
+}
+
+/**
+ * @brief Removes a book from the trigram indexes if they have been built
+ * @param row The book's row
+ * @return void
+ */
+static void removeBookTrigrams(int row) {
+    if (trigramsBuilt) {
+        trigramIndexRemove(&titleTrigrams, bookString(bookAt(row)->titleKey), row);
+        trigramIndexRemove(&authorTrigrams, symbolText(bookAt(row)->authorKey), row);
+    }
+}
+
+/**
+ * @brief Builds the trigram indexes unless they are already built
+ * @param bookCount Current number of books
+ * @return int 1 on success, 0 if memory could not be allocated (the
+ *             indexes are left empty and unbuilt)
+ */
+static int buildTrigramIndexes(int bookCount) {
+    if (trigramsBuilt) {
+        return 1;
+    }
+    trigramIndexClear(&titleTrigrams);
+    trigramIndexClear(&authorTrigrams);
+    trigramsBuilt = 1;
     for (int i = 0; i < bookCount; i++) {
-        if (strcmp(books[i].ISBN, ISBN) == 0) {
-            return i;
+        if (isBookLive(i) && !addBookTrigrams(i)) {
+            trigramIndexClear(&titleTrigrams);
+            trigramIndexClear(&authorTrigrams);
+            trigramsBuilt = 0;
+            return 0;
         }
     }
-    return -1;
+    return 1;
+}
+
+/**
+ * @brief Drops the range indexes so the next range query builds them
+ * @return void
+ */
+static void dropBookRanges(void) {
+    rangeIndexesClear(bookRanges, BOOK_RANGE_COUNT);
+    rangesBuilt = 0;
+}
+
+/**
+ * @brief Adds a book to the range indexes if they have been built
+ * @param row The book's row
+ * @return void
+ */
+static void addBookRanges(int row) {
+    if (rangesBuilt && !rangeIndexesInsert(bookRanges, BOOK_RANGE_COUNT, row)) {
+        dropBookRanges();
+    }
+}
+
+/**
+ * @brief Removes a book from the range indexes if they have been built
+ * @param row The book's row, still holding its values
+ * @return void
+ */
+static void removeBookRanges(int row) {
+    if (rangesBuilt) {
+        rangeIndexesRemove(bookRanges, BOOK_RANGE_COUNT, row);
+    }
+}
+
+/**
+ * @brief Builds the range indexes unless they are already built
+ * @param bookCount Current number of books
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int buildBookRanges(int bookCount) {
+    if (rangesBuilt) {
+        return 1;
+    }
+    int *rows = malloc(sizeof(int) * (bookCount + 1));
+    if (rows == NULL) {
+        return 0;
+    }
+    int live = 0;
+    for (int i = 0; i < bookCount; i++) {
+        if (isBookLive(i)) {
+            rows[live++] = i;
+        }
+    }
+    rangesBuilt = rangeIndexesBuild(bookRanges, BOOK_RANGE_COUNT, rows, live);
+    free(rows);
+    return rangesBuilt;
+}
+
+/**
+ * @brief Drops the facet indexes so the next faceted query builds them
+ * @return void
+ */
+static void dropBookFacets(void) {
+    facetIndexesClear(bookFacets, BOOK_FACET_COUNT);
+    facetsBuilt = 0;
+}
+
+/**
+ * @brief Adds a book to the facet indexes if they have been built
+ * @param row The book's row
+ * @return void
+ */
+static void addBookFacets(int row) {
+    if (facetsBuilt && !facetIndexesInsert(bookFacets, BOOK_FACET_COUNT, row)) {
+        dropBookFacets();
+    }
+}
+
+/**
+ * @brief Removes a book from the facet indexes if they have been built
+ * @param row The book's row, still holding its values
+ * @return void
+ */
+static void removeBookFacets(int row) {
+    if (facetsBuilt) {
+        facetIndexesRemove(bookFacets, BOOK_FACET_COUNT, row);
+    }
+}
+
+/**
+ * @brief Builds the facet indexes unless they are already built
+ * @param bookCount Current number of books
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Rows are added in order, so every bitmap only ever appends.
+ */
+static int buildBookFacets(int bookCount) {
+    if (facetsBuilt) {
+        return 1;
+    }
+    for (int i = 0; i < bookCount; i++) {
+        if (isBookLive(i) && !facetIndexesInsert(bookFacets, BOOK_FACET_COUNT, i)) {
+            facetIndexesClear(bookFacets, BOOK_FACET_COUNT);
+            return 0;
+        }
+    }
+    facetsBuilt = 1;
+    return 1;
+}
+
+/**
+ * @brief Packs the search keys of the live books unless they are packed
+ * @param bookCount Current number of books
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int packBookKeys(int bookCount) {
+    if (keysPacked) {
+        return 1;
+    }
+    packedTextClear(&titleKeys);
+    packedTextClear(&authorKeys);
+    for (int i = 0; i < bookCount; i++) {
+        if (!isBookLive(i)) {
+            continue;
+        }
+        const Book *book = bookAt(i);
+        const char *author = symbolText(book->authorKey);
+        if (!packedTextAppend(&titleKeys, i, bookString(book->titleKey), book->titleKey.length) ||
+            !packedTextAppend(&authorKeys, i, author, strlen(author))) {
+            return 0;
+        }
+    }
+    keysPacked = 1;
+    return 1;
+}
+
+/**
+ * @brief Puts a row on the list of free rows
+ * @param row The row of a deleted book
+ * @return int 1 on success, 0 if memory could not be allocated (the row
+ *             then stays unused until the next load)
+ */
+static int pushFreeRow(int row) {
+    if (freeCount == freeCapacity) {
+        int capacity = freeCapacity == 0 ? 64 : freeCapacity * 2;
+        int *rows = realloc(freeRows, sizeof(int) * capacity);
+        if (rows == NULL) {
+            return 0;
+        }
+        freeRows = rows;
+        freeCapacity = capacity;
+    }
+    freeRows[freeCount++] = row;
+    return 1;
+}
+
+/**
+ * @brief Picks the row the next added book goes to
+ * @param bookCount Current number of book rows
+ * @return int The row, or -1 if memory could not be allocated
+ *
+ * The row of a deleted book is reused if there is one; the row is only
+ * taken once the book is stored (see claimBookRow).
+ */
+static int nextBookRow(int bookCount) {
+    if (freeCount > 0) {
+        return freeRows[freeCount - 1];
+    }
+    if (!tableReserve(&bookTable, bookCount + 1)) {
+        return -1;
+    }
+    return bookCount;
+}
+
+/**
+ * @brief Takes the row returned by nextBookRow
+ * @param bookCount Pointer to the current number of book rows
+ * @param row The row
+ * @return void
+ */
+static void claimBookRow(int *bookCount, int row) {
+    if (row == *bookCount) {
+        (*bookCount)++;
+    } else {
+        freeCount--;
+        deletedCount--;
+    }
+}
+
+/**
+ * @brief Adds a live book to the statistics counters, or takes it out
+ * @param book The book
+ * @param sign 1 to add the book, -1 to take it out
+ * @return void
+ */
+static void countBook(const Book *book, int sign) {
+    countMapAdd(&libraryCounters.booksByCategory, (int)book->category, sign);
+    libraryCounters.inventoryValue += sign * (double)book->price * book->quantity;
+}
+
+/**
+ * @brief Returns the number of books that have not been deleted
+ * @param bookCount Current number of book rows
+ * @return int Number of live books
+ */
+int liveBookCount(int bookCount) {
+    return bookCount - deletedCount;
+}
+
+/**
+ * @brief Rebuilds the ISBN index from the book table
+ * @param bookCount Current number of books
+ * @return void
+ *
+ * The trigram indexes are dropped and rebuilt by the next substring search.
+ * The book statistics counters are recounted.
+ */
+void rebuildBookIndexes(int bookCount) {
+    hashIndexClear(&isbnIndex);
+    hashIndexReserve(&isbnIndex, bookCount);
+    countMapClear(&libraryCounters.booksByCategory);
+    libraryCounters.inventoryValue = 0;
+    freeCount = 0;
+    deletedCount = 0;
+    for (int i = 0; i < bookCount; i++) {
+        if (isBookLive(i)) {
+            hashIndexInsert(&isbnIndex, hashInteger(bookAt(i)->ISBN), i);
+            countBook(bookAt(i), 1);
+        } else {
+            pushFreeRow(i);
+            deletedCount++;
+        }
+    }
+    rebuildBookColumns(bookCount);
+    trigramsBuilt = 0;
+    keysPacked = 0;
+    dropBookRanges();
+    dropBookFacets();
+}
+
+/**
+ * @brief Makes room for books about to be added in bulk
+ * @param bookCount Current number of book rows
+ * @param rows Number of books about to be added
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int reserveBooks(int bookCount, int rows) {
+    return tableReserve(&bookTable, bookCount + rows) &&
+           hashIndexReserve(&isbnIndex, liveBookCount(bookCount) + rows);
+}
+
+/**
+ * @brief Returns the ISBN index so it can be saved with the books
+ * @return const HashIndex* The ISBN index
+ */
+const HashIndex *bookISBNIndex(void) {
+    return &isbnIndex;
+}
+
+/**
+ * @brief Restores the book indexes after the book rows were loaded
+ * @param bookCount Number of books loaded, all of them live
+ * @param isbnRows Rows array of the saved ISBN index
+ * @param isbnHashes Hashes array of the saved ISBN index
+ * @param isbnCapacity Slots in the saved ISBN index, 0 if none was saved
+ * @return void
+ *
+ * Falls back to rebuilding the ISBN index if the saved one cannot be used.
+ */
+void restoreBookIndexes(int bookCount, const int *isbnRows, const unsigned int *isbnHashes, int isbnCapacity) {
+    if (isbnCapacity == 0 || !hashIndexLoad(&isbnIndex, isbnRows, isbnHashes, isbnCapacity) ||
+        isbnIndex.size != bookCount) {
+        rebuildBookIndexes(bookCount);
+        return;
+    }
+    countMapClear(&libraryCounters.booksByCategory);
+    libraryCounters.inventoryValue = 0;
+    for (int i = 0; i < bookCount; i++) {
+        countBook(bookAt(i), 1);
+    }
+    rebuildBookColumns(bookCount);
+    freeCount = 0;
+    deletedCount = 0;
+    trigramsBuilt = 0;
+    keysPacked = 0;
+    dropBookRanges();
+    dropBookFacets();
+}
+
+// Function to find a book by ISBN
+int findBookByISBN(int bookCount, unsigned long long ISBN) {
+    int index = hashIndexFind(&isbnIndex, hashInteger(ISBN), bookHasISBN, &ISBN);
+    if (index >= bookCount) {
+        return -1;
+    }
+    return index;
+}
+
+/**
+ * @brief Finds a book by an ISBN typed by the user
+ * @param bookCount Current number of books
+ * @param text The ISBN as typed
+ * @return int Index of the book, or -1 if the text is not a valid ISBN or no book has it
+ */
+int findBookByISBNText(int bookCount, const char *text) {
+    unsigned long long ISBN;
+    if (!parseISBN(text, &ISBN)) {
+        return -1;
+    }
+    return findBookByISBN(bookCount, ISBN);
+}
+
+/**
+ * @brief Writes every field of a book to an output buffer
+ * @param out The output buffer
+ * @param book The book to print
+ * @return void
+ */
+static void printBook(OutputBuffer *out, const Book *book) {
+    char ISBN[ISBN_LENGTH];
+    formatISBN(book->ISBN, ISBN);
+    outputLine(out, "ISBN: ", ISBN);
+    outputLine(out, "Title: ", bookString(book->title));
+    outputLine(out, "Author: ", symbolText(book->author));
+    outputLine(out, "Publisher: ", symbolText(book->publisher));
+    outputText(out, "Publish Year: ");
+    outputNumber(out, book->publishYear);
+    outputLine(out, "\nCategory: ", symbolText(book->category));
+    outputText(out, "Price: ");
+    outputPrice(out, book->price);
+    outputText(out, "\nQuantity: ");
+    outputNumber(out, book->quantity);
+    outputBytes(out, "\n", 1);
+}
+
+/**
+ * @brief Writes books to an output buffer, each followed by a separator line
+ * @param out The output buffer
+ * @param rows Rows of the books
+ * @param count Number of books
+ * @return void
+ */
+static void printBooks(OutputBuffer *out, const int *rows, int count) {
+    for (int i = 0; i < count; i++) {
+        printBook(out, bookAt(rows[i]));
+        outputText(out, "----------------------------------------\n");
+    }
 }
 
 /**
@@ -23,75 +581,73 @@ int findBookByISBN(int bookCount, const char *ISBN) {
  * The user can enter book details and adds that book to the library (ensures all required fields are filled)
  */
 void addBook(int *bookCount) {
-    if (*bookCount >= MAX_BOOKS) {
-        printf("Library is full! Cannot add more books.\n");
+    int row = nextBookRow(*bookCount);
+    if (row == -1) {
+        printf("Out of memory! Cannot add more books.\n");
         return;
     }
+    Book *book = bookAt(row);
+    memset(book, 0, sizeof(Book));
 
     printf("\n=== Add New Book ===\n");
-    // Input ISBN (10 digits)
+    // Input ISBN (10 or 13 digits)
+    char ISBN[MAX_STRING];
     do {
-        printf("Enter ISBN (10 digits): ");
-        scanf("%s", books[*bookCount].ISBN);
+        printf("Enter ISBN (10 or 13 digits): ");
+        scanf("%s", ISBN);
         clearInputBuffer();
-        if (strlen(books[*bookCount].ISBN) != 10) {
-            printf("ISBN must be exactly 10 digits!\n");
+        if (strlen(ISBN) != 10 && strlen(ISBN) != 13) {
+            printf("ISBN must be exactly 10 or 13 digits!\n");
+        } else if (!parseISBN(ISBN, &book->ISBN)) {
+            printf("ISBN must contain only digits, and ISBN-13 must start with 978 or 979!\n");
+        } else if (findBookByISBN(*bookCount, book->ISBN) != -1) {
+            printf("ISBN already exists!\n");
         } else {
-            int valid = 1;
-            for (int i = 0; i < 10; i++) {
-                if (!isdigit(books[*bookCount].ISBN[i])) {
-                    valid = 0;
-                    break;
-                }
-            }
-            if (!valid) {
-                printf("ISBN must contain only digits!\n");
-            } else {
-                int exists = 0;
-                for (int i = 0; i < *bookCount; i++) {
-                    if (strcmp(books[i].ISBN, books[*bookCount].ISBN) == 0) {
-                        exists = 1;
-                        break;
-                    }
-                }
-                if (exists) {
-                    printf("ISBN already exists!\n");
-                } else {
-                    break;
-                }
-            }
+            break;
         }
     } while (1);
 
     printf("Enter book title: ");
-    fgets(books[*bookCount].title, MAX_STRING, stdin);
-    books[*bookCount].title[strcspn(books[*bookCount].title, "\n")] = 0;
+    int stored = readText(stdin, &book->title);
 
     printf("Enter author: ");
-    fgets(books[*bookCount].author, MAX_STRING, stdin);
-    books[*bookCount].author[strcspn(books[*bookCount].author, "\n")] = 0;
+    book->author = readSymbol(stdin);
 
     printf("Enter publisher: ");
-    fgets(books[*bookCount].publisher, MAX_STRING, stdin);
-    books[*bookCount].publisher[strcspn(books[*bookCount].publisher, "\n")] = 0;
+    book->publisher = readSymbol(stdin);
 
     printf("Enter publish year: ");
-    scanf("%d", &books[*bookCount].publishYear);
+    scanf("%d", &book->publishYear);
     clearInputBuffer();
 
     printf("Enter category: ");
-    fgets(books[*bookCount].category, MAX_STRING, stdin);
-    books[*bookCount].category[strcspn(books[*bookCount].category, "\n")] = 0;
+    book->category = readSymbol(stdin);
 
     printf("Enter price: ");
-    scanf("%f", &books[*bookCount].price);
+    scanf("%f", &book->price);
     clearInputBuffer();
 
     printf("Enter quantity: ");
-    scanf("%d", &books[*bookCount].quantity);
+    scanf("%d", &book->quantity);
     clearInputBuffer();
 
-    (*bookCount)++;
+    if (!stored || !updateBookKeys(book) ||
+        !hashIndexInsert(&isbnIndex, hashInteger(book->ISBN), row) ||
+        !addBookTrigrams(row)) {
+        hashIndexRemove(&isbnIndex, hashInteger(book->ISBN), row);
+        removeBookTrigrams(row);
+        arenaRelease(&bookText, book->title);
+        arenaRelease(&bookText, book->titleKey);
+        book->deleted = 1;
+        printf("Out of memory! Cannot add more books.\n");
+        return;
+    }
+    countBook(book, 1);
+    addBookRanges(row);
+    addBookFacets(row);
+    journalBook(book);
+    claimBookRow(bookCount, row);
+    bookColumnsUpdate(row);
     printf("Book added successfully!\n");
 }
 
@@ -108,54 +664,70 @@ void updateBook(int bookCount) {
     scanf("%s", ISBN);
     clearInputBuffer();
 
-    int index = findBookByISBN(bookCount, ISBN);
+    int index = findBookByISBNText(bookCount, ISBN);
     if (index == -1) {
         printf("Book not found!\n");
         return;
     }
+    // The current values are copied out, so the text they point at cannot
+    // move while the new values are stored
+    Book *book = bookAt(index);
+    char title[MAX_STRING];
+    char author[MAX_STRING];
+    char publisher[MAX_STRING];
+    char category[MAX_STRING];
+    snprintf(title, MAX_STRING, "%s", bookString(book->title));
+    snprintf(author, MAX_STRING, "%s", symbolText(book->author));
+    snprintf(publisher, MAX_STRING, "%s", symbolText(book->publisher));
+    snprintf(category, MAX_STRING, "%s", symbolText(book->category));
+    BookValues values = { book->ISBN, title, author, publisher, category,
+                          book->publishYear, book->price, book->quantity };
+    char line[MAX_STRING];
 
     printf("Enter new title (or press Enter to keep current): ");
-    char title[MAX_STRING];
-    fgets(title, MAX_STRING, stdin);
-    title[strcspn(title, "\n")] = 0;
-    if (strlen(title) > 0) strcpy(books[index].title, title);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(title, line);
 
     printf("Enter new author (or press Enter to keep current): ");
-    char author[MAX_STRING];
-    fgets(author, MAX_STRING, stdin);
-    author[strcspn(author, "\n")] = 0;
-    if (strlen(author) > 0) strcpy(books[index].author, author);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(author, line);
 
     printf("Enter new publisher (or press Enter to keep current): ");
-    char publisher[MAX_STRING];
-    fgets(publisher, MAX_STRING, stdin);
-    publisher[strcspn(publisher, "\n")] = 0;
-    if (strlen(publisher) > 0) strcpy(books[index].publisher, publisher);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(publisher, line);
 
     printf("Enter new publish year (or 0 to keep current): ");
     int year;
     scanf("%d", &year);
     clearInputBuffer();
-    if (year > 0) books[index].publishYear = year;
+    if (year > 0) values.publishYear = year;
 
     printf("Enter new category (or press Enter to keep current): ");
-    char category[MAX_STRING];
-    fgets(category, MAX_STRING, stdin);
-    category[strcspn(category, "\n")] = 0;
-    if (strlen(category) > 0) strcpy(books[index].category, category);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(category, line);
 
     printf("Enter new price (or 0 to keep current): ");
     float price;
     scanf("%f", &price);
     clearInputBuffer();
-    if (price > 0) books[index].price = price;
+    if (price > 0) values.price = price;
 
     printf("Enter new quantity (or -1 to keep current): ");
     int quantity;
     scanf("%d", &quantity);
     clearInputBuffer();
-    if (quantity >= 0) books[index].quantity = quantity;
+    if (quantity >= 0) values.quantity = quantity;
 
+    // storeBook leaves the book as it was if memory runs out
+    if (storeBook(&bookCount, &values) == -1) {
+        printf("Out of memory! The book was not updated.\n");
+        return;
+    }
+    journalBook(bookAt(index));
     printf("Book updated successfully!\n");
 }
 
@@ -164,7 +736,7 @@ void updateBook(int bookCount) {
  * @param bookCount Pointer to the current number of books
  * @return void
  * 
- * Removes a book by ISBN and shifts all subsequent books to maintain array continuity.
+ * Removes a book by ISBN; its row is left as a tombstone for the next added book.
  */
 void deleteBook(int *bookCount) {
     char ISBN[MAX_STRING];
@@ -172,19 +744,300 @@ void deleteBook(int *bookCount) {
     scanf("%s", ISBN);
     clearInputBuffer();
 
-    int index = findBookByISBN(*bookCount, ISBN);
+    int index = findBookByISBNText(*bookCount, ISBN);
     if (index == -1) {
         printf("Book not found!\n");
         return;
     }
 
-    for (int i = index; i < *bookCount - 1; i++) {
-        books[i] = books[i + 1];
-    }
-    (*bookCount)--;
+    journalBookDeleted(bookAt(index)->ISBN);
+    removeBook(index);
     printf("Book deleted successfully!\n");
 }
 
+/**
+ * @brief Removes the book at a row
+ * @param index Row of the book
+ * @return void
+ *
+ * The row is left as a tombstone and put on the free list, so no other
+ * book moves and indexes only lose the deleted entry.
+ */
+void removeBook(int index) {
+    Book *book = bookAt(index);
+    countBook(book, -1);
+    removeBookRanges(index);
+    removeBookFacets(index);
+    hashIndexRemove(&isbnIndex, hashInteger(book->ISBN), index);
+    removeBookTrigrams(index);
+    arenaRelease(&bookText, book->title);
+    arenaRelease(&bookText, book->titleKey);
+    book->title = (TextRef){ 0, 0 };
+    book->titleKey = (TextRef){ 0, 0 };
+    book->deleted = 1;
+    keysPacked = 0;
+    deletedCount++;
+    pushFreeRow(index);
+    bookColumnsUpdate(index);
+}
+
+/**
+ * @brief Changes the number of copies of a book in stock
+ * @param index Row of the book
+ * @param change Copies put back, negative when copies are lent
+ * @return void
+ *
+ * Keeps the inventory value, the range indexes and the columns in step.
+ */
+void adjustBookQuantity(int index, int change) {
+    Book *book = bookAt(index);
+    removeBookRanges(index);
+    book->quantity += change;
+    libraryCounters.inventoryValue += change * (double)book->price;
+    addBookRanges(index);
+    bookColumnsUpdate(index);
+}
+
+/**
+ * @brief Adds a book, or replaces every field of the book with its ISBN
+ * @param bookCount Pointer to the current number of books
+ * @param values The field values
+ * @return int Row of the book, or -1 if memory could not be allocated
+ */
+int storeBook(int *bookCount, const BookValues *values) {
+    // The title and its key are stored before the book is touched, so
+    // running out of memory leaves an updated book as it was
+    char key[MAX_STRING];
+    TextRef title;
+    TextRef titleKey;
+    normalizeText(values->title, key, MAX_STRING);
+    if (!arenaStore(&bookText, values->title, &title)) {
+        return -1;
+    }
+    if (!arenaStore(&bookText, key, &titleKey)) {
+        arenaRelease(&bookText, title);
+        return -1;
+    }
+
+    int index = findBookByISBN(*bookCount, values->ISBN);
+    int added = index == -1;
+    if (added) {
+        index = nextBookRow(*bookCount);
+        if (index == -1 || !hashIndexInsert(&isbnIndex, hashInteger(values->ISBN), index)) {
+            arenaRelease(&bookText, title);
+            arenaRelease(&bookText, titleKey);
+            return -1;
+        }
+        memset(bookAt(index), 0, sizeof(Book));
+        bookAt(index)->ISBN = values->ISBN;
+    } else {
+        Book *book = bookAt(index);
+        countBook(book, -1);
+        removeBookRanges(index);
+        removeBookFacets(index);
+        removeBookTrigrams(index);
+        arenaRelease(&bookText, book->title);
+        arenaRelease(&bookText, book->titleKey);
+    }
+
+    Book *book = bookAt(index);
+    book->title = title;
+    book->titleKey = titleKey;
+    book->author = internString(values->author);
+    normalizeText(symbolText(book->author), key, MAX_STRING);
+    book->authorKey = internString(key);
+    book->publisher = internString(values->publisher);
+    book->category = internString(values->category);
+    book->publishYear = values->publishYear;
+    book->price = values->price;
+    book->quantity = values->quantity;
+    keysPacked = 0;
+    if (!addBookTrigrams(index)) {
+        // Like the range indexes, they are dropped and built again by the
+        // next search
+        removeBookTrigrams(index);
+        trigramsBuilt = 0;
+    }
+    countBook(book, 1);
+    addBookRanges(index);
+    addBookFacets(index);
+    if (added) {
+        claimBookRow(bookCount, index);
+    }
+    bookColumnsUpdate(index);
+    return index;
+}
+
+/**
+ * @brief Merges two sorted lists of rows, dropping duplicates
+ * @param titleRows Rows matched on the title, or NULL if not searched
+ * @param titleCount Number of title rows
+ * @param authorRows Rows matched on the author, or NULL if not searched
+ * @param authorCount Number of author rows
+ * @param rows Receives a malloc'd array of the merged rows; the two lists are freed
+ * @return int Number of rows, or -1 if memory could not be allocated
+ */
+static int mergeRows(int *titleRows, int titleCount, int *authorRows, int authorCount, int **rows) {
+    if (authorRows == NULL) {
+        *rows = titleRows;
+        return titleCount;
+    }
+    if (titleRows == NULL) {
+        *rows = authorRows;
+        return authorCount;
+    }
+
+    int *merged = malloc(sizeof(int) * (titleCount + authorCount + 1));
+    int count = 0;
+    if (merged == NULL) {
+        free(titleRows);
+        free(authorRows);
+        *rows = NULL;
+        return -1;
+    }
+    int i = 0;
+    int j = 0;
+    while (i < titleCount || j < authorCount) {
+        if (j == authorCount || (i < titleCount && titleRows[i] < authorRows[j])) {
+            merged[count++] = titleRows[i++];
+        } else if (i == titleCount || authorRows[j] < titleRows[i]) {
+            merged[count++] = authorRows[j++];
+        } else {
+            merged[count++] = titleRows[i++];
+            j++;
+        }
+    }
+    free(titleRows);
+    free(authorRows);
+    *rows = merged;
+    return count;
+}
+
+/**
+ * @brief Collects the rows whose title or author may contain a term
+ * @param term The search term
+ * @param fields SEARCH_TITLE and/or SEARCH_AUTHOR
+ * @param rows Receives a malloc'd array of candidate rows in row order
+ * @return int Number of candidates, or -1 if every row has to be checked
+ *
+ * When both fields are searched the two candidate lists are merged.
+ */
+static int findSearchCandidates(const char *term, int fields, int **rows) {
+    int *titleRows = NULL;
+    int *authorRows = NULL;
+    int titleCount = 0;
+    int authorCount = 0;
+    if (fields & SEARCH_TITLE) {
+        titleCount = trigramIndexQuery(&titleTrigrams, term, &titleRows);
+    }
+    if (fields & SEARCH_AUTHOR) {
+        authorCount = trigramIndexQuery(&authorTrigrams, term, &authorRows);
+    }
+    if (titleCount < 0 || authorCount < 0) {
+        free(titleRows);
+        free(authorRows);
+        *rows = NULL;
+        return -1;
+    }
+    return mergeRows(titleRows, titleCount, authorRows, authorCount, rows);
+}
+
+/**
+ * @brief Tells whether a book's title or author contains a term
+ * @param pattern The normalized term
+ * @param fields SEARCH_TITLE and/or SEARCH_AUTHOR
+ * @param row The book's row
+ * @return int Non-zero if the book is live and matches
+ */
+static int bookMatches(const SubstringPattern *pattern, int fields, int row) {
+    if (!isBookLive(row)) {
+        return 0;
+    }
+    const Book *book = bookAt(row);
+    return ((fields & SEARCH_TITLE) && strstr(bookString(book->titleKey), pattern->term)) ||
+           ((fields & SEARCH_AUTHOR) && strstr(symbolText(book->authorKey), pattern->term));
+}
+
+/**
+ * @brief Finds every book whose title or author contains a term by
+ *        scanning the packed search keys
+ * @param pattern The normalized term
+ * @param fields SEARCH_TITLE and/or SEARCH_AUTHOR
+ * @param bookCount Current number of books
+ * @param rows Receives a malloc'd array of the matching rows in row order
+ * @return int Number of matching books, or -1 if memory could not be allocated
+ */
+static int scanBookKeys(const SubstringPattern *pattern, int fields, int bookCount, int **rows) {
+    int *titleRows = NULL;
+    int *authorRows = NULL;
+    int titleCount = 0;
+    int authorCount = 0;
+    *rows = NULL;
+    if (!packBookKeys(bookCount)) {
+        return -1;
+    }
+    if (fields & SEARCH_TITLE) {
+        titleRows = malloc(sizeof(int) * (titleKeys.count + 1));
+        if (titleRows == NULL) {
+            return -1;
+        }
+        titleCount = scanPackedText(pattern, &titleKeys, titleRows);
+    }
+    if (fields & SEARCH_AUTHOR) {
+        authorRows = malloc(sizeof(int) * (authorKeys.count + 1));
+        if (authorRows == NULL) {
+            free(titleRows);
+            return -1;
+        }
+        authorCount = scanPackedText(pattern, &authorKeys, authorRows);
+    }
+    return mergeRows(titleRows, titleCount, authorRows, authorCount, rows);
+}
+
+/**
+ * @brief Prints every book whose title or author contains a term
+ * @param out The output buffer the books are written to
+ * @param term The search term
+ * @param fields SEARCH_TITLE and/or SEARCH_AUTHOR
+ * @param bookCount Current number of books in the system
+ * @return int Number of books printed
+ *
+ * The term is normalized once and compared against the precomputed
+ * search keys, so case and diacritics do not matter. Only the candidates
+ * from the trigram indexes are checked one by one; terms shorter than
+ * three bytes, or searches the trigram indexes cannot be built for, scan
+ * the packed keys of every book instead, and every row is checked if
+ * those cannot be packed.
+ */
+static int printMatchingBooks(OutputBuffer *out, const char *searchTerm, int fields, int bookCount) {
+    char term[MAX_STRING];
+    normalizeText(searchTerm, term, MAX_STRING);
+    SubstringPattern pattern;
+    prepareSubstring(&pattern, term);
+    int *rows = NULL;
+    int count = buildTrigramIndexes(bookCount) ? findSearchCandidates(term, fields, &rows) : -1;
+    int exact = 0;
+    if (count < 0) {
+        count = scanBookKeys(&pattern, fields, bookCount, &rows);
+        exact = count >= 0;
+    }
+    int rowsToCheck = count < 0 ? bookCount : count;
+    int found = 0;
+    for (int k = 0; k < rowsToCheck; k++) {
+        int i = count < 0 ? k : rows[k];
+        if (i >= bookCount) {
+            break;
+        }
+        if (exact || bookMatches(&pattern, fields, i)) {
+            printBook(out, bookAt(i));
+            outputText(out, "----------------------------------------\n");
+            found++;
+        }
+    }
+    free(rows);
+    return found;
+}
+
 /**
  * @brief Searches for books by title or author
  * @param bookCount Current number of books in the system
@@ -198,54 +1051,138 @@ void searchBook(int bookCount) {
     fgets(searchTerm, MAX_STRING, stdin);
     searchTerm[strcspn(searchTerm, "\n")] = 0;
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
-    int found = 0;
-    for (int i = 0; i < bookCount; i++) {
-        if (strstr(books[i].title, searchTerm) || strstr(books[i].author, searchTerm)) {
-            printf("ISBN: %s\n", books[i].ISBN);
-            printf("Title: %s\n", books[i].title);
-            printf("Author: %s\n", books[i].author);
-            printf("Publisher: %s\n", books[i].publisher);
-            printf("Publish Year: %d\n", books[i].publishYear);
-            printf("Category: %s\n", books[i].category);
-            printf("Price: %.2f\n", books[i].price);
-            printf("Quantity: %d\n", books[i].quantity);
-            printf("----------------------------------------\n");
-            found = 1;
-        }
-    }
-    if (!found) {
-        printf("No books found matching the search term.\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
+    if (printMatchingBooks(out, searchTerm, SEARCH_TITLE | SEARCH_AUTHOR, bookCount) == 0) {
+        outputText(out, "No books found matching the search term.\n");
     }
+    outputFlush(out);
 }
 
 /**
- * @brief Displays all books
+ * @brief Displays all books a page at a time
  * @param bookCount Current number of books in the library
  * @return void
  * 
- * Display detailed information about all books currently in the library.
+ * Shows the books in ISBN order, one page at a time; the user moves to the
+ * next or previous page, jumps to an ISBN or changes the page size, and
+ * only the page shown is read and printed.
  */
 void displayAllBooks(int bookCount) {
-    if (bookCount == 0) {
+    if (liveBookCount(bookCount) == 0) {
         printf("No books in the library.\n");
         return;
     }
 
-    printf("\nAll Books:\n");
-    printf("----------------------------------------\n");
-    for (int i = 0; i < bookCount; i++) {
-        printf("ISBN: %s\n", books[i].ISBN);
-        printf("Title: %s\n", books[i].title);
-        printf("Author: %s\n", books[i].author);
-        printf("Publisher: %s\n", books[i].publisher);
-        printf("Publish Year: %d\n", books[i].publishYear);
-        printf("Category: %s\n", books[i].category);
-        printf("Price: %.2f\n", books[i].price);
-        printf("Quantity: %d\n", books[i].quantity);
-        printf("----------------------------------------\n");
+    int rows[MAX_PAGE_SIZE];
+    int size = PAGE_SIZE;
+    unsigned long long cursor = 0;
+    RangePageStart start = RANGE_PAGE_FROM;
+    int choice;
+    do {
+        int hasPrevious;
+        int hasNext;
+        int count = findBookPage(bookCount, cursor, start, size, rows, &hasPrevious, &hasNext);
+        if (count == -1) {
+            printf("Memory allocation failed!\n");
+            return;
+        }
+        OutputBuffer *out = screenOutput();
+        outputText(out, "\nAll Books:\n");
+        outputText(out, "----------------------------------------\n");
+        printBooks(out, rows, count);
+        if (count == 0) {
+            outputText(out, "No books on this page.\n");
+        }
+        outputText(out, "Showing ");
+        outputNumber(out, count);
+        outputText(out, " of ");
+        outputNumber(out, liveBookCount(bookCount));
+        outputText(out, " books.\n");
+        outputFlush(out);
+
+        // Showing the page again starts from its first book
+        if (count > 0) {
+            cursor = bookAt(rows[0])->ISBN;
+            start = RANGE_PAGE_FROM;
+        }
+        printf("1. Next Page\n");
+        printf("2. Previous Page\n");
+        printf("3. Jump to ISBN\n");
+        printf("4. Change Page Size\n");
+        printf("0. Back\n");
+        printf("Enter your choice: ");
+        if (scanf("%d", &choice) != 1) {
+            choice = -1;
+        }
+        clearInputBuffer();
+
+        char text[MAX_STRING];
+        switch (choice) {
+            case 1:
+                if (!hasNext) {
+                    printf("This is the last page.\n");
+                } else {
+                    cursor = bookAt(rows[count - 1])->ISBN;
+                    start = RANGE_PAGE_AFTER;
+                }
+                break;
+            case 2:
+                if (!hasPrevious) {
+                    printf("This is the first page.\n");
+                } else {
+                    start = RANGE_PAGE_BEFORE;
+                }
+                break;
+            case 3:
+                printf("Enter ISBN to jump to: ");
+                scanf("%99s", text);
+                clearInputBuffer();
+                if (!parseISBN(text, &cursor)) {
+                    printf("Invalid ISBN! Must be 10 or 13 digits.\n");
+                }
+                break;
+            case 4:
+                printf("Books per page (1-%d): ", MAX_PAGE_SIZE);
+                if (scanf("%d", &size) != 1 || size < 1 || size > MAX_PAGE_SIZE) {
+                    printf("Invalid page size!\n");
+                    size = PAGE_SIZE;
+                }
+                clearInputBuffer();
+                break;
+            case 0:
+                break;
+            default:
+                printf("Invalid choice!\n");
+        }
+    } while (choice != 0);
+}
+
+/**
+ * @brief Reads one page of the books in ISBN order
+ * @param bookCount Current number of books
+ * @param ISBN The cursor: 0 starts from the first book, and ULLONG_MAX
+ *             with RANGE_PAGE_BEFORE ends at the last
+ * @param start Whether the page starts at the ISBN, just after it or ends
+ *              just before it
+ * @param size Most books on the page
+ * @param rows Receives the rows of the page in ISBN order; room for size rows
+ * @param hasPrevious Receives non-zero if books come before the page
+ * @param hasNext Receives non-zero if books come after the page
+ * @return int Number of books on the page, or -1 if memory could not be allocated
+ *
+ * Reads the ISBN range index, so a page costs O(log n + size) wherever it
+ * lies in the catalog. The next page starts after the ISBN of the last
+ * book shown and the previous one ends before the ISBN of the first, so
+ * books added or deleted in between do not shift the pages.
+ */
+int findBookPage(int bookCount, unsigned long long ISBN, RangePageStart start, int size, int *rows,
+                 int *hasPrevious, int *hasNext) {
+    if (!buildBookRanges(bookCount)) {
+        return -1;
     }
+    return rangeIndexPage(&bookRanges[BOOK_RANGE_ISBN], (double)ISBN, start, size, rows, hasPrevious, hasNext);
 }
 
 /**
@@ -261,26 +1198,13 @@ void searchBookByTitle(int bookCount) {
     fgets(searchTerm, MAX_STRING, stdin);
     searchTerm[strcspn(searchTerm, "\n")] = 0;
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
-    int found = 0;
-    for (int i = 0; i < bookCount; i++) {
-        if (strstr(books[i].title, searchTerm)) {
-            printf("ISBN: %s\n", books[i].ISBN);
-            printf("Title: %s\n", books[i].title);
-            printf("Author: %s\n", books[i].author);
-            printf("Publisher: %s\n", books[i].publisher);
-            printf("Publish Year: %d\n", books[i].publishYear);
-            printf("Category: %s\n", books[i].category);
-            printf("Price: %.2f\n", books[i].price);
-            printf("Quantity: %d\n", books[i].quantity);
-            printf("----------------------------------------\n");
-            found = 1;
-        }
-    }
-    if (!found) {
-        printf("No books found matching the title.\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
+    if (printMatchingBooks(out, searchTerm, SEARCH_TITLE, bookCount) == 0) {
+        outputText(out, "No books found matching the title.\n");
     }
+    outputFlush(out);
 }
 
 /**
@@ -296,26 +1220,16 @@ void searchBookByISBN(int bookCount) {
     scanf("%s", searchTerm);
     clearInputBuffer();
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
-    int found = 0;
-    for (int i = 0; i < bookCount; i++) {
-        if (strcmp(books[i].ISBN, searchTerm) == 0) {
-            printf("ISBN: %s\n", books[i].ISBN);
-            printf("Title: %s\n", books[i].title);
-            printf("Author: %s\n", books[i].author);
-            printf("Publisher: %s\n", books[i].publisher);
-            printf("Publish Year: %d\n", books[i].publishYear);
-            printf("Category: %s\n", books[i].category);
-            printf("Price: %.2f\n", books[i].price);
-            printf("Quantity: %d\n", books[i].quantity);
-            printf("----------------------------------------\n");
-            found = 1;
-        }
-    }
-    if (!found) {
-        printf("No books found matching the ISBN.\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
+    int index = findBookByISBNText(bookCount, searchTerm);
+    if (index != -1) {
+        printBooks(out, &index, 1);
+    } else {
+        outputText(out, "No books found matching the ISBN.\n");
     }
+    outputFlush(out);
 }
 
 /**
@@ -331,26 +1245,600 @@ void searchBookByAuthor(int bookCount) {
     fgets(searchTerm, MAX_STRING, stdin);
     searchTerm[strcspn(searchTerm, "\n")] = 0;
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
+    if (printMatchingBooks(out, searchTerm, SEARCH_AUTHOR, bookCount) == 0) {
+        outputText(out, "No books found matching the author.\n");
+    }
+    outputFlush(out);
+}
+
+/**
+ * @brief Lists books by publish year, price and stock
+ * @param bookCount Current number of books in the system
+ * @return void
+ *
+ * Displays the books published within a range of years that cost at most
+ * a given price and have at least a given number of copies, then their
+ * number and the value of their stock.
+ */
+void filterBooks(int bookCount) {
+    BookFilter filter = { 0, 0, 0.0f, 0.0f, 0 };
+    printf("Enter first publish year: ");
+    scanf("%d", &filter.yearFrom);
+    clearInputBuffer();
+    printf("Enter last publish year: ");
+    scanf("%d", &filter.yearTo);
+    clearInputBuffer();
+    printf("Enter maximum price: ");
+    scanf("%f", &filter.priceTo);
+    clearInputBuffer();
+    printf("Enter minimum quantity: ");
+    scanf("%d", &filter.minQuantity);
+    clearInputBuffer();
+
+    int *rows = malloc(sizeof(int) * (size_t)(bookCount > 0 ? bookCount : 1));
+    if (rows == NULL) {
+        printf("Memory allocation failed!\n");
+        return;
+    }
+    double stockValue = 0;
+    int count = filterBookColumns(&filter, bookCount, rows, &stockValue);
+    if (count == -1) {
+        printf("Memory allocation failed!\n");
+        free(rows);
+        return;
+    }
+
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nFilter Results:\n");
+    outputText(out, "----------------------------------------\n");
+    printBooks(out, rows, count);
+    if (count == 0) {
+        outputText(out, "No books match the filter.\n");
+    } else {
+        outputText(out, "Books found: ");
+        outputNumber(out, count);
+        outputText(out, "\nStock value: ");
+        outputPrice(out, stockValue);
+        outputBytes(out, "\n", 1);
+    }
+    outputFlush(out);
+    free(rows);
+}
+
+// Rows collected by a range query
+typedef struct {
+    int *rows;
+    int count;
+    int limit;                  // 0 for no limit
+} RangeResult;
+
+// Adds a row to a range result; stops the query once the limit is reached
+static int collectRangeRow(int row, void *context) {
+    RangeResult *result = context;
+    result->rows[result->count++] = row;
+    return result->limit == 0 || result->count < result->limit;
+}
+
+/**
+ * @brief Finds the books whose publish year, price or quantity lies in a range
+ * @param bookCount Current number of books
+ * @param field "year", "price" or "quantity"
+ * @param low Smallest value wanted
+ * @param high Largest value wanted
+ * @param descending Non-zero to list the largest values first
+ * @param limit Most books wanted, 0 for all of them
+ * @param rows Receives a malloc'd array of the rows in field order
+ * @return int Number of books, -1 if there is no such field, or -2 if
+ *             memory could not be allocated
+ *
+ * Reads the range indexes, so the query costs O(log n + k) for k books
+ * once they are built; "newest 50" is year over every value, descending,
+ * limited to 50, and "out of stock" is quantity from 0 to 0.
+ */
+int findBooksInRange(int bookCount, const char *field, double low, double high, int descending, int limit,
+                     int **rows) {
+    *rows = NULL;
+    // The ISBN index only serves the paged listing
+    RangeIndex *index = findRangeIndex(bookRanges + BOOK_RANGE_YEAR, BOOK_RANGE_COUNT - BOOK_RANGE_YEAR, field);
+    if (index == NULL) {
+        return -1;
+    }
+    if (!buildBookRanges(bookCount)) {
+        return -2;
+    }
+    int capacity = limit > 0 && limit < index->size ? limit : index->size;
+    RangeResult result = { malloc(sizeof(int) * (capacity + 1)), 0, limit };
+    if (result.rows == NULL) {
+        return -2;
+    }
+    rangeIndexVisit(index, low, high, descending, collectRangeRow, &result);
+    *rows = result.rows;
+    return result.count;
+}
+
+/**
+ * @brief Lists books by a range of publish years, prices or quantities
+ * @param bookCount Current number of books in the system
+ * @return void
+ *
+ * The user picks the field, the range, the order and how many books to
+ * show, so "newest 50 titles" and "out-of-stock books" are both one query.
+ */
+void browseBooksByRange(int bookCount) {
+    const char *fields[] = { "year", "price", "quantity" };
+    int field;
+    printf("Field (1. Publish year, 2. Price, 3. Quantity): ");
+    scanf("%d", &field);
+    clearInputBuffer();
+    if (field < 1 || field > 3) {
+        printf("Invalid field!\n");
+        return;
+    }
+    double low;
+    double high;
+    printf("From: ");
+    scanf("%lf", &low);
+    clearInputBuffer();
+    printf("To: ");
+    scanf("%lf", &high);
+    clearInputBuffer();
+    int order;
+    printf("Order (1. Ascending, 2. Descending): ");
+    scanf("%d", &order);
+    clearInputBuffer();
+    int limit;
+    printf("Show at most (0 for all): ");
+    scanf("%d", &limit);
+    clearInputBuffer();
+
+    int *rows;
+    int count = findBooksInRange(bookCount, fields[field - 1], low, high, order == 2, limit > 0 ? limit : 0, &rows);
+    if (count < 0) {
+        printf("Memory allocation failed!\n");
+        return;
+    }
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nBooks Found:\n");
+    outputText(out, "----------------------------------------\n");
+    printBooks(out, rows, count);
+    if (count == 0) {
+        outputText(out, "No books in this range.\n");
+    } else {
+        outputText(out, "Books found: ");
+        outputNumber(out, count);
+        outputBytes(out, "\n", 1);
+    }
+    outputFlush(out);
+    free(rows);
+}
+
+/**
+ * @brief Turns the text of a facet value into the value
+ * @param facet One of the BOOK_FACET_* constants
+ * @param text A category, a publisher, or a year of the decade ("1990" or "1990s")
+ * @param value Receives the value; text no book has gives -1, which
+ *              matches nothing
+ * @return int 1 on success, 0 if a decade is not a number
+ */
+int parseBookFacetValue(int facet, const char *text, int *value) {
+    if (facet != BOOK_FACET_DECADE) {
+        Symbol symbol;
+        *value = findSymbol(text, &symbol) ? (int)symbol : -1;
+        return 1;
+    }
+    char *end;
+    long year = strtol(text, &end, 10);
+    if (end == text || (*end != 0 && strcmp(end, "s") != 0) || year < -999999 || year > 999999) {
+        return 0;
+    }
+    *value = (int)year / 10 * 10;
+    return 1;
+}
+
+/**
+ * @brief Writes a facet value as text
+ * @param facet One of the BOOK_FACET_* constants
+ * @param value The value
+ * @param text Receives the text, room for MAX_STRING bytes
+ * @return void
+ */
+void formatBookFacetValue(int facet, int value, char *text) {
+    if (facet == BOOK_FACET_DECADE) {
+        snprintf(text, MAX_STRING, "%ds", value);
+    } else {
+        snprintf(text, MAX_STRING, "%s", symbolText((Symbol)value));
+    }
+}
+
+// Rows picked for each facet of a selection
+typedef struct {
+    const Bitmap *rows[BOOK_FACET_COUNT];   // NULL when nothing is picked for the facet
+    Bitmap merged[BOOK_FACET_COUNT];        // OR of the picks when there are several
+    Bitmap scratch[2];                      // Intersections being worked out
+} PickedFacets;
+
+// Rows of a picked value no book has
+static const Bitmap noBooks = BITMAP_INIT;
+
+// Frees the bitmaps worked out for a selection
+static void freePickedFacets(PickedFacets *picked) {
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        bitmapFree(&picked->merged[facet]);
+    }
+    bitmapFree(&picked->scratch[0]);
+    bitmapFree(&picked->scratch[1]);
+}
+
+/**
+ * @brief Looks up the rows picked for each facet
+ * @param selection The values picked
+ * @param picked Receives the rows; free with freePickedFacets
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * A single value is read straight from its bitmap; the bitmaps of several
+ * values are ORed together.
+ */
+static int pickBookFacets(const FacetSelection *selection, PickedFacets *picked) {
+    memset(picked, 0, sizeof(PickedFacets));
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        if (selection->count[facet] == 1) {
+            const Bitmap *rows = facetBitmap(&bookFacets[facet], selection->values[facet][0]);
+            picked->rows[facet] = rows != NULL ? rows : &noBooks;
+            continue;
+        }
+        for (int i = 0; i < selection->count[facet]; i++) {
+            const Bitmap *rows = facetBitmap(&bookFacets[facet], selection->values[facet][i]);
+            if (rows != NULL && !bitmapOr(&picked->merged[facet], rows)) {
+                return 0;
+            }
+        }
+        if (selection->count[facet] > 1) {
+            picked->rows[facet] = &picked->merged[facet];
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Works out the books matching the picks of every facet but one
+ * @param picked The rows picked for each facet
+ * @param skip Facet left out, or -1 for none
+ * @param rows Receives the matching rows, or NULL if every live book
+ *             matches; valid until the next call
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * The picks of one facet are used as they are; every further facet is
+ * ANDed in.
+ */
+static int intersectBookFacets(PickedFacets *picked, int skip, const Bitmap **rows) {
+    *rows = NULL;
+    int next = 0;
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        if (facet == skip || picked->rows[facet] == NULL) {
+            continue;
+        }
+        if (*rows == NULL) {
+            *rows = picked->rows[facet];
+            continue;
+        }
+        Bitmap *result = &picked->scratch[next];
+        next = 1 - next;
+        if (!bitmapAnd(result, *rows, picked->rows[facet])) {
+            return 0;
+        }
+        *rows = result;
+    }
+    return 1;
+}
+
+/**
+ * @brief Finds the books matching the values picked for each facet
+ * @param bookCount Current number of books
+ * @param selection The values picked
+ * @param rows Receives a malloc'd array of the rows in row order
+ * @return int Number of books, or -1 if memory could not be allocated
+ */
+int findBooksByFacets(int bookCount, const FacetSelection *selection, int **rows) {
+    if (!buildBookFacets(bookCount)) {
+        return -1;
+    }
+    PickedFacets picked;
+    const Bitmap *matches;
+    if (!pickBookFacets(selection, &picked) || !intersectBookFacets(&picked, -1, &matches)) {
+        freePickedFacets(&picked);
+        return -1;
+    }
+    int count = matches != NULL ? bitmapCardinality(matches) : liveBookCount(bookCount);
+    *rows = malloc(sizeof(int) * (count + 1));
+    if (*rows == NULL) {
+        freePickedFacets(&picked);
+        return -1;
+    }
+    if (matches != NULL) {
+        bitmapRows(matches, *rows);
+    } else {
+        for (int i = 0, found = 0; i < bookCount; i++) {
+            if (isBookLive(i)) {
+                (*rows)[found++] = i;
+            }
+        }
+    }
+    freePickedFacets(&picked);
+    return count;
+}
+
+// Orders facet counts from the most books down, then by value
+static int compareFacetCounts(const void *a, const void *b) {
+    const FacetCount *first = a;
+    const FacetCount *second = b;
+    if (first->count != second->count) {
+        return second->count - first->count;
+    }
+    return (first->value > second->value) - (first->value < second->value);
+}
+
+/**
+ * @brief Counts the matching books with each value of a facet
+ * @param index The facet's index
+ * @param base Books matching the picks of the other facets, or NULL for
+ *             every live book
+ * @param counts Receives a malloc'd array of the values with at least one
+ *               book, most books first
+ * @return int Number of values, or -1 if memory could not be allocated
+ */
+static int countFacetValues(const FacetIndex *index, const Bitmap *base, FacetCount **counts) {
+    *counts = malloc(sizeof(FacetCount) * (index->valueCount + 1));
+    int *shared = malloc(sizeof(int) * (index->valueCount + 1));
+    if (*counts == NULL || shared == NULL) {
+        free(*counts);
+        free(shared);
+        *counts = NULL;
+        return -1;
+    }
+    if (base != NULL) {
+        bitmapAndCardinalities(base, index->bitmaps, index->valueCount, shared);
+    }
     int found = 0;
-    for (int i = 0; i < bookCount; i++) {
-        if (strstr(books[i].author, searchTerm)) {
-            printf("ISBN: %s\n", books[i].ISBN);
-            printf("Title: %s\n", books[i].title);
-            printf("Author: %s\n", books[i].author);
-            printf("Publisher: %s\n", books[i].publisher);
-            printf("Publish Year: %d\n", books[i].publishYear);
-            printf("Category: %s\n", books[i].category);
-            printf("Price: %.2f\n", books[i].price);
-            printf("Quantity: %d\n", books[i].quantity);
-            printf("----------------------------------------\n");
-            found = 1;
+    for (int i = 0; i < index->valueCount; i++) {
+        int count = base != NULL ? shared[i] : bitmapCardinality(&index->bitmaps[i]);
+        if (count > 0) {
+            (*counts)[found].value = index->values[i];
+            (*counts)[found].count = count;
+            found++;
+        }
+    }
+    free(shared);
+    qsort(*counts, found, sizeof(FacetCount), compareFacetCounts);
+    return found;
+}
+
+/**
+ * @brief Counts the matching books and the books with each facet value
+ * @param bookCount Current number of books
+ * @param selection The values picked
+ * @param counts Receives, for each facet, a malloc'd array of the values
+ *               with at least one book, most books first
+ * @param valueCounts Receives the length of each array
+ * @return int Number of books matching the selection, or -1 if memory
+ *             could not be allocated (no arrays are then left to free)
+ *
+ * A facet's own picks are left out of its counts, so each count is the
+ * number of books picking that value as well would add, while the picks
+ * of the other facets still apply. Every count is a popcount of two ANDed
+ * bitmaps; nothing is copied unless several facets or several values of
+ * one facet are picked.
+ */
+int countBookFacets(int bookCount, const FacetSelection *selection, FacetCount *counts[BOOK_FACET_COUNT],
+                    int valueCounts[BOOK_FACET_COUNT]) {
+    PickedFacets picked;
+    for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+        counts[facet] = NULL;
+    }
+    if (!buildBookFacets(bookCount)) {
+        return -1;
+    }
+    int matches = -1;
+    int failed = !pickBookFacets(selection, &picked);
+    for (int facet = 0; facet < BOOK_FACET_COUNT && !failed; facet++) {
+        const Bitmap *base;
+        if (!intersectBookFacets(&picked, facet, &base)) {
+            failed = 1;
+            break;
+        }
+        if (matches == -1 && picked.rows[facet] != NULL) {
+            matches = base != NULL ? bitmapAndCardinality(base, picked.rows[facet])
+                                   : bitmapCardinality(picked.rows[facet]);
+        }
+        valueCounts[facet] = countFacetValues(&bookFacets[facet], base, &counts[facet]);
+        failed = valueCounts[facet] == -1;
+    }
+    freePickedFacets(&picked);
+    if (failed) {
+        for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+            free(counts[facet]);
+            counts[facet] = NULL;
+        }
+        return -1;
+    }
+    return matches != -1 ? matches : liveBookCount(bookCount);
+}
+
+/**
+ * @brief Prints the values picked for a facet and the most common values
+ * @param selection The values picked
+ * @param facet One of the BOOK_FACET_* constants
+ * @param title Name of the facet shown to the user
+ * @param counts The facet's counts from countBookFacets
+ * @param count Number of counts
+ * @return void
+ */
+static void printBookFacet(const FacetSelection *selection, int facet, const char *title,
+                           const FacetCount *counts, int count) {
+    char text[MAX_STRING];
+    printf("%s", title);
+    for (int i = 0; i < selection->count[facet]; i++) {
+        // Text no book has is picked as -1 (see parseBookFacetValue)
+        if (selection->values[facet][i] == -1) {
+            snprintf(text, MAX_STRING, "(unknown)");
+        } else {
+            formatBookFacetValue(facet, selection->values[facet][i], text);
+        }
+        printf("%s%s", i == 0 ? " (picked: " : ", ", text);
+    }
+    printf(selection->count[facet] > 0 ? "):\n" : ":\n");
+    for (int i = 0; i < count && i < MAX_FACET_SHOWN; i++) {
+        formatBookFacetValue(facet, counts[i].value, text);
+        printf("  %-30s %d\n", text, counts[i].count);
+    }
+    if (count > MAX_FACET_SHOWN) {
+        printf("  ... and %d more\n", count - MAX_FACET_SHOWN);
+    }
+}
+
+/**
+ * @brief Lets the user narrow the books down by category, publisher and decade
+ * @param bookCount Current number of books in the system
+ * @return void
+ *
+ * Each round shows how many books match the values picked so far and how
+ * many books each value of every facet would bring, so a patron can pick
+ * a category, then a publisher, then a decade. Values picked for the same
+ * facet add up; different facets narrow the list down.
+ */
+void browseBooksByFacets(int bookCount) {
+    const char *titles[BOOK_FACET_COUNT] = { "Category", "Publisher", "Decade" };
+    const char *prompts[BOOK_FACET_COUNT] = { "category", "publisher", "a year of the decade" };
+    FacetSelection selection;
+    memset(&selection, 0, sizeof(selection));
+    int choice;
+    do {
+        printf("\n=== Browse by Category, Publisher and Decade ===\n");
+        FacetCount *counts[BOOK_FACET_COUNT];
+        int valueCounts[BOOK_FACET_COUNT];
+        int matches = countBookFacets(bookCount, &selection, counts, valueCounts);
+        if (matches == -1) {
+            printf("Memory allocation failed!\n");
+            return;
         }
+        for (int facet = 0; facet < BOOK_FACET_COUNT; facet++) {
+            printBookFacet(&selection, facet, titles[facet], counts[facet], valueCounts[facet]);
+            free(counts[facet]);
+        }
+        printf("Books matching: %d\n", matches);
+        printf("1. Pick a Category\n");
+        printf("2. Pick a Publisher\n");
+        printf("3. Pick a Decade\n");
+        printf("4. Show Matching Books\n");
+        printf("5. Clear Picks\n");
+        printf("0. Back\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+        clearInputBuffer();
+
+        if (choice >= 1 && choice <= 3) {
+            int facet = choice - 1;
+            char text[MAX_STRING];
+            printf("Enter %s: ", prompts[facet]);
+            fgets(text, MAX_STRING, stdin);
+            text[strcspn(text, "\n")] = 0;
+            int value;
+            if (!parseBookFacetValue(facet, text, &value)) {
+                printf("Invalid year!\n");
+            } else if (selection.count[facet] == MAX_FACET_PICKS) {
+                printf("Cannot pick more than %d values for one facet!\n", MAX_FACET_PICKS);
+            } else {
+                selection.values[facet][selection.count[facet]++] = value;
+            }
+        } else if (choice == 4) {
+            int *rows;
+            int count = findBooksByFacets(bookCount, &selection, &rows);
+            if (count == -1) {
+                printf("Memory allocation failed!\n");
+                return;
+            }
+            OutputBuffer *out = screenOutput();
+            outputText(out, "\nBooks Found:\n");
+            outputText(out, "----------------------------------------\n");
+            printBooks(out, rows, count);
+            outputText(out, "Books found: ");
+            outputNumber(out, count);
+            outputBytes(out, "\n", 1);
+            outputFlush(out);
+            free(rows);
+        } else if (choice == 5) {
+            memset(&selection, 0, sizeof(selection));
+        } else if (choice != 0) {
+            printf("Invalid choice! Please try again.\n");
+        }
+    } while (choice != 0);
+}
+
+// Returns the seconds elapsed since a time
+static double secondsSince(struct timespec start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Times the ways of finding the books whose title contains a term
+ * @param bookCount Current number of books
+ * @param term The search term, normalized before use
+ * @param rounds Times each way is run
+ * @return int 0 if every way found the same books, 1 otherwise
+ *
+ * Compares strstr on each title key, as searches did before the keys were
+ * packed, with one scan of the packed title keys. Prints the matches and
+ * the time per round of each; the bandwidth counts the bytes of the keys.
+ */
+int benchmarkTitleSearch(int bookCount, const char *term, int rounds) {
+    char key[MAX_STRING];
+    normalizeText(term, key, MAX_STRING);
+    SubstringPattern pattern;
+    prepareSubstring(&pattern, key);
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    keysPacked = 0;
+    if (!packBookKeys(bookCount)) {
+        printf("Not enough memory to pack the title keys.\n");
+        return 1;
+    }
+    double packSeconds = secondsSince(start);
+    int *rows = malloc(sizeof(int) * (titleKeys.count + 1));
+    if (rows == NULL) {
+        printf("Memory allocation failed!\n");
+        return 1;
     }
-    if (!found) {
-        printf("No books found matching the author.\n");
+    double megabytes = (double)titleKeys.size / 1e6;
+    printf("Term \"%s\", %d titles, %.1f MB of keys, %s kernels\n", key, titleKeys.count, megabytes,
+           substringKernelName());
+    printf("Packing the keys took %.2f ms\n", packSeconds * 1e3);
+
+    int found[2] = { 0, 0 };
+    const char *names[2] = { "strstr per row", "packed scan" };
+    for (int method = 0; method < 2; method++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int round = 0; round < rounds; round++) {
+            int count = 0;
+            if (method == 1) {
+                count = scanPackedText(&pattern, &titleKeys, rows);
+            } else {
+                for (int i = 0; i < bookCount; i++) {
+                    count += isBookLive(i) && strstr(bookString(bookAt(i)->titleKey), key) != NULL;
+                }
+            }
+            found[method] = count;
+        }
+        double seconds = secondsSince(start) / (rounds > 0 ? rounds : 1);
+        printf("%-16s %8d matches %10.3f ms %10.1f MB/s\n", names[method], found[method], seconds * 1e3,
+               seconds > 0 ? megabytes / seconds : 0.0);
     }
+    free(rows);
+    return found[0] != found[1];
 }
 
 // Update the function to save data to the file
@@ -362,18 +1850,24 @@ void saveBooksToFile(int bookCount) {
     }
     
     // Save the number of books
-    fprintf(file, "%d\n", bookCount);
+    fprintf(file, "%d\n", liveBookCount(bookCount));
     
-    // Save the information of each book
+    // Save the information of each book, skipping deleted rows
     for (int i = 0; i < bookCount; i++) {
-        fprintf(file, "%s\n", books[i].ISBN);
-        fprintf(file, "%s\n", books[i].title);
-        fprintf(file, "%s\n", books[i].author);
-        fprintf(file, "%s\n", books[i].publisher);
-        fprintf(file, "%d\n", books[i].publishYear);
-        fprintf(file, "%s\n", books[i].category);
-        fprintf(file, "%.2f\n", books[i].price);
-        fprintf(file, "%d\n", books[i].quantity);
+        if (!isBookLive(i)) {
+            continue;
+        }
+        const Book *book = bookAt(i);
+        char ISBN[ISBN_LENGTH];
+        formatISBN(book->ISBN, ISBN);
+        fprintf(file, "%s\n", ISBN);
+        fprintf(file, "%s\n", bookString(book->title));
+        fprintf(file, "%s\n", symbolText(book->author));
+        fprintf(file, "%s\n", symbolText(book->publisher));
+        fprintf(file, "%d\n", book->publishYear);
+        fprintf(file, "%s\n", symbolText(book->category));
+        fprintf(file, "%.2f\n", book->price);
+        fprintf(file, "%d\n", book->quantity);
     }
     
     fclose(file);
@@ -390,30 +1884,52 @@ void loadBooksFromFile(int *bookCount) {
     
     // Read the number of books
     fscanf(file, "%d\n", bookCount);
+    if (*bookCount < 0 || !tableReserve(&bookTable, *bookCount)) {
+        printf("Not enough memory to load book data.\n");
+        *bookCount = 0;
+        fclose(file);
+        return;
+    }
     
     // Read the information of each book
-    for (int i = 0; i < *bookCount; i++) {
-        fgets(books[i].ISBN, MAX_STRING, file);
-        books[i].ISBN[strcspn(books[i].ISBN, "\n")] = 0;
-        
-        fgets(books[i].title, MAX_STRING, file);
-        books[i].title[strcspn(books[i].title, "\n")] = 0;
+    arenaClear(&bookText);
+    int count = *bookCount;
+    *bookCount = 0;
+    for (int i = 0; i < count; i++) {
+        Book *book = bookAt(*bookCount);
+        memset(book, 0, sizeof(Book));
+        char ISBN[MAX_STRING];
+        if (fgets(ISBN, MAX_STRING, file) == NULL) {
+            ISBN[0] = 0;
+        }
+        ISBN[strcspn(ISBN, "\n")] = 0;
+        int valid = parseISBN(ISBN, &book->ISBN);
         
-        fgets(books[i].author, MAX_STRING, file);
-        books[i].author[strcspn(books[i].author, "\n")] = 0;
+        int stored = readText(file, &book->title);
         
-        fgets(books[i].publisher, MAX_STRING, file);
-        books[i].publisher[strcspn(books[i].publisher, "\n")] = 0;
+        book->author = readSymbol(file);
+        book->publisher = readSymbol(file);
         
-        fscanf(file, "%d\n", &books[i].publishYear);
+        fscanf(file, "%d\n", &book->publishYear);
         
-        fgets(books[i].category, MAX_STRING, file);
-        books[i].category[strcspn(books[i].category, "\n")] = 0;
+        book->category = readSymbol(file);
         
-        fscanf(file, "%f\n", &books[i].price);
-        fscanf(file, "%d\n", &books[i].quantity);
+        fscanf(file, "%f\n", &book->price);
+        fscanf(file, "%d\n", &book->quantity);
+        if (!stored || !updateBookKeys(book)) {
+            printf("Not enough memory to load book data.\n");
+            break;
+        }
+        if (!valid) {
+            printf("Invalid ISBN '%s' in file, book skipped.\n", ISBN);
+            arenaRelease(&bookText, book->title);
+            arenaRelease(&bookText, book->titleKey);
+            continue;
+        }
+        (*bookCount)++;
     }
     
     fclose(file);
+    rebuildBookIndexes(*bookCount);
     printf("Books loaded from file successfully.\n");
 } 
\ No newline at end of file
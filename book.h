@@ -5,23 +5,93 @@
 #include <stdlib.h>
 #include <string.h>
 #include "constants.h"
+#include "table.h"
+#include "intern.h"
+#include "textarena.h"
+#include "hashindex.h"
+#include "rangeindex.h"
+
+// Room for the longest ISBN (13 digits) and the terminator
+#define ISBN_LENGTH 14
 
 // Define the Book struct
+// Deleted books leave their row behind as a tombstone that the next added
+// book reuses, so rows never move while the program runs; snapshots only
+// hold live books.
+// Author, publisher and category repeat across many books, so they are
+// interned and each row only keeps their symbols (see symbolText). The
+// title lives in the book text arena (see bookString).
 typedef struct {
-    char ISBN[MAX_STRING];
-    char title[MAX_STRING];
-    char author[MAX_STRING];
-    char publisher[MAX_STRING];
+    unsigned long long ISBN;       // 10- or 13-digit ISBN as a number
+    TextRef title;
+    TextRef titleKey;              // Normalized title used by searches
+    Symbol author;
+    Symbol publisher;
+    Symbol category;
+    Symbol authorKey;              // Normalized author used by searches
     int publishYear;
-    char category[MAX_STRING];
     float price;
     int quantity;
+    unsigned char deleted;         // Non-zero once the book is deleted and the row is free
 } Book;
 
-// Declare the books array
-extern Book books[MAX_BOOKS];
+// Values of every field of a book, used to add or replace a book without
+// prompting (journal replay)
+typedef struct {
+    unsigned long long ISBN;
+    const char *title;
+    const char *author;
+    const char *publisher;
+    const char *category;
+    int publishYear;
+    float price;
+    int quantity;
+} BookValues;
+
+// Facets books can be browsed by. The decade of a book is its publish
+// year rounded down to a multiple of ten.
+enum { BOOK_FACET_CATEGORY, BOOK_FACET_PUBLISHER, BOOK_FACET_DECADE, BOOK_FACET_COUNT };
+
+// Most values that can be picked for one facet
+#define MAX_FACET_PICKS 8
+
+// Values picked while browsing by facets (category and publisher symbols,
+// decades). A book matches when, for every facet with values picked, it
+// has one of them.
+typedef struct {
+    int values[BOOK_FACET_COUNT][MAX_FACET_PICKS];
+    int count[BOOK_FACET_COUNT];
+} FacetSelection;
+
+// Number of matching books with one value of a facet
+typedef struct {
+    int value;
+    int count;
+} FacetCount;
+
+// Declare the table of books
+extern Table bookTable;
+
+// Declare the arena holding the text of books
+extern TextArena bookText;
+
+// Returns the text of a book field stored in the arena
+static inline const char *bookString(TextRef ref) {
+    return arenaText(&bookText, ref);
+}
+
+// Returns the book stored at the given row
+static inline Book *bookAt(int index) {
+    return (Book *)tableRow(&bookTable, index);
+}
+
+// Returns non-zero if the row holds a book that has not been deleted
+static inline int isBookLive(int index) {
+    return !bookAt(index)->deleted;
+}
 
 // Declare the functions
+int liveBookCount(int bookCount);
 void addBook(int *bookCount);
 void updateBook(int bookCount);
 void deleteBook(int *bookCount);
@@ -29,8 +99,31 @@ void searchBook(int bookCount);
 void searchBookByTitle(int bookCount);
 void searchBookByISBN(int bookCount);
 void displayAllBooks(int bookCount);
+int findBookPage(int bookCount, unsigned long long ISBN, RangePageStart start, int size, int *rows,
+                 int *hasPrevious, int *hasNext);
+void filterBooks(int bookCount);
+void browseBooksByRange(int bookCount);
+int findBooksInRange(int bookCount, const char *field, double low, double high, int descending, int limit,
+                     int **rows);
+void browseBooksByFacets(int bookCount);
+int parseBookFacetValue(int facet, const char *text, int *value);
+void formatBookFacetValue(int facet, int value, char *text);
+int findBooksByFacets(int bookCount, const FacetSelection *selection, int **rows);
+int countBookFacets(int bookCount, const FacetSelection *selection, FacetCount *counts[BOOK_FACET_COUNT],
+                    int valueCounts[BOOK_FACET_COUNT]);
+int benchmarkTitleSearch(int bookCount, const char *term, int rounds);
 void saveBooksToFile(int bookCount);
 void loadBooksFromFile(int *bookCount);
-int findBookByISBN(int bookCount, const char *ISBN);
+int storeBook(int *bookCount, const BookValues *values);
+void removeBook(int index);
+void adjustBookQuantity(int index, int change);
+void rebuildBookIndexes(int bookCount);
+int reserveBooks(int bookCount, int rows);
+const HashIndex *bookISBNIndex(void);
+void restoreBookIndexes(int bookCount, const int *isbnRows, const unsigned int *isbnHashes, int isbnCapacity);
+int findBookByISBN(int bookCount, unsigned long long ISBN);
+int findBookByISBNText(int bookCount, const char *text);
+int parseISBN(const char *text, unsigned long long *ISBN);
+void formatISBN(unsigned long long ISBN, char *text);
 
 #endif // BOOK_H 
\ No newline at end of file
@@ -2,9 +2,18 @@
 #include "reader.h"
 #include "book.h"
 #include "library.h"
+#include "journal.h"
+#include "counters.h"
+#include "columns.h"
 
-// Define the array of borrowings
-Borrowing borrowings[MAX_BORROWINGS];
+// Define the table of borrowings
+Table borrowingTable = TABLE_INIT(Borrowing);
+
+// Active and returned borrowings of each reader
+LoanIndex readerLoans = LOAN_INDEX_INIT;
+
+// Borrowings not yet returned, earliest due date first
+DueQueue openLoans = DUE_QUEUE_INIT;
 
 // Function to calculate fines
 int calculateFine(time_t dueDate, time_t returnDate) {
@@ -15,24 +24,115 @@ int calculateFine(time_t dueDate, time_t returnDate) {
     return daysLate * FINE_PER_DAY;
 }
 
+/**
+ * @brief Finds the row of the reader who made a borrowing
+ * @param borrowing The borrowing record
+ * @return int Index of the reader, or -1 if the reader has been deleted
+ *
+ * The handle stored in the record resolves in O(1); once the reader's row
+ * has been released its generation no longer matches and the handle is
+ * reported as stale instead of pointing at whoever took the row next.
+ */
+int findReaderOfBorrowing(const Borrowing *borrowing) {
+    return slotMapResolve(&readerSlots, borrowing->readerHandle);
+}
+
+/**
+ * @brief Appends a borrowing and takes its books out of stock
+ * @param bookCount Current number of books in the system
+ * @param borrowingCount Pointer to the current number of borrowings
+ * @param borrowing The borrowing to add; its reader handle is filled in
+ * @return int Row of the new borrowing, or -1 if memory could not be allocated
+ */
+int storeBorrowing(int bookCount, int *borrowingCount, const Borrowing *borrowing) {
+    if (!tableReserve(&borrowingTable, *borrowingCount + 1) ||
+        !dueQueueReserve(&openLoans, *borrowingCount + 1) ||
+        !loanIndexAdd(&readerLoans, borrowing->readerID, *borrowingCount, borrowing->isReturned)) {
+        return -1;
+    }
+    int index = (*borrowingCount)++;
+    if (!borrowing->isReturned) {
+        dueQueuePush(&openLoans, index, borrowing->dueDate);
+        libraryCounters.activeLoans++;
+        libraryCounters.booksOut += borrowing->bookCount;
+    }
+    Borrowing *stored = borrowingAt(index);
+    *stored = *borrowing;
+    stored->readerHandle = slotMapHandle(&readerSlots, stored->readerID);
+    for (int i = 0; i < stored->bookCount; i++) {
+        int bookIndex = findBookByISBN(bookCount, stored->books[i]);
+        if (bookIndex != -1) {
+            adjustBookQuantity(bookIndex, -1);
+        }
+    }
+    borrowingColumnsUpdate(index);
+    return index;
+}
+
+/**
+ * @brief Marks a borrowing as returned and puts its books back in stock
+ * @param bookCount Current number of books in the system
+ * @param index Row of the borrowing
+ * @param returnDate Time the books came back
+ * @return void
+ */
+void returnBorrowing(int bookCount, int index, time_t returnDate) {
+    Borrowing *borrowing = borrowingAt(index);
+    borrowing->returnDate = returnDate;
+    for (int i = 0; i < borrowing->bookCount; i++) {
+        int bookIndex = findBookByISBN(bookCount, borrowing->books[i]);
+        if (bookIndex != -1) {
+            adjustBookQuantity(bookIndex, 1);
+        }
+    }
+    if (!borrowing->isReturned) {
+        libraryCounters.activeLoans--;
+        libraryCounters.booksOut -= borrowing->bookCount;
+    }
+    borrowing->isReturned = 1;
+    loanIndexReturn(&readerLoans, borrowing->readerID, index);
+    dueQueueRemove(&openLoans, index);
+    borrowingColumnsUpdate(index);
+}
+
+/**
+ * @brief Checks that a copy of one of the books of a borrowing is in stock
+ * @param bookCount Current number of books in the system
+ * @param borrowing The borrowing being put together
+ * @param i Position of the book in the borrowing
+ * @return LendCheck LEND_OK if a copy is left once the books at earlier
+ *         positions are taken
+ */
+LendCheck checkLendable(int bookCount, const Borrowing *borrowing, int i) {
+    int bookIndex = findBookByISBN(bookCount, borrowing->books[i]);
+    if (bookIndex == -1) {
+        return LEND_NOT_FOUND;
+    }
+    // Copies of this book already taken by earlier entries
+    int taken = 0;
+    for (int j = 0; j < i; j++) {
+        if (borrowing->books[j] == borrowing->books[i]) {
+            taken++;
+        }
+    }
+    if (bookAt(bookIndex)->quantity - taken <= 0) {
+        return LEND_UNAVAILABLE;
+    }
+    return LEND_OK;
+}
+
 /**
  * @brief Creates a new borrowing record
- * @param books Array of books in the system
  * @param bookCount Current number of books in the system
- * @param readers Array of readers in the system
  * @param readerCount Current number of readers in the system
  * @param borrowingCount Pointer to the current number of borrowings
  * @return void
  * 
  * This function creates a new borrowing record with multiple books,
  * borrowing date, and due date (7 days from borrowing date).
+ * Stock only changes once every book has been checked.
  */
-void createBorrowing(Book books[], int bookCount, Reader readers[], int readerCount, int *borrowingCount) {
-    if (*borrowingCount >= MAX_BORROWINGS) {
-        printf("Maximum number of borrowings reached!\n");
-        return;
-    }
-
+void createBorrowing(int bookCount, int readerCount, int *borrowingCount) {
     int readerId;
     printf("Enter reader ID: ");
     scanf("%d", &readerId);
@@ -46,7 +146,7 @@ void createBorrowing(Book books[], int bookCount, Reader readers[], int readerCo
 
     // Check if reader's card is expired
     time_t currentTime = time(NULL);
-    if (currentTime > readers[readerIndex].cardExpiryDate) {
+    if (dayFromTime(currentTime) > readerAt(readerIndex)->cardExpiryDate) {
         printf("Reader's card has expired!\n");
         return;
     }
@@ -61,50 +161,58 @@ void createBorrowing(Book books[], int bookCount, Reader readers[], int readerCo
         return;
     }
 
-    borrowings[*borrowingCount].readerID = readerId;
-    borrowings[*borrowingCount].borrowingDate = currentTime;
-    borrowings[*borrowingCount].dueDate = currentTime + (7 * 24 * 60 * 60); // 7 days from now
-    borrowings[*borrowingCount].bookCount = numBooks;
-    borrowings[*borrowingCount].isReturned = 0;
+    Borrowing borrowing;
+    memset(&borrowing, 0, sizeof(Borrowing));
+    borrowing.readerID = readerId;
+    borrowing.borrowingDate = currentTime;
+    borrowing.dueDate = currentTime + LOAN_DAYS * 24 * 60 * 60;
+    borrowing.bookCount = numBooks;
+    borrowing.isReturned = 0;
 
     printf("Enter ISBN for each book:\n");
     for (int i = 0; i < numBooks; i++) {
         printf("Book %d ISBN: ", i + 1);
-        scanf("%s", borrowings[*borrowingCount].books[i]);
+        char ISBN[MAX_STRING];
+        scanf("%99s", ISBN);
         clearInputBuffer();
 
-        int bookIndex = findBookByISBN(bookCount, borrowings[*borrowingCount].books[i]);
-        if (bookIndex == -1) {
-            printf("Book not found!\n");
+        if (!parseISBN(ISBN, &borrowing.books[i])) {
+            printf("Invalid ISBN! Must be 10 or 13 digits.\n");
             return;
         }
-
-        if (books[bookIndex].quantity <= 0) {
-            printf("Book is not available for borrowing!\n");
-            return;
+        switch (checkLendable(bookCount, &borrowing, i)) {
+            case LEND_NOT_FOUND:
+                printf("Book not found!\n");
+                return;
+            case LEND_UNAVAILABLE:
+                printf("Book is not available for borrowing!\n");
+                return;
+            case LEND_OK:
+                break;
         }
-
-        books[bookIndex].quantity--;
     }
 
+    int index = storeBorrowing(bookCount, borrowingCount, &borrowing);
+    if (index == -1) {
+        printf("Out of memory! Cannot create more borrowings.\n");
+        return;
+    }
+    journalBorrowing(borrowingAt(index));
     printf("Books borrowed successfully!\n");
-    printf("Due date: %s\n", ctime(&borrowings[*borrowingCount].dueDate));
-    (*borrowingCount)++;
+    printf("Due date: %s\n", ctime(&borrowing.dueDate));
 }
 
 /**
  * @brief Returns borrowed books
- * @param books Array of books in the system
  * @param bookCount Current number of books in the system
- * @param readers Array of readers in the system
  * @param readerCount Current number of readers in the system
- * @param borrowingCount Current number of borrowings
  * @return void
  * 
  * This function handles the return of borrowed books, including
- * calculating fines for late returns.
+ * calculating fines for late returns. The clerk picks one of the
+ * reader's loans that are still out from a numbered list.
  */
-void returnBooks(Book books[], int bookCount, Reader readers[], int readerCount, int borrowingCount) {
+void returnBooks(int bookCount, int readerCount) {
     int readerId;
     printf("Enter reader ID: ");
     scanf("%d", &readerId);
@@ -116,46 +224,55 @@ void returnBooks(Book books[], int bookCount, Reader readers[], int readerCount,
         return;
     }
 
-    printf("Enter borrowing index to return: ");
-    int borrowIndex;
-    scanf("%d", &borrowIndex);
-    clearInputBuffer();
-
-    if (borrowIndex < 0 || borrowIndex >= borrowingCount) {
-        printf("Invalid borrowing index!\n");
+    // List the reader's loans that are still out
+    int loans[MAX_LOANS_LISTED];
+    int loanCount = 0;
+    printf("\nBooks on loan to %s:\n", readerString(readerAt(readerIndex)->name));
+    for (int row = loanIndexFirst(&readerLoans, readerId, 0); row != -1 && loanCount < MAX_LOANS_LISTED;
+         row = loanIndexNext(&readerLoans, row)) {
+        const Borrowing *loan = borrowingAt(row);
+        char due[DATE_LENGTH];
+        formatDate(dayFromTime(loan->dueDate), due);
+        loans[loanCount++] = row;
+        printf("%d. Due %s:", loanCount, due);
+        for (int j = 0; j < loan->bookCount; j++) {
+            int bookIndex = findBookByISBN(bookCount, loan->books[j]);
+            printf("%s %s", j == 0 ? "" : ",", bookIndex != -1 ? bookString(bookAt(bookIndex)->title) : "unknown");
+        }
+        printf("\n");
+    }
+    if (loanCount == 0) {
+        printf("This reader has no books to return!\n");
         return;
     }
 
-    if (borrowings[borrowIndex].readerID != readerId) {
-        printf("This borrowing record does not belong to the reader!\n");
-        return;
+    printf("Enter loan number to return: ");
+    int choice;
+    if (scanf("%d", &choice) != 1) {
+        choice = 0;
     }
+    clearInputBuffer();
 
-    if (borrowings[borrowIndex].isReturned) {
-        printf("These books have already been returned!\n");
+    if (choice < 1 || choice > loanCount) {
+        printf("Invalid loan number!\n");
         return;
     }
+    int borrowIndex = loans[choice - 1];
+    Borrowing *borrowing = borrowingAt(borrowIndex);
 
     time_t currentTime = time(NULL);
-    borrowings[borrowIndex].returnDate = currentTime;
 
     // Calculate fine if late
-    int fine = calculateFine(borrowings[borrowIndex].dueDate, currentTime);
+    int fine = calculateFine(borrowing->dueDate, currentTime);
     if (fine > 0) {
         printf("Late return fine: %d VND\n", fine);
     }
 
     // Return all books
-    for (int i = 0; i < borrowings[borrowIndex].bookCount; i++) {
-        int bookIndex = findBookByISBN(bookCount, borrowings[borrowIndex].books[i]);
-        if (bookIndex != -1) {
-            books[bookIndex].quantity++;
-        }
-    }
-
-    borrowings[borrowIndex].isReturned = 1;
+    returnBorrowing(bookCount, borrowIndex, currentTime);
+    journalReturn(borrowIndex, currentTime);
     printf("Books returned successfully!\n");
-    printf("Reader: %s (CMND: %s)\n", readers[readerIndex].name, readers[readerIndex].CMND);
+    printf("Reader: %s (CMND: %s)\n", readerString(readerAt(readerIndex)->name), readerString(readerAt(readerIndex)->CMND));
 }
 
 /**
@@ -177,16 +294,19 @@ void saveBorrowingsToFile(int borrowingCount) {
     
     // Save the information of each borrowing
     for (int i = 0; i < borrowingCount; i++) {
-        fprintf(file, "%d\n", borrowings[i].readerID);
-        fprintf(file, "%ld\n", borrowings[i].borrowingDate);
-        fprintf(file, "%ld\n", borrowings[i].dueDate);
-        fprintf(file, "%ld\n", borrowings[i].returnDate);
-        fprintf(file, "%d\n", borrowings[i].bookCount);
-        fprintf(file, "%d\n", borrowings[i].isReturned);
+        const Borrowing *borrowing = borrowingAt(i);
+        fprintf(file, "%d\n", borrowing->readerID);
+        fprintf(file, "%ld\n", borrowing->borrowingDate);
+        fprintf(file, "%ld\n", borrowing->dueDate);
+        fprintf(file, "%ld\n", borrowing->returnDate);
+        fprintf(file, "%d\n", borrowing->bookCount);
+        fprintf(file, "%d\n", borrowing->isReturned);
         
         // Lưu danh sách sách mượn
-        for (int j = 0; j < borrowings[i].bookCount; j++) {
-            fprintf(file, "%s\n", borrowings[i].books[j]);
+        for (int j = 0; j < borrowing->bookCount; j++) {
+            char ISBN[ISBN_LENGTH];
+            formatISBN(borrowing->books[j], ISBN);
+            fprintf(file, "%s\n", ISBN);
         }
     }
     
@@ -210,23 +330,74 @@ void loadBorrowingsFromFile(int *borrowingCount) {
     
     // Read the number of borrowings
     fscanf(file, "%d\n", borrowingCount);
+    if (*borrowingCount < 0 || !tableReserve(&borrowingTable, *borrowingCount)) {
+        printf("Not enough memory to load borrowing data.\n");
+        *borrowingCount = 0;
+        fclose(file);
+        return;
+    }
     
     // Read the information of each borrowing
     for (int i = 0; i < *borrowingCount; i++) {
-        fscanf(file, "%d\n", &borrowings[i].readerID);
-        fscanf(file, "%ld\n", &borrowings[i].borrowingDate);
-        fscanf(file, "%ld\n", &borrowings[i].dueDate);
-        fscanf(file, "%ld\n", &borrowings[i].returnDate);
-        fscanf(file, "%d\n", &borrowings[i].bookCount);
-        fscanf(file, "%d\n", &borrowings[i].isReturned);
+        Borrowing *borrowing = borrowingAt(i);
+        fscanf(file, "%d\n", &borrowing->readerID);
+        fscanf(file, "%ld\n", &borrowing->borrowingDate);
+        fscanf(file, "%ld\n", &borrowing->dueDate);
+        fscanf(file, "%ld\n", &borrowing->returnDate);
+        fscanf(file, "%d\n", &borrowing->bookCount);
+        fscanf(file, "%d\n", &borrowing->isReturned);
         
         // Read the list of borrowed books
-        for (int j = 0; j < borrowings[i].bookCount; j++) {
-            fgets(borrowings[i].books[j], MAX_STRING, file);
-            borrowings[i].books[j][strcspn(borrowings[i].books[j], "\n")] = 0;
+        for (int j = 0; j < borrowing->bookCount; j++) {
+            char ISBN[MAX_STRING];
+            if (fgets(ISBN, MAX_STRING, file) == NULL) {
+                ISBN[0] = 0;
+            }
+            ISBN[strcspn(ISBN, "\n")] = 0;
+            if (!parseISBN(ISBN, &borrowing->books[j])) {
+                borrowing->books[j] = 0;
+            }
         }
     }
     
     fclose(file);
+    restoreBorrowings(*borrowingCount);
     printf("Borrowings loaded from file successfully.\n");
+}
+
+/**
+ * @brief Links the borrowings loaded into the table to their readers
+ * @param borrowingCount Number of loaded borrowings
+ * @return void
+ *
+ * Readers must be loaded first. Sets the reader handle of every
+ * borrowing, rebuilds the loan lists of every reader and the queue of
+ * open loans, and recounts the loan statistics.
+ */
+void restoreBorrowings(int borrowingCount) {
+    loanIndexClear(&readerLoans);
+    dueQueueClear(&openLoans);
+    libraryCounters.activeLoans = 0;
+    libraryCounters.booksOut = 0;
+    rebuildBorrowingColumns(borrowingCount);
+    if (!dueQueueReserve(&openLoans, borrowingCount)) {
+        printf("Not enough memory to index borrowings, overdue loans will not be listed.\n");
+    }
+    // Loans the reader lists could not take still go in the queue and the counters
+    int unlisted = 0;
+    for (int i = 0; i < borrowingCount; i++) {
+        Borrowing *borrowing = borrowingAt(i);
+        borrowing->readerHandle = slotMapHandle(&readerSlots, borrowing->readerID);
+        if (!borrowing->isReturned) {
+            dueQueuePush(&openLoans, i, borrowing->dueDate);
+            libraryCounters.activeLoans++;
+            libraryCounters.booksOut += borrowing->bookCount;
+        }
+        if (!loanIndexAdd(&readerLoans, borrowing->readerID, i, borrowing->isReturned) && borrowing->readerID > 0) {
+            unlisted++;
+        }
+    }
+    if (unlisted > 0) {
+        printf("Not enough memory to index borrowings, %d loans will not be listed by reader.\n", unlisted);
+    }
 } 
\ No newline at end of file
@@ -7,10 +7,9 @@
 #include <time.h>
 #include "reader.h"
 #include "book.h"
-
-#define MAX_BORROWINGS 1000
-#define MAX_BOOKS_PER_READER 5
-#define MAX_STRING 100
+#include "table.h"
+#include "loanindex.h"
+#include "duequeue.h"
 
 // Define the Borrowing struct
 typedef struct {
@@ -19,18 +18,42 @@ typedef struct {
     time_t dueDate;
     time_t returnDate;
     int bookCount;
-    char books[MAX_BOOKS_PER_READER][MAX_STRING];
+    unsigned long long books[MAX_BOOKS_PER_READER];    // ISBNs of the borrowed books
     int isReturned;
+    SlotHandle readerHandle;    // Row of the reader when the record was created or loaded
 } Borrowing;
 
-// Declare the borrowings array
-extern Borrowing borrowings[MAX_BORROWINGS];
+// Outcome of checking a book that is about to be lent
+typedef enum {
+    LEND_OK,
+    LEND_NOT_FOUND,
+    LEND_UNAVAILABLE
+} LendCheck;
+
+// Declare the table of borrowings
+extern Table borrowingTable;
+
+// Active and returned borrowings of each reader ID
+extern LoanIndex readerLoans;
+
+// Borrowings not yet returned, earliest due date first
+extern DueQueue openLoans;
+
+// Returns the borrowing stored at the given row
+static inline Borrowing *borrowingAt(int index) {
+    return (Borrowing *)tableRow(&borrowingTable, index);
+}
 
 // Declare the functions
-void createBorrowing(Book books[], int bookCount, Reader readers[], int readerCount, int *borrowingCount);
-void returnBooks(Book books[], int bookCount, Reader readers[], int readerCount, int borrowingCount);
+void createBorrowing(int bookCount, int readerCount, int *borrowingCount);
+void returnBooks(int bookCount, int readerCount);
+int storeBorrowing(int bookCount, int *borrowingCount, const Borrowing *borrowing);
+void returnBorrowing(int bookCount, int index, time_t returnDate);
 void saveBorrowingsToFile(int borrowingCount);
 void loadBorrowingsFromFile(int *borrowingCount);
+void restoreBorrowings(int borrowingCount);
 int calculateFine(time_t dueDate, time_t returnDate);
+LendCheck checkLendable(int bookCount, const Borrowing *borrowing, int i);
+int findReaderOfBorrowing(const Borrowing *borrowing);
 
 #endif // BORROWING_H 
\ No newline at end of file
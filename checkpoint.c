@@ -0,0 +1,188 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "library.h"
+
+// A checkpoint writes a fresh snapshot without holding up the desk. The
+// process forks between two commands and the child writes the tables as
+// they were at that moment (its copy-on-write view of them), while the
+// parent keeps taking changes, which the journal records after the
+// checkpoint marker. A background thread flags when a checkpoint is due
+// and waits for the child; the tables and the journal are only touched
+// by the main thread, once the child is done.
+
+static pthread_t checkpointThread;
+static pthread_mutex_t checkpointLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t checkpointWake = PTHREAD_COND_INITIALIZER;
+
+static int checkpointInterval = 0;     // 0 while the thread is not running
+static int stopping = 0;
+static int due = 0;                    // Interval elapsed, checkpoint wanted
+
+// Child writing a snapshot, -1 when there is none
+static pid_t writer = -1;
+static unsigned int writerGeneration = 0;
+static struct timespec writerStart;
+
+// Outcome of the last checkpoint, until the main thread reports it
+static int finished = 0;
+static int succeeded = 0;
+static double duration = 0;
+
+// Returns the seconds from one time to another
+static double secondsBetween(struct timespec from, struct timespec to) {
+    return (double)(to.tv_sec - from.tv_sec) + (double)(to.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Waits for the snapshot writer and records how it went
+ * @return void
+ *
+ * Called with the lock held; the lock is released while waiting.
+ */
+static void reapWriter(void) {
+    pid_t pid = writer;
+    pthread_mutex_unlock(&checkpointLock);
+    int status;
+    pid_t result;
+    do {
+        result = waitpid(pid, &status, 0);
+    } while (result == -1 && errno == EINTR);
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_lock(&checkpointLock);
+    succeeded = result == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    duration = secondsBetween(writerStart, end);
+    finished = 1;
+    writer = -1;
+}
+
+// Body of the checkpointer thread
+static void *checkpointLoop(void *unused) {
+    (void)unused;
+    pthread_mutex_lock(&checkpointLock);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += checkpointInterval;
+    while (!stopping) {
+        if (writer != -1) {
+            reapWriter();
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += checkpointInterval;
+            continue;
+        }
+        if (pthread_cond_timedwait(&checkpointWake, &checkpointLock, &deadline) == ETIMEDOUT) {
+            due = 1;
+            deadline.tv_sec += checkpointInterval;
+        }
+    }
+    if (writer != -1) {
+        reapWriter();
+    }
+    pthread_mutex_unlock(&checkpointLock);
+    return NULL;
+}
+
+// Starts the background checkpointer
+void startCheckpointer(int interval) {
+    if (interval <= 0) {
+        return;
+    }
+    checkpointInterval = interval;
+    if (pthread_create(&checkpointThread, NULL, checkpointLoop, NULL) != 0) {
+        checkpointInterval = 0;
+        printf("Cannot start checkpointer, the library is only saved on exit.\n");
+    }
+}
+
+/**
+ * @brief Reports a finished checkpoint and drops the journal records it holds
+ * @return void
+ *
+ * Called by the main thread with the lock held.
+ */
+static void finishCheckpoint(void) {
+    finished = 0;
+    if (!succeeded) {
+        printf("Checkpoint failed, changes are kept in the journal.\n");
+        return;
+    }
+    compactJournal(writerGeneration);
+    struct stat info;
+    long long bytes = stat(SNAPSHOT_FILE, &info) == 0 ? (long long)info.st_size : 0;
+    printf("Checkpoint wrote %lld bytes to %s in %.2f s.\n", bytes, SNAPSHOT_FILE, duration);
+}
+
+/**
+ * @brief Forks a child that writes a snapshot of the current tables
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return void
+ */
+static void startWriter(int bookCount, int readerCount, int borrowingCount) {
+    unsigned int generation = nextSnapshotGeneration();
+    if (!journalCheckpoint(generation)) {
+        return;
+    }
+    // Output still buffered would otherwise be printed by the child too
+    fflush(stdout);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int ok = saveSnapshot(SNAPSHOT_FILE, generation, bookCount, readerCount, borrowingCount);
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+    if (pid == -1) {
+        printf("Checkpoint failed, changes are kept in the journal.\n");
+        return;
+    }
+    pthread_mutex_lock(&checkpointLock);
+    writer = pid;
+    writerGeneration = generation;
+    writerStart = start;
+    pthread_cond_signal(&checkpointWake);
+    pthread_mutex_unlock(&checkpointLock);
+}
+
+// Starts a checkpoint if one is due and reports finished ones
+void checkpointIfDue(int bookCount, int readerCount, int borrowingCount) {
+    if (checkpointInterval == 0) {
+        return;
+    }
+    pthread_mutex_lock(&checkpointLock);
+    if (finished) {
+        finishCheckpoint();
+    }
+    int start = due && writer == -1;
+    if (start) {
+        due = 0;
+    }
+    pthread_mutex_unlock(&checkpointLock);
+    if (start && journalHasChanges()) {
+        startWriter(bookCount, readerCount, borrowingCount);
+    }
+}
+
+// Waits for a running checkpoint and stops the checkpointer
+void stopCheckpointer(void) {
+    if (checkpointInterval == 0) {
+        return;
+    }
+    pthread_mutex_lock(&checkpointLock);
+    stopping = 1;
+    pthread_cond_signal(&checkpointWake);
+    pthread_mutex_unlock(&checkpointLock);
+    pthread_join(checkpointThread, NULL);
+    if (finished) {
+        finishCheckpoint();
+    }
+    checkpointInterval = 0;
+}
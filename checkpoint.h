@@ -0,0 +1,33 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// Seconds between checkpoints unless set on the command line
+#define CHECKPOINT_INTERVAL 60
+
+/**
+ * @brief Starts the background checkpointer
+ * @param interval Seconds between checkpoints, 0 to never checkpoint
+ * @return void
+ */
+void startCheckpointer(int interval);
+
+/**
+ * @brief Starts a checkpoint if one is due and reports finished ones
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return void
+ *
+ * Called by the menus between commands, when the tables are consistent.
+ * Starting a checkpoint only forks the process; the snapshot is written
+ * by the child while the desk carries on.
+ */
+void checkpointIfDue(int bookCount, int readerCount, int borrowingCount);
+
+/**
+ * @brief Waits for a running checkpoint and stops the checkpointer
+ * @return void
+ */
+void stopCheckpointer(void);
+
+#endif // CHECKPOINT_H
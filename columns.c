@@ -0,0 +1,291 @@
+#include <limits.h>
+#include "columns.h"
+#include "library.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define COLUMNS_AVX2 1
+#endif
+
+BookColumns bookColumns = { NULL, NULL, NULL, NULL, 0, 0 };
+BorrowingColumns borrowingColumns = { NULL, NULL, 0, 0 };
+
+/**
+ * @brief Grows arrays of the given element sizes to hold a number of rows
+ * @param arrays The arrays
+ * @param sizes Element size of each array
+ * @param count Number of arrays
+ * @param capacity Current length of the arrays, updated on success
+ * @param needed Rows the arrays must hold
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int growColumns(void **arrays[], const size_t *sizes, int count, int *capacity, int needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    int newCapacity = *capacity == 0 ? 1024 : *capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    for (int i = 0; i < count; i++) {
+        void *grown = realloc(*arrays[i], sizes[i] * (size_t)newCapacity);
+        if (grown == NULL) {
+            return 0;
+        }
+        *arrays[i] = grown;
+    }
+    *capacity = newCapacity;
+    return 1;
+}
+
+static int growBookColumns(int needed) {
+    void **arrays[] = { (void **)&bookColumns.price, (void **)&bookColumns.year,
+                        (void **)&bookColumns.quantity, (void **)&bookColumns.live };
+    const size_t sizes[] = { sizeof(float), sizeof(int), sizeof(int), sizeof(unsigned char) };
+    return growColumns(arrays, sizes, 4, &bookColumns.capacity, needed);
+}
+
+static int growBorrowingColumns(int needed) {
+    void **arrays[] = { (void **)&borrowingColumns.dueDate, (void **)&borrowingColumns.returned };
+    const size_t sizes[] = { sizeof(long long), sizeof(unsigned char) };
+    return growColumns(arrays, sizes, 2, &borrowingColumns.capacity, needed);
+}
+
+/**
+ * @brief Copies one book row into the columns, which must be large enough
+ * @param row Row of the book
+ * @return void
+ */
+static void copyBook(int row) {
+    const Book *book = bookAt(row);
+    bookColumns.price[row] = book->price;
+    bookColumns.year[row] = book->publishYear;
+    bookColumns.quantity[row] = book->quantity;
+    bookColumns.live[row] = isBookLive(row);
+}
+
+// Copies the fields of one book row into the columns
+void bookColumnsUpdate(int row) {
+    if (!growBookColumns(row + 1)) {
+        bookColumns.stale = 1;
+        return;
+    }
+    copyBook(row);
+}
+
+// Copies every book row into the columns
+int rebuildBookColumns(int bookCount) {
+    if (!growBookColumns(bookCount)) {
+        bookColumns.stale = 1;
+        return 0;
+    }
+    for (int i = 0; i < bookCount; i++) {
+        copyBook(i);
+    }
+    bookColumns.stale = 0;
+    return 1;
+}
+
+// Copies the fields of one borrowing into the columns
+void borrowingColumnsUpdate(int row) {
+    if (!growBorrowingColumns(row + 1)) {
+        borrowingColumns.stale = 1;
+        return;
+    }
+    borrowingColumns.dueDate[row] = borrowingAt(row)->dueDate;
+    borrowingColumns.returned[row] = borrowingAt(row)->isReturned != 0;
+}
+
+// Copies every borrowing into the columns
+int rebuildBorrowingColumns(int borrowingCount) {
+    if (!growBorrowingColumns(borrowingCount)) {
+        borrowingColumns.stale = 1;
+        return 0;
+    }
+    for (int i = 0; i < borrowingCount; i++) {
+        borrowingColumns.dueDate[i] = borrowingAt(i)->dueDate;
+        borrowingColumns.returned[i] = borrowingAt(i)->isReturned != 0;
+    }
+    borrowingColumns.stale = 0;
+    return 1;
+}
+
+/**
+ * @brief Filters book rows one at a time
+ * @param filter The conditions
+ * @param from First row
+ * @param to Row after the last one
+ * @param rows Receives matching rows, or NULL
+ * @param stockValue Sum of price times quantity, added to
+ * @return int Number of matches
+ */
+static int filterBooksScalar(const BookFilter *filter, int from, int to, int *rows, double *stockValue) {
+    int count = 0;
+    double value = 0;
+    for (int i = from; i < to; i++) {
+        float price = bookColumns.price[i];
+        int year = bookColumns.year[i];
+        int quantity = bookColumns.quantity[i];
+        if (bookColumns.live[i] && year >= filter->yearFrom && year <= filter->yearTo &&
+            price >= filter->priceFrom && price <= filter->priceTo && quantity >= filter->minQuantity) {
+            if (rows != NULL) {
+                rows[count] = i;
+            }
+            count++;
+            value += (double)price * quantity;
+        }
+    }
+    *stockValue += value;
+    return count;
+}
+
+/**
+ * @brief Counts open borrowings due before a time one at a time
+ * @param before The time
+ * @param from First row
+ * @param to Row after the last one
+ * @return int Number of matches
+ */
+static int countDueScalar(long long before, int from, int to) {
+    int count = 0;
+    for (int i = from; i < to; i++) {
+        count += !borrowingColumns.returned[i] && borrowingColumns.dueDate[i] < before;
+    }
+    return count;
+}
+
+#ifdef COLUMNS_AVX2
+/**
+ * @brief Filters book rows eight at a time with AVX2
+ * @param filter The conditions
+ * @param end Rows before this one are scanned, a multiple of eight
+ * @param rows Receives matching rows, or NULL
+ * @param stockValue Sum of price times quantity, added to
+ * @return int Number of matches
+ *
+ * Integer bounds are turned into strict comparisons, so they are clamped
+ * to keep year - 1 and the like from overflowing.
+ */
+__attribute__((target("avx2")))
+static int filterBooksAVX2(const BookFilter *filter, int end, int *rows, double *stockValue) {
+    const __m256i yearAbove = _mm256_set1_epi32(filter->yearFrom > INT_MIN ? filter->yearFrom - 1 : INT_MIN);
+    const __m256i yearBelow = _mm256_set1_epi32(filter->yearTo < INT_MAX ? filter->yearTo + 1 : INT_MAX);
+    const __m256i quantityAbove = _mm256_set1_epi32(filter->minQuantity > INT_MIN ? filter->minQuantity - 1 : INT_MIN);
+    const __m256 priceFrom = _mm256_set1_ps(filter->priceFrom);
+    const __m256 priceTo = _mm256_set1_ps(filter->priceTo);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256d value = _mm256_setzero_pd();
+    int count = 0;
+    for (int i = 0; i < end; i += 8) {
+        __m256 price = _mm256_loadu_ps(&bookColumns.price[i]);
+        __m256i year = _mm256_loadu_si256((const __m256i *)&bookColumns.year[i]);
+        __m256i quantity = _mm256_loadu_si256((const __m256i *)&bookColumns.quantity[i]);
+        long long liveBytes;
+        memcpy(&liveBytes, &bookColumns.live[i], sizeof(liveBytes));
+        __m256i live = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(liveBytes));
+
+        __m256i match = _mm256_and_si256(_mm256_cmpgt_epi32(live, zero), _mm256_cmpgt_epi32(year, yearAbove));
+        match = _mm256_and_si256(match, _mm256_cmpgt_epi32(yearBelow, year));
+        match = _mm256_and_si256(match, _mm256_cmpgt_epi32(quantity, quantityAbove));
+        __m256 matchPrice = _mm256_and_ps(_mm256_cmp_ps(price, priceFrom, _CMP_GE_OQ),
+                                          _mm256_cmp_ps(price, priceTo, _CMP_LE_OQ));
+        __m256 mask = _mm256_and_ps(_mm256_castsi256_ps(match), matchPrice);
+        unsigned int bits = (unsigned int)_mm256_movemask_ps(mask);
+        if (bits == 0) {
+            continue;
+        }
+
+        // Stock value of the matching lanes, multiplied in doubles as the
+        // scalar loop does; other lanes are zeroed first
+        price = _mm256_and_ps(price, mask);
+        quantity = _mm256_and_si256(quantity, _mm256_castps_si256(mask));
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(price)),
+                                                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(quantity))));
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(price, 1)),
+                                                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(quantity, 1))));
+
+        if (rows == NULL) {
+            count += __builtin_popcount(bits);
+            continue;
+        }
+        while (bits != 0) {
+            rows[count++] = i + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, value);
+    *stockValue += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return count;
+}
+
+/**
+ * @brief Counts open borrowings due before a time four at a time with AVX2
+ * @param before The time
+ * @param end Rows before this one are scanned, a multiple of four
+ * @return int Number of matches
+ */
+__attribute__((target("avx2")))
+static int countDueAVX2(long long before, int end) {
+    const __m256i limit = _mm256_set1_epi64x(before);
+    const __m256i zero = _mm256_setzero_si256();
+    int count = 0;
+    for (int i = 0; i < end; i += 4) {
+        __m256i due = _mm256_loadu_si256((const __m256i *)&borrowingColumns.dueDate[i]);
+        int returnedBytes;
+        memcpy(&returnedBytes, &borrowingColumns.returned[i], sizeof(returnedBytes));
+        __m256i returned = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(returnedBytes));
+        __m256i match = _mm256_andnot_si256(_mm256_cmpgt_epi64(returned, zero), _mm256_cmpgt_epi64(limit, due));
+        count += __builtin_popcount((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(match)));
+    }
+    return count;
+}
+
+// Returns non-zero if the processor runs AVX2 instructions
+static int haveAVX2(void) {
+    static int supported = -1;
+    if (supported == -1) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx2") != 0;
+    }
+    return supported;
+}
+#endif
+
+// Finds the live books that meet a filter
+int filterBookColumns(const BookFilter *filter, int bookCount, int *rows, double *stockValue) {
+    if ((bookColumns.stale || bookColumns.capacity < bookCount) && !rebuildBookColumns(bookCount)) {
+        return -1;
+    }
+    double value = 0;
+    int count = 0;
+    int end = 0;
+#ifdef COLUMNS_AVX2
+    if (haveAVX2()) {
+        end = bookCount - bookCount % 8;
+        count = filterBooksAVX2(filter, end, rows, &value);
+    }
+#endif
+    count += filterBooksScalar(filter, end, bookCount, rows == NULL ? NULL : rows + count, &value);
+    if (stockValue != NULL) {
+        *stockValue = value;
+    }
+    return count;
+}
+
+// Counts the borrowings not yet returned that are due before a time
+int countDueBefore(time_t before, int borrowingCount) {
+    if ((borrowingColumns.stale || borrowingColumns.capacity < borrowingCount) &&
+        !rebuildBorrowingColumns(borrowingCount)) {
+        return -1;
+    }
+    int count = 0;
+    int end = 0;
+#ifdef COLUMNS_AVX2
+    if (haveAVX2()) {
+        end = borrowingCount - borrowingCount % 4;
+        count = countDueAVX2((long long)before, end);
+    }
+#endif
+    return count + countDueScalar((long long)before, end, borrowingCount);
+}
@@ -0,0 +1,94 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <time.h>
+
+// Copies of the numeric fields of the books that filters read, one array
+// per field and indexed by book row, so a scan reads only the bytes it
+// compares and whole vectors of rows at once. Kept in step with the book
+// table by bookColumnsUpdate.
+typedef struct {
+    float *price;
+    int *year;
+    int *quantity;
+    unsigned char *live;        // 0 for deleted rows
+    int capacity;               // Length of every array
+    int stale;                  // Set when an update could not grow the arrays
+} BookColumns;
+
+// The same for the borrowings
+typedef struct {
+    long long *dueDate;
+    unsigned char *returned;
+    int capacity;
+    int stale;
+} BorrowingColumns;
+
+extern BookColumns bookColumns;
+extern BorrowingColumns borrowingColumns;
+
+// Conditions a book must meet, all bounds inclusive
+typedef struct {
+    int yearFrom;
+    int yearTo;
+    float priceFrom;
+    float priceTo;
+    int minQuantity;
+} BookFilter;
+
+/**
+ * @brief Copies the fields of one book row into the columns
+ * @param row Row of the book, live or deleted
+ * @return void
+ *
+ * Called after every change to a book, including its quantity. If the
+ * arrays cannot grow the columns are marked stale and rebuilt by the next
+ * filter.
+ */
+void bookColumnsUpdate(int row);
+
+/**
+ * @brief Copies every book row into the columns
+ * @param bookCount Current number of book rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int rebuildBookColumns(int bookCount);
+
+/**
+ * @brief Copies the fields of one borrowing into the columns
+ * @param row Row of the borrowing
+ * @return void
+ */
+void borrowingColumnsUpdate(int row);
+
+/**
+ * @brief Copies every borrowing into the columns
+ * @param borrowingCount Current number of borrowings
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int rebuildBorrowingColumns(int borrowingCount);
+
+/**
+ * @brief Finds the live books that meet a filter
+ * @param filter The conditions
+ * @param bookCount Current number of book rows
+ * @param rows Receives the matching rows in order, room for bookCount;
+ *             NULL to only count them
+ * @param stockValue Receives the sum of price times quantity over the
+ *                   matches, or NULL
+ * @return int Number of matching books, or -1 if memory could not be allocated
+ *
+ * Uses AVX2 when the processor has it, eight rows per step, and plain C
+ * otherwise.
+ */
+int filterBookColumns(const BookFilter *filter, int bookCount, int *rows, double *stockValue);
+
+/**
+ * @brief Counts the borrowings not yet returned that are due before a time
+ * @param before The time
+ * @param borrowingCount Current number of borrowings
+ * @return int Number of such borrowings, or -1 if memory could not be allocated
+ */
+int countDueBefore(time_t before, int borrowingCount);
+
+#endif // COLUMNS_H
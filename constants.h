@@ -3,11 +3,12 @@
 
 // Maximum lengths for strings
 #define MAX_STRING 100
-#define MAX_BOOKS 1000
-#define MAX_READERS 1000
-#define MAX_BORROWINGS 1000
 #define MAX_BOOKS_PER_READER 5
 #define MAX_DAYS 14
+#define MAX_LOANS_LISTED 50      // Loans offered when returning books
+#define LOAN_DAYS 7             // Days until borrowed books are due back
 #define FINE_PER_DAY 5000
+#define PAGE_SIZE 10            // Rows per page when listing books or readers
+#define MAX_PAGE_SIZE 500       // Largest page a listing can ask for
 
 #endif 
\ No newline at end of file
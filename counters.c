@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include "counters.h"
+
+LibraryCounters libraryCounters = LIBRARY_COUNTERS_INIT;
+
+// Key being looked up in a count map
+typedef struct {
+    const CountMap *map;
+    int key;
+} CountKey;
+
+// Returns non-zero when the group holds the key
+static int groupHasKey(int group, const void *key) {
+    const CountKey *wanted = key;
+    return wanted->map->keys[group] == wanted->key;
+}
+
+/**
+ * @brief Grows the group arrays so one more group fits
+ * @param map The count map
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int growGroups(CountMap *map) {
+    if (map->groupCount < map->groupCapacity) {
+        return 1;
+    }
+    int newCapacity = map->groupCapacity == 0 ? 16 : map->groupCapacity * 2;
+    int *keys = realloc(map->keys, sizeof(int) * (size_t)newCapacity);
+    if (keys == NULL) {
+        return 0;
+    }
+    map->keys = keys;
+    int *counts = realloc(map->counts, sizeof(int) * (size_t)newCapacity);
+    if (counts == NULL) {
+        return 0;
+    }
+    map->counts = counts;
+    map->groupCapacity = newCapacity;
+    return 1;
+}
+
+// Adds to the count of a key
+int countMapAdd(CountMap *map, int key, int delta) {
+    unsigned int hash = hashInteger((unsigned long long)(unsigned int)key);
+    CountKey wanted = { map, key };
+    int group = hashIndexFind(&map->index, hash, groupHasKey, &wanted);
+    if (group == -1) {
+        if (!growGroups(map) || !hashIndexInsert(&map->index, hash, map->groupCount)) {
+            return 0;
+        }
+        group = map->groupCount++;
+        map->keys[group] = key;
+        map->counts[group] = 0;
+    }
+    map->counts[group] += delta;
+    return 1;
+}
+
+// Drops every group but keeps the memory
+void countMapClear(CountMap *map) {
+    hashIndexClear(&map->index);
+    map->groupCount = 0;
+}
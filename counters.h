@@ -0,0 +1,51 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include "hashindex.h"
+
+// Number of rows per integer key (a category symbol, a year...). Keys are
+// kept in the order they were first seen, and a hash index finds the group
+// of a key. A group whose count drops to zero stays in place, so a key
+// that comes back keeps its position.
+typedef struct {
+    int *keys;                  // Key of each group
+    int *counts;                // Rows in each group
+    int groupCount;             // Groups in use
+    int groupCapacity;          // Length of keys and counts
+    HashIndex index;            // Key hash to group
+} CountMap;
+
+#define COUNT_MAP_INIT { NULL, NULL, 0, 0, HASH_INDEX_INIT }
+
+// Aggregates the statistics screens print, kept up to date by every
+// change to the books, readers and borrowings, and recounted on load.
+typedef struct {
+    CountMap booksByCategory;   // Live books per category symbol
+    double inventoryValue;      // Price times copies on the shelf, over live books
+    CountMap readersByYear;     // Live readers per membership year
+    int readersByGender[3];     // Live readers per Gender
+    int activeLoans;            // Borrowings not yet returned
+    int booksOut;               // Books in borrowings not yet returned
+} LibraryCounters;
+
+#define LIBRARY_COUNTERS_INIT { COUNT_MAP_INIT, 0, COUNT_MAP_INIT, { 0, 0, 0 }, 0, 0 }
+
+extern LibraryCounters libraryCounters;
+
+/**
+ * @brief Adds to the count of a key
+ * @param map The count map
+ * @param key The key
+ * @param delta Amount to add, negative to take away
+ * @return int 1 on success, 0 if memory could not be allocated for a new key
+ */
+int countMapAdd(CountMap *map, int key, int delta);
+
+/**
+ * @brief Drops every group but keeps the memory
+ * @param map The count map
+ * @return void
+ */
+void countMapClear(CountMap *map);
+
+#endif // COUNTERS_H
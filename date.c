@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include "date.h"
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+/**
+ * @brief Converts a calendar date to a day number
+ * @param year The year
+ * @param month The month, 1 to 12
+ * @param day The day of the month, 1 to 31
+ * @return int Days since 1970-01-01
+ *
+ * Counts from March 1 of year 0 so leap days fall at the end of the year.
+ */
+int daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * @brief Converts a day number back to a calendar date
+ * @param days Days since 1970-01-01
+ * @param year Receives the year
+ * @param month Receives the month
+ * @param day Receives the day of the month
+ * @return void
+ */
+void civilFromDays(int days, int *year, int *month, int *day) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    *day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    *month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/**
+ * @brief Parses a date written as YYYY-MM-DD
+ * @param text The text to parse
+ * @param day Receives the day number
+ * @return int 1 if the text is a valid date, 0 otherwise
+ */
+int parseDate(const char *text, int *day) {
+    int year, month, dayOfMonth, length = 0;
+    if (sscanf(text, "%4d-%2d-%2d%n", &year, &month, &dayOfMonth, &length) != 3 || text[length] != '\0') {
+        return 0;
+    }
+    if (month < 1 || month > 12 || dayOfMonth < 1 || dayOfMonth > 31) {
+        return 0;
+    }
+    // Reject days past the end of the month, such as 2023-02-30
+    int checkYear, checkMonth, checkDay;
+    int days = daysFromCivil(year, month, dayOfMonth);
+    civilFromDays(days, &checkYear, &checkMonth, &checkDay);
+    if (checkMonth != month) {
+        return 0;
+    }
+    *day = days;
+    return 1;
+}
+
+/**
+ * @brief Writes a day number as YYYY-MM-DD
+ * @param day The day number
+ * @param text Buffer of at least DATE_LENGTH bytes; empty for DATE_UNKNOWN
+ * @return void
+ */
+void formatDate(int day, char *text) {
+    if (day == DATE_UNKNOWN) {
+        text[0] = '\0';
+        return;
+    }
+    int year, month, dayOfMonth;
+    civilFromDays(day, &year, &month, &dayOfMonth);
+    // Written digit by digit: reports format a date per row and snprintf
+    // would take most of their time
+    unsigned int digits[3] = { (unsigned int)year % 10000u, (unsigned int)month % 100u,
+                               (unsigned int)dayOfMonth % 100u };
+    text[0] = (char)('0' + digits[0] / 1000);
+    text[1] = (char)('0' + digits[0] / 100 % 10);
+    text[2] = (char)('0' + digits[0] / 10 % 10);
+    text[3] = (char)('0' + digits[0] % 10);
+    text[4] = '-';
+    text[5] = (char)('0' + digits[1] / 10);
+    text[6] = (char)('0' + digits[1] % 10);
+    text[7] = '-';
+    text[8] = (char)('0' + digits[2] / 10);
+    text[9] = (char)('0' + digits[2] % 10);
+    text[10] = '\0';
+}
+
+/**
+ * @brief Converts a timestamp to its day number
+ * @param time The timestamp
+ * @return int Days since 1970-01-01
+ */
+int dayFromTime(time_t time) {
+    time_t days = time / SECONDS_PER_DAY;
+    if (time < 0 && time % SECONDS_PER_DAY != 0) {
+        days--;
+    }
+    return (int)days;
+}
+
+/**
+ * @brief Converts a day number to the timestamp of its midnight
+ * @param day The day number
+ * @return time_t Seconds since 1970-01-01
+ */
+time_t timeFromDay(int day) {
+    return (time_t)day * SECONDS_PER_DAY;
+}
+
+/**
+ * @brief Returns today's day number
+ * @return int Days since 1970-01-01
+ */
+int today(void) {
+    return dayFromTime(time(NULL));
+}
+
+/**
+ * @brief Returns how far local time is ahead of UTC at a moment
+ * @param time The moment
+ * @return long Seconds to add to the timestamp to get the local
+ *              wall-clock time, 0 if the local time is unknown
+ */
+long localTimeOffset(time_t time) {
+    struct tm *local = localtime(&time);
+    if (local == NULL) {
+        return 0;
+    }
+    time_t wallClock = timeFromDay(daysFromCivil(local->tm_year + 1900, local->tm_mon + 1, local->tm_mday)) +
+                       local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec;
+    return (long)(wallClock - time);
+}
@@ -0,0 +1,75 @@
+#ifndef DATE_H
+#define DATE_H
+
+#include <time.h>
+
+// Dates are stored as day numbers: days since 1970-01-01 (UTC)
+#define DATE_UNKNOWN (-2147483647 - 1)
+
+// Room for "YYYY-MM-DD" and the terminator
+#define DATE_LENGTH 11
+
+/**
+ * @brief Converts a calendar date to a day number
+ * @param year The year
+ * @param month The month, 1 to 12
+ * @param day The day of the month, 1 to 31
+ * @return int Days since 1970-01-01
+ */
+int daysFromCivil(int year, int month, int day);
+
+/**
+ * @brief Converts a day number back to a calendar date
+ * @param days Days since 1970-01-01
+ * @param year Receives the year
+ * @param month Receives the month, 1 to 12
+ * @param day Receives the day of the month
+ * @return void
+ */
+void civilFromDays(int days, int *year, int *month, int *day);
+
+/**
+ * @brief Parses a date written as YYYY-MM-DD
+ * @param text The text to parse
+ * @param day Receives the day number
+ * @return int 1 if the text is a valid date, 0 otherwise
+ */
+int parseDate(const char *text, int *day);
+
+/**
+ * @brief Writes a day number as YYYY-MM-DD
+ * @param day The day number
+ * @param text Buffer of at least DATE_LENGTH bytes; empty for DATE_UNKNOWN
+ * @return void
+ */
+void formatDate(int day, char *text);
+
+/**
+ * @brief Converts a timestamp to its day number
+ * @param time The timestamp
+ * @return int Days since 1970-01-01
+ */
+int dayFromTime(time_t time);
+
+/**
+ * @brief Converts a day number to the timestamp of its midnight
+ * @param day The day number
+ * @return time_t Seconds since 1970-01-01
+ */
+time_t timeFromDay(int day);
+
+/**
+ * @brief Returns today's day number
+ * @return int Days since 1970-01-01
+ */
+int today(void);
+
+/**
+ * @brief Returns how far local time is ahead of UTC at a moment
+ * @param time The moment
+ * @return long Seconds to add to the timestamp to get the local
+ *              wall-clock time, 0 if the local time is unknown
+ */
+long localTimeOffset(time_t time);
+
+#endif // DATE_H
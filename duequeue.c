@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include "duequeue.h"
+
+// Makes room for the borrowing rows below a limit
+int dueQueueReserve(DueQueue *queue, int rows) {
+    int newCapacity = queue->rowCapacity == 0 ? 64 : queue->rowCapacity;
+    while (newCapacity < rows) {
+        newCapacity *= 2;
+    }
+    if (newCapacity > queue->rowCapacity) {
+        int *position = realloc(queue->position, sizeof(int) * (size_t)newCapacity);
+        if (position == NULL) {
+            return 0;
+        }
+        for (int i = queue->rowCapacity; i < newCapacity; i++) {
+            position[i] = -1;
+        }
+        queue->position = position;
+        queue->rowCapacity = newCapacity;
+    }
+    // The heap never holds more loans than there are rows
+    if (newCapacity > queue->capacity) {
+        DueEntry *heap = realloc(queue->heap, sizeof(DueEntry) * (size_t)newCapacity);
+        if (heap == NULL) {
+            return 0;
+        }
+        queue->heap = heap;
+        queue->capacity = newCapacity;
+    }
+    return 1;
+}
+
+/**
+ * @brief Puts an entry at a heap position and records where it went
+ * @param queue The due queue
+ * @param at Heap position
+ * @param entry The entry
+ * @return void
+ */
+static void placeEntry(DueQueue *queue, int at, DueEntry entry) {
+    queue->heap[at] = entry;
+    queue->position[entry.row] = at;
+}
+
+/**
+ * @brief Moves the entry at a heap position up until its parent is due earlier
+ * @param queue The due queue
+ * @param at Heap position
+ * @return void
+ */
+static void siftUp(DueQueue *queue, int at) {
+    DueEntry entry = queue->heap[at];
+    while (at > 0) {
+        int parent = (at - 1) / 2;
+        if (queue->heap[parent].dueDate <= entry.dueDate) {
+            break;
+        }
+        placeEntry(queue, at, queue->heap[parent]);
+        at = parent;
+    }
+    placeEntry(queue, at, entry);
+}
+
+/**
+ * @brief Moves the entry at a heap position down until its children are due later
+ * @param queue The due queue
+ * @param at Heap position
+ * @return void
+ */
+static void siftDown(DueQueue *queue, int at) {
+    DueEntry entry = queue->heap[at];
+    for (;;) {
+        int child = 2 * at + 1;
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1 < queue->count && queue->heap[child + 1].dueDate < queue->heap[child].dueDate) {
+            child++;
+        }
+        if (entry.dueDate <= queue->heap[child].dueDate) {
+            break;
+        }
+        placeEntry(queue, at, queue->heap[child]);
+        at = child;
+    }
+    placeEntry(queue, at, entry);
+}
+
+// Adds an open loan
+int dueQueuePush(DueQueue *queue, int row, time_t dueDate) {
+    if (row < 0 || !dueQueueReserve(queue, row + 1)) {
+        return 0;
+    }
+    if (queue->position[row] != -1) {
+        dueQueueRemove(queue, row);
+    }
+    DueEntry entry = { dueDate, row };
+    placeEntry(queue, queue->count++, entry);
+    siftUp(queue, queue->count - 1);
+    return 1;
+}
+
+// Takes a loan out of the queue
+void dueQueueRemove(DueQueue *queue, int row) {
+    if (row < 0 || row >= queue->rowCapacity || queue->position[row] == -1) {
+        return;
+    }
+    int at = queue->position[row];
+    queue->position[row] = -1;
+    DueEntry last = queue->heap[--queue->count];
+    if (at == queue->count) {
+        return;
+    }
+    placeEntry(queue, at, last);
+    if (at > 0 && queue->heap[(at - 1) / 2].dueDate > last.dueDate) {
+        siftUp(queue, at);
+    } else {
+        siftDown(queue, at);
+    }
+}
+
+// Empties the queue but keeps the memory
+void dueQueueClear(DueQueue *queue) {
+    for (int i = 0; i < queue->count; i++) {
+        queue->position[queue->heap[i].row] = -1;
+    }
+    queue->count = 0;
+}
+
+/**
+ * @brief Visits the entries due before a time in the subtree below a position
+ * @param queue The due queue
+ * @param at Heap position at the top of the subtree
+ * @param before Cut-off time
+ * @param visit Called for each entry
+ * @param context Passed through to visit
+ * @return int Number of entries visited
+ *
+ * A child is never due before its parent, so a subtree whose top is not
+ * due yet is skipped whole. The recursion is as deep as the heap, which
+ * is logarithmic in its size.
+ */
+static int visitSubtree(const DueQueue *queue, int at, time_t before,
+                        void (*visit)(const DueEntry *entry, void *context), void *context) {
+    if (at >= queue->count || queue->heap[at].dueDate >= before) {
+        return 0;
+    }
+    visit(&queue->heap[at], context);
+    return 1 + visitSubtree(queue, 2 * at + 1, before, visit, context)
+             + visitSubtree(queue, 2 * at + 2, before, visit, context);
+}
+
+// Calls a function for every loan due before a given time
+int dueQueueVisitBefore(const DueQueue *queue, time_t before,
+                        void (*visit)(const DueEntry *entry, void *context), void *context) {
+    return visitSubtree(queue, 0, before, visit, context);
+}
@@ -0,0 +1,79 @@
+#ifndef DUEQUEUE_H
+#define DUEQUEUE_H
+
+#include <time.h>
+
+// One open loan in the queue
+typedef struct {
+    time_t dueDate;
+    int row;                    // Row of the borrowing
+} DueEntry;
+
+// Open loans as a binary min-heap on the due date, so the loans that fell
+// due first sit at the top. The heap position of every borrowing row is
+// kept as well, so a returned loan is taken out without searching for it.
+typedef struct {
+    DueEntry *heap;
+    int count;                  // Loans in the heap
+    int capacity;               // Length of heap
+    int *position;              // Heap position of each borrowing row, -1 if absent
+    int rowCapacity;            // Length of position
+} DueQueue;
+
+#define DUE_QUEUE_INIT { NULL, 0, 0, NULL, 0 }
+
+/**
+ * @brief Makes room for the borrowing rows below a limit
+ * @param queue The due queue
+ * @param rows Number of borrowing rows the queue must be able to hold
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Once this succeeds, dueQueuePush cannot fail for those rows.
+ */
+int dueQueueReserve(DueQueue *queue, int rows);
+
+/**
+ * @brief Adds an open loan
+ * @param queue The due queue
+ * @param row Row of the borrowing
+ * @param dueDate Time the books are due back
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int dueQueuePush(DueQueue *queue, int row, time_t dueDate);
+
+/**
+ * @brief Takes a loan out of the queue, doing nothing if it is not there
+ * @param queue The due queue
+ * @param row Row of the borrowing
+ * @return void
+ */
+void dueQueueRemove(DueQueue *queue, int row);
+
+/**
+ * @brief Empties the queue but keeps the memory
+ * @param queue The due queue
+ * @return void
+ */
+void dueQueueClear(DueQueue *queue);
+
+/**
+ * @brief Calls a function for every loan due before a given time
+ * @param queue The due queue
+ * @param before Loans due strictly before this time are visited
+ * @param visit Called with the entry of each loan and the context
+ * @param context Passed through to visit
+ * @return int Number of loans visited
+ *
+ * Only the part of the heap above the cut-off is walked, so the cost
+ * grows with the number of loans visited rather than with the queue.
+ * Loans are not visited in due order.
+ */
+int dueQueueVisitBefore(const DueQueue *queue, time_t before,
+                        void (*visit)(const DueEntry *entry, void *context), void *context);
+
+// Returns the number of open loans
+static inline int dueQueueCount(const DueQueue *queue) {
+    return queue->count;
+}
+
+#endif // DUEQUEUE_H
@@ -0,0 +1,342 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include "export.h"
+#include "output.h"
+#include "library.h"
+
+// Room for the text of a number, a timestamp or the ISBNs of a borrowing
+#define VALUE_LENGTH 128
+
+// Most fields an export writes, counting repeats
+#define MAX_COLUMNS 32
+
+// Returns the text of a field of a row; numbers and dates are written to
+// the scratch buffer of VALUE_LENGTH bytes. NULL means the field has no
+// value (an empty CSV field, null in JSON).
+typedef const char *(*ExportValue)(int row, char *scratch);
+
+typedef struct {
+    const char *name;
+    ExportValue value;
+    int numeric;                // Written without quotes in JSON
+} ExportColumn;
+
+typedef struct {
+    const char *name;
+    const ExportColumn *columns;
+    int columnCount;
+    int (*isLive)(int row);     // NULL if every row is live
+    int rowCount;
+} ExportSource;
+
+// Writes an integer; snprintf would take most of the time of an export
+static const char *writeNumber(char *scratch, int number) {
+    formatNumber(number, scratch);
+    return scratch;
+}
+
+static const char *writeDate(char *scratch, int day) {
+    if (day == DATE_UNKNOWN) {
+        return NULL;
+    }
+    formatDate(day, scratch);
+    return scratch;
+}
+
+// Writes a timestamp as YYYY-MM-DDTHH:MM:SSZ
+static const char *writeTime(char *scratch, time_t time) {
+    int length = formatTime(time, scratch);
+    scratch[DATE_LENGTH - 1] = 'T';
+    scratch[length] = 'Z';
+    scratch[length + 1] = 0;
+    return scratch;
+}
+
+static const char *bookISBN(int row, char *scratch) {
+    formatISBN(bookAt(row)->ISBN, scratch);
+    return scratch;
+}
+static const char *bookTitle(int row, char *scratch) { (void)scratch; return bookString(bookAt(row)->title); }
+static const char *bookAuthor(int row, char *scratch) { (void)scratch; return symbolText(bookAt(row)->author); }
+static const char *bookPublisher(int row, char *scratch) { (void)scratch; return symbolText(bookAt(row)->publisher); }
+static const char *bookYear(int row, char *scratch) { return writeNumber(scratch, bookAt(row)->publishYear); }
+static const char *bookCategory(int row, char *scratch) { (void)scratch; return symbolText(bookAt(row)->category); }
+static const char *bookPrice(int row, char *scratch) {
+    formatPrice(bookAt(row)->price, scratch);
+    return scratch;
+}
+static const char *bookQuantity(int row, char *scratch) { return writeNumber(scratch, bookAt(row)->quantity); }
+
+static const ExportColumn bookColumns[] = {
+    { "ISBN", bookISBN, 0 },
+    { "title", bookTitle, 0 },
+    { "author", bookAuthor, 0 },
+    { "publisher", bookPublisher, 0 },
+    { "year", bookYear, 1 },
+    { "category", bookCategory, 0 },
+    { "price", bookPrice, 1 },
+    { "quantity", bookQuantity, 1 },
+};
+
+static const char *readerID(int row, char *scratch) { return writeNumber(scratch, readerAt(row)->ID); }
+static const char *readerName(int row, char *scratch) { (void)scratch; return readerString(readerAt(row)->name); }
+static const char *readerCMND(int row, char *scratch) { (void)scratch; return readerString(readerAt(row)->CMND); }
+static const char *readerEmail(int row, char *scratch) { (void)scratch; return readerString(readerAt(row)->email); }
+static const char *readerPhone(int row, char *scratch) { (void)scratch; return readerString(readerAt(row)->phone); }
+static const char *readerAddress(int row, char *scratch) { (void)scratch; return readerString(readerAt(row)->address); }
+static const char *readerBirthDate(int row, char *scratch) { return writeDate(scratch, readerAt(row)->birthDate); }
+static const char *readerGender(int row, char *scratch) {
+    (void)scratch;
+    return genderName((Gender)readerAt(row)->gender);
+}
+static const char *readerCardIssueDate(int row, char *scratch) { return writeDate(scratch, readerAt(row)->cardIssueDate); }
+static const char *readerCardExpiryDate(int row, char *scratch) { return writeDate(scratch, readerAt(row)->cardExpiryDate); }
+static const char *readerMembershipYear(int row, char *scratch) { return writeNumber(scratch, readerAt(row)->membershipYear); }
+
+static const ExportColumn readerColumns[] = {
+    { "ID", readerID, 1 },
+    { "name", readerName, 0 },
+    { "CMND", readerCMND, 0 },
+    { "email", readerEmail, 0 },
+    { "phone", readerPhone, 0 },
+    { "address", readerAddress, 0 },
+    { "birthDate", readerBirthDate, 0 },
+    { "gender", readerGender, 0 },
+    { "cardIssueDate", readerCardIssueDate, 0 },
+    { "cardExpiryDate", readerCardExpiryDate, 0 },
+    { "membershipYear", readerMembershipYear, 1 },
+};
+
+static const char *borrowingIndex(int row, char *scratch) { return writeNumber(scratch, row); }
+static const char *borrowingReaderID(int row, char *scratch) { return writeNumber(scratch, borrowingAt(row)->readerID); }
+static const char *borrowingDate(int row, char *scratch) { return writeTime(scratch, borrowingAt(row)->borrowingDate); }
+static const char *borrowingDueDate(int row, char *scratch) { return writeTime(scratch, borrowingAt(row)->dueDate); }
+static const char *borrowingReturnDate(int row, char *scratch) {
+    const Borrowing *borrowing = borrowingAt(row);
+    return borrowing->isReturned ? writeTime(scratch, borrowing->returnDate) : NULL;
+}
+// ISBNs separated by semicolons
+static const char *borrowingBooks(int row, char *scratch) {
+    const Borrowing *borrowing = borrowingAt(row);
+    scratch[0] = 0;
+    for (int i = 0; i < borrowing->bookCount; i++) {
+        char *end = scratch + strlen(scratch);
+        if (i > 0) {
+            *end++ = ';';
+        }
+        formatISBN(borrowing->books[i], end);
+    }
+    return scratch;
+}
+static const char *borrowingReturned(int row, char *scratch) { return writeNumber(scratch, borrowingAt(row)->isReturned); }
+
+static const ExportColumn borrowingColumns[] = {
+    { "index", borrowingIndex, 1 },
+    { "readerID", borrowingReaderID, 1 },
+    { "borrowingDate", borrowingDate, 0 },
+    { "dueDate", borrowingDueDate, 0 },
+    { "returnDate", borrowingReturnDate, 0 },
+    { "books", borrowingBooks, 0 },
+    { "returned", borrowingReturned, 1 },
+};
+
+#define COLUMNS(columns) columns, (int)(sizeof(columns) / sizeof(columns[0]))
+
+/**
+ * @brief Appends a value as a CSV field, quoting it if it needs to be
+ * @param out The buffer
+ * @param value The value, NULL for an empty field
+ * @return void
+ */
+static void putCSV(OutputBuffer *out, const char *value) {
+    if (value == NULL) {
+        return;
+    }
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        outputText(out, value);
+        return;
+    }
+    outputBytes(out, "\"", 1);
+    for (const char *quote; (quote = strchr(value, '"')) != NULL; value = quote + 1) {
+        outputBytes(out, value, (size_t)(quote - value + 1));
+        outputBytes(out, "\"", 1);
+    }
+    outputText(out, value);
+    outputBytes(out, "\"", 1);
+}
+
+/**
+ * @brief Appends a value as a JSON string, or as it is for numbers
+ * @param out The buffer
+ * @param value The value, NULL for null
+ * @param numeric Non-zero to write the value without quotes
+ * @return void
+ */
+static void putJSON(OutputBuffer *out, const char *value, int numeric) {
+    if (value == NULL) {
+        outputBytes(out, "null", 4);
+        return;
+    }
+    if (numeric) {
+        outputText(out, value);
+        return;
+    }
+    outputBytes(out, "\"", 1);
+    const char *run = value;
+    for (const char *p = value; *p != 0; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        outputBytes(out, run, (size_t)(p - run));
+        char escape[8];
+        if (c == '"' || c == '\\') {
+            snprintf(escape, sizeof(escape), "\\%c", c);
+        } else {
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+        }
+        outputText(out, escape);
+        run = p + 1;
+    }
+    outputText(out, run);
+    outputBytes(out, "\"", 1);
+}
+
+// Returns the column with a name, or NULL if the table has none
+static const ExportColumn *findColumn(const ExportSource *source, const char *name, size_t length) {
+    for (int i = 0; i < source->columnCount; i++) {
+        if (strlen(source->columns[i].name) == length && strncmp(source->columns[i].name, name, length) == 0) {
+            return &source->columns[i];
+        }
+    }
+    return NULL;
+}
+
+// Opens the file an export writes to
+int openExportOutput(const char *path) {
+    if (strcmp(path, "-") != 0) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            printf("Cannot create %s.\n", path);
+        }
+        return fd;
+    }
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd != -1 && dup2(STDERR_FILENO, STDOUT_FILENO) == -1) {
+        close(fd);
+        return STDOUT_FILENO;
+    }
+    return fd;
+}
+
+// Writes the rows of a table as CSV or JSON lines
+int exportTable(int fd, const char *table, ExportFormat format, const char *fields,
+                char **filters, int filterCount, int bookCount, int readerCount, int borrowingCount) {
+    const ExportSource sources[] = {
+        { "books", COLUMNS(bookColumns), isBookLive, bookCount },
+        { "readers", COLUMNS(readerColumns), isReaderLive, readerCount },
+        { "borrowings", COLUMNS(borrowingColumns), NULL, borrowingCount },
+    };
+    const ExportSource *source = NULL;
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        if (strcmp(sources[i].name, table) == 0) {
+            source = &sources[i];
+        }
+    }
+    if (source == NULL) {
+        printf("Unknown table %s, expected books, readers or borrowings.\n", table);
+        return -1;
+    }
+
+    // Columns to write, in the order asked for
+    const ExportColumn *columns[MAX_COLUMNS];
+    int columnCount = 0;
+    if (fields == NULL) {
+        for (int i = 0; i < source->columnCount; i++) {
+            columns[columnCount++] = &source->columns[i];
+        }
+    } else {
+        for (const char *name = fields; ; name++) {
+            size_t length = strcspn(name, ",");
+            const ExportColumn *column = findColumn(source, name, length);
+            if (column == NULL || columnCount == MAX_COLUMNS) {
+                printf("Unknown field %.*s in %s.\n", (int)length, name, table);
+                return -1;
+            }
+            columns[columnCount++] = column;
+            name += length;
+            if (*name == 0) {
+                break;
+            }
+        }
+    }
+
+    // Conditions, each a column and the text it must equal
+    const ExportColumn *filterColumns[EXPORT_MAX_FILTERS];
+    const char *filterValues[EXPORT_MAX_FILTERS];
+    for (int i = 0; i < filterCount; i++) {
+        const char *equals = strchr(filters[i], '=');
+        filterColumns[i] = equals == NULL ? NULL : findColumn(source, filters[i], (size_t)(equals - filters[i]));
+        if (filterColumns[i] == NULL) {
+            printf("Invalid filter %s, expected FIELD=VALUE with a field of %s.\n", filters[i], table);
+            return -1;
+        }
+        filterValues[i] = equals + 1;
+    }
+
+    OutputBuffer out = OUTPUT_BUFFER(fd, malloc(OUTPUT_BUFFER_SIZE));
+    if (out.data == NULL) {
+        printf("Not enough memory to export %s.\n", table);
+        return -1;
+    }
+    if (format == EXPORT_CSV) {
+        for (int i = 0; i < columnCount; i++) {
+            outputText(&out, i == 0 ? "" : ",");
+            outputText(&out, columns[i]->name);
+        }
+        outputBytes(&out, "\n", 1);
+    }
+
+    int written = 0;
+    char scratch[VALUE_LENGTH];
+    for (int row = 0; row < source->rowCount && out.ok; row++) {
+        if (source->isLive != NULL && !source->isLive(row)) {
+            continue;
+        }
+        int match = 1;
+        for (int i = 0; match && i < filterCount; i++) {
+            const char *value = filterColumns[i]->value(row, scratch);
+            match = strcmp(value == NULL ? "" : value, filterValues[i]) == 0;
+        }
+        if (!match) {
+            continue;
+        }
+        if (format == EXPORT_JSONL) {
+            outputBytes(&out, "{", 1);
+        }
+        for (int i = 0; i < columnCount; i++) {
+            const char *value = columns[i]->value(row, scratch);
+            if (format == EXPORT_CSV) {
+                if (i > 0) {
+                    outputBytes(&out, ",", 1);
+                }
+                putCSV(&out, value);
+            } else {
+                outputText(&out, i == 0 ? "\"" : ",\"");
+                outputText(&out, columns[i]->name);
+                outputBytes(&out, "\":", 2);
+                putJSON(&out, value, columns[i]->numeric);
+            }
+        }
+        outputText(&out, format == EXPORT_JSONL ? "}\n" : "\n");
+        written++;
+    }
+    outputFlush(&out);
+    free(out.data);
+    if (!out.ok) {
+        printf("Error writing %s export.\n", table);
+        return -1;
+    }
+    return written;
+}
@@ -0,0 +1,44 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+// Most --where filters an export takes
+#define EXPORT_MAX_FILTERS 8
+
+typedef enum {
+    EXPORT_CSV,     // Header line, then one comma-separated line per row
+    EXPORT_JSONL    // One JSON object per row
+} ExportFormat;
+
+/**
+ * @brief Opens the file an export writes to
+ * @param path The file, or "-" for standard output
+ * @return int File descriptor, or -1 if the file cannot be created
+ *
+ * For standard output, messages printed while loading the library are
+ * sent to standard error instead, so they do not mix with the rows.
+ */
+int openExportOutput(const char *path);
+
+/**
+ * @brief Writes the rows of a table as CSV or JSON lines
+ * @param fd Output file descriptor (see openExportOutput)
+ * @param table "books", "readers" or "borrowings"
+ * @param format EXPORT_CSV or EXPORT_JSONL
+ * @param fields Comma-separated names of the fields to write, or NULL
+ *               for every field
+ * @param filters "field=value" conditions a row must all meet
+ * @param filterCount Number of filters
+ * @param bookCount Current number of book rows
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return int Number of rows written, or -1 on error
+ *
+ * Rows are formatted into a buffer of OUTPUT_BUFFER_SIZE bytes that is
+ * written out whenever it fills, so memory use does not grow with the
+ * table. Deleted books and readers are skipped. A filter compares the
+ * field as it would be written.
+ */
+int exportTable(int fd, const char *table, ExportFormat format, const char *fields,
+                char **filters, int filterCount, int bookCount, int readerCount, int borrowingCount);
+
+#endif // EXPORT_H
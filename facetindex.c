@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+#include "facetindex.h"
+
+// Value being looked up in a facet index
+typedef struct {
+    const FacetIndex *index;
+    int value;
+} FacetValue;
+
+// Returns non-zero when the position holds the value
+static int positionHasValue(int position, const void *key) {
+    const FacetValue *wanted = key;
+    return wanted->index->values[position] == wanted->value;
+}
+
+// Returns the position of a value, or -1 if it has none
+static int findValue(const FacetIndex *index, int value) {
+    FacetValue wanted = { index, value };
+    return hashIndexFind(&index->index, hashInteger((unsigned long long)(unsigned int)value),
+                         positionHasValue, &wanted);
+}
+
+/**
+ * @brief Grows the value arrays so one more value fits
+ * @param index The facet index
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int growValues(FacetIndex *index) {
+    if (index->valueCount < index->valueCapacity) {
+        return 1;
+    }
+    int newCapacity = index->valueCapacity == 0 ? 16 : index->valueCapacity * 2;
+    int *values = realloc(index->values, sizeof(int) * (size_t)newCapacity);
+    if (values == NULL) {
+        return 0;
+    }
+    index->values = values;
+    Bitmap *bitmaps = realloc(index->bitmaps, sizeof(Bitmap) * (size_t)newCapacity);
+    if (bitmaps == NULL) {
+        return 0;
+    }
+    index->bitmaps = bitmaps;
+    index->valueCapacity = newCapacity;
+    return 1;
+}
+
+/**
+ * @brief Adds a row to the bitmap of its value
+ * @param index The facet index
+ * @param row The row
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int insertRow(FacetIndex *index, int row) {
+    int value = index->key(row);
+    int position = findValue(index, value);
+    if (position == -1) {
+        if (!growValues(index) ||
+            !hashIndexInsert(&index->index, hashInteger((unsigned long long)(unsigned int)value),
+                             index->valueCount)) {
+            return 0;
+        }
+        position = index->valueCount++;
+        index->values[position] = value;
+        index->bitmaps[position] = (Bitmap)BITMAP_INIT;
+    }
+    return bitmapAdd(&index->bitmaps[position], row);
+}
+
+// Adds a row to every index of a table
+int facetIndexesInsert(FacetIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        if (!insertRow(&indexes[i], row)) {
+            facetIndexesRemove(indexes, i, row);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Removes a row from every index of a table
+void facetIndexesRemove(FacetIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        int position = findValue(&indexes[i], indexes[i].key(row));
+        if (position != -1) {
+            bitmapRemove(&indexes[i].bitmaps[position], row);
+        }
+    }
+}
+
+// Empties every index of a table and frees its bitmaps
+void facetIndexesClear(FacetIndex *indexes, int count) {
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < indexes[i].valueCount; j++) {
+            bitmapFree(&indexes[i].bitmaps[j]);
+        }
+        indexes[i].valueCount = 0;
+        hashIndexClear(&indexes[i].index);
+    }
+}
+
+// Finds an index by its field name
+int findFacetIndex(const FacetIndex *indexes, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(indexes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Returns the rows with a value
+const Bitmap *facetBitmap(const FacetIndex *index, int value) {
+    int position = findValue(index, value);
+    return position == -1 ? NULL : &index->bitmaps[position];
+}
@@ -0,0 +1,75 @@
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include "bitmap.h"
+#include "hashindex.h"
+
+// Returns the facet value of a table row (a category symbol, a decade...)
+typedef int (*FacetKey)(int row);
+
+// Bitmap index on one field of a table: one compressed bitmap of rows
+// per distinct value, so picking values is an OR of their bitmaps,
+// combining facets is an AND, and the number of matches with a value is
+// a popcount. Values are kept in the order they were first seen and found
+// through a hash index, as in CountMap; a value whose bitmap empties
+// keeps its place. Like RangeIndex, tables declare an array of these and
+// call the facetIndexes* functions whenever a row is added, changed or
+// removed.
+typedef struct {
+    const char *name;           // Field name used in queries
+    FacetKey key;               // Reads the value from a row
+    int *values;                // Value of each bitmap
+    Bitmap *bitmaps;            // Rows with each value
+    int valueCount;             // Values in use
+    int valueCapacity;          // Length of values and bitmaps
+    HashIndex index;            // Value hash to position in values
+} FacetIndex;
+
+#define FACET_INDEX(name, key) { name, key, NULL, NULL, 0, 0, HASH_INDEX_INIT }
+
+/**
+ * @brief Adds a row to every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to add
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * On failure the row is taken out of the indexes it was already added to.
+ */
+int facetIndexesInsert(FacetIndex *indexes, int count, int row);
+
+/**
+ * @brief Removes a row from every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to remove, still holding its indexed values
+ * @return void
+ */
+void facetIndexesRemove(FacetIndex *indexes, int count, int row);
+
+/**
+ * @brief Empties every index of a table and frees its bitmaps
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @return void
+ */
+void facetIndexesClear(FacetIndex *indexes, int count);
+
+/**
+ * @brief Finds an index by its field name
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param name The field name
+ * @return int Position of the index, or -1 if no index has the name
+ */
+int findFacetIndex(const FacetIndex *indexes, int count, const char *name);
+
+/**
+ * @brief Returns the rows with a value
+ * @param index The facet index
+ * @param value The value
+ * @return const Bitmap* The rows, or NULL if no row has ever had the value
+ */
+const Bitmap *facetBitmap(const FacetIndex *index, int value);
+
+#endif // FACETINDEX_H
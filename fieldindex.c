@@ -0,0 +1,120 @@
+#include <string.h>
+#include "fieldindex.h"
+
+// Key handed to the hash index: the field to read and the value wanted
+typedef struct {
+    const FieldIndex *field;
+    const char *value;
+} FieldLookup;
+
+// Returns non-zero when the row's field equals the looked-up value
+static int rowHasValue(int row, const void *key) {
+    const FieldLookup *lookup = key;
+    return strcmp(lookup->field->key(row), lookup->value) == 0;
+}
+
+/**
+ * @brief Adds a row to every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to add
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * On failure the row is taken out of the indexes it was already added to.
+ */
+int fieldIndexesInsert(FieldIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        if (!hashIndexInsert(&indexes[i].index, hashString(indexes[i].key(row)), row)) {
+            fieldIndexesRemove(indexes, i, row);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Removes a row from every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to remove, still holding its indexed values
+ * @return void
+ */
+void fieldIndexesRemove(FieldIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        hashIndexRemove(&indexes[i].index, hashString(indexes[i].key(row)), row);
+    }
+}
+
+/**
+ * @brief Empties every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @return void
+ */
+void fieldIndexesClear(FieldIndex *indexes, int count) {
+    for (int i = 0; i < count; i++) {
+        hashIndexClear(&indexes[i].index);
+    }
+}
+
+/**
+ * @brief Sizes every index of a table for a number of rows
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param rows Number of rows expected
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int fieldIndexesReserve(FieldIndex *indexes, int count, int rows) {
+    for (int i = 0; i < count; i++) {
+        if (!hashIndexReserve(&indexes[i].index, rows)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Finds the first row whose field equals a value
+ * @param index The field index
+ * @param value The value to look for
+ * @return int Row number, or -1 if no row has the value
+ */
+int fieldIndexFind(const FieldIndex *index, const char *value) {
+    FieldLookup lookup = { index, value };
+    return hashIndexFind(&index->index, hashString(value), rowHasValue, &lookup);
+}
+
+/**
+ * @brief Iterates over every row whose field equals a value
+ * @param index The field index
+ * @param value The value to look for
+ * @param cursor Iteration state, set to -1 before the first call
+ * @return int Next matching row, or -1 when there are no more
+ */
+int fieldIndexFindNext(const FieldIndex *index, const char *value, int *cursor) {
+    FieldLookup lookup = { index, value };
+    return hashIndexFindNext(&index->index, hashString(value), rowHasValue, &lookup, cursor);
+}
+
+/**
+ * @brief Checks a unique field before a value is stored in a row
+ * @param index The field index
+ * @param value The value about to be stored
+ * @param row The row that will hold the value, -1 for a new row
+ * @return int Row that already holds the value, or -1 if there is no conflict
+ *
+ * Non-unique indexes and empty values never conflict.
+ */
+int fieldIndexFindConflict(const FieldIndex *index, const char *value, int row) {
+    if (!index->unique || value[0] == '\0') {
+        return -1;
+    }
+    int cursor = -1;
+    int other;
+    while ((other = fieldIndexFindNext(index, value, &cursor)) != -1) {
+        if (other != row) {
+            return other;
+        }
+    }
+    return -1;
+}
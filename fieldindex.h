@@ -0,0 +1,84 @@
+#ifndef FIELDINDEX_H
+#define FIELDINDEX_H
+
+#include "hashindex.h"
+
+// Returns the value of the indexed field for a table row
+typedef const char *(*FieldKey)(int row);
+
+// Hash index on one text field of a table. Tables declare an array of
+// these and call the fieldIndexes* functions whenever a row is added,
+// changed or removed, so every declared index stays in sync.
+typedef struct {
+    const char *name;     // Field name used in messages
+    FieldKey key;         // Reads the field from a row
+    int unique;           // Non-zero if two rows may not share a value
+    HashIndex index;      // Rows by field value
+} FieldIndex;
+
+#define FIELD_INDEX(name, key, unique) { name, key, unique, HASH_INDEX_INIT }
+
+/**
+ * @brief Adds a row to every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to add
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int fieldIndexesInsert(FieldIndex *indexes, int count, int row);
+
+/**
+ * @brief Removes a row from every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to remove, still holding its indexed values
+ * @return void
+ */
+void fieldIndexesRemove(FieldIndex *indexes, int count, int row);
+
+/**
+ * @brief Empties every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @return void
+ */
+void fieldIndexesClear(FieldIndex *indexes, int count);
+
+/**
+ * @brief Sizes every index of a table for a number of rows
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param rows Number of rows expected
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int fieldIndexesReserve(FieldIndex *indexes, int count, int rows);
+
+/**
+ * @brief Finds the first row whose field equals a value
+ * @param index The field index
+ * @param value The value to look for
+ * @return int Row number, or -1 if no row has the value
+ */
+int fieldIndexFind(const FieldIndex *index, const char *value);
+
+/**
+ * @brief Iterates over every row whose field equals a value
+ * @param index The field index
+ * @param value The value to look for
+ * @param cursor Iteration state, set to -1 before the first call
+ * @return int Next matching row, or -1 when there are no more
+ */
+int fieldIndexFindNext(const FieldIndex *index, const char *value, int *cursor);
+
+/**
+ * @brief Checks a unique field before a value is stored in a row
+ * @param index The field index
+ * @param value The value about to be stored
+ * @param row The row that will hold the value, -1 for a new row
+ * @return int Row that already holds the value, or -1 if there is no conflict
+ *
+ * Non-unique indexes and empty values never conflict.
+ */
+int fieldIndexFindConflict(const FieldIndex *index, const char *value, int row);
+
+#endif // FIELDINDEX_H
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include "hashindex.h"
+
+#define SLOT_EMPTY -1
+#define SLOT_DELETED -2
+#define INITIAL_CAPACITY 16
+
+/**
+ * @brief Hashes a NUL-terminated string (FNV-1a)
+ * @param text The string to hash
+ * @return unsigned int The hash value
+ */
+unsigned int hashString(const char *text) {
+    unsigned int hash = 2166136261u;
+    while (*text) {
+        hash ^= (unsigned char)*text++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes a 64-bit integer key
+ * @param value The key to hash
+ * @return unsigned int The hash value
+ *
+ * Mixes every input bit into the low bits, which pick the slot.
+ */
+unsigned int hashInteger(unsigned long long value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return (unsigned int)value;
+}
+
+/**
+ * @brief Reallocates the slot arrays and re-inserts every live entry
+ * @param index The index to resize
+ * @param capacity New number of slots, a power of two
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Deleted markers are dropped on the way, so a resize also cleans up
+ * after many removals.
+ */
+static int resize(HashIndex *index, int capacity) {
+    int *rows = malloc(sizeof(int) * capacity);
+    unsigned int *hashes = malloc(sizeof(unsigned int) * capacity);
+    if (rows == NULL || hashes == NULL) {
+        free(rows);
+        free(hashes);
+        return 0;
+    }
+    for (int i = 0; i < capacity; i++) {
+        rows[i] = SLOT_EMPTY;
+    }
+
+    unsigned int mask = (unsigned int)capacity - 1;
+    for (int i = 0; i < index->capacity; i++) {
+        if (index->rows[i] < 0) {
+            continue;
+        }
+        unsigned int slot = index->hashes[i] & mask;
+        while (rows[slot] != SLOT_EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        rows[slot] = index->rows[i];
+        hashes[slot] = index->hashes[i];
+    }
+
+    free(index->rows);
+    free(index->hashes);
+    index->rows = rows;
+    index->hashes = hashes;
+    index->capacity = capacity;
+    index->used = index->size;
+    return 1;
+}
+
+/**
+ * @brief Adds a row to the index
+ * @param index The index to update
+ * @param hash Hash of the row's key
+ * @param row The row number
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * The table is kept at most 70% full, counting deleted markers.
+ */
+int hashIndexInsert(HashIndex *index, unsigned int hash, int row) {
+    if ((long)(index->used + 1) * 10 > (long)index->capacity * 7) {
+        int capacity = index->capacity == 0 ? INITIAL_CAPACITY : index->capacity;
+        // Only grow when live entries need it; otherwise just sweep markers
+        if ((long)(index->size + 1) * 10 > (long)capacity * 5) {
+            capacity *= 2;
+        }
+        if (!resize(index, capacity)) {
+            return 0;
+        }
+    }
+
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int slot = hash & mask;
+    while (index->rows[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    if (index->rows[slot] == SLOT_EMPTY) {
+        index->used++;
+    }
+    index->rows[slot] = row;
+    index->hashes[slot] = hash;
+    index->size++;
+    return 1;
+}
+
+/**
+ * @brief Grows the index so it can take a number of rows without resizing
+ * @param index The index to grow
+ * @param rows Number of rows expected
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Used before bulk loads so the table is sized once instead of doubling
+ * its way up.
+ */
+int hashIndexReserve(HashIndex *index, int rows) {
+    int capacity = index->capacity == 0 ? INITIAL_CAPACITY : index->capacity;
+    while ((long)rows * 10 > (long)capacity * 5) {
+        capacity *= 2;
+    }
+    if (capacity == index->capacity) {
+        return 1;
+    }
+    return resize(index, capacity);
+}
+
+/**
+ * @brief Finds the slot holding a given row
+ * @param index The index to search
+ * @param hash Hash of the row's key
+ * @param row The row number
+ * @return int Slot number, or -1 if the row is not in the index
+ */
+static int findSlotOfRow(const HashIndex *index, unsigned int hash, int row) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int slot = hash & mask;
+    while (index->rows[slot] != SLOT_EMPTY) {
+        if (index->rows[slot] == row) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Removes a row from the index
+ * @param index The index to update
+ * @param hash Hash of the row's key
+ * @param row The row number
+ * @return int 1 if the row was removed, 0 if it was not in the index
+ */
+int hashIndexRemove(HashIndex *index, unsigned int hash, int row) {
+    int slot = findSlotOfRow(index, hash, row);
+    if (slot == -1) {
+        return 0;
+    }
+    index->rows[slot] = SLOT_DELETED;
+    index->size--;
+    return 1;
+}
+
+/**
+ * @brief Finds the row holding a key
+ * @param index The index to search
+ * @param hash Hash of the key
+ * @param match Callback that compares a row against the key
+ * @param key The key to look for
+ * @return int Row number if found, -1 otherwise
+ *
+ * The stored hash is compared first so the callback only runs for
+ * real candidates.
+ */
+int hashIndexFind(const HashIndex *index, unsigned int hash, HashIndexMatch match, const void *key) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int slot = hash & mask;
+    while (index->rows[slot] != SLOT_EMPTY) {
+        int row = index->rows[slot];
+        if (row >= 0 && index->hashes[slot] == hash && match(row, key)) {
+            return row;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Iterates over every row holding a key
+ * @param index The index to search
+ * @param hash Hash of the key
+ * @param match Callback that compares a row against the key
+ * @param key The key to look for
+ * @param cursor Iteration state, set to -1 before the first call
+ * @return int Next row holding the key, or -1 when there are no more
+ *
+ * The cursor remembers the last slot visited; the index must not be
+ * modified while an iteration is in progress.
+ */
+int hashIndexFindNext(const HashIndex *index, unsigned int hash, HashIndexMatch match, const void *key, int *cursor) {
+    if (index->capacity == 0) {
+        return -1;
+    }
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int slot = *cursor < 0 ? (hash & mask) : (((unsigned int)*cursor + 1) & mask);
+    while (index->rows[slot] != SLOT_EMPTY) {
+        int row = index->rows[slot];
+        if (row >= 0 && index->hashes[slot] == hash && match(row, key)) {
+            *cursor = (int)slot;
+            return row;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Replaces the contents of an index with saved slot arrays
+ * @param index The index to load into
+ * @param rows Saved rows array
+ * @param hashes Saved hashes array
+ * @param capacity Number of slots, a power of two
+ * @return int 1 on success, 0 if memory could not be allocated or the
+ *             capacity is not a power of two
+ *
+ * The arrays are the ones an index holds (see HashIndex), so an index can
+ * be saved next to its table and loaded without re-inserting every row.
+ */
+int hashIndexLoad(HashIndex *index, const int *rows, const unsigned int *hashes, int capacity) {
+    if (capacity <= 0 || (capacity & (capacity - 1)) != 0) {
+        return 0;
+    }
+    int *loadedRows = malloc(sizeof(int) * capacity);
+    unsigned int *loadedHashes = malloc(sizeof(unsigned int) * capacity);
+    if (loadedRows == NULL || loadedHashes == NULL) {
+        free(loadedRows);
+        free(loadedHashes);
+        return 0;
+    }
+    memcpy(loadedRows, rows, sizeof(int) * capacity);
+    memcpy(loadedHashes, hashes, sizeof(unsigned int) * capacity);
+    hashIndexFree(index);
+    index->rows = loadedRows;
+    index->hashes = loadedHashes;
+    index->capacity = capacity;
+    for (int i = 0; i < capacity; i++) {
+        if (loadedRows[i] >= 0) {
+            index->size++;
+        }
+        if (loadedRows[i] != SLOT_EMPTY) {
+            index->used++;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Removes every entry but keeps the slots allocated
+ * @param index The index to clear
+ * @return void
+ */
+void hashIndexClear(HashIndex *index) {
+    for (int i = 0; i < index->capacity; i++) {
+        index->rows[i] = SLOT_EMPTY;
+    }
+    index->size = 0;
+    index->used = 0;
+}
+
+/**
+ * @brief Releases the memory of the index
+ * @param index The index to free
+ * @return void
+ */
+void hashIndexFree(HashIndex *index) {
+    free(index->rows);
+    free(index->hashes);
+    index->rows = NULL;
+    index->hashes = NULL;
+    index->capacity = 0;
+    index->size = 0;
+    index->used = 0;
+}
@@ -0,0 +1,110 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <stddef.h>
+
+// Open-addressing hash index from a key to a table row. The index only
+// stores row numbers and key hashes; keys are compared through a callback
+// that reads them from the row itself, so no key is ever copied.
+typedef struct {
+    int *rows;               // Row held by each slot, or an empty/deleted marker
+    unsigned int *hashes;    // Hash of the key stored in each slot
+    int capacity;            // Number of slots, always a power of two
+    int size;                // Number of rows in the index
+    int used;                // Rows plus deleted markers
+} HashIndex;
+
+#define HASH_INDEX_INIT { NULL, NULL, 0, 0, 0 }
+
+// Returns non-zero when the row holds the given key
+typedef int (*HashIndexMatch)(int row, const void *key);
+
+/**
+ * @brief Hashes a NUL-terminated string (FNV-1a)
+ * @param text The string to hash
+ * @return unsigned int The hash value
+ */
+unsigned int hashString(const char *text);
+
+/**
+ * @brief Hashes a 64-bit integer key
+ * @param value The key to hash
+ * @return unsigned int The hash value
+ */
+unsigned int hashInteger(unsigned long long value);
+
+/**
+ * @brief Adds a row to the index
+ * @param index The index to update
+ * @param hash Hash of the row's key
+ * @param row The row number
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int hashIndexInsert(HashIndex *index, unsigned int hash, int row);
+
+/**
+ * @brief Grows the index so it can take a number of rows without resizing
+ * @param index The index to grow
+ * @param rows Number of rows expected
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int hashIndexReserve(HashIndex *index, int rows);
+
+/**
+ * @brief Removes a row from the index
+ * @param index The index to update
+ * @param hash Hash of the row's key
+ * @param row The row number
+ * @return int 1 if the row was removed, 0 if it was not in the index
+ */
+int hashIndexRemove(HashIndex *index, unsigned int hash, int row);
+
+/**
+ * @brief Finds the row holding a key
+ * @param index The index to search
+ * @param hash Hash of the key
+ * @param match Callback that compares a row against the key
+ * @param key The key to look for
+ * @return int Row number if found, -1 otherwise
+ */
+int hashIndexFind(const HashIndex *index, unsigned int hash, HashIndexMatch match, const void *key);
+
+/**
+ * @brief Iterates over every row holding a key
+ * @param index The index to search
+ * @param hash Hash of the key
+ * @param match Callback that compares a row against the key
+ * @param key The key to look for
+ * @param cursor Iteration state, set to -1 before the first call
+ * @return int Next row holding the key, or -1 when there are no more
+ *
+ * Used by indexes that allow several rows with the same key.
+ */
+int hashIndexFindNext(const HashIndex *index, unsigned int hash, HashIndexMatch match, const void *key, int *cursor);
+
+/**
+ * @brief Replaces the contents of an index with saved slot arrays
+ * @param index The index to load into
+ * @param rows Saved rows array
+ * @param hashes Saved hashes array
+ * @param capacity Number of slots, a power of two
+ * @return int 1 on success, 0 if memory could not be allocated or the
+ *             capacity is not a power of two
+ */
+int hashIndexLoad(HashIndex *index, const int *rows, const unsigned int *hashes, int capacity);
+
+/**
+ * @brief Removes every entry but keeps the slots allocated
+ * @param index The index to clear
+ * @return void
+ */
+void hashIndexClear(HashIndex *index);
+
+/**
+ * @brief Releases the memory of the index
+ * @param index The index to free
+ * @return void
+ */
+void hashIndexFree(HashIndex *index);
+
+#endif // HASHINDEX_H
@@ -0,0 +1,452 @@
+#include <limits.h>
+#include <pthread.h>
+#include <strings.h>
+#include <unistd.h>
+#include "import.h"
+#include "library.h"
+
+// An import reads the whole file into memory and cuts it into one chunk
+// per thread at line breaks. Each thread splits and checks the rows of
+// its chunk in place, so the parsed fields point into the buffer. The
+// main thread then adds the valid rows in file order, which is where
+// rows already in the library or earlier in the file are caught, and
+// lists every rejected row in the report. Quoted fields may hold commas
+// and doubled quotes, but not line breaks.
+
+// Most fields in a row, and smallest chunk worth a thread of its own
+#define IMPORT_FIELDS 8
+#define IMPORT_MIN_CHUNK (1 << 16)
+
+typedef struct {
+    int line;                   // Line within the chunk, from 0
+    const char *error;          // Why the row is rejected, NULL if it is valid
+    const char *key;            // First field, quoted in the report
+    union {
+        BookValues book;
+        ReaderValues reader;
+    } values;
+} ImportRow;
+
+// Checks the fields of a row and fills in its values
+typedef const char *(*RowParser)(char **fields, int count, ImportRow *row);
+
+typedef struct {
+    char *start;
+    char *end;                  // Just after the last line break of the chunk
+    RowParser parse;
+    ImportRow *rows;
+    int rowCount;
+    int lineCount;
+} ImportChunk;
+
+/**
+ * @brief Splits a CSV line into fields in place
+ * @param line The line, without its line break
+ * @param fields Receives up to maxFields + 1 fields
+ * @param maxFields Most fields expected
+ * @return int Number of fields (maxFields + 1 if there are more), or -1
+ *             if a quoted field is not closed
+ */
+static int splitCSV(char *line, char **fields, int maxFields) {
+    int count = 0;
+    char *p = line;
+    while (count <= maxFields) {
+        char *out = p;
+        fields[count++] = p;
+        if (*p == '"') {
+            p++;
+            while (*p != '"' || p[1] == '"') {
+                if (*p == 0) {
+                    return -1;
+                }
+                if (*p == '"') {
+                    p++;
+                }
+                *out++ = *p++;
+            }
+            p++;
+            if (*p != ',' && *p != 0) {
+                return -1;
+            }
+        } else {
+            while (*p != ',' && *p != 0) {
+                p++;
+            }
+            out = p;
+        }
+        int last = *p == 0;
+        *out = 0;
+        if (last) {
+            return count;
+        }
+        p++;
+    }
+    return count;
+}
+
+// Returns non-zero if any of the fields is too long to store
+static int hasLongField(char **fields, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strlen(fields[i]) >= MAX_STRING) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ISBN,title,author,publisher,year,category,price,quantity
+static const char *parseBookFields(char **fields, int count, ImportRow *row) {
+    BookValues *book = &row->values.book;
+    if (count != 8) {
+        return "wrong number of fields";
+    }
+    if (!parseISBN(fields[0], &book->ISBN)) {
+        return "invalid ISBN";
+    }
+    if (hasLongField(fields, count)) {
+        return "field too long";
+    }
+    if (fields[1][0] == 0) {
+        return "missing title";
+    }
+    book->title = fields[1];
+    book->author = fields[2];
+    book->publisher = fields[3];
+    book->category = fields[5];
+    if (!parseInteger(fields[4], &book->publishYear)) {
+        return "invalid year";
+    }
+    if (!parsePrice(fields[6], &book->price) || book->price < 0) {
+        return "invalid price";
+    }
+    if (!parseInteger(fields[7], &book->quantity) || book->quantity < 0) {
+        return "invalid quantity";
+    }
+    return NULL;
+}
+
+// name,CMND,email,phone,address,birthDate,gender
+static const char *parseReaderFields(char **fields, int count, ImportRow *row) {
+    ReaderValues *reader = &row->values.reader;
+    if (count != 7) {
+        return "wrong number of fields";
+    }
+    if (hasLongField(fields, count)) {
+        return "field too long";
+    }
+    if (fields[0][0] == 0) {
+        return "missing name";
+    }
+    if (fields[1][0] == 0) {
+        return "missing CMND";
+    }
+    reader->name = fields[0];
+    reader->CMND = fields[1];
+    reader->email = fields[2];
+    reader->phone = fields[3];
+    reader->address = fields[4];
+    if (!parseDate(fields[5], &reader->birthDate)) {
+        return "invalid birth date";
+    }
+    if (!parseGender(fields[6], &reader->gender)) {
+        return "invalid gender";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Splits and checks the rows of a chunk
+ * @param argument The ImportChunk
+ * @return void* NULL; chunk->rows is NULL if memory ran out
+ */
+static void *parseChunk(void *argument) {
+    ImportChunk *chunk = argument;
+    // One row per line at most
+    int lines = 0;
+    for (char *p = chunk->start; p < chunk->end; lines++) {
+        char *next = memchr(p, '\n', (size_t)(chunk->end - p));
+        p = next == NULL ? chunk->end : next + 1;
+    }
+    chunk->rows = malloc(sizeof(ImportRow) * (lines > 0 ? lines : 1));
+    if (chunk->rows == NULL) {
+        return NULL;
+    }
+
+    char *p = chunk->start;
+    while (p < chunk->end) {
+        // Only the last chunk can end without a line break, and the
+        // buffer has a spare byte after it
+        char *lineEnd = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (lineEnd == NULL) {
+            lineEnd = chunk->end;
+        }
+        *lineEnd = 0;
+        if (lineEnd > p && lineEnd[-1] == '\r') {
+            lineEnd[-1] = 0;
+        }
+        if (*p != 0) {
+            ImportRow *row = &chunk->rows[chunk->rowCount++];
+            char *fields[IMPORT_FIELDS + 1];
+            int count = splitCSV(p, fields, IMPORT_FIELDS);
+            row->line = chunk->lineCount;
+            row->key = p;
+            row->error = count == -1 ? "unterminated quote" : chunk->parse(fields, count, row);
+        }
+        chunk->lineCount++;
+        p = lineEnd + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads a CSV file and parses its rows on several threads
+ * @param path The file
+ * @param header First field of the header line, which is skipped if present
+ * @param parse Checks the fields of a row
+ * @param chunks Receives the chunks, in file order
+ * @param chunkCount Receives the number of chunks
+ * @param firstLine Receives the line number of the first chunk's first line
+ * @return char* The buffer the rows point into (to free once they are
+ *         added), or NULL if the file could not be read
+ */
+static char *parseFile(const char *path, const char *header, RowParser parse,
+                       ImportChunk *chunks, int *chunkCount, int *firstLine) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Cannot open %s.\n", path);
+        return NULL;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+        rewind(file);
+    }
+    char *data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        printf("Cannot read %s.\n", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    data[size] = 0;
+
+    // A report left by an earlier import would be mistaken for this one's
+    char reportPath[PATH_MAX];
+    snprintf(reportPath, sizeof(reportPath), "%s.rejects", path);
+    remove(reportPath);
+
+    char *start = data;
+    char *end = data + size;
+    *firstLine = 1;
+    size_t headerLength = strlen(header);
+    if (strncasecmp(start, header, headerLength) == 0 &&
+        (start[headerLength] == ',' || start[headerLength] == '"')) {
+        char *next = memchr(start, '\n', (size_t)(end - start));
+        start = next == NULL ? end : next + 1;
+        *firstLine = 2;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (int)((end - start) / IMPORT_MIN_CHUNK) + 1;
+    if (threads > cores) {
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    if (threads > IMPORT_MAX_THREADS) {
+        threads = IMPORT_MAX_THREADS;
+    }
+
+    // Cut at the first line break after each even split point
+    for (int i = 0; i < threads; i++) {
+        ImportChunk *chunk = &chunks[i];
+        memset(chunk, 0, sizeof(ImportChunk));
+        chunk->start = i == 0 ? start : chunks[i - 1].end;
+        chunk->end = end;
+        chunk->parse = parse;
+        if (i + 1 < threads) {
+            char *split = start + (end - start) * (i + 1) / threads;
+            if (split < chunk->start) {
+                split = chunk->start;
+            }
+            char *next = memchr(split, '\n', (size_t)(end - split));
+            chunk->end = next == NULL ? end : next + 1;
+        }
+    }
+
+    pthread_t workers[IMPORT_MAX_THREADS];
+    int started[IMPORT_MAX_THREADS] = { 0 };
+    for (int i = 1; i < threads; i++) {
+        started[i] = pthread_create(&workers[i], NULL, parseChunk, &chunks[i]) == 0;
+    }
+    parseChunk(&chunks[0]);
+    for (int i = 1; i < threads; i++) {
+        if (started[i]) {
+            pthread_join(workers[i], NULL);
+        } else {
+            parseChunk(&chunks[i]);
+        }
+    }
+    *chunkCount = threads;
+    return data;
+}
+
+// Counts the rows that passed the checks, to size the tables once
+static int countValidRows(const ImportChunk *chunks, int chunkCount) {
+    int count = 0;
+    for (int i = 0; i < chunkCount; i++) {
+        for (int j = 0; j < chunks[i].rowCount; j++) {
+            count += chunks[i].rows[j].error == NULL;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Lists a rejected row in the report
+ * @param report The open report, or NULL to open it
+ * @param path The file being imported
+ * @param line Line number of the row
+ * @param reason Why the row is rejected
+ * @param key First field of the row
+ * @return FILE* The report, NULL if it cannot be written
+ */
+static FILE *reportReject(FILE *report, const char *path, int line, const char *reason, const char *key) {
+    if (report == NULL) {
+        char reportPath[PATH_MAX];
+        snprintf(reportPath, sizeof(reportPath), "%s.rejects", path);
+        report = fopen(reportPath, "w");
+        if (report == NULL) {
+            return NULL;
+        }
+    }
+    fprintf(report, "line %d: %s: %s\n", line, reason, key);
+    return report;
+}
+
+/**
+ * @brief Reports how an import went and closes the report
+ * @param path The file imported
+ * @param what Name of the rows
+ * @param added Rows added
+ * @param rejected Rows rejected
+ * @param start Time the import started
+ * @param report The report, NULL if nothing was rejected
+ * @return void
+ */
+static void finishImport(const char *path, const char *what, int added, int rejected,
+                         struct timespec start, FILE *report) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("Imported %d %s from %s in %.2f s.\n", added, what, path, seconds);
+    if (rejected > 0) {
+        printf("%d rows rejected, see %s.rejects.\n", rejected, path);
+    }
+    if (report != NULL) {
+        fclose(report);
+    }
+}
+
+// Adds the books of a CSV file
+int importBooks(const char *path, int *bookCount) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ImportChunk chunks[IMPORT_MAX_THREADS];
+    int chunkCount;
+    int line;
+    char *data = parseFile(path, "ISBN", parseBookFields, chunks, &chunkCount, &line);
+    if (data == NULL) {
+        return -1;
+    }
+
+    reserveBooks(*bookCount, countValidRows(chunks, chunkCount));
+    FILE *report = NULL;
+    int added = 0;
+    int rejected = 0;
+    for (int i = 0; i < chunkCount; i++) {
+        ImportChunk *chunk = &chunks[i];
+        if (chunk->rows == NULL && chunk->start < chunk->end) {
+            printf("Not enough memory to import lines %d and later.\n", line);
+            break;
+        }
+        for (int j = 0; j < chunk->rowCount; j++) {
+            ImportRow *row = &chunk->rows[j];
+            const char *error = row->error;
+            if (error == NULL && findBookByISBN(*bookCount, row->values.book.ISBN) != -1) {
+                error = "ISBN already exists";
+            }
+            if (error == NULL && storeBook(bookCount, &row->values.book) == -1) {
+                error = "out of memory";
+            }
+            if (error == NULL) {
+                added++;
+            } else {
+                rejected++;
+                report = reportReject(report, path, line + row->line, error, row->key);
+            }
+        }
+        line += chunk->lineCount;
+    }
+    for (int i = 0; i < chunkCount; i++) {
+        free(chunks[i].rows);
+    }
+    free(data);
+    finishImport(path, "books", added, rejected, start, report);
+    return added;
+}
+
+// Adds the readers of a CSV file
+int importReaders(const char *path, int *readerCount) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ImportChunk chunks[IMPORT_MAX_THREADS];
+    int chunkCount;
+    int line;
+    char *data = parseFile(path, "name", parseReaderFields, chunks, &chunkCount, &line);
+    if (data == NULL) {
+        return -1;
+    }
+
+    reserveReaders(*readerCount, countValidRows(chunks, chunkCount));
+    FILE *report = NULL;
+    int added = 0;
+    int rejected = 0;
+    for (int i = 0; i < chunkCount; i++) {
+        ImportChunk *chunk = &chunks[i];
+        if (chunk->rows == NULL && chunk->start < chunk->end) {
+            printf("Not enough memory to import lines %d and later.\n", line);
+            break;
+        }
+        for (int j = 0; j < chunk->rowCount; j++) {
+            ImportRow *row = &chunk->rows[j];
+            ReaderValues *values = &row->values.reader;
+            const char *error = row->error;
+            char reason[MAX_STRING];
+            const char *field = error == NULL ? findReaderConflict(values) : NULL;
+            if (field != NULL) {
+                snprintf(reason, sizeof(reason), "%s already registered", field);
+                error = reason;
+            }
+            if (error == NULL) {
+                values->ID = readerSlots.nextID;
+                issueCard(&values->cardIssueDate, &values->cardExpiryDate, &values->membershipYear);
+                if (storeReader(readerCount, values) == -1) {
+                    error = "out of memory";
+                }
+            }
+            if (error == NULL) {
+                added++;
+            } else {
+                rejected++;
+                report = reportReject(report, path, line + row->line, error, row->key);
+            }
+        }
+        line += chunk->lineCount;
+    }
+    for (int i = 0; i < chunkCount; i++) {
+        free(chunks[i].rows);
+    }
+    free(data);
+    finishImport(path, "readers", added, rejected, start, report);
+    return added;
+}
@@ -0,0 +1,30 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+// Most threads an import parses with
+#define IMPORT_MAX_THREADS 16
+
+/**
+ * @brief Adds the books of a CSV file
+ * @param path The CSV file, one book per line:
+ *             ISBN,title,author,publisher,year,category,price,quantity
+ * @param bookCount Pointer to the current number of books
+ * @return int Number of books added, or -1 if the file cannot be read
+ *
+ * Rejected rows are listed in path + ".rejects".
+ */
+int importBooks(const char *path, int *bookCount);
+
+/**
+ * @brief Adds the readers of a CSV file
+ * @param path The CSV file, one reader per line:
+ *             name,CMND,email,phone,address,birthDate,gender
+ * @param readerCount Pointer to the current number of reader rows
+ * @return int Number of readers added, or -1 if the file cannot be read
+ *
+ * Readers get new IDs and cards issued today. Rejected rows are listed
+ * in path + ".rejects".
+ */
+int importReaders(const char *path, int *readerCount);
+
+#endif // IMPORT_H
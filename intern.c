@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "hashindex.h"
+#include "textarena.h"
+
+// Interned text lives in an arena, so the pointers handed out by
+// symbolText stay valid
+static TextArena symbolArena = TEXT_ARENA_INIT;
+
+// Text of each symbol, indexed by symbol
+static const char **symbolTexts = NULL;
+static int symbolTotal = 0;
+static int symbolCapacity = 0;
+
+// Symbols by text
+static HashIndex symbolIndex = HASH_INDEX_INIT;
+
+// Returns non-zero when the symbol's text equals the key
+static int symbolHasText(int symbol, const void *text) {
+    return strcmp(symbolTexts[symbol], (const char *)text) == 0;
+}
+
+/**
+ * @brief Adds a new string to the pool
+ * @param text The string
+ * @param hash Its hash
+ * @return int The new symbol, or -1 if memory could not be allocated
+ */
+static int addSymbol(const char *text, unsigned int hash) {
+    if (symbolTotal == symbolCapacity) {
+        int capacity = symbolCapacity == 0 ? 256 : symbolCapacity * 2;
+        const char **texts = realloc(symbolTexts, sizeof(const char *) * capacity);
+        if (texts == NULL) {
+            return -1;
+        }
+        symbolTexts = texts;
+        symbolCapacity = capacity;
+    }
+    TextRef copy;
+    if (!arenaStore(&symbolArena, text, &copy) || !hashIndexInsert(&symbolIndex, hash, symbolTotal)) {
+        return -1;
+    }
+    symbolTexts[symbolTotal] = arenaText(&symbolArena, copy);
+    return symbolTotal++;
+}
+
+/**
+ * @brief Returns the symbol of a string, adding it to the pool if needed
+ * @param text The string to intern, at most MAX_STRING bytes
+ * @return Symbol The symbol, or 0 if memory could not be allocated
+ */
+Symbol internString(const char *text) {
+    if (symbolTotal == 0 && addSymbol("", hashString("")) == -1) {
+        return 0;
+    }
+    unsigned int hash = hashString(text);
+    int symbol = hashIndexFind(&symbolIndex, hash, symbolHasText, text);
+    if (symbol == -1) {
+        symbol = addSymbol(text, hash);
+    }
+    return symbol == -1 ? 0 : (Symbol)symbol;
+}
+
+/**
+ * @brief Looks a string up without adding it to the pool
+ * @param text The string to look for
+ * @param symbol Receives the symbol if the string is interned
+ * @return int 1 if the string is interned, 0 otherwise
+ */
+int findSymbol(const char *text, Symbol *symbol) {
+    if (text[0] == '\0') {
+        *symbol = 0;
+        return 1;
+    }
+    int found = hashIndexFind(&symbolIndex, hashString(text), symbolHasText, text);
+    if (found == -1) {
+        return 0;
+    }
+    *symbol = (Symbol)found;
+    return 1;
+}
+
+/**
+ * @brief Returns the text of a symbol
+ * @param symbol The symbol
+ * @return const char* The interned text, valid for the life of the program
+ */
+const char *symbolText(Symbol symbol) {
+    if ((int)symbol >= symbolTotal) {
+        return "";
+    }
+    return symbolTexts[symbol];
+}
+
+/**
+ * @brief Returns the number of symbols in the pool
+ * @return int Number of distinct strings interned so far
+ */
+int symbolCount(void) {
+    return symbolTotal;
+}
+
+/**
+ * @brief Reports the bytes held by the pool
+ * @return size_t Bytes of text chunks, symbol table and hash index
+ */
+size_t internMemoryUsage(void) {
+    return arenaMemoryUsage(&symbolArena) +
+           (size_t)symbolCapacity * sizeof(const char *) +
+           (size_t)symbolIndex.capacity * (sizeof(int) + sizeof(unsigned int));
+}
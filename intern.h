@@ -0,0 +1,45 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// ID of an interned string. Equal strings always get the same symbol, so
+// comparing two symbols is the same as comparing their text. Symbol 0 is
+// the empty string.
+typedef unsigned int Symbol;
+
+/**
+ * @brief Returns the symbol of a string, adding it to the pool if needed
+ * @param text The string to intern, at most MAX_STRING bytes
+ * @return Symbol The symbol, or 0 if memory could not be allocated
+ */
+Symbol internString(const char *text);
+
+/**
+ * @brief Looks a string up without adding it to the pool
+ * @param text The string to look for
+ * @param symbol Receives the symbol if the string is interned
+ * @return int 1 if the string is interned, 0 otherwise
+ */
+int findSymbol(const char *text, Symbol *symbol);
+
+/**
+ * @brief Returns the text of a symbol
+ * @param symbol The symbol
+ * @return const char* The interned text, valid for the life of the program
+ */
+const char *symbolText(Symbol symbol);
+
+/**
+ * @brief Returns the number of symbols in the pool
+ * @return int Number of distinct strings interned so far
+ */
+int symbolCount(void);
+
+/**
+ * @brief Reports the bytes held by the pool
+ * @return size_t Bytes of text chunks, symbol table and hash index
+ */
+size_t internMemoryUsage(void);
+
+#endif // INTERN_H
@@ -0,0 +1,691 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "journal.h"
+#include "library.h"
+#include "snapshot.h"
+
+// File layout: a header naming the snapshot generation the journal
+// continues, then records back to back. Each record is a RecordHeader
+// followed by its payload; numbers use the native byte order and text is
+// a 2-byte length followed by the bytes. Replay stops at the first record
+// whose length or checksum does not hold, which is where a crash cut the
+// file short.
+//
+// A checkpoint writes a new snapshot while changes keep coming in, so it
+// first appends a marker naming the new snapshot's generation. Once that
+// snapshot is on disk, the records before the marker are dropped; if the
+// process dies before that, replay over the new snapshot starts after
+// the marker and replay over the old one ignores it.
+#define JOURNAL_MAGIC "LIBJRNL"
+#define JOURNAL_VERSION 1
+
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int generation;    // Snapshot the records apply to
+} JournalHeader;
+
+enum {
+    RECORD_BOOK = 1,            // Every field of an added or updated book
+    RECORD_BOOK_DELETED,        // ISBN of a deleted book
+    RECORD_READER,              // Every field of an added or updated reader
+    RECORD_READER_DELETED,      // ID of a deleted reader
+    RECORD_BORROWING,           // A new borrowing
+    RECORD_RETURN,              // Row of a returned borrowing and the return time
+    RECORD_CHECKPOINT           // Generation of a snapshot holding every earlier record
+};
+
+typedef struct {
+    unsigned int size;          // Bytes of payload after the header
+    unsigned int type;
+    unsigned int checksum;      // Checksum of the header with this field set to 0, then the payload
+} RecordHeader;
+
+// Open journal file and its path, -1 when there is none
+static int journalFile = -1;
+static char journalPath[PATH_MAX];
+
+// End of the last record known to be in the file
+static off_t journalEnd = 0;
+
+// End of the last checkpoint marker (or of the header) and the
+// generation the marker names
+static off_t checkpointEnd = 0;
+static unsigned int checkpointGeneration = 0;
+
+// Commits per sync and commits written since the last sync
+static int syncInterval = 1;
+static int unsyncedCommits = 0;
+
+// Records made since the last commit
+static unsigned char *pending = NULL;
+static size_t pendingSize = 0;
+static size_t pendingCapacity = 0;
+
+// Start of the record being built, and whether it ran out of memory
+static size_t recordStart = 0;
+static int recordFailed = 0;
+
+/**
+ * @brief Adds bytes to a checksum (FNV-1a)
+ * @param hash The checksum so far
+ * @param data The bytes
+ * @param size Number of bytes
+ * @return unsigned int The updated checksum
+ */
+static unsigned int checksumBytes(unsigned int hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Returns the checksum of a record
+static unsigned int recordChecksum(RecordHeader header, const void *payload) {
+    header.checksum = 0;
+    unsigned int hash = checksumBytes(2166136261u, &header, sizeof(header));
+    return checksumBytes(hash, payload, header.size);
+}
+
+// Appends bytes to the record being built
+static void putBytes(const void *data, size_t size) {
+    if (recordFailed) {
+        return;
+    }
+    if (pendingSize + size > pendingCapacity) {
+        size_t capacity = pendingCapacity == 0 ? 4096 : pendingCapacity;
+        while (pendingSize + size > capacity) {
+            capacity *= 2;
+        }
+        unsigned char *grown = realloc(pending, capacity);
+        if (grown == NULL) {
+            recordFailed = 1;
+            return;
+        }
+        pending = grown;
+        pendingCapacity = capacity;
+    }
+    memcpy(pending + pendingSize, data, size);
+    pendingSize += size;
+}
+
+static void putInt(int value) {
+    putBytes(&value, sizeof(value));
+}
+
+static void putTime(time_t value) {
+    long long time = value;
+    putBytes(&time, sizeof(time));
+}
+
+static void putText(const char *text) {
+    unsigned short length = (unsigned short)strlen(text);
+    putBytes(&length, sizeof(length));
+    putBytes(text, length);
+}
+
+/**
+ * @brief Starts a record
+ * @param type The record type
+ * @return int 1 if the record should be built, 0 if no journal is open
+ */
+static int beginRecord(unsigned int type) {
+    if (journalFile == -1) {
+        return 0;
+    }
+    RecordHeader header = { 0, type, 0 };
+    recordStart = pendingSize;
+    recordFailed = 0;
+    putBytes(&header, sizeof(header));
+    return 1;
+}
+
+/**
+ * @brief Fills in the header of the record being built
+ * @return void
+ *
+ * A record that ran out of memory is dropped; the change is still saved
+ * on exit.
+ */
+static void endRecord(void) {
+    if (recordFailed) {
+        pendingSize = recordStart;
+        printf("Out of memory! Change not written to the journal.\n");
+        return;
+    }
+    RecordHeader header;
+    memcpy(&header, pending + recordStart, sizeof(header));
+    header.size = (unsigned int)(pendingSize - recordStart - sizeof(header));
+    header.checksum = recordChecksum(header, pending + recordStart + sizeof(header));
+    memcpy(pending + recordStart, &header, sizeof(header));
+}
+
+// Records a book that was added or updated
+void journalBook(const Book *book) {
+    if (!beginRecord(RECORD_BOOK)) {
+        return;
+    }
+    putBytes(&book->ISBN, sizeof(book->ISBN));
+    putInt(book->publishYear);
+    putBytes(&book->price, sizeof(book->price));
+    putInt(book->quantity);
+    putText(bookString(book->title));
+    putText(symbolText(book->author));
+    putText(symbolText(book->publisher));
+    putText(symbolText(book->category));
+    endRecord();
+}
+
+// Records a book that was deleted
+void journalBookDeleted(unsigned long long ISBN) {
+    if (!beginRecord(RECORD_BOOK_DELETED)) {
+        return;
+    }
+    putBytes(&ISBN, sizeof(ISBN));
+    endRecord();
+}
+
+// Records a reader that was added or updated
+void journalReader(const Reader *reader) {
+    if (!beginRecord(RECORD_READER)) {
+        return;
+    }
+    putInt(reader->ID);
+    putInt(reader->birthDate);
+    putInt(reader->cardIssueDate);
+    putInt(reader->cardExpiryDate);
+    putInt(reader->membershipYear);
+    putInt(reader->gender);
+    putText(readerString(reader->name));
+    putText(readerString(reader->CMND));
+    putText(readerString(reader->email));
+    putText(readerString(reader->phone));
+    putText(readerString(reader->address));
+    endRecord();
+}
+
+// Records a reader that was deleted
+void journalReaderDeleted(int id) {
+    if (!beginRecord(RECORD_READER_DELETED)) {
+        return;
+    }
+    putInt(id);
+    endRecord();
+}
+
+// Records a new borrowing
+void journalBorrowing(const Borrowing *borrowing) {
+    if (!beginRecord(RECORD_BORROWING)) {
+        return;
+    }
+    putInt(borrowing->readerID);
+    putTime(borrowing->borrowingDate);
+    putTime(borrowing->dueDate);
+    putInt(borrowing->bookCount);
+    putBytes(borrowing->books, sizeof(borrowing->books[0]) * borrowing->bookCount);
+    endRecord();
+}
+
+// Records that the books of a borrowing were returned
+void journalReturn(int index, time_t returnDate) {
+    if (!beginRecord(RECORD_RETURN)) {
+        return;
+    }
+    putInt(index);
+    putTime(returnDate);
+    endRecord();
+}
+
+/**
+ * @brief Writes a whole buffer, retrying short writes
+ * @param data The bytes
+ * @param size Number of bytes
+ * @return int 1 on success, 0 on error
+ */
+static int writeAll(const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    while (size > 0) {
+        ssize_t written = write(journalFile, bytes, size);
+        if (written <= 0) {
+            return 0;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+// Writes the changes recorded since the last commit
+int journalCommit(void) {
+    if (journalFile == -1 || pendingSize == 0) {
+        return 1;
+    }
+    int ok = writeAll(pending, pendingSize);
+    pendingSize = 0;
+    if (!ok) {
+        // Cut off a partly written record so later records stay reachable
+        if (ftruncate(journalFile, journalEnd) != 0 ||
+            lseek(journalFile, journalEnd, SEEK_SET) == -1) {
+            close(journalFile);
+            journalFile = -1;
+        }
+        printf("Error writing journal! Recent changes will only be saved on exit.\n");
+        return 0;
+    }
+    journalEnd = lseek(journalFile, 0, SEEK_CUR);
+    if (syncInterval > 0 && ++unsyncedCommits >= syncInterval) {
+        fdatasync(journalFile);
+        unsyncedCommits = 0;
+    }
+    return 1;
+}
+
+// Reads fields of a record payload, failing once the payload runs out
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+    int ok;
+} RecordReader;
+
+static void getBytes(RecordReader *in, void *out, size_t size) {
+    if (!in->ok || size > in->size - in->offset) {
+        in->ok = 0;
+        memset(out, 0, size);
+        return;
+    }
+    memcpy(out, in->data + in->offset, size);
+    in->offset += size;
+}
+
+static int getInt(RecordReader *in) {
+    int value;
+    getBytes(in, &value, sizeof(value));
+    return value;
+}
+
+static time_t getTime(RecordReader *in) {
+    long long time;
+    getBytes(in, &time, sizeof(time));
+    return (time_t)time;
+}
+
+// Reads text into a buffer of MAX_STRING bytes
+static void getText(RecordReader *in, char *text) {
+    unsigned short length;
+    getBytes(in, &length, sizeof(length));
+    if (length >= MAX_STRING) {
+        in->ok = 0;
+        length = 0;
+    }
+    getBytes(in, text, length);
+    text[in->ok ? length : 0] = 0;
+}
+
+/**
+ * @brief Redoes the change held by a record
+ * @param type The record type
+ * @param in The record payload
+ * @param bookCount Pointer to the current number of books
+ * @param readerCount Pointer to the current number of reader rows
+ * @param borrowingCount Pointer to the current number of borrowings
+ * @return int 1 if the record was understood, 0 if it is malformed
+ */
+static int replayRecord(unsigned int type, RecordReader *in, int *bookCount, int *readerCount, int *borrowingCount) {
+    char title[MAX_STRING], author[MAX_STRING], publisher[MAX_STRING], category[MAX_STRING];
+    char name[MAX_STRING], CMND[MAX_STRING], email[MAX_STRING], phone[MAX_STRING], address[MAX_STRING];
+    switch (type) {
+        case RECORD_BOOK: {
+            BookValues book = { 0, title, author, publisher, category, 0, 0, 0 };
+            getBytes(in, &book.ISBN, sizeof(book.ISBN));
+            book.publishYear = getInt(in);
+            getBytes(in, &book.price, sizeof(book.price));
+            book.quantity = getInt(in);
+            getText(in, title);
+            getText(in, author);
+            getText(in, publisher);
+            getText(in, category);
+            if (in->ok && storeBook(bookCount, &book) == -1) {
+                printf("Not enough memory to replay journal.\n");
+            }
+            break;
+        }
+        case RECORD_BOOK_DELETED: {
+            unsigned long long ISBN;
+            getBytes(in, &ISBN, sizeof(ISBN));
+            int index = findBookByISBN(*bookCount, ISBN);
+            if (in->ok && index != -1) {
+                removeBook(index);
+            }
+            break;
+        }
+        case RECORD_READER: {
+            ReaderValues reader = { 0, name, CMND, email, phone, address, 0, 0, 0, 0, GENDER_UNKNOWN };
+            reader.ID = getInt(in);
+            reader.birthDate = getInt(in);
+            reader.cardIssueDate = getInt(in);
+            reader.cardExpiryDate = getInt(in);
+            reader.membershipYear = getInt(in);
+            reader.gender = (Gender)getInt(in);
+            getText(in, name);
+            getText(in, CMND);
+            getText(in, email);
+            getText(in, phone);
+            getText(in, address);
+            if (in->ok && storeReader(readerCount, &reader) == -1) {
+                printf("Not enough memory to replay journal.\n");
+            }
+            break;
+        }
+        case RECORD_READER_DELETED: {
+            int id = getInt(in);
+            if (in->ok) {
+                removeReader(*readerCount, id);
+            }
+            break;
+        }
+        case RECORD_BORROWING: {
+            Borrowing borrowing;
+            memset(&borrowing, 0, sizeof(Borrowing));
+            borrowing.readerID = getInt(in);
+            borrowing.borrowingDate = getTime(in);
+            borrowing.dueDate = getTime(in);
+            borrowing.bookCount = getInt(in);
+            if (borrowing.bookCount < 0 || borrowing.bookCount > MAX_BOOKS_PER_READER) {
+                return 0;
+            }
+            getBytes(in, borrowing.books, sizeof(borrowing.books[0]) * borrowing.bookCount);
+            if (in->ok && storeBorrowing(*bookCount, borrowingCount, &borrowing) == -1) {
+                printf("Not enough memory to replay journal.\n");
+            }
+            break;
+        }
+        case RECORD_RETURN: {
+            int index = getInt(in);
+            time_t returnDate = getTime(in);
+            if (in->ok && index >= 0 && index < *borrowingCount && !borrowingAt(index)->isReturned) {
+                returnBorrowing(*bookCount, index, returnDate);
+            }
+            break;
+        }
+        case RECORD_CHECKPOINT: {
+            unsigned int generation;
+            getBytes(in, &generation, sizeof(generation));
+            break;
+        }
+        default:
+            return 0;
+    }
+    return in->ok && in->offset == in->size;
+}
+
+/**
+ * @brief Reads a whole file into memory
+ * @param file The open file
+ * @param size Receives the number of bytes read
+ * @return unsigned char* malloc'd contents, NULL on error
+ */
+static unsigned char *readFile(int file, size_t *size) {
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        return NULL;
+    }
+    unsigned char *data = malloc((size_t)info.st_size + 1);
+    if (data == NULL) {
+        return NULL;
+    }
+    size_t total = 0;
+    while (total < (size_t)info.st_size) {
+        ssize_t got = read(file, data + total, (size_t)info.st_size - total);
+        if (got <= 0) {
+            break;
+        }
+        total += (size_t)got;
+    }
+    *size = total;
+    return data;
+}
+
+/**
+ * @brief Writes a journal header at the start of a file
+ * @param file The file
+ * @param generation Generation of the snapshot the journal follows
+ * @return int 1 on success, 0 on error
+ */
+static int writeHeader(int file, unsigned int generation) {
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.generation = generation;
+    return pwrite(file, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
+
+/**
+ * @brief Checks the record at an offset
+ * @param data The journal contents
+ * @param size Bytes in the journal
+ * @param offset Start of the record
+ * @param record Receives the record header
+ * @return size_t End of the record, or 0 if it is cut short or damaged
+ */
+static size_t checkRecord(const unsigned char *data, size_t size, size_t offset, RecordHeader *record) {
+    if (size - offset < sizeof(RecordHeader)) {
+        return 0;
+    }
+    memcpy(record, data + offset, sizeof(RecordHeader));
+    const unsigned char *payload = data + offset + sizeof(RecordHeader);
+    if (record->size > size - offset - sizeof(RecordHeader) || record->checksum != recordChecksum(*record, payload)) {
+        return 0;
+    }
+    return offset + sizeof(RecordHeader) + record->size;
+}
+
+/**
+ * @brief Finds where the changes missing from a snapshot start
+ * @param data The journal contents
+ * @param size Bytes in the journal
+ * @param generation Generation of the snapshot
+ * @return size_t Offset just past the snapshot's checkpoint marker, or 0
+ *                if the journal has none
+ *
+ * A process that died after a failed checkpoint may have reused its
+ * generation, so the last marker for the generation is the one that counts.
+ */
+static size_t findCheckpoint(const unsigned char *data, size_t size, unsigned int generation) {
+    RecordHeader record;
+    size_t offset = sizeof(JournalHeader);
+    size_t found = 0;
+    size_t end;
+    while ((end = checkRecord(data, size, offset, &record)) != 0) {
+        unsigned int marked;
+        if (record.type == RECORD_CHECKPOINT && record.size == sizeof(marked)) {
+            memcpy(&marked, data + offset + sizeof(record), sizeof(marked));
+            if (marked == generation) {
+                found = end;
+            }
+        }
+        offset = end;
+    }
+    return found;
+}
+
+/**
+ * @brief Replaces the journal with the records from an offset on
+ * @param generation Generation of the snapshot holding the records before it
+ * @param from Offset of the first record to keep
+ * @return int 1 on success, 0 on error (the journal is left as it was)
+ *
+ * The kept records are written to a temporary file that is synced and
+ * renamed over the journal. Once renamed, the new file is the journal even
+ * if its directory cannot be synced, since the old one is no longer linked.
+ */
+static int rewriteJournal(unsigned int generation, off_t from) {
+    size_t size = (size_t)(journalEnd - from);
+    unsigned char *records = malloc(size + 1);
+    char tempPath[PATH_MAX + 4];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", journalPath);
+    int file = records == NULL ? -1 : open(tempPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int ok = file != -1 && pread(journalFile, records, size, from) == (ssize_t)size &&
+             writeHeader(file, generation) &&
+             pwrite(file, records, size, sizeof(JournalHeader)) == (ssize_t)size &&
+             fdatasync(file) == 0 && rename(tempPath, journalPath) == 0;
+    free(records);
+    if (!ok) {
+        if (file != -1) {
+            close(file);
+            remove(tempPath);
+        }
+        return 0;
+    }
+    if (!syncDirectory(journalPath)) {
+        printf("Cannot sync the directory of journal %s, a crash may bring back the old journal.\n", journalPath);
+    }
+    close(journalFile);
+    journalFile = file;
+    journalEnd = (off_t)(sizeof(JournalHeader) + size);
+    checkpointEnd = sizeof(JournalHeader);
+    checkpointGeneration = 0;
+    return lseek(journalFile, journalEnd, SEEK_SET) != -1;
+}
+
+// Replays the journal over the loaded data and opens it for appending
+int openJournal(const char *path, unsigned int generation, int syncEvery,
+                int *bookCount, int *readerCount, int *borrowingCount) {
+    snprintf(journalPath, sizeof(journalPath), "%s", path);
+    journalFile = open(path, O_RDWR | O_CREAT, 0644);
+    size_t size = 0;
+    unsigned char *data = journalFile == -1 ? NULL : readFile(journalFile, &size);
+    if (data == NULL) {
+        if (journalFile != -1) {
+            close(journalFile);
+            journalFile = -1;
+        }
+        printf("Cannot open journal %s, changes will only be saved on exit.\n", path);
+        return -1;
+    }
+    syncInterval = syncEvery;
+
+    // Records apply from the start if the journal follows the loaded
+    // snapshot, or from its checkpoint marker if a checkpoint wrote it
+    JournalHeader header;
+    size_t start = 0;
+    size_t end = 0;
+    int replayed = 0;
+    if (size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 && header.version == JOURNAL_VERSION) {
+            start = header.generation == generation ? sizeof(header) : findCheckpoint(data, size, generation);
+        }
+    }
+    if (start != 0) {
+        RecordHeader record;
+        size_t next;
+        end = start;
+        while ((next = checkRecord(data, size, end, &record)) != 0) {
+            RecordReader in = { data + end + sizeof(record), record.size, 0, 1 };
+            if (!replayRecord(record.type, &in, bookCount, readerCount, borrowingCount)) {
+                break;
+            }
+            if (record.type != RECORD_CHECKPOINT) {
+                replayed++;
+            }
+            end = next;
+        }
+        if (end < size) {
+            printf("Journal %s ends with an incomplete change, which is discarded.\n", path);
+        }
+    } else if (size > sizeof(header)) {
+        printf("Journal %s does not match the loaded data and is discarded.\n", path);
+    }
+    free(data);
+
+    int ok;
+    if (start == 0) {
+        ok = ftruncate(journalFile, 0) == 0 && writeHeader(journalFile, generation) && fdatasync(journalFile) == 0;
+        end = sizeof(header);
+    } else {
+        ok = ftruncate(journalFile, (off_t)end) == 0;
+    }
+    journalEnd = (off_t)end;
+    checkpointEnd = (off_t)start;
+    ok = ok && lseek(journalFile, journalEnd, SEEK_SET) != -1;
+    // Drop the records the loaded snapshot already holds
+    if (ok && start > sizeof(header)) {
+        ok = rewriteJournal(generation, (off_t)start);
+    }
+    if (!ok) {
+        close(journalFile);
+        journalFile = -1;
+        printf("Cannot open journal %s, changes will only be saved on exit.\n", path);
+        return -1;
+    }
+    if (replayed > 0) {
+        printf("Replayed %d changes from %s.\n", replayed, path);
+    }
+    return replayed;
+}
+
+// Tells whether changes were recorded since the last checkpoint marker
+int journalHasChanges(void) {
+    return journalFile != -1 && (pendingSize > 0 || journalEnd > checkpointEnd);
+}
+
+// Marks the point a snapshot being written will hold every change up to
+int journalCheckpoint(unsigned int generation) {
+    if (!beginRecord(RECORD_CHECKPOINT)) {
+        return 0;
+    }
+    putBytes(&generation, sizeof(generation));
+    endRecord();
+    if (!journalCommit() || fdatasync(journalFile) != 0) {
+        return 0;
+    }
+    checkpointEnd = journalEnd;
+    checkpointGeneration = generation;
+    return 1;
+}
+
+// Drops the records held by a snapshot a checkpoint finished writing
+int compactJournal(unsigned int generation) {
+    if (journalFile == -1 || generation != checkpointGeneration || !journalCommit()) {
+        return 0;
+    }
+    return rewriteJournal(generation, checkpointEnd);
+}
+
+// Empties the journal after a snapshot was saved
+int resetJournal(unsigned int generation) {
+    if (journalFile == -1) {
+        return 0;
+    }
+    pendingSize = 0;
+    if (ftruncate(journalFile, 0) != 0 || !writeHeader(journalFile, generation) ||
+        fdatasync(journalFile) != 0) {
+        return 0;
+    }
+    journalEnd = sizeof(JournalHeader);
+    checkpointEnd = journalEnd;
+    checkpointGeneration = 0;
+    unsyncedCommits = 0;
+    return lseek(journalFile, journalEnd, SEEK_SET) != -1;
+}
+
+// Commits pending changes, syncs and closes the journal
+void closeJournal(void) {
+    if (journalFile == -1) {
+        return;
+    }
+    journalCommit();
+    fdatasync(journalFile);
+    close(journalFile);
+    journalFile = -1;
+    free(pending);
+    pending = NULL;
+    pendingSize = 0;
+    pendingCapacity = 0;
+}
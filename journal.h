@@ -0,0 +1,117 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <time.h>
+#include "book.h"
+#include "reader.h"
+#include "borrowing.h"
+
+// Append-only log of the changes made since the last snapshot
+#define JOURNAL_FILE "library.journal"
+
+/**
+ * @brief Replays the journal over the loaded data and opens it for appending
+ * @param path The journal file
+ * @param generation Generation of the loaded snapshot (see snapshotGeneration)
+ * @param syncEvery Commits per sync to disk; 1 syncs every change, 0 leaves
+ *                  syncing to the operating system
+ * @param bookCount Pointer to the current number of books
+ * @param readerCount Pointer to the current number of reader rows
+ * @param borrowingCount Pointer to the current number of borrowings
+ * @return int Number of changes replayed, or -1 if the journal cannot be
+ *             opened (changes are then only saved on exit)
+ *
+ * A journal written against another snapshot is discarded, and so is a
+ * change cut short by a crash at the end of the file.
+ */
+int openJournal(const char *path, unsigned int generation, int syncEvery,
+                int *bookCount, int *readerCount, int *borrowingCount);
+
+/**
+ * @brief Records a book that was added or updated
+ * @param book The book, holding its new values
+ * @return void
+ */
+void journalBook(const Book *book);
+
+/**
+ * @brief Records a book that was deleted
+ * @param ISBN ISBN of the book
+ * @return void
+ */
+void journalBookDeleted(unsigned long long ISBN);
+
+/**
+ * @brief Records a reader that was added or updated
+ * @param reader The reader, holding its new values
+ * @return void
+ */
+void journalReader(const Reader *reader);
+
+/**
+ * @brief Records a reader that was deleted
+ * @param id ID of the reader
+ * @return void
+ */
+void journalReaderDeleted(int id);
+
+/**
+ * @brief Records a new borrowing
+ * @param borrowing The borrowing
+ * @return void
+ */
+void journalBorrowing(const Borrowing *borrowing);
+
+/**
+ * @brief Records that the books of a borrowing were returned
+ * @param index Row of the borrowing
+ * @param returnDate Time the books came back
+ * @return void
+ */
+void journalReturn(int index, time_t returnDate);
+
+/**
+ * @brief Writes the changes recorded since the last commit
+ * @return int 1 on success, 0 if the journal could not be written
+ *
+ * All pending changes go out in a single write; the file is synced once
+ * every syncEvery commits.
+ */
+int journalCommit(void);
+
+/**
+ * @brief Tells whether changes were recorded since the last checkpoint
+ * @return int 1 if there are changes a new snapshot would add, 0 otherwise
+ */
+int journalHasChanges(void);
+
+/**
+ * @brief Marks the point up to which a snapshot about to be written holds
+ *        every change
+ * @param generation Generation of the snapshot
+ * @return int 1 on success, 0 if the marker could not be written
+ */
+int journalCheckpoint(unsigned int generation);
+
+/**
+ * @brief Drops the records held by a snapshot a checkpoint finished writing
+ * @param generation Generation of the snapshot, as passed to journalCheckpoint
+ * @return int 1 on success, 0 on error (the records are then kept and
+ *             skipped on replay)
+ */
+int compactJournal(unsigned int generation);
+
+/**
+ * @brief Empties the journal after a snapshot was saved
+ * @param generation Generation of the snapshot just saved
+ * @return int 1 on success, 0 on error
+ */
+int resetJournal(unsigned int generation);
+
+/**
+ * @brief Commits pending changes, syncs and closes the journal
+ * @return void
+ */
+void closeJournal(void);
+
+#endif // JOURNAL_H
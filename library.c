@@ -1,34 +1,8 @@
+#include <errno.h>
+#include <limits.h>
 #include "library.h"
-
-// Global array definitions
-char bookISBN[MAX_BOOKS][MAX_STRING];
-char bookTitle[MAX_BOOKS][MAX_STRING];
-char bookAuthor[MAX_BOOKS][MAX_STRING];
-char bookPublisher[MAX_BOOKS][MAX_STRING];
-int bookPublishYear[MAX_BOOKS];
-char bookCategory[MAX_BOOKS][MAX_STRING];
-float bookPrice[MAX_BOOKS];
-int bookQuantity[MAX_BOOKS];
-
-int readerID[MAX_READERS];
-char readerName[MAX_READERS][MAX_STRING];
-char readerEmail[MAX_READERS][MAX_STRING];
-char readerPhone[MAX_READERS][MAX_STRING];
-char readerAddress[MAX_READERS][MAX_STRING];
-int readerMembershipYear[MAX_READERS];
-char readerCMND[MAX_READERS][MAX_STRING];
-char readerBirthDate[MAX_READERS][11];
-char readerGender[MAX_READERS][10];
-time_t readerCardIssueDate[MAX_READERS];
-time_t readerCardExpiryDate[MAX_READERS];
-
-int borrowingReaderID[MAX_BORROWINGS];
-time_t borrowingDate[MAX_BORROWINGS];
-time_t dueDate[MAX_BORROWINGS];
-time_t returnDate[MAX_BORROWINGS];
-int borrowingBookCount[MAX_BORROWINGS];
-char borrowingBooks[MAX_BORROWINGS][MAX_BOOKS_PER_READER][MAX_STRING];
-int isReturned[MAX_BORROWINGS];
+#include "journal.h"
+#include "checkpoint.h"
 
 /**
  * @brief Clears the input buffer to prevent input issues
@@ -47,22 +21,42 @@ void clearInputBuffer() {
  * @param isbn ISBN string to validate
  * @return int 1 if valid, 0 if invalid
  * 
- * This function checks if the ISBN is exactly 10 digits.
+ * This function checks if the ISBN is 10 digits, or 13 digits starting with 978 or 979.
  */
 int isValidISBN(const char *isbn) {
-    if (strlen(isbn) != 10) {
+    unsigned long long ISBN;
+    return parseISBN(isbn, &ISBN);
+}
+
+/**
+ * @brief Parses a whole string as an integer
+ * @param text The string
+ * @param value Receives the number
+ * @return int 1 on success, 0 if the string is not an integer in range
+ */
+int parseInteger(const char *text, int *value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != 0 || errno != 0 || number < INT_MIN || number > INT_MAX) {
         return 0;
     }
-    
-    for (int i = 0; i < 10; i++) {
-        if (!isdigit(isbn[i])) {
-            return 0;
-        }
-    }
-    
+    *value = (int)number;
     return 1;
 }
 
+/**
+ * @brief Parses a whole string as a price
+ * @param text The string
+ * @param value Receives the price
+ * @return int 1 on success, 0 if the string is not a number
+ */
+int parsePrice(const char *text, float *value) {
+    char *end;
+    *value = strtof(text, &end);
+    return end != text && *end == 0;
+}
+
 /**
  * @brief Displays all borrowing records
  * @param borrowingCount Current number of borrowings
@@ -113,16 +107,16 @@ void borrowingManagement(int bookCount, int readerCount, int *borrowingCount) {
 
         switch (choice) {
             case 1:
-                createBorrowing(books, bookCount, readers, readerCount, borrowingCount);
+                createBorrowing(bookCount, readerCount, borrowingCount);
                 break;
             case 2:
-                returnBooks(books, bookCount, readers, readerCount, *borrowingCount);
+                returnBooks(bookCount, readerCount);
                 break;
             case 3:
                 displayBorrowings(*borrowingCount);
                 break;
             case 4:
-                displayOverdueBorrowings(*borrowingCount);
+                displayOverdueBorrowings(bookCount, *borrowingCount);
                 break;
             case 0:
                 printf("Returning to main menu...\n");
@@ -130,5 +124,7 @@ void borrowingManagement(int bookCount, int readerCount, int *borrowingCount) {
             default:
                 printf("Invalid choice!\n");
         }
+        journalCommit();
+        checkpointIfDue(bookCount, readerCount, *borrowingCount);
     } while (choice != 0);
 } 
\ No newline at end of file
@@ -11,47 +11,6 @@
 #include "reader.h"
 #include "borrowing.h"
 
-// Maximum lengths for strings
-#define MAX_STRING 100
-#define MAX_BOOKS 1000
-#define MAX_READERS 1000
-#define MAX_BORROWINGS 1000
-#define MAX_BOOKS_PER_READER 5
-#define MAX_DAYS 14
-#define FINE_PER_DAY 5000
-
-// Book data arrays
-extern char bookISBN[MAX_BOOKS][MAX_STRING];    // ISBN of each book
-extern char bookTitle[MAX_BOOKS][MAX_STRING];   // Title of each book
-extern char bookAuthor[MAX_BOOKS][MAX_STRING];  // Author of each book
-extern char bookPublisher[MAX_BOOKS][MAX_STRING]; // Publisher of each book
-extern int bookPublishYear[MAX_BOOKS];               // Publish year of each book
-extern char bookCategory[MAX_BOOKS][MAX_STRING]; // Category of each book
-extern float bookPrice[MAX_BOOKS];                   // Price of each book
-extern int bookQuantity[MAX_BOOKS];                  // Quantity of each book
-
-// Reader data arrays
-extern int readerID[MAX_READERS];                    // ID of each reader
-extern char readerName[MAX_READERS][MAX_STRING]; // Name of each reader
-extern char readerEmail[MAX_READERS][MAX_STRING]; // Email of each reader
-extern char readerPhone[MAX_READERS][MAX_STRING]; // Phone of each reader
-extern char readerAddress[MAX_READERS][MAX_STRING]; // Address of each reader
-extern int readerMembershipYear[MAX_READERS];        // Membership year of each reader
-extern char readerCMND[MAX_READERS][MAX_STRING];
-extern char readerBirthDate[MAX_READERS][11]; // Format: YYYY-MM-DD
-extern char readerGender[MAX_READERS][10]; // "Male" or "Female"
-extern time_t readerCardIssueDate[MAX_READERS];
-extern time_t readerCardExpiryDate[MAX_READERS];
-
-// Borrowing data arrays
-extern int borrowingReaderID[MAX_BORROWINGS];
-extern time_t borrowingDate[MAX_BORROWINGS];
-extern time_t dueDate[MAX_BORROWINGS];
-extern time_t returnDate[MAX_BORROWINGS];
-extern int borrowingBookCount[MAX_BORROWINGS];
-extern char borrowingBooks[MAX_BORROWINGS][MAX_BOOKS_PER_READER][MAX_STRING];
-extern int isReturned[MAX_BORROWINGS];
-
 // Function declarations with detailed comments
 
 /**
@@ -79,7 +38,7 @@ void updateBook(int bookCount);
  * @param bookCount Pointer to the current number of books
  * @return void
  * 
- * This function removes a book by ISBN and shifts remaining books to maintain array order.
+ * This function removes a book by ISBN, leaving its row free for the next added book.
  */
 void deleteBook(int *bookCount);
 
@@ -97,7 +56,8 @@ void searchBook(int bookCount);
  * @param bookCount Current number of books
  * @return void
  * 
- * This function shows a formatted list of all books in the system.
+ * This function shows a formatted list of all books in the system, one
+ * page at a time in ISBN order.
  */
 void displayAllBooks(int bookCount);
 
@@ -144,7 +104,8 @@ void searchReader(int readerCount);
  * @param readerCount Current number of readers
  * @return void
  * 
- * This function shows a formatted list of all readers in the system.
+ * This function shows a formatted list of all readers in the system, one
+ * page at a time in ID order.
  */
 void displayAllReaders(int readerCount);
 
@@ -153,17 +114,33 @@ void displayAllReaders(int readerCount);
  * @param ISBN The ISBN to validate
  * @return int 1 if valid, 0 if invalid
  * 
- * This function checks if the ISBN is exactly 13 digits.
+ * This function checks if the ISBN is 10 digits, or 13 digits starting with 978 or 979.
  */
 int isValidISBN(const char *ISBN);
 
+/**
+ * @brief Parses a whole string as an integer
+ * @param text The string
+ * @param value Receives the number
+ * @return int 1 on success, 0 if the string is not an integer in range
+ */
+int parseInteger(const char *text, int *value);
+
+/**
+ * @brief Parses a whole string as a price
+ * @param text The string
+ * @param value Receives the price
+ * @return int 1 on success, 0 if the string is not a number
+ */
+int parsePrice(const char *text, float *value);
+
 /**
  * @brief Finds a book by ISBN
  * @param bookCount Current number of books
  * @param ISBN The ISBN to search for
  * @return int Index of the book if found, -1 if not found
  */
-int findBookByISBN(int bookCount, const char *ISBN);
+int findBookByISBN(int bookCount, unsigned long long ISBN);
 
 /**
  * @brief Finds a reader by ID
@@ -187,7 +164,7 @@ void searchBookByISBN(int bookCount);
 void searchBookByAuthor(int bookCount);
 void searchReaderByCMND(int readerCount);
 void displayBorrowings(int borrowingCount);
-void displayOverdueBorrowings(int borrowingCount);
+void displayOverdueBorrowings(int bookCount, int borrowingCount);
 void displayBookStatistics(int bookCount);
 void displayReaderStatistics(int readerCount);
 void displayGenderStatistics(int readerCount);
@@ -195,7 +172,7 @@ void displayOverdueStatistics(int borrowingCount);
 int calculateFine(time_t dueDate, time_t returnDate);
 int calculateLostBookFine(float bookPrice);
 void displayCurrentlyBorrowedBooks(int borrowingCount);
-void searchBooksByReaderName(int borrowingCount);
+void searchBooksByReaderName(int bookCount, int readerCount);
 
 // Function declarations
 void displayMainMenu();
@@ -225,7 +202,7 @@ void displayAllReaders(int readerCount);
 // Borrowing management functions
 void borrowingManagement(int bookCount, int readerCount, int *borrowingCount);
 void displayBorrowings(int borrowingCount);
-void displayOverdueBorrowings(int borrowingCount);
+void displayOverdueBorrowings(int bookCount, int borrowingCount);
 
 // Statistics functions
 void statistics(int bookCount, int readerCount, int borrowingCount);
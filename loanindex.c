@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include "loanindex.h"
+
+/**
+ * @brief Grows arrays of ints, filling the new elements with -1
+ * @param first First array
+ * @param second Second array to grow alongside, or NULL
+ * @param capacity Current length of the arrays, updated on success
+ * @param needed Length the arrays must reach
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int growLists(int **first, int **second, int *capacity, int needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    int newCapacity = *capacity == 0 ? 64 : *capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    int **arrays[2] = { first, second };
+    for (int a = 0; a < 2 && arrays[a] != NULL; a++) {
+        int *grown = realloc(*arrays[a], sizeof(int) * (size_t)newCapacity);
+        if (grown == NULL) {
+            return 0;
+        }
+        for (int i = *capacity; i < newCapacity; i++) {
+            grown[i] = -1;
+        }
+        *arrays[a] = grown;
+    }
+    *capacity = newCapacity;
+    return 1;
+}
+
+// Adds a borrowing to the lists of its reader
+int loanIndexAdd(LoanIndex *index, int readerID, int row, int returned) {
+    if (readerID <= 0 ||
+        !growLists(&index->activeHead, &index->returnedHead, &index->idCapacity, readerID + 1) ||
+        !growLists(&index->next, NULL, &index->rowCapacity, row + 1)) {
+        return 0;
+    }
+    int *head = returned ? &index->returnedHead[readerID] : &index->activeHead[readerID];
+    index->next[row] = *head;
+    *head = row;
+    return 1;
+}
+
+// Moves a borrowing from the active loans to the returned ones
+void loanIndexReturn(LoanIndex *index, int readerID, int row) {
+    if (readerID <= 0 || readerID >= index->idCapacity) {
+        return;
+    }
+    int *link = &index->activeHead[readerID];
+    while (*link != -1 && *link != row) {
+        link = &index->next[*link];
+    }
+    if (*link == -1) {
+        return;
+    }
+    *link = index->next[row];
+    index->next[row] = index->returnedHead[readerID];
+    index->returnedHead[readerID] = row;
+}
+
+// Empties every list but keeps the memory
+void loanIndexClear(LoanIndex *index) {
+    for (int i = 0; i < index->idCapacity; i++) {
+        index->activeHead[i] = -1;
+        index->returnedHead[i] = -1;
+    }
+}
+
+// Returns the newest loan of a reader
+int loanIndexFirst(const LoanIndex *index, int readerID, int returned) {
+    if (readerID <= 0 || readerID >= index->idCapacity) {
+        return -1;
+    }
+    return returned ? index->returnedHead[readerID] : index->activeHead[readerID];
+}
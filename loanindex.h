@@ -0,0 +1,61 @@
+#ifndef LOANINDEX_H
+#define LOANINDEX_H
+
+// Borrowings of each reader ID, as two linked lists threaded through the
+// borrowing rows: loans still out and loans already returned. Each list
+// starts with the newest borrowing, so a reader's loans are found without
+// looking at anyone else's.
+typedef struct {
+    int *activeHead;            // First active loan of each ID, -1 if none
+    int *returnedHead;          // First returned loan of each ID, -1 if none
+    int idCapacity;             // Length of activeHead and returnedHead
+    int *next;                  // Next loan in the same list, per borrowing row
+    int rowCapacity;            // Length of next
+} LoanIndex;
+
+#define LOAN_INDEX_INIT { NULL, NULL, 0, NULL, 0 }
+
+/**
+ * @brief Adds a borrowing to the lists of its reader
+ * @param index The loan index
+ * @param readerID ID of the reader who made the borrowing
+ * @param row Row of the borrowing
+ * @param returned Non-zero if the books are already back
+ * @return int 1 on success, 0 if the ID is invalid or memory could not
+ *             be allocated
+ */
+int loanIndexAdd(LoanIndex *index, int readerID, int row, int returned);
+
+/**
+ * @brief Moves a borrowing from the active loans to the returned ones
+ * @param index The loan index
+ * @param readerID ID of the reader who made the borrowing
+ * @param row Row of the borrowing
+ * @return void
+ *
+ * Takes time proportional to the reader's active loans.
+ */
+void loanIndexReturn(LoanIndex *index, int readerID, int row);
+
+/**
+ * @brief Empties every list but keeps the memory
+ * @param index The loan index
+ * @return void
+ */
+void loanIndexClear(LoanIndex *index);
+
+/**
+ * @brief Returns the newest loan of a reader
+ * @param index The loan index
+ * @param readerID ID of the reader
+ * @param returned Non-zero for returned loans, zero for active ones
+ * @return int Row of the borrowing, or -1 if there is none
+ */
+int loanIndexFirst(const LoanIndex *index, int readerID, int returned);
+
+// Returns the next older loan in the same list, -1 after the last one
+static inline int loanIndexNext(const LoanIndex *index, int row) {
+    return index->next[row];
+}
+
+#endif // LOANINDEX_H
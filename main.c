@@ -1,8 +1,15 @@
+#include <unistd.h>
 #include "library.h"
 #include "reader.h"
 #include "book.h"
 #include "stats.h"
 #include "borrowing.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "checkpoint.h"
+#include "batch.h"
+#include "import.h"
+#include "export.h"
 
 /**
  * @brief Displays the main menu of the program
@@ -25,13 +32,15 @@ void displayMenu() {
 /**
  * @brief Displays and handles the book management menu
  * @param bookCount Pointer to the current number of books
+ * @param readerCount Current number of readers in the system
+ * @param borrowingCount Current number of borrowings in the system
  * @return void
  * 
  * This function shows the book management options and handles user input.
  * It provides options for adding, updating, deleting, searching, and
  * displaying books.
  */
-void bookManagementMenu(int *bookCount) {
+void bookManagementMenu(int *bookCount, int readerCount, int borrowingCount) {
     int choice;
     do {
         printf("\n=== Book Management ===\n");
@@ -42,6 +51,9 @@ void bookManagementMenu(int *bookCount) {
         printf("5. Search Book by ISBN\n");
         printf("6. Search Book by Author\n");
         printf("7. Display All Books\n");
+        printf("8. Filter Books by Year, Price and Stock\n");
+        printf("9. Browse Books by Year, Price or Quantity\n");
+        printf("10. Browse Books by Category, Publisher and Decade\n");
         printf("0. Back to Main Menu\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -69,25 +81,38 @@ void bookManagementMenu(int *bookCount) {
             case 7:
                 displayAllBooks(*bookCount);
                 break;
+            case 8:
+                filterBooks(*bookCount);
+                break;
+            case 9:
+                browseBooksByRange(*bookCount);
+                break;
+            case 10:
+                browseBooksByFacets(*bookCount);
+                break;
             case 0:
                 printf("Returning to main menu...\n");
                 break;
             default:
                 printf("Invalid choice! Please try again.\n");
         }
+        journalCommit();
+        checkpointIfDue(*bookCount, readerCount, borrowingCount);
     } while (choice != 0);
 }
 
 /**
  * @brief Displays and handles the reader management menu
+ * @param bookCount Current number of books in the system
  * @param readerCount Pointer to the current number of readers
+ * @param borrowingCount Current number of borrowings in the system
  * @return void
  * 
  * This function shows the reader management options and handles user input.
  * It provides options for adding, updating, deleting, searching, and
  * displaying readers.
  */
-void readerManagementMenu(int *readerCount) {
+void readerManagementMenu(int bookCount, int *readerCount, int borrowingCount) {
     int choice;
     do {
         printf("\n=== Reader Management ===\n");
@@ -120,7 +145,7 @@ void readerManagementMenu(int *readerCount) {
                 searchReaderByCMND(*readerCount);
                 break;
             case 6:
-                searchBooksByReaderName(*readerCount);
+                searchBooksByReaderName(bookCount, *readerCount);
                 break;
             case 7:
                 displayAllReaders(*readerCount);
@@ -131,6 +156,8 @@ void readerManagementMenu(int *readerCount) {
             default:
                 printf("Invalid choice! Please try again.\n");
         }
+        journalCommit();
+        checkpointIfDue(bookCount, *readerCount, borrowingCount);
     } while (choice != 0);
 }
 
@@ -160,16 +187,16 @@ void borrowingManagementMenu(int bookCount, int readerCount, int *borrowingCount
 
         switch (choice) {
             case 1:
-                createBorrowing(books, bookCount, readers, readerCount, borrowingCount);
+                createBorrowing(bookCount, readerCount, borrowingCount);
                 break;
             case 2:
-                returnBooks(books, bookCount, readers, readerCount, *borrowingCount);
+                returnBooks(bookCount, readerCount);
                 break;
             case 3:
                 displayBorrowings(*borrowingCount);
                 break;
             case 4:
-                displayOverdueBorrowings(*borrowingCount);
+                displayOverdueBorrowings(bookCount, *borrowingCount);
                 break;
             case 0:
                 printf("Returning to main menu...\n");
@@ -177,6 +204,8 @@ void borrowingManagementMenu(int bookCount, int readerCount, int *borrowingCount
             default:
                 printf("Invalid choice! Please try again.\n");
         }
+        journalCommit();
+        checkpointIfDue(bookCount, readerCount, *borrowingCount);
     } while (choice != 0);
 }
 
@@ -200,6 +229,8 @@ void statisticsMenu(int bookCount, int readerCount, int borrowingCount) {
         printf("3. Gender Statistics\n");
         printf("4. Overdue Statistics\n");
         printf("5. Currently Borrowed Books Statistics\n");
+        printf("6. Memory Usage\n");
+        printf("7. Custom Report (group by)\n");
         printf("0. Back to Main Menu\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -221,6 +252,12 @@ void statisticsMenu(int bookCount, int readerCount, int borrowingCount) {
             case 5:
                 displayCurrentlyBorrowedBooks(borrowingCount);
                 break;
+            case 6:
+                displayMemoryUsage(bookCount, borrowingCount);
+                break;
+            case 7:
+                displayCustomReport(bookCount, readerCount, borrowingCount);
+                break;
             case 0:
                 printf("Returning to main menu...\n");
                 break;
@@ -230,54 +267,239 @@ void statisticsMenu(int bookCount, int readerCount, int borrowingCount) {
     } while (choice != 0);
 }
 
+/**
+ * @brief Converts the text data files into a snapshot
+ * @return int 0 on success, 1 if the snapshot could not be written
+ */
+static int convertTextFiles(void) {
+    int bookCount = 0;
+    int readerCount = 0;
+    int borrowingCount = 0;
+    loadBooksFromFile(&bookCount);
+    loadReadersFromFile(&readerCount);
+    loadBorrowingsFromFile(&borrowingCount);
+    if (!saveSnapshot(SNAPSHOT_FILE, nextSnapshotGeneration(), bookCount, readerCount, borrowingCount)) {
+        return 1;
+    }
+    // Changes journaled against an older snapshot do not apply to this one
+    remove(JOURNAL_FILE);
+    printf("Converted %d books, %d readers and %d borrowings to %s.\n",
+           bookCount, liveReaderCount(), borrowingCount, SNAPSHOT_FILE);
+    return 0;
+}
+
 /**
  * @brief Main function of the program
+ * @param argc Number of command line arguments
+ * @param argv Command line arguments; --convert turns the text data files
+ *             into a snapshot and exits, --sync-every N syncs the journal
+ *             to disk once every N changes instead of after each one,
+ *             --checkpoint-every SECONDS sets how often a snapshot is
+ *             written in the background (0 turns it off), --batch FILE
+ *             runs the commands in FILE ("-" for standard input) instead
+ *             of showing the menus (see runBatch), --import-books FILE
+ *             and --import-readers FILE add the rows of CSV files (see
+ *             importBooks and importReaders), save the library and exit,
+ *             --export TABLE FILE writes a table as CSV, or as JSON lines
+ *             with --format jsonl, and exits; --fields LIST picks the
+ *             fields and each --where FIELD=VALUE filters the rows (see
+ *             exportTable); --bench-search TERM ROUNDS times the title
+ *             search kernels on the loaded books and exits (see
+ *             benchmarkTitleSearch)
  * @return int 0 on successful execution
  * 
  * This function initializes the program and handles the main menu loop.
  * It manages the overall program flow and user interaction.
+ * Data is loaded from the snapshot when there is one and from the text
+ * files otherwise, then the journal of changes made since is replayed.
+ * Every change is appended to the journal as it is made and folded into
+ * a new snapshot by the checkpointer; on exit the snapshot is saved and
+ * the journal emptied.
  */
-int main() {
+int main(int argc, char *argv[]) {
     int bookCount = 0;
     int readerCount = 0;
     int borrowingCount = 0;
+    int syncEvery = 1;
+    int checkpointEvery = CHECKPOINT_INTERVAL;
+    const char *batchPath = NULL;
+    const char *importBooksPath = NULL;
+    const char *importReadersPath = NULL;
+    const char *exportName = NULL;
+    const char *exportPath = NULL;
+    const char *exportFields = NULL;
+    const char *benchTerm = NULL;
+    int benchRounds = 0;
+    ExportFormat exportFormat = EXPORT_CSV;
+    char *exportFilters[EXPORT_MAX_FILTERS];
+    int exportFilterCount = 0;
+    int status = 0;
     int choice;
 
-    // Load data from files
-    loadBooksFromFile(&bookCount);
-    loadReadersFromFile(&readerCount);
-    loadBorrowingsFromFile(&borrowingCount);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--convert") == 0) {
+            return convertTextFiles();
+        } else if (strcmp(argv[i], "--sync-every") == 0 && i + 1 < argc) {
+            syncEvery = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpointEvery = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (strcmp(argv[i], "--import-books") == 0 && i + 1 < argc) {
+            importBooksPath = argv[++i];
+        } else if (strcmp(argv[i], "--import-readers") == 0 && i + 1 < argc) {
+            importReadersPath = argv[++i];
+        } else if (strcmp(argv[i], "--export") == 0 && i + 2 < argc) {
+            exportName = argv[++i];
+            exportPath = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "csv") == 0 || strcmp(argv[i + 1], "jsonl") == 0)) {
+            exportFormat = strcmp(argv[++i], "csv") == 0 ? EXPORT_CSV : EXPORT_JSONL;
+        } else if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+            exportFields = argv[++i];
+        } else if (strcmp(argv[i], "--bench-search") == 0 && i + 2 < argc) {
+            benchTerm = argv[++i];
+            benchRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--where") == 0 && i + 1 < argc && exportFilterCount < EXPORT_MAX_FILTERS) {
+            exportFilters[exportFilterCount++] = argv[++i];
+        } else {
+            printf("Usage: %s [--convert] [--sync-every N] [--checkpoint-every SECONDS] [--batch FILE]\n"
+                   "       [--import-books FILE] [--import-readers FILE]\n"
+                   "       [--export books|readers|borrowings FILE [--format csv|jsonl] [--fields LIST]\n"
+                   "        [--where FIELD=VALUE]...] [--bench-search TERM ROUNDS]\n", argv[0]);
+            return 1;
+        }
+    }
 
-    do {
-        displayMenu();
-        scanf("%d", &choice);
-        clearInputBuffer();
+    // Imported rows are only saved on exit, so no changes may be
+    // journaled after them
+    int importing = importBooksPath != NULL || importReadersPath != NULL;
+    if (importing && batchPath != NULL) {
+        printf("--batch cannot be combined with --import-books or --import-readers.\n");
+        return 1;
+    }
+    if ((exportName != NULL || benchTerm != NULL) && (importing || batchPath != NULL)) {
+        printf("--export and --bench-search cannot be combined with --batch or an import.\n");
+        return 1;
+    }
 
-        switch (choice) {
-            case 1:
-                bookManagementMenu(&bookCount);
-                break;
-            case 2:
-                readerManagementMenu(&readerCount);
-                break;
-            case 3:
-                borrowingManagementMenu(bookCount, readerCount, &borrowingCount);
-                break;
-            case 4:
-                statisticsMenu(bookCount, readerCount, borrowingCount);
-                break;
-            case 0:
-                printf("Thank you for using the Library Management System!\n");
-                break;
-            default:
-                printf("Invalid choice! Please try again.\n");
+    // Commands come from the batch file instead of the menus
+    FILE *batchInput = NULL;
+    FILE *batchResults = NULL;
+    if (batchPath != NULL) {
+        batchInput = strcmp(batchPath, "-") == 0 ? stdin : fopen(batchPath, "r");
+        if (batchInput == NULL) {
+            printf("Cannot open batch file %s.\n", batchPath);
+            return 1;
         }
-    } while (choice != 0);
+        batchResults = openBatchResults();
+    }
+
+    // Rows go to the export file instead of the menus
+    int exportFile = -1;
+    if (exportName != NULL) {
+        exportFile = openExportOutput(exportPath);
+        if (exportFile == -1) {
+            return 1;
+        }
+    }
 
-    // Save data to files
-    saveBooksToFile(bookCount);
-    saveReadersToFile(readerCount);
-    saveBorrowingsToFile(borrowingCount);
+    // Load data from the snapshot, or from the text files if there is none
+    int fromSnapshot = loadSnapshot(SNAPSHOT_FILE, &bookCount, &readerCount, &borrowingCount);
+    if (!fromSnapshot) {
+        loadBooksFromFile(&bookCount);
+        loadReadersFromFile(&readerCount);
+        loadBorrowingsFromFile(&borrowingCount);
+    }
+    int journaled = openJournal(JOURNAL_FILE, snapshotGeneration(), syncEvery,
+                                &bookCount, &readerCount, &borrowingCount) != -1;
 
-    return 0;
-} 
\ No newline at end of file
+    // An export changes nothing, so there is nothing to save afterwards
+    if (exportFile != -1) {
+        int written = exportTable(exportFile, exportName, exportFormat, exportFields, exportFilters,
+                                  exportFilterCount, bookCount, readerCount, borrowingCount);
+        if (close(exportFile) != 0 && written != -1) {
+            printf("Error writing %s.\n", exportPath);
+            written = -1;
+        }
+        if (written != -1) {
+            printf("Exported %d %s to %s.\n", written, exportName, exportPath);
+        }
+        closeJournal();
+        return written == -1 ? 1 : 0;
+    }
+    // A benchmark only reads the books, like an export
+    if (benchTerm != NULL) {
+        int differ = benchmarkTitleSearch(bookCount, benchTerm, benchRounds);
+        closeJournal();
+        return differ;
+    }
+    if (journaled && !importing) {
+        startCheckpointer(checkpointEvery);
+    }
+
+    // Imported rows are not journaled, the library is saved right after
+    if (importBooksPath != NULL && importBooks(importBooksPath, &bookCount) == -1) {
+        status = 1;
+    }
+    if (importReadersPath != NULL && importReaders(importReadersPath, &readerCount) == -1) {
+        status = 1;
+    }
+
+    if (batchInput != NULL) {
+        runBatch(batchInput, batchResults, &bookCount, readerCount, &borrowingCount);
+        if (batchInput != stdin) {
+            fclose(batchInput);
+        }
+    } else if (!importing) {
+        do {
+            displayMenu();
+            scanf("%d", &choice);
+            clearInputBuffer();
+
+            switch (choice) {
+                case 1:
+                    bookManagementMenu(&bookCount, readerCount, borrowingCount);
+                    break;
+                case 2:
+                    readerManagementMenu(bookCount, &readerCount, borrowingCount);
+                    break;
+                case 3:
+                    borrowingManagementMenu(bookCount, readerCount, &borrowingCount);
+                    break;
+                case 4:
+                    statisticsMenu(bookCount, readerCount, borrowingCount);
+                    break;
+                case 0:
+                    printf("Thank you for using the Library Management System!\n");
+                    break;
+                default:
+                    printf("Invalid choice! Please try again.\n");
+            }
+            checkpointIfDue(bookCount, readerCount, borrowingCount);
+        } while (choice != 0);
+    }
+
+    // Save data to the snapshot, falling back to the text files
+    stopCheckpointer();
+    unsigned int generation = nextSnapshotGeneration();
+    if (saveSnapshot(SNAPSHOT_FILE, generation, bookCount, readerCount, borrowingCount)) {
+        resetJournal(generation);
+        printf("Library saved to %s.\n", SNAPSHOT_FILE);
+    } else {
+        saveBooksToFile(bookCount);
+        saveReadersToFile(readerCount);
+        saveBorrowingsToFile(borrowingCount);
+        // Without a snapshot the text files are what the journal replays
+        // over, and they now hold every change
+        if (!fromSnapshot) {
+            resetJournal(0);
+        }
+    }
+    closeJournal();
+    if (batchResults != NULL) {
+        fclose(batchResults);
+    }
+
+    return status;
+}
@@ -0,0 +1,82 @@
+#include "normalize.h"
+
+// Base letter of U+00C0..U+024F and U+1E00..U+1EFF, '.' when the
+// character has none and is copied unchanged
+static const char latinFold[] =
+    "aaaaaa.ceeeeiiii.nooooo.ouuuuy..aaaaaa.ceeeeiiii.nooooo.ouuuuy.y"
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii..jjkk.llllll."
+    ".llnnnnnn...oooooo..rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzz."
+    "b......................i........oo.............uu....zz........."
+    ".............aaiioouuuuuuuuuu.aaaa....ggkkoooo..j...gg..nnaa...."
+    "aaaaeeeeiiiioooorrrruuuusstt..hh......aaeeooooooooyy............"
+    "................";
+
+static const char latinExtendedFold[] =
+    "aabbbbbbccddddddddddeeeeeeeeeeffgghhhhhhhhhhiiiikkkkkkllllllllmm"
+    "mmmmnnnnnnnnoooooooopppprrrrrrrrssssssssssttttttttuuuuuuuuuuvvvv"
+    "wwwwwwwwwwxxxxyyzzzzzzhtwy......aaaaaaaaaaaaaaaaaaaaaaaaeeeeeeee"
+    "eeeeeeeeiiiioooooooooooooooooooooooouuuuuuuuuuuuuuyyyyyyyy......";
+
+/**
+ * @brief Decodes one UTF-8 character
+ * @param text Pointer to the first byte
+ * @param length Receives the number of bytes used
+ * @return unsigned int The code point, or the byte itself if it is not valid UTF-8
+ */
+static unsigned int decodeUTF8(const unsigned char *text, int *length) {
+    if (text[0] < 0x80) {
+        *length = 1;
+        return text[0];
+    }
+    if ((text[0] & 0xE0) == 0xC0 && (text[1] & 0xC0) == 0x80) {
+        *length = 2;
+        return ((text[0] & 0x1Fu) << 6) | (text[1] & 0x3Fu);
+    }
+    if ((text[0] & 0xF0) == 0xE0 && (text[1] & 0xC0) == 0x80 && (text[2] & 0xC0) == 0x80) {
+        *length = 3;
+        return ((text[0] & 0x0Fu) << 12) | ((text[1] & 0x3Fu) << 6) | (text[2] & 0x3Fu);
+    }
+    *length = 1;
+    return text[0];
+}
+
+/**
+ * @brief Builds the search key of a text
+ * @param text UTF-8 text to normalize
+ * @param key Receives the key, NUL-terminated
+ * @param keySize Size of the key buffer
+ * @return void
+ */
+void normalizeText(const char *text, char *key, size_t keySize) {
+    const unsigned char *in = (const unsigned char *)text;
+    size_t out = 0;
+    while (*in && out + 1 < keySize) {
+        int length;
+        unsigned int codePoint = decodeUTF8(in, &length);
+        char folded = '.';
+        if (codePoint < 0x80) {
+            folded = (codePoint >= 'A' && codePoint <= 'Z') ? (char)(codePoint + 32) : (char)codePoint;
+        } else if (codePoint >= 0x0300 && codePoint <= 0x036F) {
+            // Combining marks of decomposed text are dropped
+            in += length;
+            continue;
+        } else if (codePoint >= 0x00C0 && codePoint <= 0x024F) {
+            folded = latinFold[codePoint - 0x00C0];
+        } else if (codePoint >= 0x1E00 && codePoint <= 0x1EFF) {
+            folded = latinExtendedFold[codePoint - 0x1E00];
+        }
+
+        if (codePoint < 0x80 || folded != '.') {
+            key[out++] = folded;
+        } else {
+            if (out + length >= keySize) {
+                break;
+            }
+            for (int i = 0; i < length; i++) {
+                key[out++] = (char)in[i];
+            }
+        }
+        in += length;
+    }
+    key[out] = '\0';
+}
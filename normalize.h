@@ -0,0 +1,21 @@
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <stddef.h>
+
+/**
+ * @brief Builds the search key of a text
+ * @param text UTF-8 text to normalize
+ * @param key Receives the key, NUL-terminated
+ * @param keySize Size of the key buffer
+ * @return void
+ *
+ * The key is case-folded and stripped of diacritics, so "Tiếng Việt",
+ * "TIENG VIET" and "tieng viet" share the key "tieng viet". Vietnamese and
+ * other Latin letters fold to their ASCII base letter; characters
+ * without a base letter are copied unchanged. The key is never longer
+ * than the text.
+ */
+void normalizeText(const char *text, char *key, size_t keySize);
+
+#endif // NORMALIZE_H
@@ -0,0 +1,182 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "output.h"
+#include "date.h"
+
+// Buffer of the screens, reused by every screen
+static char screenData[OUTPUT_BUFFER_SIZE];
+static OutputBuffer screen = OUTPUT_BUFFER(STDOUT_FILENO, screenData);
+
+// Writes an integer in decimal
+int formatNumber(long long number, char *text) {
+    char digits[20];
+    int count = 0;
+    unsigned long long value = number < 0 ? 0ULL - (unsigned long long)number : (unsigned long long)number;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    char *p = text;
+    if (number < 0) {
+        *p++ = '-';
+    }
+    while (count > 0) {
+        *p++ = digits[--count];
+    }
+    *p = 0;
+    return (int)(p - text);
+}
+
+// Writes a price with two decimals, as printf's "%.2f" does
+int formatPrice(double price, char *text) {
+    // Also catches NaN
+    if (!(price > -1e15 && price < 1e15)) {
+        return snprintf(text, NUMBER_LENGTH, "%.6g", price);
+    }
+    char *p = text;
+    if (signbit(price)) {
+        *p++ = '-';
+        price = -price;
+    }
+    // The whole part is taken off first so scaling the fraction keeps its
+    // precision; for prices held as floats the scaling is exact, so
+    // halfway cases are seen as such
+    long long whole = (long long)price;
+    double scaled = (price - (double)whole) * 100;
+    long long cents = (long long)scaled;
+    double rest = scaled - (double)cents;
+    if (rest > 0.5 || (rest == 0.5 && cents % 2 == 1)) {
+        cents++;
+    }
+    cents += whole * 100;
+    p += formatNumber(cents / 100, p);
+    *p++ = '.';
+    *p++ = (char)('0' + cents % 100 / 10);
+    *p++ = (char)('0' + cents % 10);
+    *p = 0;
+    return (int)(p - text);
+}
+
+// Writes a timestamp as YYYY-MM-DD HH:MM:SS
+int formatTime(time_t time, char *text) {
+    int day = dayFromTime(time);
+    int seconds = (int)(time - timeFromDay(day));
+    int parts[3] = { seconds / 3600, seconds / 60 % 60, seconds % 60 };
+    formatDate(day, text);
+    char *p = text + DATE_LENGTH - 1;
+    for (int i = 0; i < 3; i++) {
+        *p++ = i == 0 ? ' ' : ':';
+        *p++ = (char)('0' + parts[i] / 10);
+        *p++ = (char)('0' + parts[i] % 10);
+    }
+    *p = 0;
+    return (int)(p - text);
+}
+
+// Returns the buffer the screens write to standard output through
+OutputBuffer *screenOutput(void) {
+    fflush(stdout);
+    screen.used = 0;
+    screen.ok = 1;
+    return &screen;
+}
+
+/**
+ * @brief Writes every byte of several blocks, retrying short writes
+ * @param fd The file descriptor
+ * @param parts The blocks; changed as they are written
+ * @param count Number of blocks
+ * @return int 1 on success, 0 if a write failed
+ */
+static int writeParts(int fd, struct iovec *parts, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        while (count > 0 && (size_t)written >= parts->iov_len) {
+            written -= (ssize_t)parts->iov_len;
+            parts++;
+            count--;
+        }
+        if (count > 0) {
+            parts->iov_base = (char *)parts->iov_base + written;
+            parts->iov_len -= (size_t)written;
+        }
+    }
+    return 1;
+}
+
+// Writes the collected output
+void outputFlush(OutputBuffer *out) {
+    if (out->ok && out->used > 0) {
+        struct iovec part = { out->data, out->used };
+        out->ok = writeParts(out->fd, &part, 1);
+    }
+    out->used = 0;
+}
+
+// Appends bytes to the output, writing it out when the buffer fills
+void outputBytes(OutputBuffer *out, const char *bytes, size_t size) {
+    if (out->used + size <= OUTPUT_BUFFER_SIZE) {
+        memcpy(out->data + out->used, bytes, size);
+        out->used += size;
+        return;
+    }
+    if (size < OUTPUT_BUFFER_SIZE) {
+        outputFlush(out);
+        memcpy(out->data, bytes, size);
+        out->used = size;
+        return;
+    }
+    // A value longer than the buffer goes straight out after it
+    if (out->ok) {
+        struct iovec parts[2] = { { out->data, out->used }, { (void *)bytes, size } };
+        out->ok = writeParts(out->fd, parts, 2);
+    }
+    out->used = 0;
+}
+
+// Appends a string to the output
+void outputText(OutputBuffer *out, const char *text) {
+    outputBytes(out, text, strlen(text));
+}
+
+// Appends a label, a string and a line break to the output
+void outputLine(OutputBuffer *out, const char *label, const char *text) {
+    outputText(out, label);
+    outputText(out, text);
+    outputBytes(out, "\n", 1);
+}
+
+// Appends an integer to the output
+void outputNumber(OutputBuffer *out, long long number) {
+    char text[NUMBER_LENGTH];
+    outputBytes(out, text, (size_t)formatNumber(number, text));
+}
+
+// Appends a price with two decimals to the output
+void outputPrice(OutputBuffer *out, double price) {
+    char text[NUMBER_LENGTH];
+    outputBytes(out, text, (size_t)formatPrice(price, text));
+}
+
+// Appends a day number as YYYY-MM-DD to the output
+void outputDate(OutputBuffer *out, int day) {
+    char text[DATE_LENGTH];
+    formatDate(day, text);
+    outputText(out, text);
+}
+
+// Appends a timestamp as YYYY-MM-DD HH:MM:SS to the output
+void outputTime(OutputBuffer *out, time_t time) {
+    char text[TIME_LENGTH];
+    outputBytes(out, text, (size_t)formatTime(time, text));
+}
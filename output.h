@@ -0,0 +1,137 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Bytes collected before each write to the output
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// Room for the text of a number or a price and the terminator
+#define NUMBER_LENGTH 24
+
+// Room for "YYYY-MM-DD HH:MM:SS" and the terminator
+#define TIME_LENGTH 20
+
+// Text collected in memory and written to a file descriptor in large
+// blocks. Screens, reports and exports format their rows into one with
+// the output* functions instead of calling printf for every field, so a
+// listing of thousands of rows costs a few writes; numbers, prices and
+// dates are formatted by hand rather than through the locale-aware stdio
+// code. A value too large for the buffer is written together with what
+// was collected in one writev.
+typedef struct {
+    int fd;
+    char *data;                 // OUTPUT_BUFFER_SIZE bytes
+    size_t used;
+    int ok;                     // Cleared by a failed write
+} OutputBuffer;
+
+#define OUTPUT_BUFFER(fd, data) { fd, data, 0, 1 }
+
+/**
+ * @brief Writes an integer in decimal
+ * @param number The number
+ * @param text Buffer of at least NUMBER_LENGTH bytes
+ * @return int Length of the text
+ */
+int formatNumber(long long number, char *text);
+
+/**
+ * @brief Writes a price with two decimals, as printf's "%.2f" does
+ * @param price The price
+ * @param text Buffer of at least NUMBER_LENGTH bytes
+ * @return int Length of the text
+ *
+ * Halfway cases round to even like printf. Values too large to count in
+ * cents are written by snprintf in %g form instead.
+ */
+int formatPrice(double price, char *text);
+
+/**
+ * @brief Writes a timestamp as YYYY-MM-DD HH:MM:SS
+ * @param time The timestamp, as a wall-clock time counted from 1970-01-01
+ *             (add localTimeOffset for local time)
+ * @param text Buffer of at least TIME_LENGTH bytes
+ * @return int Length of the text
+ */
+int formatTime(time_t time, char *text);
+
+/**
+ * @brief Returns the buffer the screens write to standard output through
+ * @return OutputBuffer* The buffer, empty
+ *
+ * The buffer is allocated once and reused by every screen. Whatever
+ * printf has buffered is flushed first, so the rows come after the
+ * prompts; call outputFlush before printing with printf again.
+ */
+OutputBuffer *screenOutput(void);
+
+/**
+ * @brief Writes the collected output
+ * @param out The buffer
+ * @return void
+ *
+ * After a failed write ok is cleared and later output is dropped.
+ */
+void outputFlush(OutputBuffer *out);
+
+/**
+ * @brief Appends bytes to the output, writing it out when the buffer fills
+ * @param out The buffer
+ * @param bytes The bytes
+ * @param size Number of bytes
+ * @return void
+ */
+void outputBytes(OutputBuffer *out, const char *bytes, size_t size);
+
+/**
+ * @brief Appends a string to the output
+ * @param out The buffer
+ * @param text The string
+ * @return void
+ */
+void outputText(OutputBuffer *out, const char *text);
+
+/**
+ * @brief Appends a label, a string and a line break to the output
+ * @param out The buffer
+ * @param label The label, such as "Title: "
+ * @param text The string
+ * @return void
+ */
+void outputLine(OutputBuffer *out, const char *label, const char *text);
+
+/**
+ * @brief Appends an integer to the output
+ * @param out The buffer
+ * @param number The number
+ * @return void
+ */
+void outputNumber(OutputBuffer *out, long long number);
+
+/**
+ * @brief Appends a price with two decimals to the output
+ * @param out The buffer
+ * @param price The price
+ * @return void
+ */
+void outputPrice(OutputBuffer *out, double price);
+
+/**
+ * @brief Appends a day number as YYYY-MM-DD to the output
+ * @param out The buffer
+ * @param day The day number; nothing is written for DATE_UNKNOWN
+ * @return void
+ */
+void outputDate(OutputBuffer *out, int day);
+
+/**
+ * @brief Appends a timestamp as YYYY-MM-DD HH:MM:SS to the output
+ * @param out The buffer
+ * @param time The timestamp (see formatTime)
+ * @return void
+ */
+void outputTime(OutputBuffer *out, time_t time);
+
+#endif // OUTPUT_H
@@ -0,0 +1,337 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rangeindex.h"
+
+// Orders two entries by key, then by row
+static int compareEntries(const RangeEntry *a, const RangeEntry *b) {
+    if (a->key != b->key) {
+        return a->key < b->key ? -1 : 1;
+    }
+    return (a->row > b->row) - (a->row < b->row);
+}
+
+static int compareEntriesForSort(const void *a, const void *b) {
+    return compareEntries(a, b);
+}
+
+/**
+ * @brief Finds the leaf an entry belongs in
+ * @param index The range index, with at least one leaf
+ * @param entry The entry
+ * @return int The first leaf whose last entry does not order before the
+ *             entry, or the last leaf if every entry does
+ */
+static int findLeaf(const RangeIndex *index, const RangeEntry *entry) {
+    int low = 0;
+    int high = index->leafCount - 1;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        const RangeLeaf *leaf = &index->leaves[middle];
+        if (compareEntries(&leaf->entries[leaf->count - 1], entry) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Finds the position of the first entry of a leaf not ordering
+ *        before an entry
+ * @param leaf The leaf
+ * @param entry The entry
+ * @return int The position, leaf->count if every entry orders before it
+ */
+static int lowerBound(const RangeLeaf *leaf, const RangeEntry *entry) {
+    int low = 0;
+    int high = leaf->count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (compareEntries(&leaf->entries[middle], entry) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Adds an empty leaf to the directory
+ * @param index The range index
+ * @param position Position of the new leaf in the directory
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int insertLeaf(RangeIndex *index, int position) {
+    if (index->leafCount == index->leafCapacity) {
+        int capacity = index->leafCapacity == 0 ? 16 : index->leafCapacity * 2;
+        RangeLeaf *leaves = realloc(index->leaves, sizeof(RangeLeaf) * capacity);
+        if (leaves == NULL) {
+            return 0;
+        }
+        index->leaves = leaves;
+        index->leafCapacity = capacity;
+    }
+    RangeEntry *entries = malloc(sizeof(RangeEntry) * RANGE_LEAF_SIZE);
+    if (entries == NULL) {
+        return 0;
+    }
+    memmove(&index->leaves[position + 1], &index->leaves[position],
+            sizeof(RangeLeaf) * (index->leafCount - position));
+    index->leaves[position].entries = entries;
+    index->leaves[position].count = 0;
+    index->leafCount++;
+    return 1;
+}
+
+/**
+ * @brief Adds an entry, splitting its leaf in two if it is full
+ * @param index The range index
+ * @param entry The entry
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int insertEntry(RangeIndex *index, RangeEntry entry) {
+    if (index->leafCount == 0 && !insertLeaf(index, 0)) {
+        return 0;
+    }
+    int position = findLeaf(index, &entry);
+    if (index->leaves[position].count == RANGE_LEAF_SIZE) {
+        if (!insertLeaf(index, position + 1)) {
+            return 0;
+        }
+        RangeLeaf *left = &index->leaves[position];
+        RangeLeaf *right = &index->leaves[position + 1];
+        int half = RANGE_LEAF_SIZE / 2;
+        memcpy(right->entries, left->entries + half, sizeof(RangeEntry) * (RANGE_LEAF_SIZE - half));
+        right->count = RANGE_LEAF_SIZE - half;
+        left->count = half;
+        if (compareEntries(&entry, &left->entries[half - 1]) > 0) {
+            position++;
+        }
+    }
+    RangeLeaf *leaf = &index->leaves[position];
+    int at = lowerBound(leaf, &entry);
+    memmove(&leaf->entries[at + 1], &leaf->entries[at], sizeof(RangeEntry) * (leaf->count - at));
+    leaf->entries[at] = entry;
+    leaf->count++;
+    index->size++;
+    return 1;
+}
+
+/**
+ * @brief Removes an entry, dropping its leaf once it is empty
+ * @param index The range index
+ * @param entry The entry; nothing happens if it is not in the index
+ * @return void
+ */
+static void removeEntry(RangeIndex *index, RangeEntry entry) {
+    if (index->leafCount == 0) {
+        return;
+    }
+    int position = findLeaf(index, &entry);
+    RangeLeaf *leaf = &index->leaves[position];
+    int at = lowerBound(leaf, &entry);
+    if (at == leaf->count || compareEntries(&leaf->entries[at], &entry) != 0) {
+        return;
+    }
+    memmove(&leaf->entries[at], &leaf->entries[at + 1], sizeof(RangeEntry) * (leaf->count - at - 1));
+    leaf->count--;
+    index->size--;
+    if (leaf->count == 0) {
+        free(leaf->entries);
+        memmove(&index->leaves[position], &index->leaves[position + 1],
+                sizeof(RangeLeaf) * (index->leafCount - position - 1));
+        index->leafCount--;
+    }
+}
+
+// Adds a row to every index of a table
+int rangeIndexesInsert(RangeIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        RangeEntry entry = { indexes[i].key(row), row };
+        if (!insertEntry(&indexes[i], entry)) {
+            rangeIndexesRemove(indexes, i, row);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Removes a row from every index of a table
+void rangeIndexesRemove(RangeIndex *indexes, int count, int row) {
+    for (int i = 0; i < count; i++) {
+        RangeEntry entry = { indexes[i].key(row), row };
+        removeEntry(&indexes[i], entry);
+    }
+}
+
+// Empties every index of a table and frees its leaves
+void rangeIndexesClear(RangeIndex *indexes, int count) {
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < indexes[i].leafCount; j++) {
+            free(indexes[i].leaves[j].entries);
+        }
+        free(indexes[i].leaves);
+        indexes[i].leaves = NULL;
+        indexes[i].leafCount = 0;
+        indexes[i].leafCapacity = 0;
+        indexes[i].size = 0;
+    }
+}
+
+// Fills every index of a table from a set of rows
+int rangeIndexesBuild(RangeIndex *indexes, int count, const int *rows, int rowCount) {
+    RangeEntry *sorted = malloc(sizeof(RangeEntry) * (rowCount + 1));
+    if (sorted == NULL) {
+        return 0;
+    }
+    int fill = RANGE_LEAF_SIZE * 3 / 4;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < rowCount; j++) {
+            int row = rows == NULL ? j : rows[j];
+            sorted[j].key = indexes[i].key(row);
+            sorted[j].row = row;
+        }
+        qsort(sorted, rowCount, sizeof(RangeEntry), compareEntriesForSort);
+        for (int j = 0; j < rowCount; j += fill) {
+            if (!insertLeaf(&indexes[i], indexes[i].leafCount)) {
+                free(sorted);
+                rangeIndexesClear(indexes, count);
+                return 0;
+            }
+            RangeLeaf *leaf = &indexes[i].leaves[indexes[i].leafCount - 1];
+            leaf->count = rowCount - j < fill ? rowCount - j : fill;
+            memcpy(leaf->entries, sorted + j, sizeof(RangeEntry) * leaf->count);
+        }
+        indexes[i].size = rowCount;
+    }
+    free(sorted);
+    return 1;
+}
+
+// Finds an index by its field name
+RangeIndex *findRangeIndex(RangeIndex *indexes, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(indexes[i].name, name) == 0) {
+            return &indexes[i];
+        }
+    }
+    return NULL;
+}
+
+// Visits the rows whose field lies in a range, in field order
+int rangeIndexVisit(const RangeIndex *index, double low, double high, int descending,
+                    RangeVisitor visit, void *context) {
+    int visited = 0;
+    if (index->leafCount == 0 || low > high) {
+        return 0;
+    }
+    if (!descending) {
+        RangeEntry first = { low, INT_MIN };
+        int position = findLeaf(index, &first);
+        int at = lowerBound(&index->leaves[position], &first);
+        for (; position < index->leafCount; position++, at = 0) {
+            const RangeLeaf *leaf = &index->leaves[position];
+            for (; at < leaf->count; at++) {
+                if (leaf->entries[at].key > high) {
+                    return visited;
+                }
+                visited++;
+                if (!visit(leaf->entries[at].row, context)) {
+                    return visited;
+                }
+            }
+        }
+        return visited;
+    }
+
+    // The last entry not ordering after the largest value wanted comes
+    // just before the lower bound of the entry after it
+    RangeEntry last = { high, INT_MAX };
+    int position = findLeaf(index, &last);
+    int at = lowerBound(&index->leaves[position], &last) - 1;
+    while (position >= 0) {
+        const RangeLeaf *leaf = &index->leaves[position];
+        for (; at >= 0; at--) {
+            if (leaf->entries[at].key < low) {
+                return visited;
+            }
+            visited++;
+            if (!visit(leaf->entries[at].row, context)) {
+                return visited;
+            }
+        }
+        position--;
+        if (position >= 0) {
+            at = index->leaves[position].count - 1;
+        }
+    }
+    return visited;
+}
+
+// Position of an entry: a leaf and a place in it
+typedef struct {
+    int leaf;
+    int at;
+} RangePosition;
+
+/**
+ * @brief Finds the position of the first entry not ordering before an entry
+ * @param index The range index, with at least one leaf
+ * @param entry The entry
+ * @return RangePosition The position; one past the last entry of the last
+ *                       leaf if every entry orders before it
+ */
+static RangePosition seekEntry(const RangeIndex *index, const RangeEntry *entry) {
+    RangePosition position;
+    position.leaf = findLeaf(index, entry);
+    position.at = lowerBound(&index->leaves[position.leaf], entry);
+    if (position.at == index->leaves[position.leaf].count && position.leaf < index->leafCount - 1) {
+        position.leaf++;
+        position.at = 0;
+    }
+    return position;
+}
+
+// Reads one page of rows in field order, starting from a cursor
+int rangeIndexPage(const RangeIndex *index, double cursor, RangePageStart start, int size, int *rows,
+                   int *hasPrevious, int *hasNext) {
+    *hasPrevious = 0;
+    *hasNext = 0;
+    if (index->leafCount == 0 || size <= 0) {
+        return 0;
+    }
+    // Rows are never INT_MAX, so seeking past it skips every entry with
+    // the cursor value
+    RangeEntry entry = { cursor, start == RANGE_PAGE_AFTER ? INT_MAX : INT_MIN };
+    RangePosition position = seekEntry(index, &entry);
+    if (start == RANGE_PAGE_BEFORE) {
+        for (int stepped = 0; stepped < size; stepped++) {
+            if (position.at > 0) {
+                position.at--;
+            } else if (position.leaf > 0) {
+                position.leaf--;
+                position.at = index->leaves[position.leaf].count - 1;
+            } else {
+                break;
+            }
+        }
+    }
+    *hasPrevious = position.leaf > 0 || position.at > 0;
+
+    int count = 0;
+    for (; position.leaf < index->leafCount; position.leaf++, position.at = 0) {
+        const RangeLeaf *leaf = &index->leaves[position.leaf];
+        for (; position.at < leaf->count; position.at++) {
+            if (count == size ||
+                (start == RANGE_PAGE_BEFORE && leaf->entries[position.at].key >= cursor)) {
+                *hasNext = 1;
+                return count;
+            }
+            rows[count++] = leaf->entries[position.at].row;
+        }
+    }
+    return count;
+}
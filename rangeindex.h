@@ -0,0 +1,137 @@
+#ifndef RANGEINDEX_H
+#define RANGEINDEX_H
+
+// Entries per leaf of a range index
+#define RANGE_LEAF_SIZE 256
+
+// Returns the value of the indexed field for a table row
+typedef double (*RangeKey)(int row);
+
+// One row of a range index; entries are ordered by key, then by row
+typedef struct {
+    double key;
+    int row;
+} RangeEntry;
+
+// A sorted run of entries
+typedef struct {
+    RangeEntry *entries;        // Room for RANGE_LEAF_SIZE entries
+    int count;
+} RangeLeaf;
+
+// Ordered index on one numeric field of a table: a two-level B+-tree
+// whose leaves hold sorted runs of entries and whose directory is the
+// sorted array of leaves. Finding a key is a binary search over the
+// directory and then inside one leaf; a range is read by walking the
+// leaves from there, so a query costs O(log n + k). Like FieldIndex,
+// tables declare an array of these and call the rangeIndexes* functions
+// whenever a row is added, changed or removed.
+typedef struct {
+    const char *name;           // Field name used in queries
+    RangeKey key;               // Reads the field from a row
+    RangeLeaf *leaves;
+    int leafCount;
+    int leafCapacity;
+    int size;                   // Number of entries
+} RangeIndex;
+
+#define RANGE_INDEX(name, key) { name, key, NULL, 0, 0, 0 }
+
+// Receives the rows of a range query; returns 0 to stop the query
+typedef int (*RangeVisitor)(int row, void *context);
+
+// Where a page of an index starts relative to its cursor value
+typedef enum {
+    RANGE_PAGE_FROM,            // The first rows whose field is at least the cursor
+    RANGE_PAGE_AFTER,           // The first rows whose field is above the cursor
+    RANGE_PAGE_BEFORE           // The last rows whose field is below the cursor
+} RangePageStart;
+
+/**
+ * @brief Adds a row to every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to add
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * On failure the row is taken out of the indexes it was already added to.
+ */
+int rangeIndexesInsert(RangeIndex *indexes, int count, int row);
+
+/**
+ * @brief Removes a row from every index of a table
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param row The row to remove, still holding its indexed values
+ * @return void
+ */
+void rangeIndexesRemove(RangeIndex *indexes, int count, int row);
+
+/**
+ * @brief Empties every index of a table and frees its leaves
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @return void
+ */
+void rangeIndexesClear(RangeIndex *indexes, int count);
+
+/**
+ * @brief Fills every index of a table from a set of rows
+ * @param indexes The table's indexes, empty
+ * @param count Number of indexes
+ * @param rows The rows to index, or NULL for rows 0 to rowCount - 1
+ * @param rowCount Number of rows
+ * @return int 1 on success, 0 if memory could not be allocated (the
+ *             indexes are then left empty)
+ *
+ * The entries are sorted once and cut into leaves three quarters full,
+ * which is much faster than adding the rows one by one.
+ */
+int rangeIndexesBuild(RangeIndex *indexes, int count, const int *rows, int rowCount);
+
+/**
+ * @brief Finds an index by its field name
+ * @param indexes The table's indexes
+ * @param count Number of indexes
+ * @param name The field name
+ * @return RangeIndex* The index, or NULL if no index has the name
+ */
+RangeIndex *findRangeIndex(RangeIndex *indexes, int count, const char *name);
+
+/**
+ * @brief Visits the rows whose field lies in a range, in field order
+ * @param index The range index
+ * @param low Smallest value wanted
+ * @param high Largest value wanted
+ * @param descending Non-zero to start from the largest value
+ * @param visit Called with each row until it returns 0
+ * @param context Passed through to visit
+ * @return int Number of rows visited
+ *
+ * Rows with the same value come in row order, reversed when descending.
+ */
+int rangeIndexVisit(const RangeIndex *index, double low, double high, int descending,
+                    RangeVisitor visit, void *context);
+
+/**
+ * @brief Reads one page of rows in field order, starting from a cursor
+ * @param index The range index
+ * @param cursor The field value the page starts from
+ * @param start How the page lies relative to the cursor
+ * @param size Most rows on the page
+ * @param rows Receives the rows of the page in ascending field order; room
+ *             for size rows
+ * @param hasPrevious Receives non-zero if rows come before the page
+ * @param hasNext Receives non-zero if rows come after the page
+ * @return int Number of rows on the page
+ *
+ * Seeks the cursor like a range query and steps over the page, so a page
+ * costs O(log n + size) however far into the index it lies. Pages follow
+ * each other when the field is unique: the page after one starts after the
+ * field of its last row, and the page before it ends before the field of
+ * its first row.
+ */
+int rangeIndexPage(const RangeIndex *index, double cursor, RangePageStart start, int size, int *rows,
+                   int *hasPrevious, int *hasNext);
+
+#endif // RANGEINDEX_H
@@ -2,9 +2,260 @@
 #include "book.h"
 #include "borrowing.h"
 #include "library.h"
+#include "fieldindex.h"
+#include "normalize.h"
+#include "journal.h"
+#include "counters.h"
+#include "substring.h"
+#include "rangeindex.h"
+#include "output.h"
+#include <strings.h>
+
+// Define the table of readers
+Table readerTable = TABLE_INIT(Reader);
+
+// Reader IDs and the rows they live in
+SlotMap readerSlots = SLOT_MAP_INIT;
+
+// Define the arena holding the text of readers
+TextArena readerText = TEXT_ARENA_INIT;
+
+static const char *readerCMNDField(int row) { return readerString(readerAt(row)->CMND); }
+static const char *readerEmailField(int row) { return readerString(readerAt(row)->email); }
+static const char *readerPhoneField(int row) { return readerString(readerAt(row)->phone); }
+
+// Secondary indexes on reader fields, kept in sync by every function
+// that adds, changes, removes or loads readers
+enum { READER_INDEX_CMND, READER_INDEX_EMAIL, READER_INDEX_PHONE, READER_INDEX_COUNT };
+static FieldIndex readerIndexes[READER_INDEX_COUNT] = {
+    FIELD_INDEX("CMND", readerCMNDField, 1),
+    FIELD_INDEX("email", readerEmailField, 1),
+    FIELD_INDEX("phone", readerPhoneField, 0),
+};
+
+// Name and email search keys of the live readers packed back to back for
+// searchReader. Dropped when a key changes or a reader is removed, and
+// packed again by the next search.
+static PackedText readerKeys = PACKED_TEXT_INIT;
+static int keysPacked = 0;
+
+static double readerIDKey(int row) { return readerAt(row)->ID; }
+
+// Range index on the IDs of the live readers, giving the order readers
+// are listed in page by page. Like the range indexes on books it is built
+// by the first listing after a load and kept in sync from then on; an ID
+// never changes, so only adding and removing readers touches it.
+enum { READER_RANGE_ID, READER_RANGE_COUNT };
+static RangeIndex readerRanges[READER_RANGE_COUNT] = {
+    RANGE_INDEX("id", readerIDKey),
+};
+static int rangesBuilt = 0;
 
-// Define the array of readers
-Reader readers[MAX_READERS];
+/**
+ * @brief Drops the range index so the next listing builds it
+ * @return void
+ */
+static void dropReaderRanges(void) {
+    rangeIndexesClear(readerRanges, READER_RANGE_COUNT);
+    rangesBuilt = 0;
+}
+
+/**
+ * @brief Adds a reader to the range index if it has been built
+ * @param row The reader's row
+ * @return void
+ */
+static void addReaderRanges(int row) {
+    if (rangesBuilt && !rangeIndexesInsert(readerRanges, READER_RANGE_COUNT, row)) {
+        dropReaderRanges();
+    }
+}
+
+/**
+ * @brief Builds the range index unless it is already built
+ * @param readerCount Current number of reader rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int buildReaderRanges(int readerCount) {
+    if (rangesBuilt) {
+        return 1;
+    }
+    int *rows = malloc(sizeof(int) * (readerCount + 1));
+    if (rows == NULL) {
+        return 0;
+    }
+    int live = 0;
+    for (int i = 0; i < readerCount; i++) {
+        if (isReaderLive(i)) {
+            rows[live++] = i;
+        }
+    }
+    rangesBuilt = rangeIndexesBuild(readerRanges, READER_RANGE_COUNT, rows, live);
+    free(rows);
+    return rangesBuilt;
+}
+
+/**
+ * @brief Computes the search keys of a reader's name and email
+ * @param reader The reader to update
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int updateReaderKeys(Reader *reader) {
+    char nameKey[MAX_STRING];
+    char emailKey[MAX_STRING];
+    normalizeText(readerString(reader->name), nameKey, MAX_STRING);
+    normalizeText(readerString(reader->email), emailKey, MAX_STRING);
+    keysPacked = 0;
+    return arenaReplace(&readerText, &reader->nameKey, nameKey) &&
+           arenaReplace(&readerText, &reader->emailKey, emailKey);
+}
+
+/**
+ * @brief Marks every text field of a reader as garbage in the arena
+ * @param reader The reader being removed
+ * @return void
+ */
+static void releaseReaderText(const Reader *reader) {
+    arenaRelease(&readerText, reader->name);
+    arenaRelease(&readerText, reader->CMND);
+    arenaRelease(&readerText, reader->email);
+    arenaRelease(&readerText, reader->phone);
+    arenaRelease(&readerText, reader->address);
+    arenaRelease(&readerText, reader->nameKey);
+    arenaRelease(&readerText, reader->emailKey);
+}
+
+/**
+ * @brief Stores the text fields of a reader and their search keys in the arena
+ * @param reader Receives the references to the stored text
+ * @param values The field values
+ * @return int 1 on success, 0 if memory could not be allocated (nothing
+ *             is left stored)
+ */
+static int storeReaderText(Reader *reader, const ReaderValues *values) {
+    char nameKey[MAX_STRING];
+    char emailKey[MAX_STRING];
+    normalizeText(values->name, nameKey, MAX_STRING);
+    normalizeText(values->email, emailKey, MAX_STRING);
+    memset(reader, 0, sizeof(Reader));
+    if (arenaStore(&readerText, values->name, &reader->name) &&
+        arenaStore(&readerText, values->CMND, &reader->CMND) &&
+        arenaStore(&readerText, values->email, &reader->email) &&
+        arenaStore(&readerText, values->phone, &reader->phone) &&
+        arenaStore(&readerText, values->address, &reader->address) &&
+        arenaStore(&readerText, nameKey, &reader->nameKey) &&
+        arenaStore(&readerText, emailKey, &reader->emailKey)) {
+        return 1;
+    }
+    releaseReaderText(reader);
+    return 0;
+}
+
+/**
+ * @brief Adds a live reader to the statistics counters, or takes it out
+ * @param reader The reader
+ * @param sign 1 to add the reader, -1 to take it out
+ * @return void
+ */
+static void countReader(const Reader *reader, int sign) {
+    countMapAdd(&libraryCounters.readersByYear, reader->membershipYear, sign);
+    if (reader->gender <= GENDER_FEMALE) {
+        libraryCounters.readersByGender[reader->gender] += sign;
+    }
+}
+
+/**
+ * @brief Reads one line of text into a reader field
+ * @param stream The stream to read from
+ * @param field The field to store the line in
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int readText(FILE *stream, TextRef *field) {
+    char text[MAX_STRING];
+    if (fgets(text, MAX_STRING, stream) == NULL) {
+        text[0] = 0;
+    }
+    text[strcspn(text, "\n")] = 0;
+    return arenaReplace(&readerText, field, text);
+}
+
+/**
+ * @brief Reads one word into a reader field
+ * @param field The field to store the word in
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int readWord(TextRef *field) {
+    char text[MAX_STRING];
+    scanf("%99s", text);
+    clearInputBuffer();
+    return arenaReplace(&readerText, field, text);
+}
+
+/**
+ * @brief Returns the name of a gender
+ * @param gender The gender
+ * @return const char* "Male", "Female" or "Unknown"
+ */
+const char *genderName(Gender gender) {
+    switch (gender) {
+        case GENDER_MALE:
+            return "Male";
+        case GENDER_FEMALE:
+            return "Female";
+        default:
+            return "Unknown";
+    }
+}
+
+/**
+ * @brief Parses a gender, ignoring case
+ * @param text "Male" or "Female"
+ * @param gender Receives the gender
+ * @return int 1 if the text names a gender, 0 otherwise
+ */
+int parseGender(const char *text, Gender *gender) {
+    if (strcasecmp(text, "Male") == 0) {
+        *gender = GENDER_MALE;
+    } else if (strcasecmp(text, "Female") == 0) {
+        *gender = GENDER_FEMALE;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Sets the card of a reader who joins today
+ * @param cardIssueDate Receives today
+ * @param cardExpiryDate Receives the day the card expires
+ * @param membershipYear Receives the current year
+ * @return void
+ */
+void issueCard(int *cardIssueDate, int *cardExpiryDate, int *membershipYear) {
+    // Set card issue date to today
+    *cardIssueDate = today();
+    
+    // Set expiry date to 48 months from issue date
+    *cardExpiryDate = *cardIssueDate + 48 * 30;
+
+    *membershipYear = time(NULL) / (365 * 24 * 60 * 60) + 1970;
+}
+
+/**
+ * @brief Checks the unique fields of a new reader
+ * @param values The values of the new reader
+ * @return const char* Name of a field another reader already has the
+ *         value of, or NULL if there is no conflict
+ */
+const char *findReaderConflict(const ReaderValues *values) {
+    if (fieldIndexFindConflict(&readerIndexes[READER_INDEX_CMND], values->CMND, -1) != -1) {
+        return readerIndexes[READER_INDEX_CMND].name;
+    }
+    if (fieldIndexFindConflict(&readerIndexes[READER_INDEX_EMAIL], values->email, -1) != -1) {
+        return readerIndexes[READER_INDEX_EMAIL].name;
+    }
+    return NULL;
+}
 
 /**
  * @brief Add a new reader
@@ -12,54 +263,91 @@ Reader readers[MAX_READERS];
  * @return void
  * 
  * The user can enter reader details and adds that reader to the library (ensures all required fields are filled)
- * It checks for maximum capacity and duplicate IDs.
+ * The reader gets the next unused ID and takes the row of a deleted reader if one is free.
+ * CMND and email must not belong to another reader.
  */
 void addReader(int *readerCount) {
-    if (*readerCount >= MAX_READERS) {
-        printf("Maximum number of readers reached!\n");
+    if (!tableReserve(&readerTable, *readerCount + 1)) {
+        printf("Out of memory! Cannot add more readers.\n");
         return;
     }
+    int row;
+    int ID = slotMapAcquire(&readerSlots, &row);
+    if (ID == -1) {
+        printf("Out of memory! Cannot add more readers.\n");
+        return;
+    }
+    Reader *reader = readerAt(row);
+    memset(reader, 0, sizeof(Reader));
 
     printf("\nEnter Reader Information:\n");
-    printf("ID: %d\n", *readerCount + 1);
-    readers[*readerCount].ID = *readerCount + 1;
+    printf("ID: %d\n", ID);
+    reader->ID = ID;
 
     printf("Name: ");
-    fgets(readers[*readerCount].name, MAX_STRING, stdin);
-    readers[*readerCount].name[strcspn(readers[*readerCount].name, "\n")] = 0;
-
-    printf("CMND: ");
-    scanf("%s", readers[*readerCount].CMND);
-    clearInputBuffer();
-
-    printf("Birth Date (YYYY-MM-DD): ");
-    scanf("%s", readers[*readerCount].birthDate);
-    clearInputBuffer();
-
-    printf("Gender (Male/Female): ");
-    scanf("%s", readers[*readerCount].gender);
-    clearInputBuffer();
-
-    printf("Email: ");
-    scanf("%s", readers[*readerCount].email);
-    clearInputBuffer();
+    int stored = readText(stdin, &reader->name);
+
+    do {
+        printf("CMND: ");
+        stored &= readWord(&reader->CMND);
+        if (fieldIndexFindConflict(&readerIndexes[READER_INDEX_CMND], readerString(reader->CMND), -1) != -1) {
+            printf("CMND already registered!\n");
+        } else {
+            break;
+        }
+    } while (1);
+
+    char text[MAX_STRING];
+    do {
+        printf("Birth Date (YYYY-MM-DD): ");
+        scanf("%99s", text);
+        clearInputBuffer();
+        if (parseDate(text, &reader->birthDate)) {
+            break;
+        }
+        printf("Invalid date! Please use YYYY-MM-DD.\n");
+    } while (1);
+
+    Gender gender;
+    do {
+        printf("Gender (Male/Female): ");
+        scanf("%99s", text);
+        clearInputBuffer();
+        if (parseGender(text, &gender)) {
+            break;
+        }
+        printf("Gender must be Male or Female!\n");
+    } while (1);
+    reader->gender = (unsigned char)gender;
+
+    do {
+        printf("Email: ");
+        stored &= readWord(&reader->email);
+        if (fieldIndexFindConflict(&readerIndexes[READER_INDEX_EMAIL], readerString(reader->email), -1) != -1) {
+            printf("Email already registered!\n");
+        } else {
+            break;
+        }
+    } while (1);
 
     printf("Phone: ");
-    scanf("%s", readers[*readerCount].phone);
-    clearInputBuffer();
+    stored &= readWord(&reader->phone);
 
     printf("Address: ");
-    fgets(readers[*readerCount].address, MAX_STRING, stdin);
-    readers[*readerCount].address[strcspn(readers[*readerCount].address, "\n")] = 0;
-
-    // Set card issue date to current time
-    readers[*readerCount].cardIssueDate = time(NULL);
-    
-    // Set expiry date to 48 months from issue date
-    readers[*readerCount].cardExpiryDate = readers[*readerCount].cardIssueDate + (48 * 30 * 24 * 60 * 60);
-
-    readers[*readerCount].membershipYear = time(NULL) / (365 * 24 * 60 * 60) + 1970;
-    (*readerCount)++;
+    stored &= readText(stdin, &reader->address);
+
+    issueCard(&reader->cardIssueDate, &reader->cardExpiryDate, &reader->membershipYear);
+    if (!stored || !updateReaderKeys(reader) ||
+        !fieldIndexesInsert(readerIndexes, READER_INDEX_COUNT, row)) {
+        releaseReaderText(reader);
+        slotMapRelease(&readerSlots, ID);
+        printf("Out of memory! Cannot add more readers.\n");
+        return;
+    }
+    countReader(reader, 1);
+    addReaderRanges(row);
+    journalReader(reader);
+    *readerCount = readerSlots.rowCount;
     printf("Reader added successfully!\n");
 }
 
@@ -81,37 +369,60 @@ void updateReader(int readerCount) {
         printf("Reader not found!\n");
         return;
     }
+    // The current values are copied out, so the text they point at cannot
+    // move while the new values are stored
+    Reader *reader = readerAt(index);
+    char name[MAX_STRING];
+    char CMND[MAX_STRING];
+    char email[MAX_STRING];
+    char phone[MAX_STRING];
+    char address[MAX_STRING];
+    snprintf(name, MAX_STRING, "%s", readerString(reader->name));
+    snprintf(CMND, MAX_STRING, "%s", readerString(reader->CMND));
+    snprintf(email, MAX_STRING, "%s", readerString(reader->email));
+    snprintf(phone, MAX_STRING, "%s", readerString(reader->phone));
+    snprintf(address, MAX_STRING, "%s", readerString(reader->address));
+    ReaderValues values = { reader->ID, name, CMND, email, phone, address,
+                            reader->birthDate, reader->cardIssueDate, reader->cardExpiryDate,
+                            reader->membershipYear, (Gender)reader->gender };
+    char line[MAX_STRING];
 
     printf("Enter new name (or press Enter to keep current): ");
-    char name[MAX_STRING];
-    fgets(name, MAX_STRING, stdin);
-    name[strcspn(name, "\n")] = 0;
-    if (strlen(name) > 0) strcpy(readers[index].name, name);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(name, line);
 
     printf("Enter new email (or press Enter to keep current): ");
-    char email[MAX_STRING];
-    fgets(email, MAX_STRING, stdin);
-    email[strcspn(email, "\n")] = 0;
-    if (strlen(email) > 0) strcpy(readers[index].email, email);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (fieldIndexFindConflict(&readerIndexes[READER_INDEX_EMAIL], line, index) != -1) {
+        printf("Email already registered to another reader, keeping current email.\n");
+    } else if (strlen(line) > 0) {
+        strcpy(email, line);
+    }
 
     printf("Enter new phone (or press Enter to keep current): ");
-    char phone[MAX_STRING];
-    fgets(phone, MAX_STRING, stdin);
-    phone[strcspn(phone, "\n")] = 0;
-    if (strlen(phone) > 0) strcpy(readers[index].phone, phone);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(phone, line);
 
     printf("Enter new address (or press Enter to keep current): ");
-    char address[MAX_STRING];
-    fgets(address, MAX_STRING, stdin);
-    address[strcspn(address, "\n")] = 0;
-    if (strlen(address) > 0) strcpy(readers[index].address, address);
+    fgets(line, MAX_STRING, stdin);
+    line[strcspn(line, "\n")] = 0;
+    if (strlen(line) > 0) strcpy(address, line);
 
     printf("Enter new membership year (or 0 to keep current): ");
     int year;
     scanf("%d", &year);
     clearInputBuffer();
-    if (year > 0) readers[index].membershipYear = year;
+    if (year > 0) values.membershipYear = year;
 
+    // storeReader leaves the reader as it was if memory runs out
+    if (storeReader(&readerCount, &values) == -1) {
+        printf("Out of memory! The reader was not updated.\n");
+        return;
+    }
+    journalReader(readerAt(index));
     printf("Reader updated successfully!\n");
 }
 
@@ -120,7 +431,8 @@ void updateReader(int readerCount) {
  * @param readerCount Pointer to the current number of readers
  * @return void
  * 
- * Removes a reader by ID and shifts all subsequent readers to maintain array continuity.
+ * Removes a reader by ID. The row is released to the free list instead of
+ * shifting later readers, so the rows and IDs of other readers do not change.
  */
 void deleteReader(int *readerCount) {
     int id;
@@ -128,18 +440,140 @@ void deleteReader(int *readerCount) {
     scanf("%d", &id);
     clearInputBuffer();
 
-    int index = findReaderByID(*readerCount, id);
-    if (index == -1) {
+    if (!removeReader(*readerCount, id)) {
         printf("Reader not found!\n");
         return;
     }
+    journalReaderDeleted(id);
+    printf("Reader deleted successfully!\n");
+}
 
-    // Shift remaining readers
-    for (int i = index; i < *readerCount - 1; i++) {
-        readers[i] = readers[i + 1];
+/**
+ * @brief Removes the reader with an ID
+ * @param readerCount Current number of reader rows
+ * @param id The reader's ID
+ * @return int 1 if the reader was removed, 0 if no reader has the ID
+ */
+int removeReader(int readerCount, int id) {
+    int index = findReaderByID(readerCount, id);
+    if (index == -1) {
+        return 0;
     }
-    (*readerCount)--;
-    printf("Reader deleted successfully!\n");
+    fieldIndexesRemove(readerIndexes, READER_INDEX_COUNT, index);
+    if (rangesBuilt) {
+        rangeIndexesRemove(readerRanges, READER_RANGE_COUNT, index);
+    }
+    countReader(readerAt(index), -1);
+    releaseReaderText(readerAt(index));
+    slotMapRelease(&readerSlots, id);
+    keysPacked = 0;
+    return 1;
+}
+
+/**
+ * @brief Adds a reader under a given ID, or replaces every field of the
+ *        reader that has it
+ * @param readerCount Pointer to the current number of reader rows
+ * @param values The field values
+ * @return int Row of the reader, or -1 if memory could not be allocated
+ *
+ * Unlike addReader, no ID is handed out and uniqueness is not checked;
+ * the values must come from a reader that was valid when it was saved.
+ */
+int storeReader(int *readerCount, const ReaderValues *values) {
+    // The text is stored before the reader is touched, so running out of
+    // memory leaves an updated reader as it was
+    Reader text;
+    if (!storeReaderText(&text, values)) {
+        return -1;
+    }
+    int index = findReaderByID(*readerCount, values->ID);
+    int added = index == -1;
+    if (added) {
+        if (!tableReserve(&readerTable, *readerCount + 1) ||
+            !slotMapClaim(&readerSlots, values->ID, &index)) {
+            releaseReaderText(&text);
+            return -1;
+        }
+        memset(readerAt(index), 0, sizeof(Reader));
+        readerAt(index)->ID = values->ID;
+    }
+
+    Reader *reader = readerAt(index);
+    Reader previous = *reader;
+    if (!added) {
+        fieldIndexesRemove(readerIndexes, READER_INDEX_COUNT, index);
+    }
+    reader->name = text.name;
+    reader->CMND = text.CMND;
+    reader->email = text.email;
+    reader->phone = text.phone;
+    reader->address = text.address;
+    reader->nameKey = text.nameKey;
+    reader->emailKey = text.emailKey;
+    if (!fieldIndexesInsert(readerIndexes, READER_INDEX_COUNT, index)) {
+        releaseReaderText(&text);
+        *reader = previous;
+        if (added) {
+            slotMapRelease(&readerSlots, values->ID);
+        } else {
+            fieldIndexesInsert(readerIndexes, READER_INDEX_COUNT, index);
+        }
+        return -1;
+    }
+    if (!added) {
+        countReader(&previous, -1);
+        releaseReaderText(&previous);
+    }
+    reader->birthDate = values->birthDate;
+    reader->cardIssueDate = values->cardIssueDate;
+    reader->cardExpiryDate = values->cardExpiryDate;
+    reader->membershipYear = values->membershipYear;
+    reader->gender = (unsigned char)values->gender;
+    keysPacked = 0;
+    countReader(reader, 1);
+    if (added) {
+        addReaderRanges(index);
+    }
+    *readerCount = readerSlots.rowCount;
+    return index;
+}
+
+/**
+ * @brief Packs the search keys of the live readers unless they are packed
+ * @param readerCount Current number of reader rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int packReaderKeys(int readerCount) {
+    if (keysPacked) {
+        return 1;
+    }
+    packedTextClear(&readerKeys);
+    for (int i = 0; i < readerCount; i++) {
+        if (!isReaderLive(i)) {
+            continue;
+        }
+        const Reader *reader = readerAt(i);
+        if (!packedTextAppend(&readerKeys, i, readerString(reader->nameKey), reader->nameKey.length) ||
+            !packedTextAppend(&readerKeys, i, readerString(reader->emailKey), reader->emailKey.length)) {
+            return 0;
+        }
+    }
+    keysPacked = 1;
+    return 1;
+}
+
+// Writes the fields of a reader listed or found by a search, then a separator line
+static void printFoundReader(OutputBuffer *out, const Reader *reader) {
+    outputText(out, "ID: ");
+    outputNumber(out, reader->ID);
+    outputLine(out, "\nName: ", readerString(reader->name));
+    outputLine(out, "Email: ", readerString(reader->email));
+    outputLine(out, "Phone: ", readerString(reader->phone));
+    outputLine(out, "Address: ", readerString(reader->address));
+    outputText(out, "Membership Year: ");
+    outputNumber(out, reader->membershipYear);
+    outputText(out, "\n----------------------------------------\n");
 }
 
 /**
@@ -148,120 +582,275 @@ void deleteReader(int *readerCount) {
  * @return void
  * 
  * This function displays all readers that match the search term in either their name or email field.
+ * Matching ignores case and diacritics by comparing against the precomputed search keys,
+ * which are scanned packed back to back.
  */
 void searchReader(int readerCount) {
     char searchTerm[MAX_STRING];
     printf("Enter search term (name or email): ");
     fgets(searchTerm, MAX_STRING, stdin);
     searchTerm[strcspn(searchTerm, "\n")] = 0;
+    char term[MAX_STRING];
+    normalizeText(searchTerm, term, MAX_STRING);
+
+    SubstringPattern pattern;
+    prepareSubstring(&pattern, term);
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
     int found = 0;
-    for (int i = 0; i < readerCount; i++) {
-        if (strstr(readers[i].name, searchTerm) || strstr(readers[i].email, searchTerm)) {
-            printf("ID: %d\n", readers[i].ID);
-            printf("Name: %s\n", readers[i].name);
-            printf("Email: %s\n", readers[i].email);
-            printf("Phone: %s\n", readers[i].phone);
-            printf("Address: %s\n", readers[i].address);
-            printf("Membership Year: %d\n", readers[i].membershipYear);
-            printf("----------------------------------------\n");
-            found = 1;
+    int *rows = NULL;
+    if (packReaderKeys(readerCount)) {
+        rows = malloc(sizeof(int) * (readerKeys.count + 1));
+    }
+    if (rows != NULL) {
+        found = scanPackedText(&pattern, &readerKeys, rows);
+        for (int k = 0; k < found; k++) {
+            printFoundReader(out, readerAt(rows[k]));
+        }
+        free(rows);
+    } else {
+        // Not enough memory to pack the keys, check the readers one by one
+        for (int i = 0; i < readerCount; i++) {
+            if (!isReaderLive(i)) {
+                continue;
+            }
+            const Reader *reader = readerAt(i);
+            if (strstr(readerString(reader->nameKey), term) || strstr(readerString(reader->emailKey), term)) {
+                printFoundReader(out, reader);
+                found++;
+            }
         }
     }
     if (!found) {
-        printf("No readers found matching the search term.\n");
+        outputText(out, "No readers found matching the search term.\n");
     }
+    outputFlush(out);
 }
 
 /**
- * @brief Displays all readers in the library system
+ * @brief Displays all readers in the library system a page at a time
  * @param readerCount Current number of readers in the system
  * @return void
  * 
- * This function shows detailed information about all readers
- * currently registered in the system.
+ * This function shows the readers currently registered in the system in
+ * ID order, one page at a time; the user moves to the next or previous
+ * page, jumps to an ID or changes the page size.
  */
 void displayAllReaders(int readerCount) {
-    if (readerCount == 0) {
+    if (liveReaderCount() == 0) {
         printf("No readers registered.\n");
         return;
     }
 
-    printf("\nAll Readers:\n");
-    printf("----------------------------------------\n");
-    for (int i = 0; i < readerCount; i++) {
-        printf("ID: %d\n", readers[i].ID);
-        printf("Name: %s\n", readers[i].name);
-        printf("Email: %s\n", readers[i].email);
-        printf("Phone: %s\n", readers[i].phone);
-        printf("Address: %s\n", readers[i].address);
-        printf("Membership Year: %d\n", readers[i].membershipYear);
-        printf("----------------------------------------\n");
+    int rows[MAX_PAGE_SIZE];
+    int size = PAGE_SIZE;
+    int cursor = 0;
+    RangePageStart start = RANGE_PAGE_FROM;
+    int choice;
+    do {
+        int hasPrevious;
+        int hasNext;
+        int count = findReaderPage(readerCount, cursor, start, size, rows, &hasPrevious, &hasNext);
+        if (count == -1) {
+            printf("Memory allocation failed!\n");
+            return;
+        }
+        OutputBuffer *out = screenOutput();
+        outputText(out, "\nAll Readers:\n");
+        outputText(out, "----------------------------------------\n");
+        for (int i = 0; i < count; i++) {
+            printFoundReader(out, readerAt(rows[i]));
+        }
+        if (count == 0) {
+            outputText(out, "No readers on this page.\n");
+        }
+        outputText(out, "Showing ");
+        outputNumber(out, count);
+        outputText(out, " of ");
+        outputNumber(out, liveReaderCount());
+        outputText(out, " readers.\n");
+        outputFlush(out);
+
+        // Showing the page again starts from its first reader
+        if (count > 0) {
+            cursor = readerAt(rows[0])->ID;
+            start = RANGE_PAGE_FROM;
+        }
+        printf("1. Next Page\n");
+        printf("2. Previous Page\n");
+        printf("3. Jump to ID\n");
+        printf("4. Change Page Size\n");
+        printf("0. Back\n");
+        printf("Enter your choice: ");
+        if (scanf("%d", &choice) != 1) {
+            choice = -1;
+        }
+        clearInputBuffer();
+
+        switch (choice) {
+            case 1:
+                if (!hasNext) {
+                    printf("This is the last page.\n");
+                } else {
+                    cursor = readerAt(rows[count - 1])->ID;
+                    start = RANGE_PAGE_AFTER;
+                }
+                break;
+            case 2:
+                if (!hasPrevious) {
+                    printf("This is the first page.\n");
+                } else {
+                    start = RANGE_PAGE_BEFORE;
+                }
+                break;
+            case 3:
+                printf("Enter reader ID to jump to: ");
+                if (scanf("%d", &cursor) != 1) {
+                    printf("Invalid ID!\n");
+                }
+                clearInputBuffer();
+                break;
+            case 4:
+                printf("Readers per page (1-%d): ", MAX_PAGE_SIZE);
+                if (scanf("%d", &size) != 1 || size < 1 || size > MAX_PAGE_SIZE) {
+                    printf("Invalid page size!\n");
+                    size = PAGE_SIZE;
+                }
+                clearInputBuffer();
+                break;
+            case 0:
+                break;
+            default:
+                printf("Invalid choice!\n");
+        }
+    } while (choice != 0);
+}
+
+/**
+ * @brief Reads one page of the readers in ID order
+ * @param readerCount Current number of reader rows
+ * @param id The cursor: 0 starts from the first reader, and INT_MAX with
+ *           RANGE_PAGE_BEFORE ends at the last
+ * @param start Whether the page starts at the ID, just after it or ends
+ *              just before it
+ * @param size Most readers on the page
+ * @param rows Receives the rows of the page in ID order; room for size rows
+ * @param hasPrevious Receives non-zero if readers come before the page
+ * @param hasNext Receives non-zero if readers come after the page
+ * @return int Number of readers on the page, or -1 if memory could not be allocated
+ *
+ * Reads the ID range index, so a page costs O(log n + size) however many
+ * readers there are.
+ */
+int findReaderPage(int readerCount, int id, RangePageStart start, int size, int *rows,
+                   int *hasPrevious, int *hasNext) {
+    if (!buildReaderRanges(readerCount)) {
+        return -1;
     }
+    return rangeIndexPage(&readerRanges[READER_RANGE_ID], id, start, size, rows, hasPrevious, hasNext);
 }
 
+/**
+ * @brief Searches for readers by CMND
+ * @param readerCount Current number of readers in the system
+ * @return void
+ * 
+ * This function looks the CMND up in the CMND index and displays the matching reader.
+ */
 void searchReaderByCMND(int readerCount) {
     char searchTerm[MAX_STRING];
     printf("Enter CMND to search: ");
     scanf("%s", searchTerm);
     clearInputBuffer();
 
-    printf("\nSearch Results:\n");
-    printf("----------------------------------------\n");
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nSearch Results:\n");
+    outputText(out, "----------------------------------------\n");
     int found = 0;
-    for (int i = 0; i < readerCount; i++) {
-        if (strcmp(readers[i].CMND, searchTerm) == 0) {
-            printf("ID: %d\n", readers[i].ID);
-            printf("Name: %s\n", readers[i].name);
-            printf("CMND: %s\n", readers[i].CMND);
-            printf("Email: %s\n", readers[i].email);
-            printf("Phone: %s\n", readers[i].phone);
-            printf("Address: %s\n", readers[i].address);
-            printf("Membership Year: %d\n", readers[i].membershipYear);
-            printf("----------------------------------------\n");
-            found = 1;
+    int cursor = -1;
+    int i;
+    while ((i = fieldIndexFindNext(&readerIndexes[READER_INDEX_CMND], searchTerm, &cursor)) != -1) {
+        if (i >= readerCount) {
+            continue;
         }
+        const Reader *reader = readerAt(i);
+        outputText(out, "ID: ");
+        outputNumber(out, reader->ID);
+        outputLine(out, "\nName: ", readerString(reader->name));
+        outputLine(out, "CMND: ", readerString(reader->CMND));
+        outputLine(out, "Email: ", readerString(reader->email));
+        outputLine(out, "Phone: ", readerString(reader->phone));
+        outputLine(out, "Address: ", readerString(reader->address));
+        outputText(out, "Membership Year: ");
+        outputNumber(out, reader->membershipYear);
+        outputText(out, "\n----------------------------------------\n");
+        found = 1;
     }
     if (!found) {
-        printf("No readers found matching the CMND.\n");
+        outputText(out, "No readers found matching the CMND.\n");
     }
+    outputFlush(out);
 }
 
 /**
  * @brief Searches for books by a reader's name
- * @param borrowingCount Current number of borrowings
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
  * @return void
  * 
- * This function displays all books that are currently by a reader
- * whose name matches the search term.
+ * This function displays all books that are currently borrowed by a reader
+ * whose name matches the search term. Only the loans of matching readers
+ * are looked at, through the reader's loan list.
  */
-void searchBooksByReaderName(int borrowingCount) {
+void searchBooksByReaderName(int bookCount, int readerCount) {
     char searchTerm[MAX_STRING];
     printf("Enter reader name to search: ");
     fgets(searchTerm, MAX_STRING, stdin);
     searchTerm[strcspn(searchTerm, "\n")] = 0;
+    char term[MAX_STRING];
+    normalizeText(searchTerm, term, MAX_STRING);
 
     int found = 0;
-    printf("\n=== Books Borrowed by Reader ===\n");
-    for (int i = 0; i < borrowingCount; i++) {
-        if (strstr(readers[borrowings[i].readerID].name, searchTerm)) {
-            printf("Reader: %s (CMND: %s)\n", readers[borrowings[i].readerID].name, readers[borrowings[i].readerID].CMND);
-            printf("Books:\n");
-            for (int j = 0; j < borrowings[i].bookCount; j++) {
-                int bookIndex = findBookByISBN(MAX_BOOKS, borrowings[i].books[j]);
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\n=== Books Borrowed by Reader ===\n");
+    for (int i = 0; i < readerCount; i++) {
+        if (!isReaderLive(i)) {
+            continue;
+        }
+        const Reader *reader = readerAt(i);
+        int row = loanIndexFirst(&readerLoans, reader->ID, 0);
+        if (row == -1 || !strstr(readerString(reader->nameKey), term)) {
+            continue;
+        }
+        outputText(out, "Reader: ");
+        outputText(out, readerString(reader->name));
+        outputText(out, " (CMND: ");
+        outputText(out, readerString(reader->CMND));
+        outputText(out, ")\nBooks:\n");
+        for (; row != -1; row = loanIndexNext(&readerLoans, row)) {
+            const Borrowing *borrowing = borrowingAt(row);
+            for (int j = 0; j < borrowing->bookCount; j++) {
+                int bookIndex = findBookByISBN(bookCount, borrowing->books[j]);
                 if (bookIndex != -1) {
-                    printf("- %s (ISBN: %s)\n", books[bookIndex].title, books[bookIndex].ISBN);
+                    char ISBN[ISBN_LENGTH];
+                    formatISBN(borrowing->books[j], ISBN);
+                    outputText(out, "- ");
+                    outputText(out, bookString(bookAt(bookIndex)->title));
+                    outputText(out, " (ISBN: ");
+                    outputText(out, ISBN);
+                    outputText(out, ")\n");
                 }
             }
-            printf("----------------------------------------\n");
-            found = 1;
         }
+        outputText(out, "----------------------------------------\n");
+        found = 1;
     }
     if (!found) {
-        printf("No books found for this reader.\n");
+        outputText(out, "No books found for this reader.\n");
     }
+    outputFlush(out);
 }
 
 // Update the function to save data to the file
@@ -273,21 +862,27 @@ void saveReadersToFile(int readerCount) {
     }
     
     // Save the number of readers
-    fprintf(file, "%d\n", readerCount);
+    fprintf(file, "%d\n", liveReaderCount());
     
-    // Save the information of each reader
+    // Save the information of each reader, skipping deleted rows
     for (int i = 0; i < readerCount; i++) {
-        fprintf(file, "%d\n", readers[i].ID);
-        fprintf(file, "%s\n", readers[i].name);
-        fprintf(file, "%s\n", readers[i].CMND);
-        fprintf(file, "%s\n", readers[i].birthDate);
-        fprintf(file, "%s\n", readers[i].gender);
-        fprintf(file, "%s\n", readers[i].email);
-        fprintf(file, "%s\n", readers[i].phone);
-        fprintf(file, "%s\n", readers[i].address);
-        fprintf(file, "%ld\n", readers[i].cardIssueDate);
-        fprintf(file, "%ld\n", readers[i].cardExpiryDate);
-        fprintf(file, "%d\n", readers[i].membershipYear);
+        if (!isReaderLive(i)) {
+            continue;
+        }
+        const Reader *reader = readerAt(i);
+        char birthDate[DATE_LENGTH];
+        formatDate(reader->birthDate, birthDate);
+        fprintf(file, "%d\n", reader->ID);
+        fprintf(file, "%s\n", readerString(reader->name));
+        fprintf(file, "%s\n", readerString(reader->CMND));
+        fprintf(file, "%s\n", birthDate);
+        fprintf(file, "%s\n", genderName(reader->gender));
+        fprintf(file, "%s\n", readerString(reader->email));
+        fprintf(file, "%s\n", readerString(reader->phone));
+        fprintf(file, "%s\n", readerString(reader->address));
+        fprintf(file, "%ld\n", (long)timeFromDay(reader->cardIssueDate));
+        fprintf(file, "%ld\n", (long)timeFromDay(reader->cardExpiryDate));
+        fprintf(file, "%d\n", reader->membershipYear);
     }
     
     fclose(file);
@@ -304,47 +899,112 @@ void loadReadersFromFile(int *readerCount) {
     
     // Read the number of readers
     fscanf(file, "%d\n", readerCount);
+    if (*readerCount < 0 || !tableReserve(&readerTable, *readerCount)) {
+        printf("Not enough memory to load reader data.\n");
+        *readerCount = 0;
+        fclose(file);
+        return;
+    }
     
     // Read the information of each reader
+    arenaClear(&readerText);
     for (int i = 0; i < *readerCount; i++) {
-        fscanf(file, "%d\n", &readers[i].ID);
-        
-        fgets(readers[i].name, MAX_STRING, file);
-        readers[i].name[strcspn(readers[i].name, "\n")] = 0;
-        
-        fgets(readers[i].CMND, MAX_STRING, file);
-        readers[i].CMND[strcspn(readers[i].CMND, "\n")] = 0;
+        Reader *reader = readerAt(i);
+        memset(reader, 0, sizeof(Reader));
+        fscanf(file, "%d\n", &reader->ID);
         
-        fgets(readers[i].birthDate, MAX_STRING, file);
-        readers[i].birthDate[strcspn(readers[i].birthDate, "\n")] = 0;
+        int stored = readText(file, &reader->name);
+        stored &= readText(file, &reader->CMND);
         
-        fgets(readers[i].gender, MAX_STRING, file);
-        readers[i].gender[strcspn(readers[i].gender, "\n")] = 0;
-        
-        fgets(readers[i].email, MAX_STRING, file);
-        readers[i].email[strcspn(readers[i].email, "\n")] = 0;
+        char text[MAX_STRING];
+        if (fgets(text, MAX_STRING, file) == NULL) {
+            text[0] = 0;
+        }
+        text[strcspn(text, "\n")] = 0;
+        if (!parseDate(text, &reader->birthDate)) {
+            reader->birthDate = DATE_UNKNOWN;
+        }
         
-        fgets(readers[i].phone, MAX_STRING, file);
-        readers[i].phone[strcspn(readers[i].phone, "\n")] = 0;
+        if (fgets(text, MAX_STRING, file) == NULL) {
+            text[0] = 0;
+        }
+        text[strcspn(text, "\n")] = 0;
+        Gender gender = GENDER_UNKNOWN;
+        parseGender(text, &gender);
+        reader->gender = (unsigned char)gender;
         
-        fgets(readers[i].address, MAX_STRING, file);
-        readers[i].address[strcspn(readers[i].address, "\n")] = 0;
+        stored &= readText(file, &reader->email);
+        stored &= readText(file, &reader->phone);
+        stored &= readText(file, &reader->address);
         
-        fscanf(file, "%ld\n", &readers[i].cardIssueDate);
-        fscanf(file, "%ld\n", &readers[i].cardExpiryDate);
-        fscanf(file, "%d\n", &readers[i].membershipYear);
+        long cardIssueDate;
+        long cardExpiryDate;
+        fscanf(file, "%ld\n", &cardIssueDate);
+        fscanf(file, "%ld\n", &cardExpiryDate);
+        reader->cardIssueDate = dayFromTime(cardIssueDate);
+        reader->cardExpiryDate = dayFromTime(cardExpiryDate);
+        fscanf(file, "%d\n", &reader->membershipYear);
+        if (!stored || !updateReaderKeys(reader)) {
+            printf("Not enough memory to load reader data.\n");
+            *readerCount = i;
+            break;
+        }
     }
     
     fclose(file);
+    restoreReaders(readerCount);
     printf("Readers loaded from file successfully.\n");
 }
 
+/**
+ * @brief Makes room for readers about to be added in bulk
+ * @param readerCount Current number of reader rows
+ * @param rows Number of readers about to be added
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int reserveReaders(int readerCount, int rows) {
+    return tableReserve(&readerTable, readerCount + rows) &&
+           fieldIndexesReserve(readerIndexes, READER_INDEX_COUNT, liveReaderCount() + rows);
+}
+
+/**
+ * @brief Registers the IDs and indexes of the readers loaded into the table
+ * @param readerCount Pointer to the number of loaded rows, lowered if memory runs out
+ * @return void
+ *
+ * Rows must hold live readers back to back, as written by the save functions.
+ * The reader statistics counters are recounted.
+ */
+void restoreReaders(int *readerCount) {
+    slotMapClear(&readerSlots);
+    fieldIndexesClear(readerIndexes, READER_INDEX_COUNT);
+    countMapClear(&libraryCounters.readersByYear);
+    memset(libraryCounters.readersByGender, 0, sizeof(libraryCounters.readersByGender));
+    fieldIndexesReserve(readerIndexes, READER_INDEX_COUNT, *readerCount);
+    dropReaderRanges();
+    keysPacked = 0;
+    for (int i = 0; i < *readerCount; i++) {
+        Reader *reader = readerAt(i);
+        // Files written before IDs were stable may repeat an ID
+        if (slotMapFind(&readerSlots, reader->ID) != -1) {
+            reader->ID = readerSlots.nextID;
+            printf("Duplicate reader ID in file, reader %s reassigned ID %d.\n", readerString(reader->name), reader->ID);
+        }
+        if (!slotMapRestore(&readerSlots, reader->ID, i) ||
+            !fieldIndexesInsert(readerIndexes, READER_INDEX_COUNT, i)) {
+            printf("Not enough memory to load reader data.\n");
+            *readerCount = i;
+            break;
+        }
+        countReader(reader, 1);
+    }
+}
+
 // Function to find a reader by ID
 int findReaderByID(int readerCount, int id) {
-    for (int i = 0; i < readerCount; i++) {
-        if (readers[i].ID == id) {
-            return i;
-        }
+    int index = slotMapFind(&readerSlots, id);
+    if (index >= readerCount) {
+        return -1;
     }
-    return -1;
-} 
\ No newline at end of file
+    return index;
+}
@@ -6,24 +6,82 @@
 #include <string.h>
 #include <time.h>
 #include "constants.h"
+#include "table.h"
+#include "slotmap.h"
+#include "textarena.h"
+#include "date.h"
+#include "rangeindex.h"
+
+// Gender of a reader
+typedef enum {
+    GENDER_UNKNOWN,
+    GENDER_MALE,
+    GENDER_FEMALE
+} Gender;
 
 // Define the Reader struct
+// Text fields live in the reader text arena (see readerString) and dates
+// are day numbers (see date.h).
 typedef struct {
     int ID;
-    char name[MAX_STRING];
-    char CMND[MAX_STRING];
-    char birthDate[MAX_STRING];
-    char gender[MAX_STRING];
-    char email[MAX_STRING];
-    char phone[MAX_STRING];
-    char address[MAX_STRING];
-    time_t cardIssueDate;
-    time_t cardExpiryDate;
+    TextRef name;
+    TextRef CMND;
+    TextRef email;
+    TextRef phone;
+    TextRef address;
+    TextRef nameKey;               // Normalized name used by searches
+    TextRef emailKey;              // Normalized email used by searches
+    int birthDate;                 // DATE_UNKNOWN if the file held no valid date
+    int cardIssueDate;
+    int cardExpiryDate;
     int membershipYear;
+    unsigned char gender;          // A Gender value
 } Reader;
 
-// Declare the readers array
-extern Reader readers[MAX_READERS];
+// Values of every field of a reader, used to add or replace a reader
+// without prompting (journal replay)
+typedef struct {
+    int ID;
+    const char *name;
+    const char *CMND;
+    const char *email;
+    const char *phone;
+    const char *address;
+    int birthDate;
+    int cardIssueDate;
+    int cardExpiryDate;
+    int membershipYear;
+    Gender gender;
+} ReaderValues;
+
+// Declare the table of readers
+extern Table readerTable;
+
+// Reader IDs and the rows they live in
+extern SlotMap readerSlots;
+
+// Declare the arena holding the text of readers
+extern TextArena readerText;
+
+// Returns the text of a reader field stored in the arena
+static inline const char *readerString(TextRef ref) {
+    return arenaText(&readerText, ref);
+}
+
+// Returns the reader stored at the given row
+static inline Reader *readerAt(int index) {
+    return (Reader *)tableRow(&readerTable, index);
+}
+
+// Returns non-zero if the row holds a reader that has not been deleted
+static inline int isReaderLive(int index) {
+    return slotMapIsLive(&readerSlots, index);
+}
+
+// Returns the number of readers that have not been deleted
+static inline int liveReaderCount(void) {
+    return readerSlots.liveCount;
+}
 
 // Declare the functions
 void addReader(int *readerCount);
@@ -32,13 +90,23 @@ void deleteReader(int *readerCount);
 void searchReader(int readerCount);
 void searchReaderByCMND(int readerCount);
 void displayAllReaders(int readerCount);
+int findReaderPage(int readerCount, int id, RangePageStart start, int size, int *rows,
+                   int *hasPrevious, int *hasNext);
 void displayReaderStatistics(int readerCount);
 void displayGenderStatistics(int readerCount);
-void searchBooksByReaderName(int borrowingCount);
+void searchBooksByReaderName(int bookCount, int readerCount);
 
 // Add the functions to save data to the file
 void saveReadersToFile(int readerCount);
 void loadReadersFromFile(int *readerCount);
+void restoreReaders(int *readerCount);
+int reserveReaders(int readerCount, int rows);
+int storeReader(int *readerCount, const ReaderValues *values);
+int removeReader(int readerCount, int id);
 int findReaderByID(int readerCount, int id);
+const char *genderName(Gender gender);
+int parseGender(const char *text, Gender *gender);
+void issueCard(int *cardIssueDate, int *cardExpiryDate, int *membershipYear);
+const char *findReaderConflict(const ReaderValues *values);
 
 #endif // READER_H 
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include "slotmap.h"
+
+/**
+ * @brief Grows an array geometrically until it holds the needed length
+ * @param array The array to grow
+ * @param capacity Current length, updated on success
+ * @param needed Length required
+ * @param elementSize Size of one element
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * New elements are zero-filled.
+ */
+static int growArray(void **array, int *capacity, int needed, size_t elementSize) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    int newCapacity = *capacity == 0 ? 64 : *capacity;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    char *grown = realloc(*array, (size_t)newCapacity * elementSize);
+    if (grown == NULL) {
+        return 0;
+    }
+    for (size_t i = (size_t)*capacity * elementSize; i < (size_t)newCapacity * elementSize; i++) {
+        grown[i] = 0;
+    }
+    *array = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+/**
+ * @brief Makes room for an ID in the ID directory
+ * @param map The slot map
+ * @param ID The ID that must fit
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int reserveID(SlotMap *map, int ID) {
+    int oldCapacity = map->idCapacity;
+    if (!growArray((void **)&map->idToRow, &map->idCapacity, ID + 1, sizeof(int))) {
+        return 0;
+    }
+    for (int i = oldCapacity; i < map->idCapacity; i++) {
+        map->idToRow[i] = -1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Allocates a new ID and a row for it
+ * @param map The slot map
+ * @param row Receives the row assigned to the new ID
+ * @return int The new ID, or -1 if memory could not be allocated
+ *
+ * Released rows are reused before new rows are handed out.
+ */
+int slotMapAcquire(SlotMap *map, int *row) {
+    int ID = map->nextID;
+    if (!slotMapClaim(map, ID, row)) {
+        return -1;
+    }
+    return ID;
+}
+
+/**
+ * @brief Registers a given ID and allocates a row for it
+ * @param map The slot map
+ * @param ID The ID to register
+ * @param row Receives the row assigned to the ID
+ * @return int 1 on success, 0 if the ID is invalid or live, or memory
+ *             could not be allocated
+ *
+ * Used to redo an earlier acquire, so the ID the reader got then is kept
+ * even if other IDs were handed out in between.
+ */
+int slotMapClaim(SlotMap *map, int ID, int *row) {
+    if (ID <= 0 || slotMapFind(map, ID) != -1 || !reserveID(map, ID)) {
+        return 0;
+    }
+
+    int slot;
+    if (map->freeCount > 0) {
+        slot = map->freeRows[--map->freeCount];
+    } else {
+        if (!growArray((void **)&map->generations, &map->rowCapacity, map->rowCount + 1, sizeof(unsigned int))) {
+            return 0;
+        }
+        slot = map->rowCount++;
+    }
+
+    map->generations[slot]++;
+    map->idToRow[ID] = slot;
+    if (ID >= map->nextID) {
+        map->nextID = ID + 1;
+    }
+    map->liveCount++;
+    *row = slot;
+    return 1;
+}
+
+/**
+ * @brief Registers an existing ID at a given row (used while loading)
+ * @param map The slot map
+ * @param ID The ID to register, must not be live already
+ * @param row The row holding the ID, must be rowCount
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int slotMapRestore(SlotMap *map, int ID, int row) {
+    if (!reserveID(map, ID) ||
+        !growArray((void **)&map->generations, &map->rowCapacity, row + 1, sizeof(unsigned int))) {
+        return 0;
+    }
+    map->generations[row] |= 1u;
+    map->idToRow[ID] = row;
+    map->rowCount = row + 1;
+    map->liveCount++;
+    if (ID >= map->nextID) {
+        map->nextID = ID + 1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Releases an ID and puts its row on the free list
+ * @param map The slot map
+ * @param ID The ID to release
+ * @return int The row that was released, or -1 if the ID was not live
+ */
+int slotMapRelease(SlotMap *map, int ID) {
+    int row = slotMapFind(map, ID);
+    if (row == -1) {
+        return -1;
+    }
+    if (!growArray((void **)&map->freeRows, &map->freeCapacity, map->freeCount + 1, sizeof(int))) {
+        return -1;
+    }
+    map->freeRows[map->freeCount++] = row;
+    map->generations[row]++;
+    map->idToRow[ID] = -1;
+    map->liveCount--;
+    return row;
+}
+
+/**
+ * @brief Takes a handle to the current row of an ID
+ * @param map The slot map
+ * @param ID The ID to look up
+ * @return SlotHandle Handle with row -1 if the ID is not live
+ */
+SlotHandle slotMapHandle(const SlotMap *map, int ID) {
+    SlotHandle handle = { -1, 0 };
+    int row = slotMapFind(map, ID);
+    if (row != -1) {
+        handle.row = row;
+        handle.generation = map->generations[row];
+    }
+    return handle;
+}
+
+/**
+ * @brief Removes every ID and row
+ * @param map The slot map
+ * @return void
+ *
+ * Generations are kept so handles taken before the clear stay stale.
+ */
+void slotMapClear(SlotMap *map) {
+    for (int i = 0; i < map->idCapacity; i++) {
+        map->idToRow[i] = -1;
+    }
+    for (int i = 0; i < map->rowCount; i++) {
+        if (map->generations[i] & 1u) {
+            map->generations[i]++;
+        }
+    }
+    map->nextID = 1;
+    map->rowCount = 0;
+    map->freeCount = 0;
+    map->liveCount = 0;
+}
+
+/**
+ * @brief Releases the memory of the slot map
+ * @param map The slot map
+ * @return void
+ */
+void slotMapFree(SlotMap *map) {
+    free(map->idToRow);
+    free(map->generations);
+    free(map->freeRows);
+    SlotMap empty = SLOT_MAP_INIT;
+    *map = empty;
+}
@@ -0,0 +1,126 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+// Maps stable IDs to table rows. IDs are handed out in increasing order
+// and never reused; rows of released IDs go on a free list and are
+// recycled. Every row carries a generation that changes each time it is
+// acquired or released, so a handle taken earlier can tell whether the
+// row still holds the same occupant.
+typedef struct {
+    int *idToRow;               // Row of each ID, -1 once the ID is released
+    int idCapacity;             // Length of idToRow
+    int nextID;                 // Next ID to hand out, starting at 1
+    unsigned int *generations;  // Generation of each row, odd while the row is in use
+    int rowCapacity;            // Length of generations
+    int rowCount;               // Rows ever handed out, live or free
+    int *freeRows;              // Stack of released rows
+    int freeCount;              // Number of released rows on the stack
+    int freeCapacity;           // Length of freeRows
+    int liveCount;              // Rows currently in use
+} SlotMap;
+
+// A remembered reference to the row of an ID at a point in time
+typedef struct {
+    int row;                    // Row the ID lived in, -1 if it had none
+    unsigned int generation;    // Generation of the row at that time
+} SlotHandle;
+
+#define SLOT_MAP_INIT { NULL, 0, 1, NULL, 0, 0, NULL, 0, 0, 0 }
+
+/**
+ * @brief Allocates a new ID and a row for it
+ * @param map The slot map
+ * @param row Receives the row assigned to the new ID
+ * @return int The new ID, or -1 if memory could not be allocated
+ *
+ * Released rows are reused before new rows are handed out.
+ */
+int slotMapAcquire(SlotMap *map, int *row);
+
+/**
+ * @brief Registers a given ID and allocates a row for it
+ * @param map The slot map
+ * @param ID The ID to register
+ * @param row Receives the row assigned to the ID
+ * @return int 1 on success, 0 if the ID is invalid or live, or memory
+ *             could not be allocated
+ */
+int slotMapClaim(SlotMap *map, int ID, int *row);
+
+/**
+ * @brief Registers an existing ID at a given row (used while loading)
+ * @param map The slot map
+ * @param ID The ID to register, must not be live already
+ * @param row The row holding the ID, must be rowCount
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int slotMapRestore(SlotMap *map, int ID, int row);
+
+/**
+ * @brief Releases an ID and puts its row on the free list
+ * @param map The slot map
+ * @param ID The ID to release
+ * @return int The row that was released, or -1 if the ID was not live
+ */
+int slotMapRelease(SlotMap *map, int ID);
+
+/**
+ * @brief Takes a handle to the current row of an ID
+ * @param map The slot map
+ * @param ID The ID to look up
+ * @return SlotHandle Handle with row -1 if the ID is not live
+ */
+SlotHandle slotMapHandle(const SlotMap *map, int ID);
+
+/**
+ * @brief Removes every ID and row
+ * @param map The slot map
+ * @return void
+ */
+void slotMapClear(SlotMap *map);
+
+/**
+ * @brief Releases the memory of the slot map
+ * @param map The slot map
+ * @return void
+ */
+void slotMapFree(SlotMap *map);
+
+/**
+ * @brief Finds the row of an ID
+ * @param map The slot map
+ * @param ID The ID to look up
+ * @return int Row of the ID, or -1 if the ID is not live
+ */
+static inline int slotMapFind(const SlotMap *map, int ID) {
+    if (ID <= 0 || ID >= map->idCapacity) {
+        return -1;
+    }
+    return map->idToRow[ID];
+}
+
+/**
+ * @brief Tells whether a row currently holds a live ID
+ * @param map The slot map
+ * @param row The row to check
+ * @return int 1 if the row is in use, 0 if it is free
+ */
+static inline int slotMapIsLive(const SlotMap *map, int row) {
+    return row >= 0 && row < map->rowCount && (map->generations[row] & 1u);
+}
+
+/**
+ * @brief Resolves a handle taken earlier
+ * @param map The slot map
+ * @param handle The handle to resolve
+ * @return int Row of the handle, or -1 if the row has been released since
+ */
+static inline int slotMapResolve(const SlotMap *map, SlotHandle handle) {
+    if (handle.row < 0 || handle.row >= map->rowCount ||
+        map->generations[handle.row] != handle.generation) {
+        return -1;
+    }
+    return handle.row;
+}
+
+#endif // SLOTMAP_H
@@ -0,0 +1,561 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+#include "library.h"
+
+// File layout: a fixed header, then each section at an 8-byte boundary.
+// Row sections hold the in-memory row structs back to back; text sections
+// hold the chunks of a text arena, so TextRefs stay valid once the arena
+// adopts the mapped bytes. Rows and checksums use the native byte order;
+// the version changes whenever a row struct does.
+#define SNAPSHOT_MAGIC "LIBSNAP"
+#define SNAPSHOT_VERSION 1
+
+enum {
+    SECTION_SYMBOLS,        // Interned strings in symbol order, each NUL-terminated
+    SECTION_BOOK_TEXT,      // Book text arena
+    SECTION_BOOKS,          // Book rows
+    SECTION_ISBN_INDEX,     // Slots of the ISBN index: every row, then every hash
+    SECTION_READER_TEXT,    // Reader text arena
+    SECTION_READERS,        // Live reader rows
+    SECTION_BORROWINGS,     // Borrowing rows
+    SECTION_COUNT
+};
+
+typedef struct {
+    unsigned long long offset;      // Start of the section in the file
+    unsigned long long size;        // Bytes in the section
+    unsigned long long count;       // Rows, strings, or live bytes of a text arena
+    unsigned long long checksum;    // Checksum of the section bytes
+    unsigned int rowSize;           // Size of one row, 0 for text sections
+    unsigned int reserved;
+} SnapshotSection;
+
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int sectionCount;
+    int nextReaderID;               // Keeps IDs of deleted readers from being reused
+    unsigned int generation;        // Counts saves; the journal names the one it follows
+    SnapshotSection sections[SECTION_COUNT];
+    unsigned long long checksum;    // Checksum of the header with this field set to 0
+} SnapshotHeader;
+
+// Generation of the snapshot loaded, or the last one handed out for a
+// save; 0 if there is none
+static unsigned int currentGeneration = 0;
+
+// Running checksum over 8-byte words; each step is a bijection of the
+// state, so any change to a single word changes the result
+typedef struct {
+    unsigned long long hash;
+    unsigned long long word;        // Bytes of an incomplete word
+    int pending;                    // Number of bytes in word
+    unsigned long long length;
+} Checksum;
+
+#define CHECKSUM_INIT { 0x9e3779b97f4a7c15ULL, 0, 0, 0 }
+
+static void checksumMix(Checksum *sum, unsigned long long word) {
+    unsigned long long hash = sum->hash ^ word;
+    sum->hash = ((hash << 31) | (hash >> 33)) * 0x100000001b3ULL;
+}
+
+/**
+ * @brief Adds bytes to a running checksum
+ * @param sum The checksum
+ * @param data The bytes
+ * @param size Number of bytes
+ * @return void
+ */
+static void checksumUpdate(Checksum *sum, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    sum->length += size;
+    while (size > 0 && sum->pending != 0) {
+        sum->word |= (unsigned long long)*bytes++ << (8 * sum->pending);
+        size--;
+        if (++sum->pending == 8) {
+            checksumMix(sum, sum->word);
+            sum->word = 0;
+            sum->pending = 0;
+        }
+    }
+    while (size >= 8) {
+        unsigned long long word;
+        memcpy(&word, bytes, 8);
+        checksumMix(sum, word);
+        bytes += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        sum->word |= (unsigned long long)*bytes++ << (8 * sum->pending++);
+        size--;
+    }
+}
+
+/**
+ * @brief Returns the checksum of everything added so far
+ * @param sum The checksum
+ * @return unsigned long long The checksum
+ */
+static unsigned long long checksumFinish(Checksum sum) {
+    checksumMix(&sum, sum.word);
+    checksumMix(&sum, sum.length);
+    return sum.hash ^ (sum.hash >> 29);
+}
+
+static unsigned long long checksumOf(const void *data, size_t size) {
+    Checksum sum = CHECKSUM_INIT;
+    checksumUpdate(&sum, data, size);
+    return checksumFinish(sum);
+}
+
+// Output file and the checksum of the section being written
+typedef struct {
+    FILE *file;
+    unsigned long long offset;
+    Checksum sum;
+} SnapshotWriter;
+
+// Writes bytes of the current section
+static int writeBytes(void *context, const void *data, size_t size) {
+    SnapshotWriter *writer = context;
+    checksumUpdate(&writer->sum, data, size);
+    writer->offset += size;
+    return fwrite(data, 1, size, writer->file) == size;
+}
+
+static void beginSection(SnapshotWriter *writer, SnapshotSection *section, unsigned int rowSize) {
+    Checksum sum = CHECKSUM_INIT;
+    writer->sum = sum;
+    section->offset = writer->offset;
+    section->rowSize = rowSize;
+}
+
+/**
+ * @brief Records the size and checksum of a section and pads the file
+ * @param writer The writer
+ * @param section The section that was just written
+ * @return int 1 on success, 0 on a write error
+ */
+static int endSection(SnapshotWriter *writer, SnapshotSection *section) {
+    static const char zeros[8] = { 0 };
+    section->size = writer->offset - section->offset;
+    section->checksum = checksumFinish(writer->sum);
+    size_t padding = (8 - writer->offset % 8) % 8;
+    writer->offset += padding;
+    return fwrite(zeros, 1, padding, writer->file) == padding;
+}
+
+/**
+ * @brief Writes a text arena as its own section
+ * @param writer The writer
+ * @param section The section to fill in
+ * @param text The arena
+ * @return int 1 on success, 0 on a write error
+ */
+static int writeText(SnapshotWriter *writer, SnapshotSection *section, const TextArena *text) {
+    beginSection(writer, section, 0);
+    section->count = text->liveBytes;
+    return arenaWrite(text, writeBytes, writer) && endSection(writer, section);
+}
+
+// Copies a string to the arena being written and points the reference at the copy
+static int copyText(TextArena *to, const TextArena *from, TextRef *ref) {
+    return arenaStore(to, arenaText(from, *ref), ref);
+}
+
+static int writeSymbols(SnapshotWriter *writer, SnapshotSection *section) {
+    beginSection(writer, section, 0);
+    section->count = (unsigned long long)symbolCount();
+    for (int i = 0; i < symbolCount(); i++) {
+        const char *text = symbolText((Symbol)i);
+        if (!writeBytes(writer, text, strlen(text) + 1)) {
+            return 0;
+        }
+    }
+    return endSection(writer, section);
+}
+
+/**
+ * @brief Writes the live book rows and their text
+ * @param writer The writer
+ * @param header The header to fill in
+ * @param bookCount Current number of book rows
+ * @param newRows Receives a malloc'd array giving the row each book gets
+ *                in the snapshot, -1 for deleted rows
+ * @return int 1 on success, 0 on error
+ *
+ * Deleted rows are skipped, so the snapshot holds live books back to
+ * back, and text is copied into a fresh arena on the way, which drops
+ * the strings that updates have replaced.
+ */
+static int writeBooks(SnapshotWriter *writer, SnapshotHeader *header, int bookCount, int **newRows) {
+    *newRows = malloc(sizeof(int) * (bookCount > 0 ? bookCount : 1));
+    if (*newRows == NULL) {
+        return 0;
+    }
+    TextArena text = TEXT_ARENA_INIT;
+    SnapshotSection *rows = &header->sections[SECTION_BOOKS];
+    beginSection(writer, rows, sizeof(Book));
+    rows->count = 0;
+    int ok = 1;
+    for (int i = 0; ok && i < bookCount; i++) {
+        if (!isBookLive(i)) {
+            (*newRows)[i] = -1;
+            continue;
+        }
+        Book book = *bookAt(i);
+        ok = copyText(&text, &bookText, &book.title) &&
+             copyText(&text, &bookText, &book.titleKey) &&
+             writeBytes(writer, &book, sizeof(Book));
+        (*newRows)[i] = (int)rows->count++;
+    }
+    ok = ok && endSection(writer, rows) &&
+         writeText(writer, &header->sections[SECTION_BOOK_TEXT], &text);
+    arenaFree(&text);
+    return ok;
+}
+
+/**
+ * @brief Writes the live reader rows and their text
+ * @param writer The writer
+ * @param header The header to fill in
+ * @param readerCount Current number of reader rows
+ * @return int 1 on success, 0 on error
+ *
+ * Deleted rows are skipped, so the snapshot holds live readers back to back.
+ */
+static int writeReaders(SnapshotWriter *writer, SnapshotHeader *header, int readerCount) {
+    TextArena text = TEXT_ARENA_INIT;
+    SnapshotSection *rows = &header->sections[SECTION_READERS];
+    beginSection(writer, rows, sizeof(Reader));
+    rows->count = 0;
+    int ok = 1;
+    for (int i = 0; ok && i < readerCount; i++) {
+        if (!isReaderLive(i)) {
+            continue;
+        }
+        Reader reader = *readerAt(i);
+        ok = copyText(&text, &readerText, &reader.name) &&
+             copyText(&text, &readerText, &reader.CMND) &&
+             copyText(&text, &readerText, &reader.email) &&
+             copyText(&text, &readerText, &reader.phone) &&
+             copyText(&text, &readerText, &reader.address) &&
+             copyText(&text, &readerText, &reader.nameKey) &&
+             copyText(&text, &readerText, &reader.emailKey) &&
+             writeBytes(writer, &reader, sizeof(Reader));
+        rows->count++;
+    }
+    ok = ok && endSection(writer, rows) &&
+         writeText(writer, &header->sections[SECTION_READER_TEXT], &text);
+    arenaFree(&text);
+    return ok;
+}
+
+/**
+ * @brief Writes the slots of a hash index
+ * @param writer The writer
+ * @param section The section to fill in
+ * @param index The index
+ * @param newRows Row each indexed row gets in the snapshot (see writeBooks)
+ * @return int 1 on success, 0 on a write error
+ */
+static int writeHashIndex(SnapshotWriter *writer, SnapshotSection *section, const HashIndex *index,
+                          const int *newRows) {
+    beginSection(writer, section, sizeof(int) + sizeof(unsigned int));
+    section->count = (unsigned long long)index->capacity;
+    int chunk[1024];
+    for (int i = 0; i < index->capacity; i += 1024) {
+        int count = index->capacity - i < 1024 ? index->capacity - i : 1024;
+        for (int j = 0; j < count; j++) {
+            int row = index->rows[i + j];
+            chunk[j] = row >= 0 ? newRows[row] : row;
+        }
+        if (!writeBytes(writer, chunk, sizeof(int) * count)) {
+            return 0;
+        }
+    }
+    return writeBytes(writer, index->hashes, sizeof(unsigned int) * index->capacity) &&
+           endSection(writer, section);
+}
+
+static int writeBorrowings(SnapshotWriter *writer, SnapshotSection *section, int borrowingCount) {
+    beginSection(writer, section, sizeof(Borrowing));
+    section->count = (unsigned long long)borrowingCount;
+    for (int i = 0; i < borrowingCount; i++) {
+        if (!writeBytes(writer, borrowingAt(i), sizeof(Borrowing))) {
+            return 0;
+        }
+    }
+    return endSection(writer, section);
+}
+
+/**
+ * @brief Makes a rename in the directory of a file durable
+ * @param path The file that was renamed
+ * @return int 1 on success, 0 on error
+ */
+int syncDirectory(const char *path) {
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), "%s", path);
+    char *slash = strrchr(directory, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else if (slash == directory) {
+        slash[1] = 0;
+    } else {
+        *slash = 0;
+    }
+    int fd = open(directory, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Writes every table to a snapshot file
+ * @param path The snapshot file
+ * @param generation Generation of the new snapshot (see nextSnapshotGeneration)
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return int 1 on success, 0 on error (the previous snapshot is kept)
+ *
+ * The snapshot is written to a temporary file, synced and renamed over
+ * the old one, so a crash never leaves a half-written snapshot behind.
+ * A snapshot that is currently mapped keeps its old contents as well.
+ */
+int saveSnapshot(const char *path, unsigned int generation, int bookCount, int readerCount, int borrowingCount) {
+    char tempPath[PATH_MAX];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        printf("Error opening file for writing.\n");
+        return 0;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.sectionCount = SECTION_COUNT;
+    header.nextReaderID = readerSlots.nextID;
+    header.generation = generation;
+
+    // The header is written again once the sections are known
+    SnapshotWriter writer = { file, 0, CHECKSUM_INIT };
+    int *newBookRows = NULL;
+    int ok = writeBytes(&writer, &header, sizeof(header)) &&
+             writeSymbols(&writer, &header.sections[SECTION_SYMBOLS]) &&
+             writeBooks(&writer, &header, bookCount, &newBookRows) &&
+             writeHashIndex(&writer, &header.sections[SECTION_ISBN_INDEX], bookISBNIndex(), newBookRows) &&
+             writeReaders(&writer, &header, readerCount) &&
+             writeBorrowings(&writer, &header.sections[SECTION_BORROWINGS], borrowingCount);
+    free(newBookRows);
+    header.checksum = checksumOf(&header, sizeof(header));
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        printf("Error writing snapshot %s.\n", path);
+        return 0;
+    }
+    if (!syncDirectory(path)) {
+        printf("Error writing snapshot %s.\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the generation of the snapshot that was loaded
+ * @return unsigned int The generation, 0 if no snapshot was loaded
+ */
+unsigned int snapshotGeneration(void) {
+    return currentGeneration;
+}
+
+/**
+ * @brief Hands out the generation for the next save
+ * @return unsigned int A generation no earlier save attempt has used
+ */
+unsigned int nextSnapshotGeneration(void) {
+    return ++currentGeneration;
+}
+
+/**
+ * @brief Checks the header and every section of a mapped snapshot
+ * @param data The mapped file
+ * @param size Size of the file
+ * @return const char* NULL if the snapshot is sound, otherwise the problem
+ */
+static const char *checkSnapshot(const char *data, size_t size) {
+    static const unsigned int rowSizes[SECTION_COUNT] = {
+        [SECTION_BOOKS] = sizeof(Book),
+        [SECTION_ISBN_INDEX] = sizeof(int) + sizeof(unsigned int),
+        [SECTION_READERS] = sizeof(Reader),
+        [SECTION_BORROWINGS] = sizeof(Borrowing),
+    };
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        return "not a snapshot file";
+    }
+    if (header.version != SNAPSHOT_VERSION || header.sectionCount != SECTION_COUNT) {
+        return "written by an incompatible version";
+    }
+    unsigned long long checksum = header.checksum;
+    header.checksum = 0;
+    if (checksumOf(&header, sizeof(header)) != checksum) {
+        return "header checksum mismatch";
+    }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        const SnapshotSection *section = &header.sections[i];
+        if (section->offset > size || section->size > size - section->offset) {
+            return "section extends past the end of the file";
+        }
+        if (section->rowSize != rowSizes[i] ||
+            (section->rowSize != 0 && (section->count > INT_MAX ||
+                                       section->size != section->count * section->rowSize))) {
+            return "row layout does not match this version";
+        }
+        if (checksumOf(data + section->offset, section->size) != section->checksum) {
+            return "section checksum mismatch";
+        }
+    }
+    const SnapshotSection *symbols = &header.sections[SECTION_SYMBOLS];
+    if (symbols->size > 0 && data[symbols->offset + symbols->size - 1] != '\0') {
+        return "unterminated string";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Interns the strings of the symbol section
+ * @param data The mapped file
+ * @param section The symbol section
+ * @param remap Receives the symbol each stored symbol now has
+ * @return int 1 if every symbol kept its number, 0 if rows need remapping
+ *
+ * Symbols keep their numbers when the pool is empty at load time, which
+ * is the usual case on startup.
+ */
+static int loadSymbols(const char *data, const SnapshotSection *section, Symbol *remap) {
+    const char *text = data + section->offset;
+    const char *end = text + section->size;
+    int identity = 1;
+    for (unsigned long long i = 0; i < section->count; i++) {
+        remap[i] = text < end ? internString(text) : 0;
+        if (remap[i] != i) {
+            identity = 0;
+        }
+        text += text < end ? strlen(text) + 1 : 0;
+    }
+    return identity;
+}
+
+static Symbol remapSymbol(const Symbol *remap, unsigned long long count, Symbol symbol) {
+    return symbol < count ? remap[symbol] : 0;
+}
+
+/**
+ * @brief Loads every table from a snapshot file
+ * @param path The snapshot file
+ * @param bookCount Receives the number of books
+ * @param readerCount Receives the number of reader rows
+ * @param borrowingCount Receives the number of borrowings
+ * @return int 1 on success, 0 if the file is missing, corrupt or was
+ *             written by an incompatible version
+ *
+ * The file is mapped privately and stays mapped: rows are copied into the
+ * tables, while the text arenas use the mapped chunks in place.
+ */
+int loadSnapshot(const char *path, int *bookCount, int *readerCount, int *borrowingCount) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        printf("Snapshot %s not loaded: file is too short.\n", path);
+        return 0;
+    }
+    size_t size = (size_t)info.st_size;
+    char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Snapshot %s not loaded: cannot map file.\n", path);
+        return 0;
+    }
+    const char *error = checkSnapshot(data, size);
+    if (error != NULL) {
+        printf("Snapshot %s not loaded: %s.\n", path, error);
+        munmap(data, size);
+        return 0;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    const SnapshotSection *sections = header.sections;
+    Symbol *remap = malloc(sizeof(Symbol) * (sections[SECTION_SYMBOLS].count + 1));
+    int books = (int)sections[SECTION_BOOKS].count;
+    int readers = (int)sections[SECTION_READERS].count;
+    int borrowings = (int)sections[SECTION_BORROWINGS].count;
+    if (remap == NULL ||
+        !tableLoadRows(&bookTable, data + sections[SECTION_BOOKS].offset, books) ||
+        !tableLoadRows(&readerTable, data + sections[SECTION_READERS].offset, readers) ||
+        !tableLoadRows(&borrowingTable, data + sections[SECTION_BORROWINGS].offset, borrowings) ||
+        !arenaAdopt(&bookText, data + sections[SECTION_BOOK_TEXT].offset,
+                    sections[SECTION_BOOK_TEXT].size, sections[SECTION_BOOK_TEXT].count) ||
+        !arenaAdopt(&readerText, data + sections[SECTION_READER_TEXT].offset,
+                    sections[SECTION_READER_TEXT].size, sections[SECTION_READER_TEXT].count)) {
+        free(remap);
+        printf("Not enough memory to load snapshot %s.\n", path);
+        return 0;
+    }
+
+    if (!loadSymbols(data, &sections[SECTION_SYMBOLS], remap)) {
+        unsigned long long symbols = sections[SECTION_SYMBOLS].count;
+        for (int i = 0; i < books; i++) {
+            Book *book = bookAt(i);
+            book->author = remapSymbol(remap, symbols, book->author);
+            book->publisher = remapSymbol(remap, symbols, book->publisher);
+            book->category = remapSymbol(remap, symbols, book->category);
+            book->authorKey = remapSymbol(remap, symbols, book->authorKey);
+        }
+    }
+    free(remap);
+
+    *bookCount = books;
+    const SnapshotSection *isbnSection = &sections[SECTION_ISBN_INDEX];
+    const int *isbnRows = (const int *)(data + isbnSection->offset);
+    const unsigned int *isbnHashes = (const unsigned int *)(isbnRows + isbnSection->count);
+    restoreBookIndexes(*bookCount, isbnRows, isbnHashes, (int)isbnSection->count);
+
+    *readerCount = readers;
+    restoreReaders(readerCount);
+    if (header.nextReaderID > readerSlots.nextID) {
+        readerSlots.nextID = header.nextReaderID;
+    }
+
+    currentGeneration = header.generation;
+
+    *borrowingCount = borrowings;
+    restoreBorrowings(borrowings);
+
+    printf("Loaded %d books, %d readers and %d borrowings from %s.\n",
+           *bookCount, liveReaderCount(), *borrowingCount, path);
+    return 1;
+}
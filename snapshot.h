@@ -0,0 +1,60 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Binary snapshot of the whole library, written on exit and loaded on startup
+#define SNAPSHOT_FILE "library.dat"
+
+/**
+ * @brief Writes every table to a snapshot file
+ * @param path The snapshot file
+ * @param generation Generation of the new snapshot (see nextSnapshotGeneration)
+ * @param bookCount Current number of books
+ * @param readerCount Current number of reader rows
+ * @param borrowingCount Current number of borrowings
+ * @return int 1 on success, 0 on error (the previous snapshot is kept)
+ *
+ * The snapshot is written to a temporary file, synced and renamed over
+ * the old one, so a crash never leaves a half-written snapshot behind.
+ */
+int saveSnapshot(const char *path, unsigned int generation, int bookCount, int readerCount, int borrowingCount);
+
+/**
+ * @brief Loads every table from a snapshot file
+ * @param path The snapshot file
+ * @param bookCount Receives the number of books
+ * @param readerCount Receives the number of reader rows
+ * @param borrowingCount Receives the number of borrowings
+ * @return int 1 on success, 0 if the file is missing, corrupt or was
+ *             written by an incompatible version
+ *
+ * The file is mapped into memory; rows are copied into the tables and
+ * text is used in place.
+ */
+int loadSnapshot(const char *path, int *bookCount, int *readerCount, int *borrowingCount);
+
+/**
+ * @brief Returns the generation of the snapshot that was loaded
+ * @return unsigned int The generation, 0 if no snapshot was loaded
+ *
+ * Every save gets a new generation, so a journal can tell whether it was
+ * written against the snapshot on disk.
+ */
+unsigned int snapshotGeneration(void);
+
+/**
+ * @brief Hands out the generation for the next save
+ * @return unsigned int A generation no earlier save attempt has used
+ *
+ * Failed saves use up their generation too, so a number that reached the
+ * journal always names one snapshot.
+ */
+unsigned int nextSnapshotGeneration(void);
+
+/**
+ * @brief Makes a rename in the directory of a file durable
+ * @param path The file that was renamed
+ * @return int 1 on success, 0 on error
+ */
+int syncDirectory(const char *path);
+
+#endif // SNAPSHOT_H
@@ -1,4 +1,7 @@
 #include "stats.h"
+#include "counters.h"
+#include "aggregate.h"
+#include "output.h"
 
 /**
  * @brief Displays book statistics
@@ -6,31 +9,32 @@
  * @return void
  * 
  * This function shows various statistics about the books in the library.
+ * The figures come from the running counters, so no book is looked at.
  */
 void displayBookStatistics(int bookCount) {
-    if (bookCount == 0) {
+    if (liveBookCount(bookCount) == 0) {
         printf("No books in the library.\n");
         return;
     }
-    printf("\nBook Statistics:\n");
-    printf("----------------------------------------\n");
-    printf("Total number of books: %d\n", bookCount);
-    float totalValue = 0;
-    for (int i = 0; i < bookCount; i++) {
-        totalValue += bookPrice[i] * bookQuantity[i];
-    }
-    printf("Total value of books: %.2f\n", totalValue);
-    printf("\nBooks by Category:\n");
-    for (int i = 0; i < bookCount; i++) {
-        int count = 1;
-        for (int j = i + 1; j < bookCount; j++) {
-            if (strcmp(bookCategory[i], bookCategory[j]) == 0) {
-                count++;
-            }
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nBook Statistics:\n");
+    outputText(out, "----------------------------------------\n");
+    outputText(out, "Total number of books: ");
+    outputNumber(out, liveBookCount(bookCount));
+    outputText(out, "\nTotal value of books: ");
+    outputPrice(out, libraryCounters.inventoryValue);
+    outputText(out, "\n\nBooks by Category:\n");
+    const CountMap *categories = &libraryCounters.booksByCategory;
+    for (int i = 0; i < categories->groupCount; i++) {
+        if (categories->counts[i] > 0) {
+            outputText(out, symbolText((Symbol)categories->keys[i]));
+            outputText(out, ": ");
+            outputNumber(out, categories->counts[i]);
+            outputBytes(out, "\n", 1);
         }
-        printf("%s: %d\n", bookCategory[i], count);
     }
-    printf("----------------------------------------\n");
+    outputText(out, "----------------------------------------\n");
+    outputFlush(out);
 }
 
 /**
@@ -38,27 +42,32 @@ void displayBookStatistics(int bookCount) {
  * @param readerCount Current number of readers in the system
  * @return void
  * 
- * This function shows various statistics about the readers.
+ * This function shows various statistics about the readers, taken from
+ * the running counters.
  */
 void displayReaderStatistics(int readerCount) {
-    if (readerCount == 0) {
+    (void)readerCount;
+    if (liveReaderCount() == 0) {
         printf("No readers registered.\n");
         return;
     }
-    printf("\nReader Statistics:\n");
-    printf("----------------------------------------\n");
-    printf("Total number of readers: %d\n", readerCount);
-    printf("\nReaders by Membership Year:\n");
-    for (int i = 0; i < readerCount; i++) {
-        int count = 1;
-        for (int j = i + 1; j < readerCount; j++) {
-            if (readerMembershipYear[i] == readerMembershipYear[j]) {
-                count++;
-            }
+    OutputBuffer *out = screenOutput();
+    outputText(out, "\nReader Statistics:\n");
+    outputText(out, "----------------------------------------\n");
+    outputText(out, "Total number of readers: ");
+    outputNumber(out, liveReaderCount());
+    outputText(out, "\n\nReaders by Membership Year:\n");
+    const CountMap *years = &libraryCounters.readersByYear;
+    for (int i = 0; i < years->groupCount; i++) {
+        if (years->counts[i] > 0) {
+            outputNumber(out, years->keys[i]);
+            outputText(out, ": ");
+            outputNumber(out, years->counts[i]);
+            outputBytes(out, "\n", 1);
         }
-        printf("%d: %d\n", readerMembershipYear[i], count);
     }
-    printf("----------------------------------------\n");
+    outputText(out, "----------------------------------------\n");
+    outputFlush(out);
 }
 
 /**
@@ -69,19 +78,17 @@ void displayReaderStatistics(int readerCount) {
  * This function shows the distribution of readers by gender.
  */
 void displayGenderStatistics(int readerCount) {
-    int maleCount = 0;
-    int femaleCount = 0;
-    for (int i = 0; i < readerCount; i++) {
-        if (strcmp(readerGender[i], "Male") == 0) {
-            maleCount++;
-        } else if (strcmp(readerGender[i], "Female") == 0) {
-            femaleCount++;
-        }
-    }
+    (void)readerCount;
+    int maleCount = libraryCounters.readersByGender[GENDER_MALE];
+    int femaleCount = libraryCounters.readersByGender[GENDER_FEMALE];
     printf("\n=== Gender Statistics ===\n");
-    printf("Total Readers: %d\n", readerCount);
-    printf("Male Readers: %d (%.1f%%)\n", maleCount, (float)maleCount / readerCount * 100);
-    printf("Female Readers: %d (%.1f%%)\n", femaleCount, (float)femaleCount / readerCount * 100);
+    int total = liveReaderCount();
+    printf("Total Readers: %d\n", total);
+    if (total == 0) {
+        return;
+    }
+    printf("Male Readers: %d (%.1f%%)\n", maleCount, (float)maleCount / total * 100);
+    printf("Female Readers: %d (%.1f%%)\n", femaleCount, (float)femaleCount / total * 100);
 }
 
 /**
@@ -98,29 +105,42 @@ void displayBorrowingStatistics(int borrowingCount) {
     printf("----------------------------------------\n");
 }
 
+// Running totals over the overdue loans
+typedef struct {
+    time_t now;
+    long long totalFine;
+} OverdueTotals;
+
+/**
+ * @brief Adds the fine of one overdue loan to the totals
+ * @param entry The loan
+ * @param context The OverdueTotals being filled
+ * @return void
+ */
+static void addOverdueFine(const DueEntry *entry, void *context) {
+    OverdueTotals *totals = context;
+    totals->totalFine += calculateFine(entry->dueDate, totals->now);
+}
+
 /**
  * @brief Displays statistics about overdue borrowings
  * @param borrowingCount Current number of borrowings
  * @return void
  * 
- * This function shows statistics about overdue borrowings.
+ * This function shows statistics about overdue borrowings. Only the
+ * overdue loans at the top of the due queue are looked at.
  */
 void displayOverdueStatistics(int borrowingCount) {
-    time_t currentTime = time(NULL);
-    int overdueCount = 0;
-    int totalFine = 0;
-    for (int i = 0; i < borrowingCount; i++) {
-        if (currentTime > dueDate[i]) {
-            overdueCount++;
-            totalFine += calculateFine(dueDate[i], currentTime);
-        }
-    }
+    OverdueTotals totals = { time(NULL), 0 };
+    int openCount = dueQueueCount(&openLoans);
+    int overdueCount = dueQueueVisitBefore(&openLoans, totals.now, addOverdueFine, &totals);
     printf("\n=== Overdue Statistics ===\n");
     printf("Total Borrowings: %d\n", borrowingCount);
-    printf("Overdue Borrowings: %d (%.1f%%)\n", overdueCount, (float)overdueCount / borrowingCount * 100);
-    printf("Total Fine: %d VND\n", totalFine);
+    printf("Open Borrowings: %d\n", openCount);
+    printf("Overdue Borrowings: %d (%.1f%%)\n", overdueCount, openCount > 0 ? (float)overdueCount / openCount * 100 : 0.0f);
+    printf("Total Fine: %lld VND\n", totals.totalFine);
     if (overdueCount > 0) {
-        printf("Average Fine per Overdue: %.0f VND\n", (float)totalFine / overdueCount);
+        printf("Average Fine per Overdue: %.0f VND\n", (double)totals.totalFine / overdueCount);
     }
 }
 
@@ -132,14 +152,9 @@ void displayOverdueStatistics(int borrowingCount) {
  * This function shows statistics about books that are currently borrowed.
  */
 void displayCurrentlyBorrowedBooks(int borrowingCount) {
-    int totalBorrowedBooks = 0;
-    int activeBorrowings = 0;
-    for (int i = 0; i < borrowingCount; i++) {
-        if (!isReturned[i]) {
-            totalBorrowedBooks += borrowingBookCount[i];
-            activeBorrowings++;
-        }
-    }
+    (void)borrowingCount;
+    int totalBorrowedBooks = libraryCounters.booksOut;
+    int activeBorrowings = libraryCounters.activeLoans;
     printf("\n=== Currently Borrowed Books Statistics ===\n");
     printf("Total Active Borrowings: %d\n", activeBorrowings);
     printf("Total Books Currently Borrowed: %d\n", totalBorrowedBooks);
@@ -148,32 +163,187 @@ void displayCurrentlyBorrowedBooks(int borrowingCount) {
     }
 }
 
+// Overdue loans collected from the due queue
+typedef struct {
+    DueEntry *entries;
+    int count;
+} OverdueList;
+
+/**
+ * @brief Appends one overdue loan to a list sized for all of them
+ * @param entry The loan
+ * @param context The OverdueList being filled
+ * @return void
+ */
+static void collectOverdue(const DueEntry *entry, void *context) {
+    OverdueList *list = context;
+    list->entries[list->count++] = *entry;
+}
+
+/**
+ * @brief Orders loans by due date, then by row
+ * @param a First DueEntry
+ * @param b Second DueEntry
+ * @return int Negative, zero or positive as for qsort
+ */
+static int compareDueEntries(const void *a, const void *b) {
+    const DueEntry *first = a;
+    const DueEntry *second = b;
+    if (first->dueDate != second->dueDate) {
+        return first->dueDate < second->dueDate ? -1 : 1;
+    }
+    return first->row - second->row;
+}
+
 /**
  * @brief Displays all overdue borrowings
+ * @param bookCount Current number of books
  * @param borrowingCount Current number of borrowings
  * @return void
  * 
- * This function shows all borrowing records that are past their due date.
+ * This function shows the borrowings that are past their due date and
+ * not yet returned, longest overdue first. The loans are taken from the
+ * top of the due queue, so the cost depends on how many are overdue
+ * rather than on the number of borrowings. Dates are shown in local time,
+ * taking the offset from UTC once for the whole report.
  */
-void displayOverdueBorrowings(int borrowingCount) {
+void displayOverdueBorrowings(int bookCount, int borrowingCount) {
+    (void)borrowingCount;
     time_t currentTime = time(NULL);
-    int found = 0;
     printf("\n=== Overdue Borrowings ===\n");
-    for (int i = 0; i < borrowingCount; i++) {
-        if (currentTime > dueDate[i]) {
-            printf("\nBorrowing ID: %d\n", i);
-            printf("Reader: %s (CMND: %s)\n", readerName[borrowingReaderID[i]], readerCMND[borrowingReaderID[i]]);
-            printf("Books:\n");
-            for (int j = 0; j < borrowingBookCount[i]; j++) {
-                printf("- %s (ISBN: %s)\n", borrowingBooks[i][j], bookISBN[findBookByISBN(MAX_BOOKS, borrowingBooks[i][j])]);
-            }
-            printf("Borrow Date: %s", ctime(&borrowingDate[i]));
-            printf("Due Date: %s", ctime(&dueDate[i]));
-            printf("Fine: %d VND\n", calculateFine(dueDate[i], currentTime));
-            found = 1;
+    OverdueList list = { malloc(sizeof(DueEntry) * (size_t)(dueQueueCount(&openLoans) + 1)), 0 };
+    if (list.entries == NULL) {
+        printf("Not enough memory to list overdue borrowings.\n");
+        return;
+    }
+    dueQueueVisitBefore(&openLoans, currentTime, collectOverdue, &list);
+    qsort(list.entries, list.count, sizeof(DueEntry), compareDueEntries);
+    long offset = localTimeOffset(currentTime);
+    OutputBuffer *out = screenOutput();
+    for (int i = 0; i < list.count; i++) {
+        const Borrowing *borrowing = borrowingAt(list.entries[i].row);
+        outputText(out, "\nBorrowing ID: ");
+        outputNumber(out, list.entries[i].row);
+        int readerIndex = findReaderOfBorrowing(borrowing);
+        if (readerIndex != -1) {
+            outputText(out, "\nReader: ");
+            outputText(out, readerString(readerAt(readerIndex)->name));
+            outputText(out, " (CMND: ");
+            outputText(out, readerString(readerAt(readerIndex)->CMND));
+            outputText(out, ")\n");
+        } else {
+            outputText(out, "\nReader: deleted (ID: ");
+            outputNumber(out, borrowing->readerID);
+            outputText(out, ")\n");
+        }
+        outputText(out, "Books:\n");
+        for (int j = 0; j < borrowing->bookCount; j++) {
+            int bookIndex = findBookByISBN(bookCount, borrowing->books[j]);
+            char ISBN[ISBN_LENGTH];
+            formatISBN(borrowing->books[j], ISBN);
+            outputText(out, "- ");
+            outputText(out, bookIndex != -1 ? bookString(bookAt(bookIndex)->title) : "unknown");
+            outputText(out, " (ISBN: ");
+            outputText(out, ISBN);
+            outputText(out, ")\n");
         }
+        outputText(out, "Borrow Date: ");
+        outputTime(out, borrowing->borrowingDate + offset);
+        outputText(out, "\nDue Date: ");
+        outputTime(out, borrowing->dueDate + offset);
+        outputText(out, "\nFine: ");
+        outputNumber(out, calculateFine(borrowing->dueDate, currentTime));
+        outputText(out, " VND\n");
+    }
+    if (list.count == 0) {
+        outputText(out, "No overdue borrowings found.\n");
+    }
+    outputFlush(out);
+    free(list.entries);
+}
+
+/**
+ * @brief Prints the memory held by one table
+ * @param name Name of the table
+ * @param rows Rows in use
+ * @param table The table
+ * @param arena The table's text arena, or NULL if it has none
+ * @return size_t Bytes held by the table and its arena
+ */
+static size_t printTableMemory(const char *name, int rows, const Table *table, const TextArena *arena) {
+    size_t bytes = tableMemoryUsage(table);
+    printf("%-11s %8d rows x %4zu bytes, %10zu bytes allocated", name, rows, table->rowSize, bytes);
+    if (arena != NULL) {
+        printf(", text %zu bytes (%zu live, %zu replaced)",
+               arenaMemoryUsage(arena), arena->liveBytes, arena->garbageBytes);
+        bytes += arenaMemoryUsage(arena);
+    }
+    printf("\n");
+    return bytes;
+}
+
+/**
+ * @brief Displays the memory used by the tables and their text storage
+ * @param bookCount Current number of books
+ * @param borrowingCount Current number of borrowings
+ * @return void
+ *
+ * Row sizes show the packed layout; text is counted separately in the
+ * arenas and the interned string pool.
+ */
+void displayMemoryUsage(int bookCount, int borrowingCount) {
+    printf("\n=== Memory Usage ===\n");
+    size_t total = 0;
+    total += printTableMemory("Books:", liveBookCount(bookCount), &bookTable, &bookText);
+    total += printTableMemory("Readers:", liveReaderCount(), &readerTable, &readerText);
+    total += printTableMemory("Borrowings:", borrowingCount, &borrowingTable, NULL);
+    printf("%-11s %8d strings, %10zu bytes allocated\n", "Interned:", symbolCount(), internMemoryUsage());
+    total += internMemoryUsage();
+    printf("Total: %zu bytes\n", total);
+}
+
+/**
+ * @brief Groups a table by fields the user picks and prints aggregates per group
+ * @param bookCount Current number of books
+ * @param readerCount Current number of readers
+ * @param borrowingCount Current number of borrowings
+ * @return void
+ *
+ * Answers questions such as loans per category per month or average
+ * price by publisher and year in one pass over the table.
+ */
+void displayCustomReport(int bookCount, int readerCount, int borrowingCount) {
+    char table[MAX_STRING];
+    printf("\n=== Custom Report ===\n");
+    printf("Table (books, readers, borrowings, loans): ");
+    fgets(table, MAX_STRING, stdin);
+    table[strcspn(table, "\n")] = 0;
+    if (!listAggregateFields(stdout, table)) {
+        printf("Unknown table!\n");
+        return;
     }
-    if (!found) {
-        printf("No overdue borrowings found.\n");
+
+    char keys[MAX_STRING];
+    printf("Group by (comma-separated fields, or press Enter for one group): ");
+    fgets(keys, MAX_STRING, stdin);
+    keys[strcspn(keys, "\n")] = 0;
+
+    char values[MAX_STRING];
+    printf("Aggregates (e.g. count,avg:price; press Enter for count): ");
+    fgets(values, MAX_STRING, stdin);
+    values[strcspn(values, "\n")] = 0;
+    if (strlen(values) == 0) {
+        strcpy(values, "count");
     }
-} 
\ No newline at end of file
+
+    Aggregation aggregation = AGGREGATION_INIT;
+    const char *error = runAggregation(&aggregation, table, keys, values, bookCount, readerCount, borrowingCount);
+    if (error != NULL) {
+        printf("Cannot run the report: %s\n", error);
+    } else {
+        printf("\n");
+        writeAggregation(stdout, &aggregation, " | ");
+        printf("(%d groups)\n", aggregation.groupCount);
+    }
+    freeAggregation(&aggregation);
+}
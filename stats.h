@@ -9,6 +9,8 @@ void displayGenderStatistics(int readerCount);
 void displayBorrowingStatistics(int borrowingCount);
 void displayOverdueStatistics(int borrowingCount);
 void displayCurrentlyBorrowedBooks(int borrowingCount);
-void displayOverdueBorrowings(int borrowingCount);
+void displayOverdueBorrowings(int bookCount, int borrowingCount);
+void displayMemoryUsage(int bookCount, int borrowingCount);
+void displayCustomReport(int bookCount, int readerCount, int borrowingCount);
 
 #endif // STATS_H 
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include "substring.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define SUBSTRING_SIMD 1
+#endif
+
+// Progress of a scan over packed text
+typedef struct {
+    const SubstringPattern *pattern;
+    const PackedText *packed;
+    int *rows;                  // Matching rows found so far
+    int count;
+    int entry;                  // No match lies in an entry before this one
+} PackedScan;
+
+// Scans packed text from a position to the end
+typedef void (*SubstringKernel)(PackedScan *scan, size_t from);
+
+/**
+ * @brief Finds the entry a position of packed text falls in
+ * @param packed The packed text
+ * @param from An entry at or before the position
+ * @param position The position
+ * @return int The entry
+ *
+ * Dense matches mostly fall in the entry the scan is at, which is tried
+ * before the binary search.
+ */
+static int entryAt(const PackedText *packed, int from, size_t position) {
+    if (from + 1 >= packed->count || packed->starts[from + 1] > position) {
+        return from;
+    }
+    int low = from + 1;
+    int high = packed->count - 1;
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        if (packed->starts[middle] <= position) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Records a match and skips the rest of its entry
+ * @param scan The scan
+ * @param at Position of the match
+ * @return size_t Position the scan resumes at
+ *
+ * A match cannot cross the NUL between two entries, since the term holds
+ * none, so it lies inside one entry and the row is known.
+ */
+static size_t recordMatch(PackedScan *scan, size_t at) {
+    const PackedText *packed = scan->packed;
+    int entry = entryAt(packed, scan->entry, at);
+    if (scan->count == 0 || scan->rows[scan->count - 1] != packed->rows[entry]) {
+        scan->rows[scan->count++] = packed->rows[entry];
+    }
+    scan->entry = entry + 1;
+    return scan->entry < packed->count ? packed->starts[scan->entry] : packed->size;
+}
+
+/**
+ * @brief Scans one position at a time
+ * @param scan The scan, for a term at least one byte long
+ * @param from First position to try
+ * @return void
+ */
+static void scanScalar(PackedScan *scan, size_t from) {
+    const char *data = scan->packed->data;
+    size_t size = scan->packed->size;
+    size_t length = scan->pattern->length;
+    const char *term = scan->pattern->term;
+    while (from + length <= size) {
+        const char *hit = memchr(data + from, term[0], size - length + 1 - from);
+        if (hit == NULL) {
+            return;
+        }
+        size_t at = (size_t)(hit - data);
+        from = memcmp(hit, term, length) == 0 ? recordMatch(scan, at) : at + 1;
+    }
+}
+
+#ifdef SUBSTRING_SIMD
+/**
+ * @brief Scans sixteen positions at a time with SSE2
+ * @param scan The scan, for a term at least one byte long
+ * @param from First position to try
+ * @return void
+ *
+ * Each step loads the sixteen bytes that would start a match and the
+ * sixteen that would end one; positions where both the first and the last
+ * byte of the term line up are compared in full. Loads never go past the
+ * text, the last positions are left to scanScalar.
+ */
+static void scanSSE2(PackedScan *scan, size_t from) {
+    const char *data = scan->packed->data;
+    size_t size = scan->packed->size;
+    size_t length = scan->pattern->length;
+    const char *term = scan->pattern->term;
+    const __m128i first = _mm_shuffle_epi32(_mm_cvtsi32_si128(0x01010101 * (unsigned char)term[0]), 0);
+    const __m128i last = _mm_shuffle_epi32(_mm_cvtsi32_si128(0x01010101 * (unsigned char)term[length - 1]), 0);
+    size_t i = from;
+    while (i + length - 1 + 16 <= size) {
+        __m128i starts = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i ends = _mm_loadu_si128((const __m128i *)(data + i + length - 1));
+        unsigned int bits = (unsigned int)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, last)));
+        size_t next = i + 16;
+        while (bits != 0) {
+            size_t at = i + (size_t)__builtin_ctz(bits);
+            if (length <= 2 || memcmp(data + at + 1, term + 1, length - 2) == 0) {
+                next = recordMatch(scan, at);
+                break;
+            }
+            bits &= bits - 1;
+        }
+        i = next;
+    }
+    scanScalar(scan, i);
+}
+
+/**
+ * @brief Scans 32 positions at a time with AVX2
+ * @param scan The scan, for a term at least one byte long
+ * @param from First position to try
+ * @return void
+ *
+ * The same filter as scanSSE2 on twice the width; the last positions are
+ * left to scanSSE2.
+ */
+__attribute__((target("avx2")))
+static void scanAVX2(PackedScan *scan, size_t from) {
+    const char *data = scan->packed->data;
+    size_t size = scan->packed->size;
+    size_t length = scan->pattern->length;
+    const char *term = scan->pattern->term;
+    const __m256i first = _mm256_broadcastb_epi8(_mm_cvtsi32_si128((unsigned char)term[0]));
+    const __m256i last = _mm256_broadcastb_epi8(_mm_cvtsi32_si128((unsigned char)term[length - 1]));
+    size_t i = from;
+    while (i + length - 1 + 32 <= size) {
+        __m256i starts = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i ends = _mm256_loadu_si256((const __m256i *)(data + i + length - 1));
+        unsigned int bits = (unsigned int)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(starts, first), _mm256_cmpeq_epi8(ends, last)));
+        size_t next = i + 32;
+        while (bits != 0) {
+            size_t at = i + (size_t)__builtin_ctz(bits);
+            if (length <= 2 || memcmp(data + at + 1, term + 1, length - 2) == 0) {
+                next = recordMatch(scan, at);
+                break;
+            }
+            bits &= bits - 1;
+        }
+        i = next;
+    }
+    scanSSE2(scan, i);
+}
+#endif
+
+// Returns the widest kernel the processor runs
+static SubstringKernel substringKernel(void) {
+    static SubstringKernel kernel = NULL;
+    if (kernel == NULL) {
+#ifdef SUBSTRING_SIMD
+        __builtin_cpu_init();
+        kernel = __builtin_cpu_supports("avx2") ? scanAVX2 : scanSSE2;
+#else
+        kernel = scanScalar;
+#endif
+    }
+    return kernel;
+}
+
+// Names the instructions the scans use on this processor
+const char *substringKernelName(void) {
+#ifdef SUBSTRING_SIMD
+    SubstringKernel kernel = substringKernel();
+    if (kernel == scanAVX2) {
+        return "AVX2";
+    }
+    if (kernel == scanSSE2) {
+        return "SSE2";
+    }
+#endif
+    return "scalar";
+}
+
+// Prepares a term for scanPackedText
+void prepareSubstring(SubstringPattern *pattern, const char *term) {
+    pattern->term = term;
+    pattern->length = strlen(term);
+}
+
+// Adds an entry to packed text
+int packedTextAppend(PackedText *packed, int row, const char *text, size_t length) {
+    if (packed->count == packed->entryCapacity) {
+        int capacity = packed->entryCapacity == 0 ? 1024 : packed->entryCapacity * 2;
+        unsigned int *starts = realloc(packed->starts, sizeof(unsigned int) * capacity);
+        if (starts == NULL) {
+            return 0;
+        }
+        packed->starts = starts;
+        int *rows = realloc(packed->rows, sizeof(int) * capacity);
+        if (rows == NULL) {
+            return 0;
+        }
+        packed->rows = rows;
+        packed->entryCapacity = capacity;
+    }
+    if (packed->size + length + 1 > packed->capacity) {
+        size_t capacity = packed->capacity == 0 ? 65536 : packed->capacity;
+        while (packed->size + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        if (capacity > 0xFFFFFFFFu) {
+            return 0;
+        }
+        char *data = realloc(packed->data, capacity);
+        if (data == NULL) {
+            return 0;
+        }
+        packed->data = data;
+        packed->capacity = capacity;
+    }
+    packed->starts[packed->count] = (unsigned int)packed->size;
+    packed->rows[packed->count] = row;
+    packed->count++;
+    memcpy(packed->data + packed->size, text, length);
+    packed->data[packed->size + length] = 0;
+    packed->size += length + 1;
+    return 1;
+}
+
+// Removes every entry but keeps the memory for reuse
+void packedTextClear(PackedText *packed) {
+    packed->size = 0;
+    packed->count = 0;
+}
+
+// Finds the rows with an entry that contains a term
+int scanPackedText(const SubstringPattern *pattern, const PackedText *packed, int *rows) {
+    PackedScan scan = { pattern, packed, rows, 0, 0 };
+    if (pattern->length > 0) {
+        substringKernel()(&scan, 0);
+        return scan.count;
+    }
+    for (int i = 0; i < packed->count; i++) {
+        if (scan.count == 0 || rows[scan.count - 1] != packed->rows[i]) {
+            rows[scan.count++] = packed->rows[i];
+        }
+    }
+    return scan.count;
+}
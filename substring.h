@@ -0,0 +1,74 @@
+#ifndef SUBSTRING_H
+#define SUBSTRING_H
+
+#include <stddef.h>
+
+// A term to look for, with its length worked out once
+typedef struct {
+    const char *term;
+    size_t length;
+} SubstringPattern;
+
+// The search keys of many rows copied back to back, each followed by a
+// NUL, so one pass over a single buffer checks every row. A row may have
+// several entries (one per field); entries are added in row order.
+typedef struct {
+    char *data;
+    size_t size;                // Bytes used in data
+    size_t capacity;            // Bytes allocated for data
+    unsigned int *starts;       // Offset of each entry in data
+    int *rows;                  // Row of each entry
+    int count;                  // Number of entries
+    int entryCapacity;          // Length of starts and rows
+} PackedText;
+
+#define PACKED_TEXT_INIT { NULL, 0, 0, NULL, NULL, 0, 0 }
+
+/**
+ * @brief Prepares a term for scanPackedText
+ * @param pattern Receives the prepared term
+ * @param term The term, which must outlive the pattern
+ * @return void
+ */
+void prepareSubstring(SubstringPattern *pattern, const char *term);
+
+/**
+ * @brief Adds an entry to packed text
+ * @param packed The packed text
+ * @param row Row the entry belongs to, not below the row of the last entry
+ * @param text The text of the entry
+ * @param length Length of the text
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int packedTextAppend(PackedText *packed, int row, const char *text, size_t length);
+
+/**
+ * @brief Removes every entry but keeps the memory for reuse
+ * @param packed The packed text
+ * @return void
+ */
+void packedTextClear(PackedText *packed);
+
+/**
+ * @brief Finds the rows with an entry that contains a term
+ * @param pattern The prepared term
+ * @param packed The packed text
+ * @param rows Receives each matching row once, in order; room for
+ *             packed->count rows
+ * @return int Number of matching rows
+ *
+ * The whole buffer is scanned as one text. Candidate positions are found
+ * by comparing the first and last byte of the term against 32 (AVX2) or
+ * 16 (SSE2) positions at once, picked by the processor the program runs
+ * on; only those are compared in full. After a match the scan resumes at
+ * the next entry.
+ */
+int scanPackedText(const SubstringPattern *pattern, const PackedText *packed, int *rows);
+
+/**
+ * @brief Names the instructions the scans use on this processor
+ * @return const char* "AVX2", "SSE2" or "scalar"
+ */
+const char *substringKernelName(void);
+
+#endif // SUBSTRING_H
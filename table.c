@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+#include "table.h"
+
+/**
+ * @brief Makes sure the table can hold at least the given number of rows
+ * @param table The table to grow
+ * @param rows Number of rows needed
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * New segments are appended one at a time, each twice as large as the
+ * previous one, so existing rows keep their address.
+ */
+int tableReserve(Table *table, int rows) {
+    while (table->capacity < rows) {
+        if (table->segmentCount >= TABLE_MAX_SEGMENTS) {
+            return 0;
+        }
+        size_t segmentRows = (size_t)TABLE_BASE_ROWS << table->segmentCount;
+        if ((size_t)table->capacity + segmentRows > 0x7fffffff) {
+            return 0;
+        }
+        char *segment = calloc(segmentRows, table->rowSize);
+        if (segment == NULL) {
+            return 0;
+        }
+        table->segments[table->segmentCount++] = segment;
+        table->capacity += (int)segmentRows;
+    }
+    return 1;
+}
+
+/**
+ * @brief Copies rows stored back to back into the start of the table
+ * @param table The table to fill
+ * @param rows The rows, table->rowSize bytes each
+ * @param count Number of rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Copies one run per segment instead of one row at a time.
+ */
+int tableLoadRows(Table *table, const void *rows, int count) {
+    if (!tableReserve(table, count)) {
+        return 0;
+    }
+    const char *source = rows;
+    int copied = 0;
+    for (int segment = 0; copied < count; segment++) {
+        int segmentRows = TABLE_BASE_ROWS << segment;
+        int run = count - copied < segmentRows ? count - copied : segmentRows;
+        memcpy(table->segments[segment], source, (size_t)run * table->rowSize);
+        source += (size_t)run * table->rowSize;
+        copied += run;
+    }
+    return 1;
+}
+
+/**
+ * @brief Releases every segment of the table
+ * @param table The table to free
+ * @return void
+ */
+void tableFree(Table *table) {
+    for (int i = 0; i < table->segmentCount; i++) {
+        free(table->segments[i]);
+        table->segments[i] = NULL;
+    }
+    table->segmentCount = 0;
+    table->capacity = 0;
+}
+
+/**
+ * @brief Reports the bytes allocated for the table's segments
+ * @param table The table to inspect
+ * @return size_t Allocated bytes
+ */
+size_t tableMemoryUsage(const Table *table) {
+    return (size_t)table->capacity * table->rowSize;
+}
@@ -0,0 +1,66 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stddef.h>
+
+// Number of rows in the first segment; every following segment doubles it
+#define TABLE_BASE_ROWS 64
+#define TABLE_MAX_SEGMENTS 32
+
+// Growable row storage shared by the book, reader and borrowing tables.
+// Rows live in segments that double in size, so growing the table never
+// moves an existing row and memory follows the number of rows in use.
+typedef struct {
+    size_t rowSize;                        // Size of one row in bytes
+    int capacity;                          // Rows available without growing
+    int segmentCount;                      // Number of allocated segments
+    char *segments[TABLE_MAX_SEGMENTS];    // Segment k holds TABLE_BASE_ROWS << k rows
+} Table;
+
+#define TABLE_INIT(type) { sizeof(type), 0, 0, { NULL } }
+
+/**
+ * @brief Makes sure the table can hold at least the given number of rows
+ * @param table The table to grow
+ * @param rows Number of rows needed
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int tableReserve(Table *table, int rows);
+
+/**
+ * @brief Copies rows stored back to back into the start of the table
+ * @param table The table to fill
+ * @param rows The rows, table->rowSize bytes each
+ * @param count Number of rows
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int tableLoadRows(Table *table, const void *rows, int count);
+
+/**
+ * @brief Releases every segment of the table
+ * @param table The table to free
+ * @return void
+ */
+void tableFree(Table *table);
+
+/**
+ * @brief Reports the bytes allocated for the table's segments
+ * @param table The table to inspect
+ * @return size_t Allocated bytes
+ */
+size_t tableMemoryUsage(const Table *table);
+
+/**
+ * @brief Returns the address of a row
+ * @param table The table holding the row
+ * @param index Row index, must be below the table capacity
+ * @return void* Pointer to the row, stable for the lifetime of the table
+ */
+static inline void *tableRow(const Table *table, int index) {
+    unsigned int block = (unsigned int)index / TABLE_BASE_ROWS + 1;
+    int segment = 31 - __builtin_clz(block);
+    size_t offset = (size_t)index - (size_t)TABLE_BASE_ROWS * ((1u << segment) - 1);
+    return table->segments[segment] + offset * table->rowSize;
+}
+
+#endif // TABLE_H
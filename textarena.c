@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include "textarena.h"
+
+/**
+ * @brief Moves on to the next chunk, allocating it if needed
+ * @param arena The arena
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int nextChunk(TextArena *arena) {
+    if (arena->chunkCount == (1 << (32 - TEXT_CHUNK_BITS))) {
+        return 0;
+    }
+    if (arena->chunkCount == arena->chunkCapacity) {
+        int capacity = arena->chunkCapacity == 0 ? 16 : arena->chunkCapacity * 2;
+        char **chunks = realloc(arena->chunks, sizeof(char *) * capacity);
+        if (chunks == NULL) {
+            return 0;
+        }
+        for (int i = arena->chunkCapacity; i < capacity; i++) {
+            chunks[i] = NULL;
+        }
+        arena->chunks = chunks;
+        arena->chunkCapacity = capacity;
+    }
+    // Chunks kept by arenaClear are reused before new ones are allocated;
+    // adopted chunks may be written to as their mapping is private
+    if (arena->chunks[arena->chunkCount] == NULL) {
+        arena->chunks[arena->chunkCount] = calloc(1, TEXT_CHUNK_SIZE);
+        if (arena->chunks[arena->chunkCount] == NULL) {
+            return 0;
+        }
+    }
+    arena->chunkCount++;
+    arena->used = 0;
+    return 1;
+}
+
+/**
+ * @brief Copies a string into the arena
+ * @param arena The arena
+ * @param text The string, shorter than TEXT_CHUNK_SIZE
+ * @param ref Receives the reference to the copy
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int arenaStore(TextArena *arena, const char *text, TextRef *ref) {
+    size_t length = strlen(text);
+    if (length == 0) {
+        ref->offset = 0;
+        ref->length = 0;
+        return 1;
+    }
+    if (length >= TEXT_CHUNK_SIZE) {
+        return 0;
+    }
+    if (arena->used + length + 1 > TEXT_CHUNK_SIZE && !nextChunk(arena)) {
+        return 0;
+    }
+    int chunk = arena->chunkCount - 1;
+    memcpy(arena->chunks[chunk] + arena->used, text, length + 1);
+    ref->offset = ((unsigned int)chunk << TEXT_CHUNK_BITS) | arena->used;
+    ref->length = (unsigned int)length;
+    arena->used += (unsigned int)length + 1;
+    arena->liveBytes += length + 1;
+    return 1;
+}
+
+/**
+ * @brief Stores a new string in place of an old one
+ * @param arena The arena
+ * @param ref The reference to update; the old string becomes garbage
+ * @param text The new string
+ * @return int 1 on success, 0 if memory could not be allocated (ref is kept)
+ */
+int arenaReplace(TextArena *arena, TextRef *ref, const char *text) {
+    TextRef replaced;
+    if (!arenaStore(arena, text, &replaced)) {
+        return 0;
+    }
+    arenaRelease(arena, *ref);
+    *ref = replaced;
+    return 1;
+}
+
+/**
+ * @brief Marks a string as no longer referenced
+ * @param arena The arena
+ * @param ref The reference to release
+ * @return void
+ */
+void arenaRelease(TextArena *arena, TextRef ref) {
+    if (ref.length > 0) {
+        arena->liveBytes -= ref.length + 1;
+        arena->garbageBytes += ref.length + 1;
+    }
+}
+
+/**
+ * @brief Forgets every string but keeps the chunks for reuse
+ * @param arena The arena
+ * @return void
+ */
+void arenaClear(TextArena *arena) {
+    arena->chunkCount = 0;
+    arena->used = TEXT_CHUNK_SIZE;
+    arena->liveBytes = 0;
+    arena->garbageBytes = 0;
+}
+
+/**
+ * @brief Takes over text written by arenaWrite without copying it
+ * @param arena The arena, must be empty
+ * @param data The written chunks, kept alive and writable by the caller
+ * @param size Number of bytes written
+ * @param liveBytes Bytes of strings in use, as reported when writing
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Full chunks are used in place; the last one is copied so new strings
+ * can be appended after it.
+ */
+int arenaAdopt(TextArena *arena, char *data, size_t size, size_t liveBytes) {
+    arenaFree(arena);
+    if (size == 0) {
+        return 1;
+    }
+    int fullChunks = (int)((size - 1) / TEXT_CHUNK_SIZE);
+    int capacity = 16;
+    while (capacity < fullChunks + 1) {
+        capacity *= 2;
+    }
+    char **chunks = calloc(capacity, sizeof(char *));
+    char *last = malloc(TEXT_CHUNK_SIZE);
+    if (chunks == NULL || last == NULL) {
+        free(chunks);
+        free(last);
+        return 0;
+    }
+    for (int i = 0; i < fullChunks; i++) {
+        chunks[i] = data + (size_t)i * TEXT_CHUNK_SIZE;
+    }
+    unsigned int used = (unsigned int)(size - (size_t)fullChunks * TEXT_CHUNK_SIZE);
+    memcpy(last, data + (size_t)fullChunks * TEXT_CHUNK_SIZE, used);
+    chunks[fullChunks] = last;
+
+    arena->chunks = chunks;
+    arena->chunkCount = fullChunks + 1;
+    arena->chunkCapacity = capacity;
+    arena->adoptedChunks = fullChunks;
+    arena->used = used;
+    arena->liveBytes = liveBytes;
+    arena->garbageBytes = 0;
+    return 1;
+}
+
+/**
+ * @brief Writes the used part of every chunk, back to back
+ * @param arena The arena
+ * @param write Callback receiving each run of bytes
+ * @param context Passed through to the callback
+ * @return int 1 if every write succeeded, 0 otherwise
+ *
+ * Every chunk but the last is written in full, so references stay valid
+ * for an arena that adopts the output.
+ */
+int arenaWrite(const TextArena *arena, int (*write)(void *context, const void *data, size_t size), void *context) {
+    for (int i = 0; i < arena->chunkCount; i++) {
+        size_t size = i == arena->chunkCount - 1 ? arena->used : TEXT_CHUNK_SIZE;
+        if (!write(context, arena->chunks[i], size)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns the number of bytes arenaWrite produces
+ * @param arena The arena
+ * @return size_t Bytes of text data
+ */
+size_t arenaDataSize(const TextArena *arena) {
+    if (arena->chunkCount == 0) {
+        return 0;
+    }
+    return (size_t)(arena->chunkCount - 1) * TEXT_CHUNK_SIZE + arena->used;
+}
+
+/**
+ * @brief Releases the chunks the arena allocated itself
+ * @param arena The arena
+ * @return void
+ */
+void arenaFree(TextArena *arena) {
+    for (int i = arena->adoptedChunks; i < arena->chunkCapacity; i++) {
+        free(arena->chunks[i]);
+    }
+    free(arena->chunks);
+    TextArena empty = TEXT_ARENA_INIT;
+    *arena = empty;
+}
+
+/**
+ * @brief Reports the bytes allocated by the arena
+ * @param arena The arena
+ * @return size_t Bytes of allocated chunks and the chunk list
+ */
+size_t arenaMemoryUsage(const TextArena *arena) {
+    size_t bytes = sizeof(char *) * (size_t)arena->chunkCapacity;
+    for (int i = 0; i < arena->chunkCapacity; i++) {
+        if (arena->chunks[i] != NULL) {
+            bytes += TEXT_CHUNK_SIZE;
+        }
+    }
+    return bytes;
+}
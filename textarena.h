@@ -0,0 +1,125 @@
+#ifndef TEXTARENA_H
+#define TEXTARENA_H
+
+#include <stddef.h>
+
+// Bytes per arena chunk; a reference packs the chunk number above these bits
+#define TEXT_CHUNK_BITS 16
+#define TEXT_CHUNK_SIZE (1u << TEXT_CHUNK_BITS)
+
+// Reference to a string stored in a text arena. A zeroed reference is the
+// empty string, so freshly cleared rows need no extra setup.
+typedef struct {
+    unsigned int offset;    // Chunk number and position of the first byte
+    unsigned int length;    // Length in bytes, without the terminator
+} TextRef;
+
+// Append-only storage for the variable-length text of table rows. Strings
+// are kept NUL-terminated in fixed-size chunks that never move, so the
+// pointer returned by arenaText stays valid until the arena is cleared.
+// Replaced strings are not reclaimed; their bytes are only counted.
+typedef struct {
+    char **chunks;          // Allocated chunks
+    int chunkCount;         // Number of chunks in use
+    int chunkCapacity;      // Length of chunks
+    int adoptedChunks;      // Leading chunks that belong to a loaded snapshot
+    unsigned int used;      // Bytes used in the last chunk
+    size_t liveBytes;       // Bytes of strings still referenced
+    size_t garbageBytes;    // Bytes of strings that were replaced
+} TextArena;
+
+#define TEXT_ARENA_INIT { NULL, 0, 0, 0, TEXT_CHUNK_SIZE, 0, 0 }
+
+/**
+ * @brief Copies a string into the arena
+ * @param arena The arena
+ * @param text The string, shorter than TEXT_CHUNK_SIZE
+ * @param ref Receives the reference to the copy
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int arenaStore(TextArena *arena, const char *text, TextRef *ref);
+
+/**
+ * @brief Stores a new string in place of an old one
+ * @param arena The arena
+ * @param ref The reference to update; the old string becomes garbage
+ * @param text The new string
+ * @return int 1 on success, 0 if memory could not be allocated (ref is kept)
+ */
+int arenaReplace(TextArena *arena, TextRef *ref, const char *text);
+
+/**
+ * @brief Marks a string as no longer referenced
+ * @param arena The arena
+ * @param ref The reference to release
+ * @return void
+ */
+void arenaRelease(TextArena *arena, TextRef ref);
+
+/**
+ * @brief Forgets every string but keeps the chunks for reuse
+ * @param arena The arena
+ * @return void
+ */
+void arenaClear(TextArena *arena);
+
+/**
+ * @brief Takes over text written by arenaWrite without copying it
+ * @param arena The arena, must be empty
+ * @param data The written chunks, kept alive and writable by the caller
+ * @param size Number of bytes written
+ * @param liveBytes Bytes of strings in use, as reported when writing
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Full chunks are used in place; the last one is copied so new strings
+ * can be appended after it.
+ */
+int arenaAdopt(TextArena *arena, char *data, size_t size, size_t liveBytes);
+
+/**
+ * @brief Writes the used part of every chunk, back to back
+ * @param arena The arena
+ * @param write Callback receiving each run of bytes
+ * @param context Passed through to the callback
+ * @return int 1 if every write succeeded, 0 otherwise
+ *
+ * Every chunk but the last is written in full, so references stay valid
+ * for an arena that adopts the output.
+ */
+int arenaWrite(const TextArena *arena, int (*write)(void *context, const void *data, size_t size), void *context);
+
+/**
+ * @brief Returns the number of bytes arenaWrite produces
+ * @param arena The arena
+ * @return size_t Bytes of text data
+ */
+size_t arenaDataSize(const TextArena *arena);
+
+/**
+ * @brief Releases the chunks the arena allocated itself
+ * @param arena The arena
+ * @return void
+ */
+void arenaFree(TextArena *arena);
+
+/**
+ * @brief Reports the bytes allocated by the arena
+ * @param arena The arena
+ * @return size_t Bytes of allocated chunks and the chunk list
+ */
+size_t arenaMemoryUsage(const TextArena *arena);
+
+/**
+ * @brief Returns the text of a reference
+ * @param arena The arena holding the string
+ * @param ref The reference
+ * @return const char* The NUL-terminated string
+ */
+static inline const char *arenaText(const TextArena *arena, TextRef ref) {
+    if (ref.length == 0) {
+        return "";
+    }
+    return arena->chunks[ref.offset >> TEXT_CHUNK_BITS] + (ref.offset & (TEXT_CHUNK_SIZE - 1));
+}
+
+#endif // TEXTARENA_H
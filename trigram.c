@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <string.h>
+#include "trigram.h"
+
+#define INITIAL_CAPACITY 1024
+
+/**
+ * @brief Packs three bytes into a trigram code
+ * @param text Pointer to the first byte
+ * @return unsigned int The code, never 0
+ */
+static unsigned int trigramCode(const char *text) {
+    return (((unsigned int)(unsigned char)text[0] << 16) |
+            ((unsigned int)(unsigned char)text[1] << 8) |
+            (unsigned int)(unsigned char)text[2]) + 1;
+}
+
+static unsigned int hashCode(unsigned int code) {
+    return code * 2654435761u;
+}
+
+static int compareCodes(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *)a;
+    unsigned int y = *(const unsigned int *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Collects the distinct trigrams of a text
+ * @param text The text
+ * @param codes Receives the codes, must hold strlen(text) entries
+ * @return int Number of distinct trigrams
+ */
+static int distinctTrigrams(const char *text, unsigned int *codes) {
+    int length = (int)strlen(text);
+    int count = 0;
+    for (int i = 0; i + 3 <= length; i++) {
+        codes[count++] = trigramCode(text + i);
+    }
+    qsort(codes, count, sizeof(unsigned int), compareCodes);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct == 0 || codes[distinct - 1] != codes[i]) {
+            codes[distinct++] = codes[i];
+        }
+    }
+    return distinct;
+}
+
+/**
+ * @brief Finds the slot of a trigram
+ * @param index The trigram index
+ * @param code The trigram code
+ * @return int Slot holding the trigram or the empty slot where it belongs
+ */
+static int findSlot(const TrigramIndex *index, unsigned int code) {
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int slot = hashCode(code) & mask;
+    while (index->codes[slot] != 0 && index->codes[slot] != code) {
+        slot = (slot + 1) & mask;
+    }
+    return (int)slot;
+}
+
+/**
+ * @brief Doubles the number of slots
+ * @param index The trigram index
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+static int grow(TrigramIndex *index) {
+    int capacity = index->capacity == 0 ? INITIAL_CAPACITY : index->capacity * 2;
+    unsigned int *codes = calloc(capacity, sizeof(unsigned int));
+    PostingList *lists = calloc(capacity, sizeof(PostingList));
+    if (codes == NULL || lists == NULL) {
+        free(codes);
+        free(lists);
+        return 0;
+    }
+    TrigramIndex grown = { codes, lists, capacity, index->size };
+    for (int i = 0; i < index->capacity; i++) {
+        if (index->codes[i] != 0) {
+            int slot = findSlot(&grown, index->codes[i]);
+            codes[slot] = index->codes[i];
+            lists[slot] = index->lists[i];
+        }
+    }
+    free(index->codes);
+    free(index->lists);
+    *index = grown;
+    return 1;
+}
+
+/**
+ * @brief Finds the position of a row in a posting list
+ * @param list The posting list
+ * @param row The row number
+ * @return int Position of the row, or of the first larger row
+ */
+static int lowerBound(const PostingList *list, int row) {
+    int low = 0;
+    int high = list->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (list->rows[middle] < row) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Inserts a row into a posting list, keeping it sorted
+ * @param list The posting list
+ * @param row The row number
+ * @return int 1 on success, 0 if memory could not be allocated
+ *
+ * Rows are usually added in increasing order, which appends at the end.
+ */
+static int postingInsert(PostingList *list, int row) {
+    int position = list->count;
+    if (position > 0 && list->rows[position - 1] >= row) {
+        position = lowerBound(list, row);
+        if (position < list->count && list->rows[position] == row) {
+            return 1;
+        }
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        int *rows = realloc(list->rows, sizeof(int) * capacity);
+        if (rows == NULL) {
+            return 0;
+        }
+        list->rows = rows;
+        list->capacity = capacity;
+    }
+    memmove(list->rows + position + 1, list->rows + position, sizeof(int) * (list->count - position));
+    list->rows[position] = row;
+    list->count++;
+    return 1;
+}
+
+/**
+ * @brief Adds a row under every trigram of its text
+ * @param index The trigram index
+ * @param text The indexed text of the row
+ * @param row The row number
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int trigramIndexAdd(TrigramIndex *index, const char *text, int row) {
+    unsigned int codes[strlen(text) + 1];
+    int count = distinctTrigrams(text, codes);
+    for (int i = 0; i < count; i++) {
+        if ((index->size + 1) * 4 > index->capacity * 3 && !grow(index)) {
+            return 0;
+        }
+        int slot = findSlot(index, codes[i]);
+        if (index->codes[slot] == 0) {
+            index->codes[slot] = codes[i];
+            index->size++;
+        }
+        if (!postingInsert(&index->lists[slot], row)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Removes a row from the posting lists of its text
+ * @param index The trigram index
+ * @param text The text the row was indexed with
+ * @param row The row number
+ * @return void
+ *
+ * Trigrams whose list becomes empty keep their slot.
+ */
+void trigramIndexRemove(TrigramIndex *index, const char *text, int row) {
+    if (index->capacity == 0) {
+        return;
+    }
+    unsigned int codes[strlen(text) + 1];
+    int count = distinctTrigrams(text, codes);
+    for (int i = 0; i < count; i++) {
+        int slot = findSlot(index, codes[i]);
+        if (index->codes[slot] == 0) {
+            continue;
+        }
+        PostingList *list = &index->lists[slot];
+        int position = lowerBound(list, row);
+        if (position < list->count && list->rows[position] == row) {
+            memmove(list->rows + position, list->rows + position + 1, sizeof(int) * (list->count - position - 1));
+            list->count--;
+        }
+    }
+}
+
+/**
+ * @brief Removes every row but keeps the trigram slots
+ * @param index The trigram index
+ * @return void
+ */
+void trigramIndexClear(TrigramIndex *index) {
+    for (int i = 0; i < index->capacity; i++) {
+        index->lists[i].count = 0;
+    }
+}
+
+// Orders posting lists from shortest to longest
+static int compareLists(const void *a, const void *b) {
+    int x = (*(const PostingList *const *)a)->count;
+    int y = (*(const PostingList *const *)b)->count;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Finds the rows that may contain a substring
+ * @param index The trigram index
+ * @param term The substring to look for
+ * @param rows Receives a malloc'd array of candidate rows in row order
+ * @return int Number of candidates, or -1 if the term is shorter than a
+ *             trigram and every row has to be checked
+ *
+ * The shortest posting list is copied and then filtered against each
+ * longer list with a binary search that only moves forward.
+ */
+int trigramIndexQuery(const TrigramIndex *index, const char *term, int **rows) {
+    *rows = NULL;
+    if (strlen(term) < 3) {
+        return -1;
+    }
+    if (index->capacity == 0) {
+        return 0;
+    }
+
+    unsigned int codes[strlen(term) + 1];
+    int count = distinctTrigrams(term, codes);
+    const PostingList *lists[count];
+    for (int i = 0; i < count; i++) {
+        int slot = findSlot(index, codes[i]);
+        if (index->codes[slot] == 0 || index->lists[slot].count == 0) {
+            return 0;
+        }
+        lists[i] = &index->lists[slot];
+    }
+    qsort(lists, count, sizeof(lists[0]), compareLists);
+
+    int *result = malloc(sizeof(int) * lists[0]->count);
+    if (result == NULL) {
+        return -1;
+    }
+    memcpy(result, lists[0]->rows, sizeof(int) * lists[0]->count);
+    int resultCount = lists[0]->count;
+
+    for (int i = 1; i < count && resultCount > 0; i++) {
+        const PostingList *list = lists[i];
+        int kept = 0;
+        int position = 0;
+        for (int j = 0; j < resultCount; j++) {
+            int low = position;
+            int high = list->count;
+            while (low < high) {
+                int middle = (low + high) / 2;
+                if (list->rows[middle] < result[j]) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            position = low;
+            if (position == list->count) {
+                break;
+            }
+            if (list->rows[position] == result[j]) {
+                result[kept++] = result[j];
+            }
+        }
+        resultCount = kept;
+    }
+
+    *rows = result;
+    return resultCount;
+}
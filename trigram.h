@@ -0,0 +1,63 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+// Sorted list of rows containing one trigram
+typedef struct {
+    int *rows;
+    int count;
+    int capacity;
+} PostingList;
+
+// Inverted index from every 3-byte sequence of a text field to the rows
+// whose text contains it. A substring query of three or more bytes can
+// only match rows that appear in the posting list of each of its
+// trigrams, so searches intersect those lists and only verify the rows
+// that survive.
+typedef struct {
+    unsigned int *codes;    // Trigram stored in each slot, 0 when empty
+    PostingList *lists;     // Posting list of each slot
+    int capacity;           // Number of slots, always a power of two
+    int size;               // Number of distinct trigrams
+} TrigramIndex;
+
+#define TRIGRAM_INDEX_INIT { NULL, NULL, 0, 0 }
+
+/**
+ * @brief Adds a row under every trigram of its text
+ * @param index The trigram index
+ * @param text The indexed text of the row
+ * @param row The row number
+ * @return int 1 on success, 0 if memory could not be allocated
+ */
+int trigramIndexAdd(TrigramIndex *index, const char *text, int row);
+
+/**
+ * @brief Removes a row from the posting lists of its text
+ * @param index The trigram index
+ * @param text The text the row was indexed with
+ * @param row The row number
+ * @return void
+ */
+void trigramIndexRemove(TrigramIndex *index, const char *text, int row);
+
+/**
+ * @brief Removes every row but keeps the trigram slots
+ * @param index The trigram index
+ * @return void
+ */
+void trigramIndexClear(TrigramIndex *index);
+
+/**
+ * @brief Finds the rows that may contain a substring
+ * @param index The trigram index
+ * @param term The substring to look for
+ * @param rows Receives a malloc'd array of candidate rows in row order
+ * @return int Number of candidates, or -1 if the term is shorter than a
+ *             trigram and every row has to be checked
+ *
+ * Candidates contain every trigram of the term but may still not contain
+ * the term itself, so callers verify each one.
+ */
+int trigramIndexQuery(const TrigramIndex *index, const char *term, int **rows);
+
+#endif // TRIGRAM_H